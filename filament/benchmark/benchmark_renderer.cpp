@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <filament/Camera.h>
+#include <filament/Engine.h>
+#include <filament/Fence.h>
+#include <filament/IndexBuffer.h>
+#include <filament/Material.h>
+#include <filament/RenderableManager.h>
+#include <filament/Renderer.h>
+#include <filament/Scene.h>
+#include <filament/TransformManager.h>
+#include <filament/VertexBuffer.h>
+#include <filament/View.h>
+
+#include <utils/Entity.h>
+#include <utils/EntityManager.h>
+
+#include <math/mat4.h>
+#include <math/vec3.h>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+using namespace filament;
+using namespace filament::math;
+using namespace utils;
+
+static const float3 TRIANGLE_VERTICES[3] = {{ -1, -1, 0 }, { 1, -1, 0 }, { 0, 1, 0 }};
+static constexpr uint16_t TRIANGLE_INDICES[3] = { 0, 1, 2 };
+
+static constexpr const char* STAGE_NAMES[Renderer::CPU_STAGE_COUNT] = {
+        "scenePrepare", "culling", "froxelization", "commandGeneration", "sort", "recording",
+        "driver"
+};
+
+// Renders a scene of state.range(0) triangles on the noop backend and reports the CPU counters
+// of each stage of the frame.
+static void renderFrame(benchmark::State& state) {
+    Engine* engine = Engine::create(Engine::Backend::NOOP);
+    if (!engine) {
+        state.SkipWithError("the noop backend is only available in debug builds");
+        return;
+    }
+
+    SwapChain* swapChain = engine->createSwapChain(nullptr);
+    Renderer* renderer = engine->createRenderer();
+    Scene* scene = engine->createScene();
+    View* view = engine->createView();
+    Camera* camera = engine->createCamera();
+    camera->setProjection(45.0, 1.0, 0.1, 1000.0);
+    view->setCamera(camera);
+    view->setScene(scene);
+    view->setViewport({ 0, 0, 1280, 720 });
+
+    VertexBuffer* vb = VertexBuffer::Builder()
+            .vertexCount(3)
+            .bufferCount(1)
+            .attribute(VertexAttribute::POSITION, 0, VertexBuffer::AttributeType::FLOAT3)
+            .build(*engine);
+    vb->setBufferAt(*engine, 0,
+            VertexBuffer::BufferDescriptor(TRIANGLE_VERTICES, sizeof(TRIANGLE_VERTICES)));
+    IndexBuffer* ib = IndexBuffer::Builder()
+            .indexCount(3)
+            .bufferType(IndexBuffer::IndexType::USHORT)
+            .build(*engine);
+    ib->setBuffer(*engine,
+            IndexBuffer::BufferDescriptor(TRIANGLE_INDICES, sizeof(TRIANGLE_INDICES)));
+
+    // a grid of triangles in front of the camera
+    const size_t count = size_t(state.range(0));
+    const size_t side = size_t(std::ceil(std::sqrt(double(count))));
+    std::vector<Entity> renderables(count);
+    EntityManager::get().create(count, renderables.data());
+    TransformManager& tcm = engine->getTransformManager();
+    for (size_t i = 0; i < count; i++) {
+        RenderableManager::Builder(1)
+                .boundingBox({{ -1, -1, -1 }, { 1, 1, 1 }})
+                .material(0, engine->getDefaultMaterial()->getDefaultInstance())
+                .geometry(0, RenderableManager::PrimitiveType::TRIANGLES, vb, ib)
+                .build(*engine, renderables[i]);
+        tcm.create(renderables[i], {}, mat4f::translate(float3{
+                float(i % side) - side * 0.5f, float(i / side) - side * 0.5f, -float(side) }));
+        scene->addEntity(renderables[i]);
+    }
+
+    renderer->setCpuCountersEnabled(true);
+    renderer->resetCpuCounters();
+    for (auto _ : state) {
+        if (renderer->beginFrame(swapChain)) {
+            renderer->render(view);
+            renderer->endFrame();
+        }
+    }
+    // the driver stage is sampled on the driver thread, wait for it
+    Fence::waitAndDestroy(engine->createFence());
+    renderer->setCpuCountersEnabled(false);
+
+    for (size_t i = 0; i < Renderer::CPU_STAGE_COUNT; i++) {
+        Renderer::CpuCounters c = renderer->getCpuCounters(Renderer::CpuStage(i));
+        const std::string name(STAGE_NAMES[i]);
+        state.counters.insert({
+                { name + ".us",   { c.samples ? c.time * 1e-3 / c.samples : 0.0 }},
+                { name + ".IPC",  { c.getIPC() }},
+                { name + ".L1D",  { c.getL1DMissRate() }},
+                { name + ".L1I",  { c.getL1IMissRate() }},
+                { name + ".BPU",  { c.getBranchMissRate() }},
+        });
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+
+    for (Entity e : renderables) {
+        engine->destroy(e);
+    }
+    EntityManager::get().destroy(count, renderables.data());
+    engine->destroy(ib);
+    engine->destroy(vb);
+    engine->destroy(camera);
+    engine->destroy(view);
+    engine->destroy(scene);
+    engine->destroy(renderer);
+    engine->destroy(swapChain);
+    Engine::destroy(&engine);
+}
+
+BENCHMARK(renderFrame)->Arg(256)->Arg(4096)->Unit(benchmark::kMicrosecond);
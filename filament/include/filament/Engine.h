@@ -26,11 +26,18 @@
 #include <utils/compiler.h>
 #include <utils/EntityManager.h>
 
+#include <stdint.h>
+
+namespace utils {
+class JobSystem;
+} // namespace utils
+
 namespace filament {
 
 class Camera;
 class DebugRegistry;
 class Fence;
+class GeometryArena;
 class IndexBuffer;
 class IndirectLight;
 class Material;
@@ -145,6 +152,80 @@ public:
     using Platform = driver::Platform;
     using Backend = driver::Backend;
 
+    /**
+     * Engine configuration, used to tune memory and threading resources at creation time.
+     *
+     * All sizes are in MiB. A value of 0 selects filament's default, which is the value
+     * documented for each field.
+     *
+     * @see Engine::create()
+     */
+    struct Config {
+        /**
+         * Size of the circular buffer used to send commands to the driver thread. Default
+         * is 3 MiB. If it isn't larger than minCommandBufferSizeMB, three times that value
+         * is used instead.
+         */
+        uint32_t commandBufferSizeMB = 0;
+
+        /**
+         * Space that must be available in the command buffer after each flush. When less than
+         * this is available, the main thread blocks until the driver thread catches up.
+         * This must be at least the size of the commands generated in a frame. Default is 1 MiB.
+         */
+        uint32_t minCommandBufferSizeMB = 0;
+
+        /**
+         * Size of the per-render-pass arena, which holds the high-level draw commands
+         * and the froxelization data. Default is 2 MiB. It is increased if needed, so it can
+         * hold perFrameCommandsSizeMB plus 1 MiB.
+         */
+        uint32_t perRenderPassArenaSizeMB = 0;
+
+        /**
+         * Size of the high-level draw commands buffer, allocated from the per-render-pass
+         * arena. Default is 1 MiB.
+         */
+        uint32_t perFrameCommandsSizeMB = 0;
+
+        /**
+         * Number of worker threads of the JobSystem created by the Engine. Default is
+         * automatically selected for the platform. Ignored if jobSystem is set.
+         */
+        uint32_t jobSystemThreadCount = 0;
+
+        /**
+         * CPU the driver thread is pinned to. -1 (the default) selects the highest numbered
+         * core, which is typically a big core in a big.LITTLE configuration.
+         */
+        int32_t driverThreadAffinity = -1;
+
+        /**
+         * An external JobSystem to use instead of creating one. This allows several Engines to
+         * share the same worker threads. The JobSystem must outlive all Engines using it
+         * and must have an adoptable slot for each thread creating an Engine. A thread that the
+         * JobSystem didn't own before the Engine was created is emancipated at shutdown, its
+         * adoptable slot isn't reused.
+         * Default is nullptr, in which case each Engine creates its own JobSystem.
+         */
+        utils::JobSystem* jobSystem = nullptr;
+
+        /**
+         * Path of a file to which the commands sent to the driver are written, for replaying
+         * them later with the replay tool. The path is copied. Default is nullptr, which
+         * disables the capture.
+         */
+        const char* driverCapturePath = nullptr;
+
+        /**
+         * Existing directory in which the OpenGL backend caches the binaries of the programs it
+         * links, so that later runs skip compiling and linking them. The path is copied.
+         * It is used by the default blob cache of the Platform, a Platform providing its own
+         * cache ignores it. Default is nullptr, which disables the default cache.
+         */
+        const char* programCachePath = nullptr;
+    };
+
     /**
      * Creates an instance of Engine
      *
@@ -166,6 +247,8 @@ public:
      *                          Setting this parameter will force filament to use the OpenGL
      *                          implementation (instead of Vulkan for instance).
      *
+     *  @param config           An optional Config used to tune the Engine's memory and threading
+     *                          resources. If nullptr, default values are used.
      *
      * @return A pointer to the newly created Engine, or nullptr if the Engine couldn't be created.
      *
@@ -180,7 +263,8 @@ public:
      * This method is thread-safe.
      */
     static Engine* create(Backend backend = Backend::DEFAULT,
-            Platform* platform = nullptr, void* sharedGLContext = nullptr);
+            Platform* platform = nullptr, void* sharedGLContext = nullptr,
+            const Config* config = nullptr);
 
     /**
      * Destroy the Engine instance and all associated resources.
@@ -272,6 +356,7 @@ public:
     void destroy(const VertexBuffer* p);        //!< Destroys an VertexBuffer object.
     void destroy(const Fence* p);               //!< Destroys a Fence object.
     void destroy(const IndexBuffer* p);         //!< Destroys an IndexBuffer object.
+    void destroy(const GeometryArena* p);       //!< Destroys a GeometryArena and its buffers.
     void destroy(const IndirectLight* p);       //!< Destroys an IndirectLight object.
 
     /**
@@ -344,6 +429,70 @@ public:
 
     DebugRegistry& getDebugRegistry() noexcept;
 
+    /**
+     * Returns the JobSystem used by this Engine. This is either the JobSystem specified in
+     * Config::jobSystem or the Engine's own.
+     */
+    utils::JobSystem& getJobSystem() noexcept;
+
+    /**
+     * Sets the GPU memory budget of the streamed textures. When it is exceeded, the least
+     * recently used textures are brought back to their coarsest levels, and finer levels are
+     * only loaded if they fit. The default is 256 MiB.
+     *
+     * @param bytes Memory budget in bytes.
+     *
+     * @see Texture::setStreamingSource()
+     */
+    void setTextureStreamingBudget(size_t bytes) noexcept;
+
+    //! Returns the GPU memory budget of the streamed textures in bytes.
+    size_t getTextureStreamingBudget() const noexcept;
+
+    /**
+     * Creates the materials built with Material::Builder::buildAsync() that are ready, in the
+     * order they were requested, and calls their callbacks. This is done by
+     * Renderer::beginFrame() as well, so it is only needed to get materials before the next
+     * frame, e.g. while loading a level.
+     *
+     * @param wait If true, waits for all the materials being built rather than stopping at
+     *             the first one that isn't ready.
+     *
+     * @see Material::Builder::buildAsync()
+     */
+    void publishMaterials(bool wait = false) noexcept;
+
+    //! Memory used by one of the Engine's subsystems, in bytes.
+    struct MemoryUsage {
+        size_t current = 0;     //!< memory in use
+        size_t peak = 0;        //!< most memory in use so far
+        size_t reserved = 0;    //!< memory allocated, used or not
+    };
+
+    /**
+     * Memory used by the Engine, per subsystem. The CPU side is exact, the GPU side is an
+     * estimate from the sizes and formats of the resources, the actual usage depends on the
+     * backend.
+     *
+     * Peaks of the scenes and components are sampled once per frame and when the statistics
+     * are queried.
+     */
+    struct MemoryStats {
+        MemoryUsage perRenderPassArena; //!< transient per-frame data, summed over all Renderers
+        MemoryUsage commandBuffer;      //!< commands waiting for the driver thread
+        MemoryUsage handles;            //!< backend objects
+        MemoryUsage scenes;             //!< renderable and light data of all Scenes
+        MemoryUsage components;         //!< transform, renderable and light components
+        MemoryUsage renderTargetPool;   //!< GPU, cached and in-use render targets
+        MemoryUsage textures;           //!< GPU, resident levels of all Textures
+        MemoryUsage buffers;            //!< GPU, all VertexBuffers and IndexBuffers
+    };
+
+    /**
+     * Returns the memory used by the Engine. This is cheap enough to be called every frame.
+     */
+    MemoryStats getMemoryStats() const noexcept;
+
 protected:
     //! \privatesection
     Engine() noexcept = default;
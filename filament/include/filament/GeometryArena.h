@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_GEOMETRYARENA_H
+#define TNT_FILAMENT_GEOMETRYARENA_H
+
+#include <filament/EngineEnums.h>
+#include <filament/FilamentAPI.h>
+#include <filament/IndexBuffer.h>
+#include <filament/VertexBuffer.h>
+
+#include <filament/driver/BufferDescriptor.h>
+
+#include <utils/compiler.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace filament {
+
+namespace details {
+class FGeometryArena;
+} // namespace details
+
+class Engine;
+
+/**
+ * Suballocates the geometry of many small meshes from a single VertexBuffer and IndexBuffer.
+ *
+ * All the meshes of an arena share the same vertex layout, declared with the Builder as a single
+ * interleaved buffer, and use 32-bit indices. Each mesh gets an Allocation, a range of vertices
+ * and a range of indices, which is passed to RenderableManager::Builder::geometry(). Renderables
+ * drawn from the same arena share its buffers.
+ *
+ * Freed ranges are merged with their free neighbours, so the arena doesn't fragment when meshes
+ * are streamed in and out. Live allocations are never moved.
+ */
+class UTILS_PUBLIC GeometryArena : public FilamentAPI {
+    struct BuilderDetails;
+
+public:
+    using AttributeType = VertexBuffer::AttributeType;
+    using IndexType = IndexBuffer::IndexType;
+    using BufferDescriptor = driver::BufferDescriptor;
+
+    struct Allocation {
+        uint32_t firstVertex = 0;
+        uint32_t vertexCount = 0;
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+
+        // false if the arena didn't have room for the allocation
+        explicit operator bool() const noexcept { return indexCount != 0; }
+    };
+
+    class Builder : public BuilderBase<BuilderDetails> {
+        friend struct BuilderDetails;
+    public:
+        Builder() noexcept;
+        Builder(Builder const& rhs) noexcept;
+        Builder(Builder&& rhs) noexcept;
+        ~Builder() noexcept;
+        Builder& operator=(Builder const& rhs) noexcept;
+        Builder& operator=(Builder&& rhs) noexcept;
+
+        // capacity of the arena, in vertices and in indices
+        Builder& vertexCount(uint32_t vertexCount) noexcept;
+        Builder& indexCount(uint32_t indexCount) noexcept;
+
+        // attributes of the interleaved vertex buffer, no-op if attribute is an invalid enum.
+        // All the attributes share the largest stride, which is at least the end of the last
+        // attribute.
+        Builder& attribute(VertexAttribute attribute,
+                AttributeType attributeType,
+                uint32_t byteOffset = 0,
+                uint8_t byteStride = 0) noexcept;     // default is the size of a vertex
+
+        // no-op if attribute is an invalid enum
+        Builder& normalized(VertexAttribute attribute, bool normalize = true) noexcept;
+
+        /**
+         * Creates the GeometryArena object and returns a pointer to it.
+         *
+         * @param engine Reference to the filament::Engine to associate this GeometryArena with.
+         *
+         * @return pointer to the newly created object or nullptr if exceptions are disabled and
+         *         an error occurred.
+         *
+         * @exception utils::PostConditionPanic if a runtime error occurred, such as running out of
+         *            memory or other resources.
+         * @exception utils::PreConditionPanic if a parameter to a builder function was invalid.
+         */
+        GeometryArena* build(Engine& engine);
+
+    private:
+        friend class details::FGeometryArena;
+    };
+
+    /**
+     * Reserves vertexCount vertices and indexCount indices.
+     *
+     * @return the allocated ranges, which evaluate to false if the arena is full.
+     */
+    Allocation allocate(uint32_t vertexCount, uint32_t indexCount) noexcept;
+
+    /**
+     * Returns the ranges of an allocation to the arena. Renderables using it must have been
+     * destroyed or given another geometry.
+     */
+    void free(Allocation const& allocation) noexcept;
+
+    /**
+     * Uploads the interleaved vertices of an allocation, at most allocation.vertexCount of them.
+     */
+    void setVertices(Engine& engine, Allocation const& allocation, BufferDescriptor&& vertices);
+
+    /**
+     * Uploads the indices of an allocation, at most allocation.indexCount of them.
+     *
+     * Indices are relative to the first vertex of the allocation. They're rebased to the arena's
+     * vertex buffer on the CPU, so the buffer's callback is called before this returns.
+     */
+    void setIndices(Engine& engine, Allocation const& allocation, BufferDescriptor&& indices,
+            IndexType indexType = IndexType::UINT);
+
+    VertexBuffer* getVertexBuffer() const noexcept;
+    IndexBuffer* getIndexBuffer() const noexcept;
+
+    size_t getFreeVertexCount() const noexcept;
+    size_t getFreeIndexCount() const noexcept;
+};
+
+} // namespace filament
+
+#endif // TNT_FILAMENT_GEOMETRYARENA_H
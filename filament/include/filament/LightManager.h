@@ -159,6 +159,17 @@ public:
      */
     Instance getInstance(utils::Entity e) const noexcept;
 
+    /**
+     * Gets the Instances of the Light components associated with several Entities at once.
+     * This is equivalent to, but faster than, calling getInstance() for each Entity.
+     * @param entities  An array of \p count Entities.
+     * @param instances An array of \p count Instances that receives the result. An Entity without
+     *                  a Light component gets an invalid Instance.
+     * @param count     Number of Entities.
+     * @see getInstance()
+     */
+    void getInstances(utils::Entity const* entities, Instance* instances, size_t count) const noexcept;
+
     // destroys this component from the given entity
     void destroy(utils::Entity e) noexcept;
 
@@ -210,6 +221,63 @@ public:
          * use the camera far distance.
          */
         float shadowFarHint = 100.0f;
+
+        /** Number of shadow cascades to use for directional lights, between 1 and 4.
+         * Each cascade covers a range of the camera's depth with its own shadow map, stored side
+         * by side in the same texture; this improves the quality of shadows close to the camera
+         * without increasing mapSize. Cascades are ignored for other types of light.
+         * The texture is at most 4096 texels wide, mapSize is reduced to fit all the cascades.
+         * @see cascadeSplitPositions
+         */
+        uint8_t shadowCascades = 1;
+
+        /** Where the cascades are split, as fractions of the shadowed depth range, i.e. between
+         * the camera's near plane and shadowFar (or the camera's far plane). Only the first
+         * shadowCascades - 1 values are used, they must be strictly increasing and in ]0, 1[.
+         * @see ShadowCascades
+         */
+        float cascadeSplitPositions[3] = { 0.125f, 0.25f, 0.50f };
+    };
+
+    /**
+     * Helpers to compute ShadowOptions::cascadeSplitPositions.
+     */
+    struct ShadowCascades {
+        /**
+         * Splits the depth range in cascades of equal size.
+         *
+         * @param splitPositions an array of at least cascades - 1 floats that receives the split
+         *                       positions
+         * @param cascades       the number of cascades, between 1 and 4
+         */
+        static void computeUniformSplits(float* splitPositions, uint8_t cascades);
+
+        /**
+         * Splits the depth range logarithmically, which gives each cascade roughly the same
+         * projected texel density.
+         *
+         * @param splitPositions an array of at least cascades - 1 floats that receives the split
+         *                       positions
+         * @param cascades       the number of cascades, between 1 and 4
+         * @param near           the camera's near plane distance, a 0 distance is treated as a
+         *                       very small one
+         * @param far            the shadows' far distance
+         */
+        static void computeLogSplits(float* splitPositions, uint8_t cascades,
+                float near, float far);
+
+        /**
+         * Blends the uniform and logarithmic splits, as in "Parallel-Split Shadow Maps".
+         *
+         * @param splitPositions an array of at least cascades - 1 floats that receives the split
+         *                       positions
+         * @param cascades       the number of cascades, between 1 and 4
+         * @param near           the camera's near plane distance
+         * @param far            the shadows' far distance
+         * @param lambda         0 for uniform splits, 1 for logarithmic splits
+         */
+        static void computePracticalSplits(float* splitPositions, uint8_t cascades,
+                float near, float far, float lambda);
     };
 
     //! Use Builder to construct a Light object instance
@@ -235,8 +303,11 @@ public:
          *
          * @return This Builder, for chaining calls.
          *
-         * @warning
-         * - Only a Type.DIRECTIONAL or Type.SUN light can cast shadows
+         * @note
+         * The shadows of Type.SPOT and Type.POINT lights share a single shadow atlas: a spot
+         * light uses one tile of the atlas, a point light uses 6 tiles. When the atlas is full,
+         * the lights that appear the largest on screen get their shadows first, and their
+         * ShadowOptions::mapSize may be reduced.
          */
         Builder& castShadows(bool enable) noexcept;
 
@@ -118,6 +118,32 @@ public:
          * @exception utils::PreConditionPanic if a parameter to a builder function was invalid.
          */
         Material* build(Engine& engine);
+
+        //! Called by buildAsync() with the new Material, or nullptr if it couldn't be built.
+        using BuildCallback = void(*)(Material* material, void* user);
+
+        /**
+         * Creates the Material asynchronously. The material package is parsed and validated in
+         * a job on the Engine's JobSystem, so that loading many materials doesn't block the
+         * calling thread. The Material is then created on the Engine's thread, by the next
+         * Renderer::beginFrame() or Engine::publishMaterials(), which call the callback.
+         *
+         * Materials are created, and callbacks called, in the order of the calls to
+         * buildAsync(), regardless of the order in which the jobs finish. Materials still being
+         * built when the Engine is destroyed are discarded without calling their callback.
+         *
+         * @param engine Reference to the filament::Engine to associate this Material with.
+         * @param callback Called on the Engine's thread with the new Material, or nullptr if the
+         *                 package is invalid.
+         * @param user User data passed to the callback.
+         * @param prewarm If true, the shaders of the material's base variant are created along
+         *                with it, rather than when it's first drawn.
+         *
+         * @note The material data given to package() must stay valid until the callback is
+         *       called.
+         */
+        void buildAsync(Engine& engine, BuildCallback callback, void* user = nullptr,
+                bool prewarm = false);
     private:
         friend class details::FMaterial;
     };
@@ -18,6 +18,7 @@
 #define TNT_FILAMENT_RENDERABLECOMPONENTMANAGER_H
 
 #include <filament/Box.h>
+#include <filament/GeometryArena.h>
 #include <filament/VertexBuffer.h>
 #include <filament/IndexBuffer.h>
 #include <filament/Material.h>
@@ -53,6 +54,9 @@ public:
 
     Instance getInstance(utils::Entity e) const noexcept;
 
+    // same as calling getInstance() for each of the count entities, but faster
+    void getInstances(utils::Entity const* entities, Instance* instances, size_t count) const noexcept;
+
     struct Bone {
         filament::math::quatf unitQuaternion = { 1, 0, 0, 0 };
         filament::math::float3 translation = { 0, 0, 0 };
@@ -73,6 +77,8 @@ public:
         Builder& geometry(size_t index, PrimitiveType type, VertexBuffer* vertices, IndexBuffer* indices) noexcept;
         Builder& geometry(size_t index, PrimitiveType type, VertexBuffer* vertices, IndexBuffer* indices, size_t offset, size_t count) noexcept;
         Builder& geometry(size_t index, PrimitiveType type, VertexBuffer* vertices, IndexBuffer* indices, size_t offset, size_t minIndex, size_t maxIndex, size_t count) noexcept;
+        // Uses the ranges of an allocation made from arena
+        Builder& geometry(size_t index, PrimitiveType type, GeometryArena* arena, GeometryArena::Allocation const& allocation) noexcept;
         Builder& material(size_t index, MaterialInstance const* materialInstance) noexcept;
         // The axis aligned bounding box of the Renderable. Mandatory unless culling is disabled.
         Builder& boundingBox(const Box& axisAlignedBoundingBox) noexcept;
@@ -142,6 +148,11 @@ public:
     void setBones(Instance instance, Bone const* transforms, size_t boneCount = 1, size_t offset = 0) noexcept;
     void setBones(Instance instance, filament::math::mat4f const* transforms, size_t boneCount = 1, size_t offset = 0) noexcept;
 
+    // Updates all the bones of several renderables at once, this is much faster than calling
+    // setBones() for each renderable. transforms holds the bones of each renderable one after
+    // the other, with as many bones per renderable as given to Builder::skinning().
+    // Nothing is updated if one of the instances is invalid or has no bones.
+    void setBones(Instance const* instances, size_t count, filament::math::mat4f const* transforms) noexcept;
 
     // getters...
     const Box& getAxisAlignedBoundingBox(Instance instance) const noexcept;
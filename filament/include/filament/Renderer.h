@@ -24,6 +24,7 @@
 
 #include <utils/compiler.h>
 
+#include <stddef.h>
 #include <stdint.h>
 
 namespace filament {
@@ -137,6 +138,44 @@ public:
      */
     void render(View const* view);
 
+    /**
+     * Render several Views into this renderer's window.
+     *
+     * This is equivalent to calling render() for each View, in order. However, Views that
+     * share the same Scene (e.g. split-screen, picture-in-picture or the six faces of a
+     * cubemap) are prepared together: the Scene is gathered only once and all their frusta
+     * are culled in a single pass, instead of once per View. Consecutive Views that don't
+     * share their Scene have their rendering commands generated in parallel.
+     *
+     * @param views An array of pointers to the views to render, in rendering order.
+     * @param count Number of views in the array.
+     *
+     * @attention
+     * render() must be called *after* beginFrame() and *before* endFrame().
+     *
+     * @see
+     * render(View const*)
+     */
+    void render(View const* const* views, size_t count);
+
+    /**
+     * Creates ahead of time the GPU pipelines needed to render a View, without drawing it.
+     *
+     * Backends that use pipeline objects (i.e. Vulkan) create them in the background, so that
+     * the first frames rendering new materials or new geometry don't stall. This is typically
+     * used while a loading screen is displayed, with the View that will be rendered next.
+     * Other backends ignore it.
+     *
+     * @param view A pointer to the view to prewarm.
+     *
+     * @attention
+     * prewarm() must be called *after* beginFrame() and *before* endFrame().
+     *
+     * @see
+     * render(View const*)
+     */
+    void prewarm(View const* view);
+
     /**
      * Flags used to configure the behavior of mirrorFrame().
      *
@@ -345,6 +384,92 @@ public:
      * getUserTime()
      */
     void resetUserTime();
+
+    /**
+     * CPU stages of a frame whose hardware counters can be sampled.
+     *
+     * @see
+     * setCpuCountersEnabled()
+     */
+    enum class CpuStage : uint8_t {
+        SCENE_PREPARE,      //!< gathering the renderables and lights of the scene
+        CULLING,            //!< culling the renderables against the camera frustum
+        FROXELIZATION,      //!< assigning the lights to froxels
+        COMMAND_GENERATION, //!< generating the draw commands of the passes
+        SORT,               //!< sorting the draw commands
+        RECORDING,          //!< recording the driver commands
+        DRIVER,             //!< executing the driver commands, on the driver thread
+    };
+
+    static constexpr size_t CPU_STAGE_COUNT = 7;
+
+    /**
+     * CPU hardware counters accumulated over all the samples of a stage.
+     *
+     * Only the thread running a stage is sampled, work it spreads to the JobSystem's other
+     * threads isn't counted. Hardware counters are only available on Linux, elsewhere only the
+     * sample count and time are set.
+     */
+    struct CpuCounters {
+        uint64_t samples = 0;       //!< number of times the stage was sampled
+        uint64_t time = 0;          //!< wall time of the stage, in nanoseconds
+        uint64_t instructions = 0;
+        uint64_t cycles = 0;
+        uint64_t l1dReferences = 0;
+        uint64_t l1dMisses = 0;
+        uint64_t l1iReferences = 0;
+        uint64_t l1iMisses = 0;
+        uint64_t branches = 0;
+        uint64_t branchMisses = 0;
+
+        //! instructions per cycle
+        double getIPC() const noexcept {
+            return cycles ? double(instructions) / double(cycles) : 0.0;
+        }
+
+        //! fraction of the L1 data cache references which missed
+        double getL1DMissRate() const noexcept {
+            return l1dReferences ? double(l1dMisses) / double(l1dReferences) : 0.0;
+        }
+
+        //! fraction of the L1 instruction cache references which missed
+        double getL1IMissRate() const noexcept {
+            return l1iReferences ? double(l1iMisses) / double(l1iReferences) : 0.0;
+        }
+
+        //! fraction of the branches which were mispredicted
+        double getBranchMissRate() const noexcept {
+            return branches ? double(branchMisses) / double(branches) : 0.0;
+        }
+    };
+
+    /**
+     * Enables sampling the CPU hardware counters (instructions, cycles, cache and branch
+     * misses) around each CpuStage of the frame. Disabled by default, in which case sampling
+     * costs nothing.
+     *
+     * The counters belong to the Engine, they accumulate the stages of all its Renderers until
+     * resetCpuCounters() is called.
+     *
+     * @param enabled true to start sampling, false to stop.
+     *
+     * @see
+     * getCpuCounters(), resetCpuCounters()
+     */
+    void setCpuCountersEnabled(bool enabled) noexcept;
+
+    /**
+     * Returns the counters accumulated for a stage since the last call to resetCpuCounters().
+     *
+     * @param stage The stage to query.
+     * @return The counters of the stage.
+     */
+    CpuCounters getCpuCounters(CpuStage stage) const noexcept;
+
+    /**
+     * Resets the counters of all the stages to zero.
+     */
+    void resetCpuCounters() noexcept;
 };
 
 } // namespace filament
@@ -365,6 +365,51 @@ public:
      * @attention This Texture instance must NOT use driver::SamplerType::SAMPLER_CUBEMAP or it has no effect
      */
     void generateMipmaps(Engine& engine) const noexcept;
+
+    /**
+     * Provides the images of a streamed texture.
+     *
+     * @see setStreamingSource()
+     */
+    class UTILS_PUBLIC StreamingSource {
+    public:
+        virtual ~StreamingSource();
+
+        /**
+         * Returns the size in bytes of a level, as it's uploaded. This is called when
+         * streaming starts, and must be cheap.
+         */
+        virtual size_t getLevelSize(size_t level) const noexcept = 0;
+
+        /**
+         * Returns the image of a level. This is called from a JobSystem thread, which is
+         * where the image can be decoded. A level can be requested several times, since
+         * levels are evicted and loaded again as needed.
+         */
+        virtual PixelBufferDescriptor getLevel(size_t level) noexcept = 0;
+    };
+
+    /**
+     * Streams the levels of this texture from a StreamingSource.
+     *
+     * Only the coarsest levels, up to 64x64, are uploaded right away. The finer levels are
+     * loaded in the background when the renderables using this texture need them on screen,
+     * and are evicted when they aren't used and the budget set with
+     * Engine::setTextureStreamingBudget() is exceeded.
+     *
+     * @param engine        Engine this texture is associated to.
+     * @param source        Provides the images of all the levels. The texture takes ownership
+     *                      of it and destroys it with the texture.
+     * @param uvDensity     How many times this texture repeats across the renderables using
+     *                      it. This gives the finest level needed for a given on-screen size.
+     *
+     * @attention \p engine must be the instance passed to Builder::build()
+     * @attention This Texture instance must use driver::SamplerType::SAMPLER_2D or it has no
+     *            effect
+     * @attention setImage() and generateMipmaps() have no effect on a streamed texture.
+     */
+    void setStreamingSource(Engine& engine, StreamingSource* source,
+            float uvDensity = 1.0f) noexcept;
 };
 
 } // namespace filament
@@ -78,6 +78,17 @@ public:
      */
     Instance getInstance(utils::Entity e) const noexcept;
 
+    /**
+     * Gets the Instances of the transform components associated with several Entities at once.
+     * This is equivalent to, but faster than, calling getInstance() for each Entity.
+     * @param entities  An array of \p count Entities.
+     * @param instances An array of \p count Instances that receives the result. An Entity without
+     *                  a transform component gets an invalid Instance.
+     * @param count     Number of Entities.
+     * @see getInstance()
+     */
+    void getInstances(utils::Entity const* entities, Instance* instances, size_t count) const noexcept;
+
     /**
      * Creates a transform component and associate it with the given entity.
      * @param entity            An Entity to associate a transform component to.
@@ -92,6 +103,27 @@ public:
      */
     void create(utils::Entity entity, Instance parent = {}, const filament::math::mat4f& localTransform = {});
 
+    /**
+     * Creates the transform components of several entities at once. This is equivalent to
+     * calling create() for each entity, but the storage is sized only once and the world
+     * transforms are computed in a single pass, which is much faster for large hierarchies.
+     *
+     * @param entities          Array of count entities to associate a transform component to.
+     * @param parents           Array of count parents, parents[i] is the index in entities of
+     *                          the parent of entities[i], or -1 if it has no parent. A parent
+     *                          must always come before its children, i.e. parents[i] < i.
+     * @param localTransforms   Array of count local transforms, relative to the parent.
+     * @param count             Number of components to create.
+     * @param instances         If not null, array receiving the count instances created.
+     *
+     * Components already existing on these entities are first destroyed.
+     *
+     * @see create()
+     */
+    void create(utils::Entity const* entities, int32_t const* parents,
+            const filament::math::mat4f* localTransforms, size_t count,
+            Instance* instances = nullptr);
+
     /**
      * Destroys this component from the given entity, children are orphaned.
      * @param e An entity.
@@ -120,10 +152,29 @@ public:
      * @see getTransform()
      * @attention This operation can be slow if the hierarchy of transform is too deep, and this
      *            will be particularly bad when updating a lot of transforms. In that case,
-     *            consider using openLocalTransformTransaction() / commitLocalTransformTransaction().
+     *            consider using setTransforms() or
+     *            openLocalTransformTransaction() / commitLocalTransformTransaction().
      */
     void setTransform(Instance ci, const filament::math::mat4f& localTransform) noexcept;
 
+    /**
+     * Sets the local transforms of several transform components at once. This is equivalent to
+     * calling setTransform() for each component within a local transform transaction, and
+     * is the most efficient way to update a large number of transforms every frame.
+     *
+     * @param instances         Array of count instances of the transform components to update.
+     * @param localTransforms   Array of count local transforms, localTransforms[i] is the
+     *                          local transform of instances[i].
+     * @param count             Number of transforms to update.
+     *
+     * @attention If no local transform transaction is open, this commits the new transforms,
+     *            which can reorder the components. All Instances are invalid after this call.
+     *
+     * @see setTransform(), commitLocalTransformTransaction()
+     */
+    void setTransforms(Instance const* instances,
+            const filament::math::mat4f* localTransforms, size_t count) noexcept;
+
     /**
      * Returns the local transform of a transform component.
      * @param ci The instance of the transform component to query the local transform from.
@@ -161,6 +212,10 @@ public:
      * Commits the currently open local transform transaction. When this returns, calls
      * to getWorldTransform() will return the proper value.
      *
+     * Components are kept sorted breadth-first (by depth in the hierarchy), so that all world
+     * transforms of a given depth are computed in parallel. If the hierarchy changed since
+     * the last commit, the components are reordered first, which invalidates all Instances.
+     *
      * @attention failing to call this method when done updating the local transform will cause
      *            a lot of rendering problems. The system never closes the transaction
      *            automatically.
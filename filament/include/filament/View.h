@@ -465,6 +465,63 @@ public:
      */
     bool isFrontFaceWindingInverted() const noexcept;
 
+    /**
+     * Counters of the draws of a pass, see Stats.
+     */
+    struct PassStats {
+        uint32_t commands = 0;                  //!< draw commands, before instancing
+        uint32_t drawCalls = 0;                 //!< draw calls, an instanced draw counts once
+        uint32_t programSwitches = 0;           //!< draw calls using a new program
+        uint32_t materialInstanceSwitches = 0;  //!< material instances bound
+    };
+
+    /**
+     * Statistics of the last frame a View was rendered in.
+     */
+    struct Stats {
+        uint32_t renderables = 0;               //!< renderables in the scene
+        uint32_t visibleRenderables = 0;        //!< renderables that passed culling
+        uint32_t shadowCasters = 0;             //!< renderables casting shadows in the scene
+        uint32_t visibleShadowCasters = 0;      //!< shadow casters that passed culling
+        uint32_t visibleLights = 0;             //!< point and spot lights that passed culling
+        uint32_t froxelRecords = 0;             //!< entries of the froxel record buffer used
+        PassStats shadowPass;                   //!< shadow map and shadow atlas passes
+        PassStats depthPass;                    //!< depth prepass
+        PassStats colorPass;                    //!< opaque and blended color passes
+        uint64_t uniformBytes = 0;              //!< uniform data uploaded for the view
+        uint64_t commandBytes = 0;              //!< bytes written to the driver command stream
+
+        //! number of Renderer::CpuStage, the size of cpuTime
+        static constexpr size_t CPU_STAGE_COUNT = 7;
+
+        /**
+         * CPU time spent in each Renderer::CpuStage, in nanoseconds. The DRIVER stage runs on
+         * its own thread, its time is the time spent executing commands while the view was
+         * rendered, which can include commands of other views. When views are rendered with
+         * Renderer::render(views, count), the command generation of a view includes the
+         * views whose commands were generated in parallel with it.
+         */
+        uint64_t cpuTime[CPU_STAGE_COUNT] = {};
+
+        uint32_t getCulledRenderables() const noexcept {
+            return renderables - visibleRenderables;
+        }
+
+        uint32_t getCulledShadowCasters() const noexcept {
+            return shadowCasters - visibleShadowCasters;
+        }
+    };
+
+    /**
+     * Returns the statistics of the last frame this View was rendered in.
+     *
+     * Statistics are always collected, they only cost a few counters per pass. They're updated
+     * at the end of Renderer::render(), so they can be read right after it returns.
+     *
+     * @return The statistics of the last frame, all zeros if the View was never rendered.
+     */
+    Stats const& getStats() const noexcept;
+
     // for debugging...
 
     //! debugging: allows to entirely disable frustum culling. (culling enabled by default).
@@ -20,6 +20,9 @@
 #include <filament/driver/DriverEnums.h>
 
 #include <utils/compiler.h>
+#include <utils/CString.h>
+
+#include <stddef.h>
 
 namespace filament {
 namespace details {
@@ -43,6 +46,31 @@ public:
 
     virtual ~Platform() noexcept;
 
+    /*
+     * Blob cache, used by the backends to keep data that is expensive to produce, such as
+     * program binaries, across runs. Keys and values are opaque binary data.
+     *
+     * The default implementation keeps each blob in a file of the directory set with
+     * setBlobCacheDirectory(). Override these methods to use the application's own cache.
+     * They can be called from the driver thread.
+     */
+
+    // Returns whether the cache can be used. If not, insertBlob() and retrieveBlob() aren't called.
+    virtual bool hasBlobCache() const noexcept;
+
+    // Stores value under key, replacing the value previously stored under it, if any.
+    virtual void insertBlob(const void* key, size_t keySize,
+            const void* value, size_t valueSize) noexcept;
+
+    // Returns the size of the value stored under key, or 0 if there is none. The value is
+    // copied to value only if valueSize is large enough.
+    virtual size_t retrieveBlob(const void* key, size_t keySize,
+            void* value, size_t valueSize) noexcept;
+
+    // Sets the directory, which must exist, where the default blob cache keeps its files.
+    // The default cache is disabled until this is called.
+    void setBlobCacheDirectory(const char* path) noexcept;
+
 protected:
     // Creates and initializes the low-level API (e.g. an OpenGL context or Vulkan instance),
     // then creates the concrete Driver. Returns null on failure.
@@ -53,6 +81,10 @@ private:
     friend class details::FEngine;
     static Platform* create(driver::Backend* backendHint) noexcept;
     static void destroy(Platform** context) noexcept;
+
+    utils::CString getBlobPath(const void* key, size_t keySize) const noexcept;
+
+    utils::CString mBlobCacheDirectory;
 };
 
 class UTILS_PUBLIC OpenGLPlatform : public Platform {
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CpuProfiler.h"
+
+#include <utils/ThreadLocal.h>
+
+#include <memory>
+#include <mutex>
+
+using namespace utils;
+
+namespace filament {
+namespace details {
+
+// the counters of a thread are shared by all the Engines, they're closed when the thread exits
+static UTILS_DEFINE_TLS(std::unique_ptr<Profiler>) sProfiler;
+
+static Profiler* getThreadProfiler() noexcept {
+    std::unique_ptr<Profiler>& profiler = sProfiler;
+    if (UTILS_UNLIKELY(!profiler)) {
+        profiler.reset(new Profiler(Profiler::EV_CPU_CYCLES | Profiler::EV_L1D_RATES |
+                Profiler::EV_L1I_RATES | Profiler::EV_BPU_RATES));
+        profiler->reset();
+        profiler->start();
+    }
+    return profiler.get();
+}
+
+void CpuProfiler::Scope::begin() noexcept {
+    mThreadProfiler = getThreadProfiler();
+    mCounters = mThreadProfiler->readCounters();
+}
+
+void CpuProfiler::Scope::end(std::chrono::steady_clock::duration time) noexcept {
+    Profiler::Counters counters = mThreadProfiler->readCounters() - mCounters;
+    mProfiler->accumulate(mStage, counters, time);
+}
+
+void CpuProfiler::accumulate(Stage stage, Profiler::Counters const& counters,
+        std::chrono::steady_clock::duration time) noexcept {
+    std::lock_guard<Mutex> lock(mLock);
+    Counters& c = mCounters[size_t(stage)];
+    c.samples++;
+    c.time += std::chrono::duration_cast<std::chrono::nanoseconds>(time).count();
+    c.instructions += counters.getInstructions();
+    c.cycles += counters.getCpuCycles();
+    c.l1dReferences += counters.getL1DReferences();
+    c.l1dMisses += counters.getL1DMisses();
+    c.l1iReferences += counters.getL1IReferences();
+    c.l1iMisses += counters.getL1IMisses();
+    c.branches += counters.getBranchInstructions();
+    c.branchMisses += counters.getBranchMisses();
+}
+
+CpuProfiler::Counters CpuProfiler::getCounters(Stage stage) const noexcept {
+    std::lock_guard<Mutex> lock(mLock);
+    return mCounters[size_t(stage)];
+}
+
+void CpuProfiler::reset() noexcept {
+    std::lock_guard<Mutex> lock(mLock);
+    mCounters.fill({});
+}
+
+} // namespace details
+} // namespace filament
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_CPUPROFILER_H
+#define TNT_FILAMENT_CPUPROFILER_H
+
+#include <filament/Renderer.h>
+
+#include <utils/compiler.h>
+#include <utils/Mutex.h>
+#include <utils/Profiler.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+
+namespace filament {
+namespace details {
+
+/*
+ * Accumulates the CPU hardware counters of the stages of a frame.
+ *
+ * Each thread samples its counters with its own utils::Profiler, created the first time the
+ * thread runs a Scope while sampling is enabled. When sampling is disabled, a Scope only reads
+ * the clock twice and adds its duration to the wall time of its stage, which feeds the
+ * View statistics.
+ */
+class CpuProfiler {
+    using StageTimes = std::array<std::atomic<uint64_t>, Renderer::CPU_STAGE_COUNT>;
+
+public:
+    using Stage = Renderer::CpuStage;
+    using Counters = Renderer::CpuCounters;
+
+    class Scope {
+    public:
+        Scope(CpuProfiler& profiler, Stage stage) noexcept
+                : mStageTimes(profiler.mStageTimes),
+                  mProfiler(profiler.isEnabled() ? &profiler : nullptr), mStage(stage),
+                  mStart(std::chrono::steady_clock::now()) {
+            if (UTILS_UNLIKELY(mProfiler)) {
+                begin();
+            }
+        }
+
+        ~Scope() noexcept {
+            std::chrono::steady_clock::duration time = std::chrono::steady_clock::now() - mStart;
+            mStageTimes[size_t(mStage)].fetch_add(uint64_t(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(time).count()),
+                    std::memory_order_relaxed);
+            if (UTILS_UNLIKELY(mProfiler)) {
+                end(time);
+            }
+        }
+
+        Scope(Scope const& rhs) = delete;
+        Scope& operator=(Scope const& rhs) = delete;
+
+    private:
+        void begin() noexcept;
+        void end(std::chrono::steady_clock::duration time) noexcept;
+
+        StageTimes& mStageTimes;
+        CpuProfiler* const mProfiler;
+        Stage const mStage;
+        utils::Profiler* mThreadProfiler = nullptr;
+        utils::Profiler::Counters mCounters;
+        std::chrono::steady_clock::time_point mStart;
+    };
+
+    bool isEnabled() const noexcept {
+        return mEnabled.load(std::memory_order_relaxed);
+    }
+
+    void setEnabled(bool enabled) noexcept {
+        mEnabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    Counters getCounters(Stage stage) const noexcept;
+
+    // wall time spent in a stage since the profiler was created, in nanoseconds. This is
+    // collected even when sampling is disabled and isn't affected by reset().
+    uint64_t getStageTime(Stage stage) const noexcept {
+        return mStageTimes[size_t(stage)].load(std::memory_order_relaxed);
+    }
+
+    void reset() noexcept;
+
+private:
+    void accumulate(Stage stage, utils::Profiler::Counters const& counters,
+            std::chrono::steady_clock::duration time) noexcept;
+
+    std::atomic<bool> mEnabled = { false };
+    mutable utils::Mutex mLock;
+    std::array<Counters, Renderer::CPU_STAGE_COUNT> mCounters;
+    StageTimes mStageTimes = {};
+};
+
+} // namespace details
+} // namespace filament
+
+#endif // TNT_FILAMENT_CPUPROFILER_H
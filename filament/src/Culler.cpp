@@ -18,6 +18,8 @@
 
 #include <math/fast.h>
 
+#include <assert.h>
+
 using namespace filament::math;
 
 namespace filament {
@@ -88,6 +90,42 @@ void Culler::intersects(
     }
 }
 
+void Culler::intersects(
+        result_type* UTILS_RESTRICT results,
+        Frustum const* UTILS_RESTRICT frusta, size_t frustumCount,
+        filament::math::float3 const* UTILS_RESTRICT center,
+        filament::math::float3 const* UTILS_RESTRICT extent,
+        size_t count) noexcept {
+
+    assert(frustumCount <= MAX_FRUSTUM_COUNT);
+
+    // Each AABB is loaded only once and tested against all the frusta, this way several
+    // views of the same scene are culled in a single pass over the data.
+    count = round(count); // capacity guaranteed to be multiple of 8
+    for (size_t i = 0; i < count; i++) {
+        const float3 c = center[i];
+        const float3 e = extent[i];
+        int mask = 0;
+        for (size_t f = 0; f < frustumCount; f++) {
+            filament::math::float4 const * UTILS_RESTRICT const planes = frusta[f].mPlanes;
+            int visible = ~0;
+
+            #pragma clang loop unroll(full)
+            for (size_t j = 0; j < 6; j++) {
+                const float dot =
+                        planes[j].x * c.x - std::abs(planes[j].x) * e.x +
+                        planes[j].y * c.y - std::abs(planes[j].y) * e.y +
+                        planes[j].z * c.z - std::abs(planes[j].z) * e.z +
+                        planes[j].w;
+
+                visible &= fast::signbit(dot) << f;
+            }
+            mask |= visible;
+        }
+        results[i] = result_type(mask);
+    }
+}
+
 /*
  * returns whether a box intersects with the frustum
  */
@@ -128,6 +166,15 @@ void Culler::Test::intersects(
     Culler::intersects(results, frustum, c, e, count, 0);
 }
 
+void Culler::Test::intersects(
+        result_type* UTILS_RESTRICT results,
+        Frustum const* UTILS_RESTRICT frusta, size_t frustumCount,
+        filament::math::float3 const* UTILS_RESTRICT c,
+        filament::math::float3 const* UTILS_RESTRICT e,
+        size_t count) noexcept {
+    Culler::intersects(results, frusta, frustumCount, c, e, count);
+}
+
 void Culler::Test::intersects(
         result_type* UTILS_RESTRICT results,
         Frustum const& UTILS_RESTRICT frustum,
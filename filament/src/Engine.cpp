@@ -20,6 +20,7 @@
 #include "details/VertexBuffer.h"
 #include "details/Fence.h"
 #include "details/Camera.h"
+#include "details/GeometryArena.h"
 #include "details/IndexBuffer.h"
 #include "details/IndirectLight.h"
 #include "details/Material.h"
@@ -31,6 +32,7 @@
 #include "details/SwapChain.h"
 #include "details/Texture.h"
 #include "details/View.h"
+#include "driver/CaptureDriver.h"
 #include "driver/Program.h"
 
 #include <private/filament/SibGenerator.h>
@@ -49,6 +51,7 @@
 #include <math/fast.h>
 #include <math/scalar.h>
 
+#include <algorithm>
 #include <functional>
 
 #include <stdio.h>
@@ -69,8 +72,10 @@ namespace details {
 static std::unordered_map<Engine const*, std::unique_ptr<FEngine>> sEngines;
 static std::mutex sEnginesLock;
 
-FEngine* FEngine::create(Backend backend, Platform* platform, void* sharedGLContext) {
-    FEngine* instance = new FEngine(backend, platform, sharedGLContext);
+FEngine* FEngine::create(Backend backend, Platform* platform, void* sharedGLContext,
+        const Config* config) {
+    FEngine* instance = new FEngine(backend, platform, sharedGLContext,
+            config ? *config : Config{});
 
     slog.i << "FEngine (" << sizeof(void*) * 8 << " bits) created at " << instance << " "
             << "(threading is " << (UTILS_HAS_THREADING ? "enabled)" : "disabled)") << io::endl;
@@ -87,7 +92,7 @@ FEngine* FEngine::create(Backend backend, Platform* platform, void* sharedGLCont
             platform = Platform::create(&instance->mBackend);
             instance->mPlatform = platform;
         }
-        instance->mDriver = platform->createDriver(sharedGLContext);
+        instance->mDriver = instance->createDriver(platform, sharedGLContext);
         instance->init();
         instance->execute();
         return instance;
@@ -122,7 +127,48 @@ static const half4 sFullScreenTriangleVertices[3] = {
 // these must be static because only a pointer is copied to the render stream
 static const uint16_t sFullScreenTriangleIndices[3] = { 0, 1, 2 };
 
-FEngine::FEngine(Backend backend, Platform* platform, void* sharedGLContext) :
+FEngine::ConfigValues FEngine::resolveConfig(Config const& config) noexcept {
+    constexpr size_t MiB = 1024 * 1024;
+    ConfigValues values;
+
+    values.minCommandBufferSize = config.minCommandBufferSizeMB ?
+            config.minCommandBufferSizeMB * MiB : CONFIG_MIN_COMMAND_BUFFERS_SIZE;
+
+    values.commandBufferSize = config.commandBufferSizeMB ?
+            config.commandBufferSizeMB * MiB : CONFIG_COMMAND_BUFFERS_SIZE;
+
+    // the circular buffer must be able to hold more than what we require after a flush,
+    // otherwise we would block forever. Use the same ratio as our defaults.
+    if (values.commandBufferSize <= values.minCommandBufferSize) {
+        values.commandBufferSize = values.minCommandBufferSize *
+                (CONFIG_COMMAND_BUFFERS_SIZE / CONFIG_MIN_COMMAND_BUFFERS_SIZE);
+    }
+
+    values.perFrameCommandsSize = config.perFrameCommandsSizeMB ?
+            config.perFrameCommandsSizeMB * MiB : CONFIG_PER_FRAME_COMMANDS_SIZE;
+
+    values.perRenderPassArenaSize = config.perRenderPassArenaSizeMB ?
+            config.perRenderPassArenaSizeMB * MiB : CONFIG_PER_RENDER_PASS_ARENA_SIZE;
+
+    // the commands buffer comes from the per-render-pass arena, make sure there is enough
+    // room left for everything else (e.g. froxelization).
+    values.perRenderPassArenaSize = std::max(values.perRenderPassArenaSize,
+            values.perFrameCommandsSize +
+                    (CONFIG_PER_RENDER_PASS_ARENA_SIZE - CONFIG_PER_FRAME_COMMANDS_SIZE));
+
+    values.driverThreadAffinity = config.driverThreadAffinity;
+    if (config.driverCapturePath) {
+        values.driverCapturePath = CString(config.driverCapturePath);
+    }
+    if (config.programCachePath) {
+        values.programCachePath = CString(config.programCachePath);
+    }
+    return values;
+}
+
+FEngine::FEngine(Backend backend, Platform* platform, void* sharedGLContext,
+        Config const& config) :
+        mConfig(resolveConfig(config)),
         mBackend(backend),
         mPlatform(platform),
         mSharedGLContext(sharedGLContext),
@@ -131,12 +177,17 @@ FEngine::FEngine(Backend backend, Platform* platform, void* sharedGLContext) :
         mTransformManager(),
         mLightManager(*this),
         mCameraManager(*this),
+        mTextureStreamer(*this),
+        mMaterialLoader(*this),
         mPerViewUib(PerViewUib::getUib()),
         mPerViewSib(PerViewSib::getSib()),
         mPostProcessUib(PostProcessingUib::getUib()),
         mPostProcessSib(PostProcessSib::getSib()),
-        mCommandBufferQueue(CONFIG_MIN_COMMAND_BUFFERS_SIZE, CONFIG_COMMAND_BUFFERS_SIZE),
-        mPerRenderPassAllocator("per-renderpass allocator", CONFIG_PER_RENDER_PASS_ARENA_SIZE),
+        mCommandBufferQueue(mConfig.minCommandBufferSize, mConfig.commandBufferSize),
+        mPerRenderPassAllocator("per-renderpass allocator", mConfig.perRenderPassArenaSize),
+        mOwnJobSystem(config.jobSystem ? nullptr :
+                new JobSystem(config.jobSystemThreadCount)),
+        mJobSystem(config.jobSystem ? *config.jobSystem : *mOwnJobSystem),
         mEngineEpoch(std::chrono::steady_clock::now()),
         mDriverBarrier(1)
 {
@@ -144,6 +195,8 @@ FEngine::FEngine(Backend backend, Platform* platform, void* sharedGLContext) :
 
     // we're assuming we're on the main thread here.
     // (it may not be the case)
+    // This is a no-op if this thread was already adopted by a shared JobSystem.
+    mAdoptedThread = JobSystem::getJobSystem() != &mJobSystem;
     mJobSystem.adopt();
 }
 
@@ -212,6 +265,7 @@ void FEngine::init() {
 
     mPostProcessManager.init(*this);
     mRenderTargetPool.init(*this);
+    mTransformManager.init(getJobSystem());
     mLightManager.init(*this);
     mDFG.reset(new DFG(*this));
 
@@ -231,14 +285,17 @@ FEngine::~FEngine() noexcept {
 void FEngine::shutdown() {
 #ifndef NDEBUG
     // print out some statistics about this run
-    size_t wm = mCommandBufferQueue.getHigWatermark();
-    size_t wmpct = wm / (CONFIG_COMMAND_BUFFERS_SIZE / 100);
+    size_t wm = mCommandBufferQueue.getHighWatermark();
+    size_t wmpct = wm / (mConfig.commandBufferSize / 100);
     slog.d << "CircularBuffer: High watermark "
            << wm / 1024 << " KiB (" << wmpct << "%)" << io::endl;
 #endif
 
     DriverApi& driver = getDriverApi();
 
+    // the materials still being built are never created
+    mMaterialLoader.terminate();
+
     /*
      * Destroy our own state first
      */
@@ -247,6 +304,7 @@ void FEngine::shutdown() {
     mRenderTargetPool.terminate(driver);    // free-up all offscreen render targets
     mDFG->terminate();                      // free-up the DFG
     mRenderableManager.terminate();         // free-up all renderables
+    mRenderPrimitiveCache.terminate(driver); // free-up shared render primitives
     mLightManager.terminate();              // free-up all lights
     mCameraManager.terminate();             // free-up all cameras
 
@@ -276,9 +334,12 @@ void FEngine::shutdown() {
         destroy(material);
     }
 
+    // this must be done before IndexBuffers and VertexBuffers, which arenas own
+    cleanupResourceList(mGeometryArenas);
     cleanupResourceList(mIndexBuffers);
     cleanupResourceList(mVertexBuffers);
     cleanupResourceList(mTextures);
+    mTextureStreamer.terminate();
     cleanupResourceList(mMaterials);
     for (auto& item : mMaterialInstances) {
         cleanupResourceList(item.second);
@@ -304,14 +365,24 @@ void FEngine::shutdown() {
         mDriverThread.join();
     }
 
-    // detach this thread from the jobsystem
-    mJobSystem.emancipate();
+    // detach this thread from the jobsystem if we adopted it, a thread adopted before the
+    // Engine was created belongs to the owner of the shared JobSystem.
+    if (mAdoptedThread) {
+        mJobSystem.emancipate();
+    }
 
     mTerminated = true;
 }
 
 void FEngine::prepare() {
     SYSTRACE_CALL();
+    // materials built asynchronously become visible to the user at the start of a frame
+    mMaterialLoader.publish(false);
+    // this can change the textures used by material instances, so it must happen before
+    // they're committed.
+    mTextureStreamer.update();
+    updateMemoryPeaks();
+
     // prepare() is called once per Renderer frame. Ideally we would upload the content of
     // UBOs that are visible only. It's not such a big issue because the actual upload() is
     // skipped is the UBO hasn't changed. Still we could have a lot of these.
@@ -322,6 +393,74 @@ void FEngine::prepare() {
     }
 }
 
+size_t FEngine::getScenesMemoryUsed() const noexcept {
+    size_t size = 0;
+    for (FScene const* scene : mScenes) {
+        size += scene->getMemoryUsed();
+    }
+    return size;
+}
+
+size_t FEngine::getComponentsMemoryUsed() const noexcept {
+    return mTransformManager.getMemoryUsed() +
+            mRenderableManager.getMemoryUsed() +
+            mLightManager.getMemoryUsed();
+}
+
+void FEngine::updateMemoryPeaks() const noexcept {
+    mScenesMemoryPeak = std::max(mScenesMemoryPeak, getScenesMemoryUsed());
+    mComponentsMemoryPeak = std::max(mComponentsMemoryPeak, getComponentsMemoryUsed());
+}
+
+Engine::MemoryStats FEngine::getMemoryStats() const noexcept {
+    updateMemoryPeaks();
+
+    MemoryStats stats;
+
+    auto const& arena = mPerRenderPassAllocator.getListener();
+    stats.perRenderPassArena = { arena.getCurrent(), arena.getHighWatermark(), arena.getSize() };
+
+    stats.commandBuffer = { mCommandBufferQueue.getUsedSize(),
+            mCommandBufferQueue.getHighWatermark(), mCommandBufferQueue.getSize() };
+
+    const Driver::MemoryStats driverStats = mDriver->getMemoryStats();
+    stats.handles = { size_t(driverStats.handleBytes), size_t(driverStats.handlePeakBytes),
+            size_t(driverStats.handleAllocatedBytes) };
+
+    size_t scenesReserved = 0;
+    for (FScene const* scene : mScenes) {
+        scenesReserved += scene->getMemoryReserved();
+    }
+    stats.scenes = { getScenesMemoryUsed(), mScenesMemoryPeak, scenesReserved };
+
+    stats.components = { getComponentsMemoryUsed(), mComponentsMemoryPeak,
+            mTransformManager.getMemoryReserved() +
+            mRenderableManager.getMemoryReserved() +
+            mLightManager.getMemoryReserved() };
+
+    stats.renderTargetPool = { mRenderTargetPool.getMemorySize(),
+            mRenderTargetPool.getPeakMemorySize(), mRenderTargetPool.getMemorySize() };
+
+    stats.textures = { mTextureMemory.current, mTextureMemory.peak, mTextureMemory.current };
+    stats.buffers = { mBufferMemory.current, mBufferMemory.peak, mBufferMemory.current };
+    return stats;
+}
+
+void FEngine::replaceTexture(Handle<HwTexture> oldHandle, Handle<HwTexture> newHandle) noexcept {
+    for (auto& materialInstanceList : mMaterialInstances) {
+        for (auto& item : materialInstanceList.second) {
+            item->replaceTexture(oldHandle, newHandle);
+        }
+    }
+    // the default instances are not committed by prepare()
+    for (auto& material : mMaterials) {
+        FMaterialInstance* const mi = material->getDefaultInstance();
+        if (mi->replaceTexture(oldHandle, newHandle)) {
+            mi->commit(*this);
+        }
+    }
+}
+
 void FEngine::gc() {
     JobSystem& js = mJobSystem;
     auto parent = js.createJob();
@@ -376,7 +515,7 @@ int FEngine::loop() {
         }
         slog.d << io::endl;
     }
-    mDriver = platform->createDriver(mSharedGLContext);
+    mDriver = createDriver(platform, mSharedGLContext);
     mDriverBarrier.latch();
     if (UTILS_UNLIKELY(!mDriver)) {
         // if we get here, it's because the driver couldn't be initialized and the problem has
@@ -391,7 +530,9 @@ int FEngine::loop() {
     // configuration. This is also a core not used by the JobSystem.
     // Either way the main reason to do this is to avoid this thread jumping from core to core
     // and loose its caches in the process.
-    uint32_t id = std::thread::hardware_concurrency() - 1;
+    // The Engine's configuration can override this choice.
+    uint32_t id = mConfig.driverThreadAffinity >= 0 ?
+            uint32_t(mConfig.driverThreadAffinity) : std::thread::hardware_concurrency() - 1;
 
     while (true) {
         // looks like thread affinity needs to be reset regularly (on Android)
@@ -406,6 +547,33 @@ int FEngine::loop() {
     return 0;
 }
 
+Driver* FEngine::createDriver(Platform* platform, void* sharedContext) const noexcept {
+    if (!mConfig.programCachePath.empty()) {
+        platform->setBlobCacheDirectory(mConfig.programCachePath.c_str());
+    }
+    Driver* driver = platform->createDriver(sharedContext);
+    if (driver && mConfig.driverCapturePath.size()) {
+        return CaptureDriver::create(driver, mConfig.driverCapturePath.c_str());
+    }
+    return driver;
+}
+
+Driver* FEngine::createStandaloneDriver(Backend backend, Platform** platform) noexcept {
+    *platform = Platform::create(&backend);
+    if (!*platform) {
+        return nullptr;
+    }
+    Driver* const driver = (*platform)->createDriver(nullptr);
+    if (!driver) {
+        Platform::destroy(platform);
+    }
+    return driver;
+}
+
+void FEngine::destroyPlatform(Platform** platform) noexcept {
+    Platform::destroy(platform);
+}
+
 void FEngine::flushCommandBuffer(CommandBufferQueue& commandQueue) {
     getDriver().purge();
     commandQueue.flush();
@@ -486,6 +654,10 @@ FIndexBuffer* FEngine::createIndexBuffer(const IndexBuffer::Builder& builder) no
     return create(mIndexBuffers, builder);
 }
 
+FGeometryArena* FEngine::createGeometryArena(const GeometryArena::Builder& builder) noexcept {
+    return create(mGeometryArenas, builder);
+}
+
 FTexture* FEngine::createTexture(const Texture::Builder& builder) noexcept {
     return create(mTextures, builder);
 }
@@ -635,6 +807,10 @@ void FEngine::destroy(const FIndexBuffer* p) {
     terminateAndDestroy(p, mIndexBuffers);
 }
 
+void FEngine::destroy(const FGeometryArena* p) {
+    terminateAndDestroy(p, mGeometryArenas);
+}
+
 inline void FEngine::destroy(const FRenderer* p) {
     terminateAndDestroy(p, mRenderers);
 }
@@ -723,6 +899,7 @@ bool FEngine::execute() {
     }
 
     // execute all command buffers
+    CpuProfiler::Scope profile(mCpuProfiler, CpuProfiler::Stage::DRIVER);
     for (auto& item : buffers) {
         if (UTILS_LIKELY(item.begin)) {
             mCommandStream.execute(item.begin);
@@ -741,8 +918,9 @@ bool FEngine::execute() {
 
 using namespace details;
 
-Engine* Engine::create(Backend backend, Platform* platform, void* sharedGLContext) {
-    std::unique_ptr<FEngine> engine(FEngine::create(backend, platform, sharedGLContext));
+Engine* Engine::create(Backend backend, Platform* platform, void* sharedGLContext,
+        const Config* config) {
+    std::unique_ptr<FEngine> engine(FEngine::create(backend, platform, sharedGLContext, config));
     if (UTILS_UNLIKELY(!engine)) {
         // something went wrong during the driver or engine initialization
         return nullptr;
@@ -815,6 +993,10 @@ void Engine::destroy(const IndexBuffer* p) {
     upcast(this)->destroy(upcast(p));
 }
 
+void Engine::destroy(const GeometryArena* p) {
+    upcast(this)->destroy(upcast(p));
+}
+
 void Engine::destroy(const IndirectLight* p) {
     upcast(this)->destroy(upcast(p));
 }
@@ -891,5 +1073,24 @@ DebugRegistry& Engine::getDebugRegistry() noexcept {
     return upcast(this)->getDebugRegistry();
 }
 
+utils::JobSystem& Engine::getJobSystem() noexcept {
+    return upcast(this)->getJobSystem();
+}
+
+void Engine::setTextureStreamingBudget(size_t bytes) noexcept {
+    upcast(this)->getTextureStreamer().setBudget(bytes);
+}
+
+size_t Engine::getTextureStreamingBudget() const noexcept {
+    return upcast(this)->getTextureStreamer().getBudget();
+}
+
+void Engine::publishMaterials(bool wait) noexcept {
+    upcast(this)->getMaterialLoader().publish(wait);
+}
+
+Engine::MemoryStats Engine::getMemoryStats() const noexcept {
+    return upcast(this)->getMemoryStats();
+}
 
 } // namespace filament
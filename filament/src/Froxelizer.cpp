@@ -748,7 +748,7 @@ void Froxelizer::froxelizeAssignRecordsCompress() noexcept {
         } while(records[i].lights == b.lights);
     }
 out_of_memory:
-    ;
+    mRecordCount = offset;
 }
 
 static inline float2 project(mat4f const& p, float3 const& v) noexcept {
@@ -0,0 +1,250 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "details/GeometryArena.h"
+
+#include "details/Engine.h"
+#include "details/IndexBuffer.h"
+#include "details/VertexBuffer.h"
+
+#include "driver/Driver.h"
+
+#include "FilamentAPI-impl.h"
+
+#include <utils/Panic.h>
+
+#include <algorithm>
+
+#include <stdlib.h>
+
+namespace filament {
+
+using namespace details;
+
+struct GeometryArena::BuilderDetails {
+    struct Attribute {
+        AttributeType type = AttributeType::FLOAT4;
+        uint32_t offset = 0;
+    };
+    VertexBuffer::Builder mVertexBuffer;
+    Attribute mAttributes[MAX_ATTRIBUTE_BUFFERS_COUNT];
+    AttributeBitset mDeclaredAttributes;
+    uint32_t mVertexCount = 0;
+    uint32_t mIndexCount = 0;
+    uint32_t mVertexStride = 0;
+};
+
+using BuilderType = GeometryArena;
+BuilderType::Builder::Builder() noexcept = default;
+BuilderType::Builder::~Builder() noexcept = default;
+BuilderType::Builder::Builder(BuilderType::Builder const& rhs) noexcept = default;
+BuilderType::Builder::Builder(BuilderType::Builder&& rhs) noexcept = default;
+BuilderType::Builder& BuilderType::Builder::operator=(BuilderType::Builder const& rhs) noexcept = default;
+BuilderType::Builder& BuilderType::Builder::operator=(BuilderType::Builder&& rhs) noexcept = default;
+
+GeometryArena::Builder& GeometryArena::Builder::vertexCount(uint32_t vertexCount) noexcept {
+    mImpl->mVertexCount = vertexCount;
+    return *this;
+}
+
+GeometryArena::Builder& GeometryArena::Builder::indexCount(uint32_t indexCount) noexcept {
+    mImpl->mIndexCount = indexCount;
+    return *this;
+}
+
+GeometryArena::Builder& GeometryArena::Builder::attribute(VertexAttribute attribute,
+        AttributeType attributeType, uint32_t byteOffset, uint8_t byteStride) noexcept {
+    if (size_t(attribute) < MAX_ATTRIBUTE_BUFFERS_COUNT) {
+        // all the attributes live in the same interleaved buffer, so they share the stride,
+        // which must at least cover the furthest attribute. It's applied in build().
+        const uint32_t end = byteOffset + uint32_t(Driver::getElementTypeSize(attributeType));
+        mImpl->mVertexStride = std::max({ mImpl->mVertexStride, end, uint32_t(byteStride) });
+        mImpl->mAttributes[attribute] = { attributeType, byteOffset };
+        mImpl->mDeclaredAttributes.set(attribute);
+    }
+    return *this;
+}
+
+GeometryArena::Builder& GeometryArena::Builder::normalized(VertexAttribute attribute,
+        bool normalize) noexcept {
+    mImpl->mVertexBuffer.normalized(attribute, normalize);
+    return *this;
+}
+
+GeometryArena* GeometryArena::Builder::build(Engine& engine) {
+    if (!ASSERT_PRECONDITION_NON_FATAL(mImpl->mVertexCount > 0, "vertexCount cannot be 0")) {
+        return nullptr;
+    }
+
+    if (!ASSERT_PRECONDITION_NON_FATAL(mImpl->mIndexCount > 0, "indexCount cannot be 0")) {
+        return nullptr;
+    }
+
+    if (!ASSERT_PRECONDITION_NON_FATAL(mImpl->mVertexStride > 0, "no attribute declared")) {
+        return nullptr;
+    }
+
+    if (!ASSERT_PRECONDITION_NON_FATAL(mImpl->mVertexStride <= 255,
+            "vertex stride (%u) > 255", mImpl->mVertexStride)) {
+        return nullptr;
+    }
+
+    return upcast(engine).createGeometryArena(*this);
+}
+
+// ------------------------------------------------------------------------------------------------
+
+namespace details {
+
+FGeometryArena::FGeometryArena(FEngine& engine, const GeometryArena::Builder& builder)
+        : mVertices(builder->mVertexCount),
+          mIndices(builder->mIndexCount),
+          mVertexStride(builder->mVertexStride) {
+    VertexBuffer::Builder vertexBuffer(builder->mVertexBuffer);
+    builder->mDeclaredAttributes.forEachSetBit([&](size_t i) {
+        auto const& attribute = builder->mAttributes[i];
+        vertexBuffer.attribute(VertexAttribute(i), 0, attribute.type, attribute.offset,
+                uint8_t(mVertexStride));
+    });
+    mVertexBuffer = engine.createVertexBuffer(vertexBuffer
+            .vertexCount(builder->mVertexCount)
+            .bufferCount(1));
+    mIndexBuffer = engine.createIndexBuffer(IndexBuffer::Builder()
+            .indexCount(builder->mIndexCount)
+            .bufferType(IndexBuffer::IndexType::UINT));
+}
+
+void FGeometryArena::terminate(FEngine& engine) {
+    engine.destroy(mIndexBuffer);
+    engine.destroy(mVertexBuffer);
+}
+
+GeometryArena::Allocation FGeometryArena::allocate(
+        uint32_t vertexCount, uint32_t indexCount) noexcept {
+    const uint32_t firstVertex = mVertices.allocate(vertexCount);
+    if (firstVertex == RangeAllocator::INVALID) {
+        return {};
+    }
+    const uint32_t firstIndex = mIndices.allocate(indexCount);
+    if (firstIndex == RangeAllocator::INVALID) {
+        mVertices.free(firstVertex, vertexCount);
+        return {};
+    }
+    return { firstVertex, vertexCount, firstIndex, indexCount };
+}
+
+void FGeometryArena::free(Allocation const& allocation) noexcept {
+    if (allocation) {
+        mVertices.free(allocation.firstVertex, allocation.vertexCount);
+        mIndices.free(allocation.firstIndex, allocation.indexCount);
+    }
+}
+
+void FGeometryArena::setVertices(FEngine& engine, Allocation const& allocation,
+        BufferDescriptor&& vertices) {
+    if (!ASSERT_PRECONDITION_NON_FATAL(
+            vertices.size <= size_t(allocation.vertexCount) * mVertexStride,
+            "vertices overflow their allocation")) {
+        return;
+    }
+    const uint32_t byteSize = uint32_t(vertices.size);
+    mVertexBuffer->setBufferAt(engine, 0, std::move(vertices),
+            allocation.firstVertex * mVertexStride, byteSize);
+}
+
+void FGeometryArena::setIndices(FEngine& engine, Allocation const& allocation,
+        BufferDescriptor&& indices, IndexType indexType) {
+    const size_t indexSize = indexType == IndexType::UINT ? sizeof(uint32_t) : sizeof(uint16_t);
+    const size_t count = indices.size / indexSize;
+    if (!ASSERT_PRECONDITION_NON_FATAL(count <= allocation.indexCount,
+            "indices overflow their allocation")) {
+        return;
+    }
+
+    const uint32_t byteOffset = uint32_t(allocation.firstIndex * sizeof(uint32_t));
+    const uint32_t byteSize = uint32_t(count * sizeof(uint32_t));
+
+    if (indexType == IndexType::UINT && allocation.firstVertex == 0) {
+        // nothing to rebase
+        mIndexBuffer->setBuffer(engine, std::move(indices), byteOffset, byteSize);
+        return;
+    }
+
+    // there is no base vertex draw in ES 3.0, so the indices must point into the arena.
+    // The source buffer is released (its callback called) when we return.
+    BufferDescriptor source(std::move(indices));
+    uint32_t* const rebased = (uint32_t*)::malloc(byteSize);
+    rebaseIndices(rebased, source.buffer, count, indexType, allocation.firstVertex);
+
+    mIndexBuffer->setBuffer(engine, BufferDescriptor(rebased, byteSize,
+            [](void* buffer, size_t, void*) { ::free(buffer); }), byteOffset, byteSize);
+}
+
+void FGeometryArena::rebaseIndices(uint32_t* out, void const* indices, size_t count,
+        IndexType indexType, uint32_t base) noexcept {
+    if (indexType == IndexType::UINT) {
+        uint32_t const* const src = (uint32_t const*)indices;
+        std::transform(src, src + count, out, [base](uint32_t i) { return i + base; });
+    } else {
+        uint16_t const* const src = (uint16_t const*)indices;
+        std::transform(src, src + count, out, [base](uint16_t i) { return i + base; });
+    }
+}
+
+} // namespace details
+
+// ------------------------------------------------------------------------------------------------
+// Trampoline calling into private implementation
+// ------------------------------------------------------------------------------------------------
+
+using namespace details;
+
+GeometryArena::Allocation GeometryArena::allocate(
+        uint32_t vertexCount, uint32_t indexCount) noexcept {
+    return upcast(this)->allocate(vertexCount, indexCount);
+}
+
+void GeometryArena::free(Allocation const& allocation) noexcept {
+    upcast(this)->free(allocation);
+}
+
+void GeometryArena::setVertices(Engine& engine, Allocation const& allocation,
+        BufferDescriptor&& vertices) {
+    upcast(this)->setVertices(upcast(engine), allocation, std::move(vertices));
+}
+
+void GeometryArena::setIndices(Engine& engine, Allocation const& allocation,
+        BufferDescriptor&& indices, IndexType indexType) {
+    upcast(this)->setIndices(upcast(engine), allocation, std::move(indices), indexType);
+}
+
+VertexBuffer* GeometryArena::getVertexBuffer() const noexcept {
+    return upcast(this)->getVertexBuffer();
+}
+
+IndexBuffer* GeometryArena::getIndexBuffer() const noexcept {
+    return upcast(this)->getIndexBuffer();
+}
+
+size_t GeometryArena::getFreeVertexCount() const noexcept {
+    return upcast(this)->getFreeVertexCount();
+}
+
+size_t GeometryArena::getFreeIndexCount() const noexcept {
+    return upcast(this)->getFreeIndexCount();
+}
+
+} // namespace filament
@@ -62,11 +62,14 @@ FIndexBuffer::FIndexBuffer(FEngine& engine, const IndexBuffer::Builder& builder)
             (driver::ElementType)builder->mIndexType,
             uint32_t(builder->mIndexCount),
             driver::BufferUsage::STATIC);
+    mMemorySize = mIndexCount * Driver::getElementTypeSize((driver::ElementType)builder->mIndexType);
+    engine.getBufferMemory().add(mMemorySize);
 }
 
 void FIndexBuffer::terminate(FEngine& engine) {
     FEngine::DriverApi& driver = engine.getDriverApi();
     driver.destroyIndexBuffer(mHandle);
+    engine.getBufferMemory().remove(mMemorySize);
 }
 
 void FIndexBuffer::setBuffer(FEngine& engine,
@@ -77,6 +80,7 @@ void FIndexBuffer::setBuffer(FEngine& engine,
     }
 
     engine.getDriverApi().updateIndexBuffer(mHandle, std::move(buffer), byteOffset, byteSize);
+    engine.invalidateContent();
 }
 
 } // namespace details
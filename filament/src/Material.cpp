@@ -50,6 +50,9 @@ struct Material::BuilderDetails {
     const void* mPayload = nullptr;
     size_t mSize = 0;
     filaflat::MaterialParser* mMaterialParser = nullptr;
+    // set by asynchronous builds, which extract the interface blocks in a job
+    UniformInterfaceBlock* mUniformInterfaceBlock = nullptr;
+    SamplerInterfaceBlock* mSamplerInterfaceBlock = nullptr;
     bool mDefaultMaterial = false;
 };
 
@@ -72,22 +75,56 @@ Material::Builder& Material::Builder::package(const void* payload, size_t size)
 }
 
 Material* Material::Builder::build(Engine& engine) {
-    MaterialParser* materialParser = new MaterialParser(
-            upcast(engine).getBackend(), mImpl->mPayload, mImpl->mSize);
-    bool materialOK = materialParser->parse() && materialParser->isShadingMaterial();
-    if (!ASSERT_POSTCONDITION_NON_FATAL(materialOK, "could not parse the material package")) {
+    assert(upcast(engine).getBackend() != Backend::DEFAULT &&
+            "Default backend has not been resolved.");
+
+    MaterialParser* materialParser = FMaterial::parse(upcast(engine).getBackend(),
+            upcast(engine).getDriver().getShaderModel(), mImpl->mPayload, mImpl->mSize);
+    if (!materialParser) {
         return nullptr;
     }
 
+    mImpl->mMaterialParser = materialParser;
+
+    return upcast(engine).createMaterial(*this);
+}
+
+void Material::Builder::buildAsync(Engine& engine, BuildCallback callback, void* user,
+        bool prewarm) {
     assert(upcast(engine).getBackend() != Backend::DEFAULT &&
             "Default backend has not been resolved.");
 
+    upcast(engine).getMaterialLoader().add(mImpl->mPayload, mImpl->mSize, callback, user, prewarm);
+}
+
+namespace details {
+
+MaterialParser* FMaterial::parse(Backend backend, ShaderModel shaderModel,
+        const void* payload, size_t size) noexcept {
+    MaterialParser* materialParser = new MaterialParser(backend, payload, size);
+    bool materialOK = materialParser->parse() && materialParser->isShadingMaterial();
+    if (!ASSERT_POSTCONDITION_NON_FATAL(materialOK, "could not parse the material package")) {
+        delete materialParser;
+        return nullptr;
+    }
+
+    uint32_t version = 0;
+    materialParser->getMaterialVersion(&version);
+    if (version != MATERIAL_VERSION) {
+        CString name;
+        materialParser->getName(&name);
+        slog.e << "The material '" << name.c_str_safe() << "' was built with version "
+                << version << " but this engine expects version " << MATERIAL_VERSION
+                << ", it must be recompiled." << io::endl;
+        delete materialParser;
+        return nullptr;
+    }
+
     uint32_t v;
     materialParser->getShaderModels(&v);
     utils::bitset32 shaderModels;
     shaderModels.setValue(v);
 
-    driver::ShaderModel shaderModel = upcast(engine).getDriver().getShaderModel();
     if (!shaderModels.test(static_cast<uint32_t>(shaderModel))) {
         CString name;
         materialParser->getName(&name);
@@ -99,15 +136,20 @@ Material* Material::Builder::build(Engine& engine) {
         }
         slog.e << "Compiled material contains shader models 0x"
                 << io::hex << shaderModels.getValue() << io::dec << "." << io::endl;
+        delete materialParser;
         return nullptr;
     }
-
-    mImpl->mMaterialParser = materialParser;
-
-    return upcast(engine).createMaterial(*this);
+    return materialParser;
 }
 
-namespace details {
+FMaterial* FMaterial::create(FEngine& engine, MaterialParser* parser,
+        UniformInterfaceBlock* uib, SamplerInterfaceBlock* sib) {
+    Material::Builder builder;
+    builder->mMaterialParser = parser;
+    builder->mUniformInterfaceBlock = uib;
+    builder->mSamplerInterfaceBlock = sib;
+    return engine.createMaterial(builder);
+}
 
 FMaterial::FMaterial(FEngine& engine, const Material::Builder& builder)
         : mEngine(engine),
@@ -119,11 +161,19 @@ FMaterial::FMaterial(FEngine& engine, const Material::Builder& builder)
     UTILS_UNUSED_IN_RELEASE bool nameOk = parser->getName(&mName);
     assert(nameOk);
 
-    UTILS_UNUSED_IN_RELEASE bool sibOK = parser->getSIB(&mSamplerInterfaceBlock);
-    assert(sibOK);
+    if (builder->mSamplerInterfaceBlock) {
+        mSamplerInterfaceBlock = std::move(*builder->mSamplerInterfaceBlock);
+    } else {
+        UTILS_UNUSED_IN_RELEASE bool sibOK = parser->getSIB(&mSamplerInterfaceBlock);
+        assert(sibOK);
+    }
 
-    UTILS_UNUSED_IN_RELEASE bool uibOK = parser->getUIB(&mUniformInterfaceBlock);
-    assert(uibOK);
+    if (builder->mUniformInterfaceBlock) {
+        mUniformInterfaceBlock = std::move(*builder->mUniformInterfaceBlock);
+    } else {
+        UTILS_UNUSED_IN_RELEASE bool uibOK = parser->getUIB(&mUniformInterfaceBlock);
+        assert(uibOK);
+    }
 
     // Populate sampler bindings for the backend that will consume this Material.
     const uint8_t offset = getSamplerBindingsStart(engine.getBackend());
@@ -262,6 +312,11 @@ void FMaterial::terminate(FEngine& engine) {
     mDefaultInstance.terminate(engine);
 }
 
+void FMaterial::prewarm() const noexcept {
+    // the base variant is the only one every package has, the others can be filtered out
+    getProgram(0);
+}
+
 FMaterialInstance* FMaterial::createInstance() const noexcept {
     return mEngine.createMaterialInstance(this);
 }
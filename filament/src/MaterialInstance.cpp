@@ -94,6 +94,12 @@ void FMaterialInstance::terminate(FEngine& engine) {
 void FMaterialInstance::commitSlow(FEngine& engine) const {
     // update uniforms if needed
     FEngine::DriverApi& driver = engine.getDriverApi();
+    // only the parameters of masked materials and of materials with a custom depth shader
+    // can change the depth of what's rendered, and therefore the content of the shadow maps
+    if (mMaterial->getBlendingMode() == BlendingMode::MASKED ||
+            mMaterial->hasCustomDepthShader()) {
+        engine.invalidateContent();
+    }
     if (mUniforms.isDirty()) {
         driver.updateUniformBuffer(mUbHandle, mUniforms.toBufferDescriptor(driver));
         mUniforms.clean();
@@ -123,6 +129,19 @@ void FMaterialInstance::setParameter(const char* name,
             { upcast(texture)->getHwHandle(), sampler.getSamplerParams() });
 }
 
+bool FMaterialInstance::replaceTexture(
+        Handle<HwTexture> oldHandle, Handle<HwTexture> newHandle) noexcept {
+    bool replaced = false;
+    SamplerBuffer::Sampler const* const samplers = mSamplers.getBuffer();
+    for (size_t i = 0, c = mSamplers.getSize(); i < c; i++) {
+        if (samplers[i].t.getId() == oldHandle.getId()) {
+            mSamplers.setSampler(i, { newHandle, samplers[i].s });
+            replaced = true;
+        }
+    }
+    return replaced;
+}
+
 } // namespace details
 
 using namespace details;
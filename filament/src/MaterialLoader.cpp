@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "details/MaterialLoader.h"
+
+#include "details/Engine.h"
+#include "details/Material.h"
+
+#include <filaflat/MaterialParser.h>
+
+#include <utils/Systrace.h>
+
+using namespace utils;
+
+namespace filament {
+namespace details {
+
+FMaterialLoader::FMaterialLoader(FEngine& engine) noexcept : mEngine(engine) {
+}
+
+FMaterialLoader::~FMaterialLoader() noexcept {
+    assert(mBuilds.empty());
+}
+
+void FMaterialLoader::terminate() noexcept {
+    JobSystem& js = mEngine.getJobSystem();
+    for (Build* build : mBuilds) {
+        js.waitAndRelease(build->job);
+        delete build->parser;
+        delete build;
+    }
+    mBuilds.clear();
+}
+
+void FMaterialLoader::add(const void* payload, size_t size,
+        Material::Builder::BuildCallback callback, void* user, bool prewarm) noexcept {
+    Build* const build = new Build;
+    build->callback = callback;
+    build->user = user;
+    build->prewarm = prewarm;
+    mBuilds.push_back(build);
+
+    // the job must not touch the engine, so we resolve what it needs from it here
+    const driver::Backend backend = mEngine.getBackend();
+    const Material::ShaderModel shaderModel = mEngine.getDriver().getShaderModel();
+
+    JobSystem& js = mEngine.getJobSystem();
+    build->job = js.runAndRetain(js.createJob(nullptr,
+            [build, backend, shaderModel, payload, size](JobSystem&, JobSystem::Job*) {
+                SYSTRACE_NAME("FMaterialLoader::parse");
+                filaflat::MaterialParser* parser =
+                        FMaterial::parse(backend, shaderModel, payload, size);
+                if (parser) {
+                    UTILS_UNUSED_IN_RELEASE bool uibOK = parser->getUIB(&build->uib);
+                    UTILS_UNUSED_IN_RELEASE bool sibOK = parser->getSIB(&build->sib);
+                    assert(uibOK && sibOK);
+                }
+                build->parser = parser;
+                build->done.store(true, std::memory_order_release);
+            }));
+}
+
+void FMaterialLoader::publish(bool wait) noexcept {
+    SYSTRACE_CALL();
+    JobSystem& js = mEngine.getJobSystem();
+    while (!mBuilds.empty()) {
+        Build* const build = mBuilds.front();
+        if (!wait && !build->done.load(std::memory_order_acquire)) {
+            // later builds wait for this one, even if they're done
+            break;
+        }
+        js.waitAndRelease(build->job);
+
+        // the callback can start new builds, so the build is removed first
+        mBuilds.pop_front();
+
+        FMaterial* material = nullptr;
+        if (build->parser) {
+            material = FMaterial::create(mEngine, build->parser, &build->uib, &build->sib);
+            if (material && build->prewarm) {
+                material->prewarm();
+            }
+        }
+        if (build->callback) {
+            build->callback(material, build->user);
+        }
+        delete build;
+    }
+}
+
+} // namespace details
+} // namespace filament
@@ -142,7 +142,7 @@ void PostProcessManager::finish(driver::TargetBufferFlags discarded,
             // draw a full screen triangle
             pipeline.program = commands[i].program;
             driver.beginRenderPass(target->target, params);
-            driver.draw(pipeline, fullScreenRenderPrimitive);
+            driver.draw(pipeline, fullScreenRenderPrimitive, 1);
             driver.endRenderPass();
         } else {
             driver.blit(TargetBufferFlags::COLOR,
@@ -170,7 +170,7 @@ void PostProcessManager::finish(driver::TargetBufferFlags discarded,
         setSource(params.viewport.width, params.viewport.height, previous->texture, previous->w, previous->h);
         pipeline.program = commands.back().program;
         driver.beginRenderPass(viewRenderTarget, params);
-        driver.draw(pipeline, fullScreenRenderPrimitive);
+        driver.draw(pipeline, fullScreenRenderPrimitive, 1);
         driver.endRenderPass();
 
     } else {
@@ -262,7 +262,7 @@ FrameGraphResource PostProcessManager::toneMapping(FrameGraph& fg,
 
                 auto const& target = resources.getRenderTarget(data.output);
                 driver.beginRenderPass(target.target, target.params);
-                driver.draw(pipeline, fullScreenRenderPrimitive);
+                driver.draw(pipeline, fullScreenRenderPrimitive, 1);
                 driver.endRenderPass();
             });
 
@@ -313,7 +313,7 @@ FrameGraphResource PostProcessManager::fxaa(FrameGraph& fg,
 
                 auto const& target = resources.getRenderTarget(data.output);
                 driver.beginRenderPass(target.target, target.params);
-                driver.draw(pipeline, fullScreenRenderPrimitive);
+                driver.draw(pipeline, fullScreenRenderPrimitive, 1);
                 driver.endRenderPass();
             });
 
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RangeAllocator.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include <assert.h>
+
+namespace filament {
+
+RangeAllocator::RangeAllocator(uint32_t size) noexcept
+        : mSize(size), mFreeSize(size) {
+    if (size) {
+        mFreeList.push_back({ 0, size });
+    }
+}
+
+uint32_t RangeAllocator::allocate(uint32_t size) noexcept {
+    if (!size || size > mFreeSize) {
+        return INVALID;
+    }
+
+    // best fit, the free-list stays short as long as freed ranges are coalesced
+    auto best = mFreeList.end();
+    for (auto it = mFreeList.begin(); it != mFreeList.end(); ++it) {
+        if (it->size >= size && (best == mFreeList.end() || it->size < best->size)) {
+            best = it;
+            if (it->size == size) {
+                break;
+            }
+        }
+    }
+    if (best == mFreeList.end()) {
+        return INVALID;
+    }
+
+    const uint32_t offset = best->offset;
+    if (best->size == size) {
+        mFreeList.erase(best);
+    } else {
+        best->offset += size;
+        best->size -= size;
+    }
+    mFreeSize -= size;
+    return offset;
+}
+
+void RangeAllocator::free(uint32_t offset, uint32_t size) noexcept {
+    if (!size || offset == INVALID) {
+        return;
+    }
+    assert(offset + size <= mSize);
+
+    // first free range after the one we're freeing
+    auto next = std::upper_bound(mFreeList.begin(), mFreeList.end(), offset,
+            [](uint32_t offset, Range const& range) { return offset < range.offset; });
+
+    assert(next == mFreeList.end() || offset + size <= next->offset);
+    assert(next == mFreeList.begin() || std::prev(next)->offset + std::prev(next)->size <= offset);
+
+    const bool mergePrev = next != mFreeList.begin() &&
+            std::prev(next)->offset + std::prev(next)->size == offset;
+    const bool mergeNext = next != mFreeList.end() && offset + size == next->offset;
+
+    if (mergePrev && mergeNext) {
+        std::prev(next)->size += size + next->size;
+        mFreeList.erase(next);
+    } else if (mergePrev) {
+        std::prev(next)->size += size;
+    } else if (mergeNext) {
+        next->offset = offset;
+        next->size += size;
+    } else {
+        mFreeList.insert(next, { offset, size });
+    }
+    mFreeSize += size;
+}
+
+} // namespace filament
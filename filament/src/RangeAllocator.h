@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_RANGEALLOCATOR_H
+#define TNT_FILAMENT_RANGEALLOCATOR_H
+
+#include <limits>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace filament {
+
+/*
+ * RangeAllocator hands out sub-ranges of [0, size). The free ranges are kept sorted by offset,
+ * so a freed range is merged with its free neighbours and the free space doesn't fragment
+ * over time. Allocations are served from the smallest free range that fits.
+ */
+class RangeAllocator {
+public:
+    static constexpr uint32_t INVALID = std::numeric_limits<uint32_t>::max();
+
+    explicit RangeAllocator(uint32_t size = 0) noexcept;
+
+    // returns the offset of the allocated range, or INVALID if there is no room for it
+    uint32_t allocate(uint32_t size) noexcept;
+
+    // size must be the size the range was allocated with
+    void free(uint32_t offset, uint32_t size) noexcept;
+
+    uint32_t getSize() const noexcept { return mSize; }
+    uint32_t getFreeSize() const noexcept { return mFreeSize; }
+
+    // 1 when all the free space is contiguous
+    size_t getFreeRangeCount() const noexcept { return mFreeList.size(); }
+
+private:
+    struct Range {
+        uint32_t offset;
+        uint32_t size;
+    };
+    std::vector<Range> mFreeList;
+    uint32_t mSize = 0;
+    uint32_t mFreeSize = 0;
+};
+
+} // namespace filament
+
+#endif // TNT_FILAMENT_RANGEALLOCATOR_H
@@ -20,6 +20,7 @@
 #include "details/Material.h"
 #include "details/MaterialInstance.h"
 #include "details/RenderPrimitive.h"
+#include "details/ShadowAtlas.h"
 #include "details/ShadowMap.h"
 #include "details/View.h"
 
@@ -44,38 +45,67 @@ RenderPass::~RenderPass() noexcept = default;
 
 UTILS_ALWAYS_INLINE // this allows the compiler to devirtualize some calls
 inline              // this removes the code from the compilation unit
-void RenderPass::render(
-        FEngine& engine, JobSystem& js,
-        FScene& scene, Range<uint32_t> vr,
-        uint32_t commandTypeFlags, RenderFlags renderFlags,
+void RenderPass::execute(FEngine& engine, FView& view, Slice<Command> const& work,
         const CameraInfo& camera, filament::Viewport const& viewport,
-        GrowingSlice<Command>& commands) noexcept {
+        View::PassStats& depthStats, View::PassStats& colorStats) noexcept {
 
-    SYSTRACE_CONTEXT();
+    driver::DriverApi& driver = engine.getDriverApi();
 
-    // trace the number of visible renderables
-    SYSTRACE_VALUE32("visibleRenderables", vr.size());
+    // Take care not to upload data within the render pass (synchronize can commit froxel data)
+    RenderPass::updateInstancesUBO(driver, view, work);
+
+    beginRenderPass(driver, viewport, camera);
+
+    // Now, execute all commands
+    RenderPass::recordDriverCommands(driver, view, work, depthStats, colorStats);
 
-    FScene::RenderableSoa const& soa = scene.getRenderableData();
+    endRenderPass(driver, viewport);
+
+    // Kick the GPU since we're done with this render target
+    driver.flush();
+    // Wake-up the driver thread
+    engine.flush();
+}
+
+/* static */
+Slice<RenderPass::Command> RenderPass::buildCommands(
+        FEngine& engine, JobSystem& js,
+        FScene::RenderableSoa& soa, Range<uint32_t> vr,
+        uint32_t commandTypeFlags, RenderFlags renderFlags, uint8_t cascadeCount,
+        const CameraInfo& camera, GrowingSlice<Command>& commands) noexcept {
 
     // up-to-date summed primitive counts needed for generateCommands()
-    updateSummedPrimitiveCounts(const_cast<FScene::RenderableSoa&>(soa), vr);
+    updateSummedPrimitiveCounts(soa, vr);
+
+    return buildCommands(engine, js, soa, soa.data<FScene::VISIBLE_MASK>(), vr,
+            commandTypeFlags, renderFlags, cascadeCount, camera, commands);
+}
+
+/* static */
+Slice<RenderPass::Command> RenderPass::buildCommands(
+        FEngine& engine, JobSystem& js,
+        FScene::RenderableSoa const& soa, uint8_t const* visibleMask, Range<uint32_t> vr,
+        uint32_t commandTypeFlags, RenderFlags renderFlags, uint8_t cascadeCount,
+        const CameraInfo& camera, GrowingSlice<Command>& commands) noexcept {
+
+    SYSTRACE_CONTEXT();
+
+    // trace the number of visible renderables
+    SYSTRACE_VALUE32("visibleRenderables", vr.size());
 
     // compute how much maximum storage we need for this pass
     uint32_t growBy = FScene::getPrimitiveCount(soa, vr.last);
-    // double the color pass for transparent objects that need to render twice
-    const bool colorPass  = bool(commandTypeFlags & CommandTypeFlags::COLOR);
-    const bool depthPass  = bool(commandTypeFlags & (CommandTypeFlags::DEPTH | CommandTypeFlags::SHADOW));
-    growBy *= uint32_t(colorPass * 2 + depthPass);
+    growBy *= getCommandsPerPrimitive(commandTypeFlags, cascadeCount);
     Command* const curr = commands.grow(growBy);
 
     // we extract camera position/forward outside of the loop, because these are not cheap.
     const float3 cameraPosition(camera.getPosition());
     const float3 cameraForwardVector(camera.getForwardVector());
-    auto work = [commandTypeFlags, curr, &soa, renderFlags, cameraPosition, cameraForwardVector]
+    auto work = [commandTypeFlags, curr, &soa, visibleMask, renderFlags, cascadeCount,
+            cameraPosition, cameraForwardVector]
             (uint32_t startIndex, uint32_t indexCount) {
-        RenderPass::generateCommands(commandTypeFlags, curr,
-                soa, { startIndex, startIndex + indexCount }, renderFlags,
+        RenderPass::generateCommands(commandTypeFlags, curr, soa, visibleMask,
+                { startIndex, startIndex + indexCount }, renderFlags, cascadeCount,
                 cameraPosition, cameraForwardVector);
     };
 
@@ -84,6 +114,8 @@ void RenderPass::render(
 
     { // scope for systrace
         SYSTRACE_NAME("jobCommandsParallel");
+        CpuProfiler::Scope profile(engine.getCpuProfiler(),
+                CpuProfiler::Stage::COMMAND_GENERATION);
         js.runAndWait(jobCommandsParallel);
     }
 
@@ -94,44 +126,156 @@ void RenderPass::render(
 
     { // sort all commands
         SYSTRACE_NAME("sort commands");
+        CpuProfiler::Scope profile(engine.getCpuProfiler(), CpuProfiler::Stage::SORT);
         std::sort(commands.begin(), commands.end());
     }
 
-    // Take care not to upload data within the render pass (synchronize can commit froxel data)
-    driver::DriverApi& driver = engine.getDriverApi();
-    beginRenderPass(driver, viewport, camera);
+    RenderPass::instanceCommands(commands.begin(), commands.end());
 
-    // Now, execute all commands
-    RenderPass::recordDriverCommands(driver, scene, commands);
+    // the SENTINEL commands (including the cancelled ones) are sorted last
+    Command* const last = std::lower_bound(commands.begin(), commands.end(),
+            uint64_t(Pass::SENTINEL), [](Command const& lhs, CommandKey key) {
+                return lhs.key < key;
+            });
+    return { commands.begin(), last };
+}
 
-    endRenderPass(driver, viewport);
+/* static */
+UTILS_NOINLINE
+uint32_t RenderPass::instanceCommands(Command* const first, Command* const last) noexcept {
+    SYSTRACE_CALL();
 
-    // Kick the GPU since we're done with this render target
-    driver.flush();
-    // Wake-up the driver thread
-    engine.flush();
+    uint32_t instanceCount = 0;
+    Command* UTILS_RESTRICT curr = first;
+    while (curr != last && curr->key != uint64_t(Pass::SENTINEL)) {
+        Command* const UTILS_RESTRICT head = curr++;
+        PrimitiveInfo const& info = head->primitive;
+
+        // skinned renderables have their own range of bones, they can't be instanced
+        // and commands of different shadow cascades are rendered in different passes
+        if (!info.perRenderableBones) {
+            Command const* const end = first + std::min(
+                    size_t(last - first), size_t(head - first) + CONFIG_MAX_INSTANCES);
+            while (curr != end && curr->key != uint64_t(Pass::SENTINEL) &&
+                   curr->primitive.primitiveHandle.getId() == info.primitiveHandle.getId() &&
+                   curr->primitive.mi == info.mi &&
+                   curr->primitive.materialVariant.key == info.materialVariant.key &&
+                   !(curr->primitive.rasterState != info.rasterState) &&
+                   !curr->primitive.perRenderableBones &&
+                   !((curr->key ^ head->key) & CASCADE_MASK)) {
+                curr->primitive.instanceCount = 0;
+                ++curr;
+            }
+        }
+
+        const uint32_t count = uint32_t(curr - head);
+        head->primitive.instanceCount = uint8_t(count);
+
+        // when the renderables are consecutive, their entries in the renderable UBO can be
+        // bound directly, otherwise they're gathered into the instances UBO
+        bool consecutive = true;
+        for (uint32_t i = 1; i < count && consecutive; i++) {
+            consecutive = head[i].primitive.index == head->primitive.index + i;
+        }
+        head->primitive.instancesUbo = !consecutive;
+        instanceCount += consecutive ? 0 : count;
+    }
+    return instanceCount;
+}
+
+/* static */
+UTILS_NOINLINE
+void RenderPass::updateInstancesUBO(FEngine::DriverApi& driver, FView& view,
+        Slice<Command> commands) noexcept {
+    SYSTRACE_CALL();
+
+    uint32_t instanceCount = 0;
+    for (Command const& c : commands) {
+        instanceCount += c.primitive.instancesUbo ? c.primitive.instanceCount : 0u;
+    }
+    if (!instanceCount) {
+        return;
+    }
+
+    const size_t size = instanceCount * sizeof(PerRenderableUib);
+
+    // allocate space into the command stream directly
+    void* const buffer = driver.allocate(size);
+
+    uint32_t first = 0;
+    for (Command* c = commands.begin(), *e = commands.end(); c != e; c++) {
+        if (c->primitive.instancesUbo) {
+            const uint32_t count = c->primitive.instanceCount;
+            for (uint32_t i = 0; i < count; i++) {
+                view.copyRenderableUniforms(buffer,
+                        (first + i) * sizeof(PerRenderableUib), c[i].primitive.index);
+            }
+            // from now on, index refers to the instances UBO
+            assert(first <= std::numeric_limits<uint16_t>::max());
+            c->primitive.index = uint16_t(first);
+            first += count;
+        }
+    }
+
+    FScene& scene = *view.getScene();
+    driver.updateUniformBuffer(scene.prepareInstancesUBO(instanceCount), { buffer, size });
+    scene.addUniformBytes(size);
+}
+
+static inline bool isSamePipeline(
+        Driver::PipelineState const& lhs, Driver::PipelineState const& rhs) noexcept {
+    return lhs.program.getId() == rhs.program.getId() &&
+           lhs.rasterState == rhs.rasterState &&
+           lhs.polygonOffset.slope == rhs.polygonOffset.slope &&
+           lhs.polygonOffset.constant == rhs.polygonOffset.constant;
 }
 
 UTILS_NOINLINE // no need to be inlined
 void RenderPass::recordDriverCommands(
         FEngine::DriverApi& UTILS_RESTRICT driver,  // using restrict here is very important
-        FScene& UTILS_RESTRICT scene,
-        Slice<Command> const& commands) noexcept {
+        FView& UTILS_RESTRICT view,
+        Slice<Command> const& commands,
+        View::PassStats& depthStats, View::PassStats& colorStats) noexcept {
     SYSTRACE_CALL();
 
+    FScene& UTILS_RESTRICT scene = *view.getScene();
+    CpuProfiler::Scope profile(scene.getEngine().getCpuProfiler(), CpuProfiler::Stage::RECORDING);
+
     if (!commands.empty()) {
         Driver::PipelineState pipeline;
-        Handle<HwUniformBuffer> uboHandle = scene.getRenderableUBO();
+        Handle<HwUniformBuffer> uboHandle = view.getRenderableUBO();
+        Handle<HwUniformBuffer> instancesUboHandle = scene.getInstancesUBO();
+        Handle<HwUniformBuffer> bonesUboHandle = scene.getBonesUBO();
         FMaterialInstance const* UTILS_RESTRICT mi = nullptr;
         FMaterial const* UTILS_RESTRICT ma = nullptr;
+        View::PassStats* const passStats[2] = { &depthStats, &colorStats };
+        HandleBase::HandleId program = HandleBase::nullid;
+
+        // The state last sent to the driver, so that unchanged bindings are not sent again and
+        // draws that only change the per-renderable data are sent as a compact drawDelta().
+        Driver::PipelineState drawnPipeline;
+        HandleBase::HandleId boundUbo = HandleBase::nullid;
+        size_t boundOffset = 0;
+        uint32_t boundBones = 0;
+        uint32_t deltaCount = 0;
+
         Command const* UTILS_RESTRICT c;
-        for (c = commands.cbegin(); c->key != -1LLU; ++c) {
+        Command const* const end = commands.cend();
+        for (c = commands.cbegin(); c != end; ++c) {
             /*
              * Be careful when changing code below, this is the hot inner-loop
              */
 
+            View::PassStats& stats = *passStats[(c->key & PASS_MASK) != uint64_t(Pass::DEPTH)];
+            stats.commands++;
+
             // per-renderable uniform
             const PrimitiveInfo info = c->primitive;
+            if (UTILS_UNLIKELY(!info.instanceCount)) {
+                // this command is drawn by a previous instanced command
+                continue;
+            }
+            stats.drawCalls++;
             pipeline.rasterState = info.rasterState;
             if (UTILS_UNLIKELY(mi != info.mi)) {
                 // this is always taken the first time
@@ -139,18 +283,77 @@ void RenderPass::recordDriverCommands(
                 pipeline.polygonOffset = mi->getPolygonOffset();
                 ma = mi->getMaterial();
                 mi->use(driver);
+                stats.materialInstanceSwitches++;
             }
 
             pipeline.program = ma->getProgram(info.materialVariant.key);
+            if (pipeline.program.getId() != program) {
+                program = pipeline.program.getId();
+                stats.programSwitches++;
+            }
             size_t offset = info.index * sizeof(PerRenderableUib);
-            if (info.perRenderableBones) {
-                driver.bindUniformBuffer(BindingPoints::PER_RENDERABLE_BONES, info.perRenderableBones);
+            if (info.perRenderableBones && info.perRenderableBones != boundBones) {
+                // the shaders always see CONFIG_MAX_BONE_COUNT bones from the bound offset
+                boundBones = info.perRenderableBones;
+                driver.bindUniformBufferRange(BindingPoints::PER_RENDERABLE_BONES, bonesUboHandle,
+                        info.perRenderableBones, CONFIG_MAX_BONE_COUNT * sizeof(PerRenderableUibBone));
             }
-            driver.bindUniformBufferRange(BindingPoints::PER_RENDERABLE, uboHandle, offset, sizeof(PerRenderableUib));
-            driver.draw(pipeline, info.primitiveHandle);
+
+            // the range bound must cover the whole ObjectUniforms block, whatever the number
+            // of instances drawn, see FScene::getRenderableUBOSlack()
+            Handle<HwUniformBuffer> const& ubo = info.instancesUbo ? instancesUboHandle : uboHandle;
+            if (isSamePipeline(pipeline, drawnPipeline) && ubo.getId() == boundUbo) {
+                // only the primitive and the per-renderable data can be different
+                driver.drawDelta(BindingPoints::PER_RENDERABLE, uint32_t(offset),
+                        info.primitiveHandle, info.instanceCount);
+                deltaCount++;
+            } else {
+                if (ubo.getId() != boundUbo || offset != boundOffset) {
+                    driver.bindUniformBufferRange(BindingPoints::PER_RENDERABLE, ubo,
+                            offset, CONFIG_MAX_INSTANCES * sizeof(PerRenderableUib));
+                }
+                driver.draw(pipeline, info.primitiveHandle, info.instanceCount);
+                drawnPipeline = pipeline;
+            }
+            boundUbo = ubo.getId();
+            boundOffset = offset;
         }
 
         SYSTRACE_VALUE32("commandCount", c - commands.cbegin());
+        SYSTRACE_VALUE32("deltaCommandCount", deltaCount);
+    }
+}
+
+void RenderPass::prewarmDriverCommands(FEngine::DriverApi& driver,
+        Slice<Command> const& commands,
+        Handle<HwRenderTarget> rth, RenderPassParams const& params) noexcept {
+    SYSTRACE_CALL();
+
+    Driver::PipelineState pipeline;
+    Driver::PipelineState prewarmedPipeline;
+    HandleBase::HandleId prewarmedPrimitive = HandleBase::nullid;
+    FMaterialInstance const* mi = nullptr;
+    FMaterial const* ma = nullptr;
+    for (Command const& c : commands) {
+        // the pipeline state is computed the same way as in recordDriverCommands()
+        const PrimitiveInfo info = c.primitive;
+        if (!info.instanceCount) {
+            continue;
+        }
+        pipeline.rasterState = info.rasterState;
+        if (mi != info.mi) {
+            mi = info.mi;
+            pipeline.polygonOffset = mi->getPolygonOffset();
+            ma = mi->getMaterial();
+        }
+        pipeline.program = ma->getProgram(info.materialVariant.key);
+        if (isSamePipeline(pipeline, prewarmedPipeline) &&
+                info.primitiveHandle.getId() == prewarmedPrimitive) {
+            continue;
+        }
+        driver.prewarmPipeline(pipeline, info.primitiveHandle, rth, params);
+        prewarmedPipeline = pipeline;
+        prewarmedPrimitive = info.primitiveHandle.getId();
     }
 }
 
@@ -205,7 +408,8 @@ void RenderPass::setupColorCommand(Command& cmdDraw, bool hasDepthPass,
 /* static */
 UTILS_NOINLINE
 void RenderPass::generateCommands(uint32_t commandTypeFlags, Command* const commands,
-        FScene::RenderableSoa const& soa, utils::Range<uint32_t> range, RenderFlags renderFlags,
+        FScene::RenderableSoa const& soa, uint8_t const* visibleMask,
+        utils::Range<uint32_t> range, RenderFlags renderFlags, uint8_t cascadeCount,
         filament::math::float3 cameraPosition, filament::math::float3 cameraForward) noexcept {
 
     // generateCommands() writes both the draw and depth commands simultaneously such that
@@ -215,10 +419,7 @@ void RenderPass::generateCommands(uint32_t commandTypeFlags, Command* const comm
 
     // compute how much maximum storage we need
     uint32_t offset = FScene::getPrimitiveCount(soa, range.first);
-    // double the color pass for transparents that need to render twice
-    const bool colorPass  = bool(commandTypeFlags & CommandTypeFlags::COLOR);
-    const bool depthPass  = bool(commandTypeFlags & (CommandTypeFlags::DEPTH | CommandTypeFlags::SHADOW));
-    offset *= uint32_t(colorPass * 2 + depthPass);
+    offset *= getCommandsPerPrimitive(commandTypeFlags, cascadeCount);
     Command* const curr = commands + offset;
 
     /*
@@ -241,15 +442,18 @@ void RenderPass::generateCommands(uint32_t commandTypeFlags, Command* const comm
         default: // squash IDE warning -- should never happen.
         case CommandTypeFlags::COLOR:
             generateCommandsImpl<CommandTypeFlags::COLOR>(commandTypeFlags, curr,
-                    soa, range, renderFlags, cameraPosition, cameraForward);
+                    soa, visibleMask, range, renderFlags, cascadeCount,
+                    cameraPosition, cameraForward);
             break;
         case CommandTypeFlags::DEPTH_AND_COLOR:
             generateCommandsImpl<CommandTypeFlags::DEPTH_AND_COLOR>(commandTypeFlags, curr,
-                    soa, range, renderFlags, cameraPosition, cameraForward);
+                    soa, visibleMask, range, renderFlags, cascadeCount,
+                    cameraPosition, cameraForward);
             break;
         case CommandTypeFlags::SHADOW:
             generateCommandsImpl<CommandTypeFlags::SHADOW>(commandTypeFlags, curr,
-                    soa, range, renderFlags, cameraPosition, cameraForward);
+                    soa, visibleMask, range, renderFlags, cascadeCount,
+                    cameraPosition, cameraForward);
             break;
     }
 }
@@ -259,8 +463,9 @@ template<uint32_t commandTypeFlags>
 UTILS_NOINLINE
 void RenderPass::generateCommandsImpl(uint32_t,
         Command* UTILS_RESTRICT curr,
-        FScene::RenderableSoa const& UTILS_RESTRICT soa, utils::Range<uint32_t> range,
-        RenderFlags renderFlags,
+        FScene::RenderableSoa const& UTILS_RESTRICT soa, uint8_t const* UTILS_RESTRICT visibleMask,
+        utils::Range<uint32_t> range,
+        RenderFlags renderFlags, uint8_t cascadeCount,
         float3 cameraPosition, float3 cameraForward) noexcept {
 
     // generateCommands() writes both the draw and depth commands simultaneously such that
@@ -271,11 +476,13 @@ void RenderPass::generateCommandsImpl(uint32_t,
     const bool colorPass  = bool(commandTypeFlags & CommandTypeFlags::COLOR);
     const bool depthPass  = bool(commandTypeFlags & (CommandTypeFlags::DEPTH | CommandTypeFlags::SHADOW));
     const bool shadowPass = bool(commandTypeFlags & CommandTypeFlags::SHADOW);
+    // the shadow pass generates one depth command per cascade
+    const uint32_t depthCommandCount = shadowPass ? cascadeCount : 1u;
 
     auto const* const UTILS_RESTRICT soaWorldAABBCenter = soa.data<FScene::WORLD_AABB_CENTER>();
     auto const* const UTILS_RESTRICT soaVisibility      = soa.data<FScene::VISIBILITY_STATE>();
     auto const* const UTILS_RESTRICT soaPrimitives      = soa.data<FScene::PRIMITIVES>();
-    auto const* const UTILS_RESTRICT soaBonesUbh        = soa.data<FScene::BONES_UBH>();
+    auto const* const UTILS_RESTRICT soaBonesOffset     = soa.data<FScene::BONES_OFFSET>();
 
     const bool hasShadowing = renderFlags & HAS_SHADOWING;
     const bool inverseFrontFaces = renderFlags & HAS_INVERSE_FRONT_FACES;
@@ -329,7 +536,7 @@ void RenderPass::generateCommandsImpl(uint32_t,
 
         cmdColor.key = makeField(soaVisibility[i].priority, PRIORITY_MASK, PRIORITY_SHIFT);
         cmdColor.primitive.index = (uint16_t)i;
-        cmdColor.primitive.perRenderableBones = soaBonesUbh[i];
+        cmdColor.primitive.perRenderableBones = soaBonesOffset[i];
         materialVariant.setShadowReceiver(soaVisibility[i].receiveShadows & hasShadowing);
         materialVariant.setSkinning(soaVisibility[i].skinning);
 
@@ -339,7 +546,7 @@ void RenderPass::generateCommandsImpl(uint32_t,
         cmdDepth.key |= makeField(soaVisibility[i].priority, PRIORITY_MASK, PRIORITY_SHIFT);
         cmdDepth.key |= makeField(distanceBits, DISTANCE_BITS_MASK, DISTANCE_BITS_SHIFT);
         cmdDepth.primitive.index = (uint16_t)i;
-        cmdDepth.primitive.perRenderableBones = soaBonesUbh[i];
+        cmdDepth.primitive.perRenderableBones = soaBonesOffset[i];
         cmdDepth.primitive.materialVariant.setSkinning(soaVisibility[i].skinning);
 
         const bool shadowCaster = soaVisibility[i].castShadows & hasShadowing;
@@ -441,11 +648,9 @@ void RenderPass::generateCommandsImpl(uint32_t,
             if (depthPass) {
                 Driver::RasterState rs = mi->getMaterial()->getRasterState();
 
-                // unconditionally write the command
                 cmdDepth.primitive.primitiveHandle = primitive.getHwHandle();
                 cmdDepth.primitive.mi = mi;
                 cmdDepth.primitive.rasterState.culling = rs.culling;
-                *curr = cmdDepth;
 
                 // If we are drawing depth+draw we don't want to put commands using
                 // alpha testing (indicated by the alpha to coverage flag) or blending in the
@@ -456,11 +661,22 @@ void RenderPass::generateCommandsImpl(uint32_t,
                 bool issueDepth =
                         (rs.depthWrite & !(colorPass & (rs.alphaToCoverage | rs.hasBlending())))
                         | writeDepthForShadows;
-                curr->key |= select(!issueDepth);
 
-                // handle the case where this primitive is empty / no-op
-                curr->key |= select(primitive.getPrimitiveType() == PrimitiveType::NONE);
-                ++curr;
+                for (uint32_t c = 0; c < depthCommandCount; c++) {
+                    // unconditionally write the command
+                    *curr = cmdDepth;
+
+                    // in the shadow pass, undo the command if the renderable is not visible
+                    // from this cascade.
+                    bool inCascade = !shadowPass ||
+                            ((visibleMask[i] >> (FView::VISIBLE_CASCADE_BIT + c)) & 1u);
+                    curr->key |= makeField(shadowPass ? c : 0u, CASCADE_MASK, CASCADE_SHIFT);
+                    curr->key |= select(!(issueDepth & inCascade));
+
+                    // handle the case where this primitive is empty / no-op
+                    curr->key |= select(primitive.getPrimitiveType() == PrimitiveType::NONE);
+                    ++curr;
+                }
             }
         }
     }
@@ -491,11 +707,18 @@ FRenderer::ColorPass::ColorPass(const char* name,
 
 void FRenderer::ColorPass::beginRenderPass(
         driver::DriverApi& driver, filament::Viewport const& viewport, const CameraInfo& camera) noexcept {
-    // wait for froxelization to finish
+    // wait for froxelization to finish, unless the renderer already did
     // (this could even be a special command between the depth and color passes)
-    js.waitAndRelease(jobFroxelize);
+    if (jobFroxelize) {
+        js.waitAndRelease(jobFroxelize);
+    }
     view.commitFroxels(driver);
 
+    driver.beginRenderPass(rth, getRenderPassParams(view, viewport));
+}
+
+RenderPassParams FRenderer::ColorPass::getRenderPassParams(
+        FView const& view, filament::Viewport const& viewport) noexcept {
     // We won't need the depth or stencil buffers after this pass.
     RenderPassParams params = {};
     params.flags.discardEnd = TargetBufferFlags::DEPTH_AND_STENCIL;
@@ -515,7 +738,6 @@ void FRenderer::ColorPass::beginRenderPass(
             params.flags.clear = TargetBufferFlags::DEPTH_AND_STENCIL;
         }
         params.flags.discardStart = TargetBufferFlags::ALL;
-        driver.beginRenderPass(rth, params);
     } else {
         params.flags.discardStart = view.getDiscardedTargetBuffers();
         if (view.getClearTargetColor()) {
@@ -527,8 +749,8 @@ void FRenderer::ColorPass::beginRenderPass(
         if (view.getClearTargetStencil()) {
             params.flags.clear |= TargetBufferFlags::STENCIL;
         }
-        driver.beginRenderPass(rth, params);
     }
+    return params;
 }
 
 void FRenderer::ColorPass::endRenderPass(DriverApi& driver, filament::Viewport const& viewport) noexcept {
@@ -545,13 +767,10 @@ void FRenderer::ColorPass::endRenderPass(DriverApi& driver, filament::Viewport c
     }
 }
 
-void FRenderer::ColorPass::renderColorPass(FEngine& engine,
-        JobSystem& js, JobSystem::Job* sync,
-        Handle<HwRenderTarget> const rth, FView& view, filament::Viewport const& scaledViewport,
-        GrowingSlice<Command>& commands) noexcept {
-
+void FRenderer::ColorPass::prepareColorPass(FEngine& engine,
+        FView& view, filament::Viewport const& scaledViewport) noexcept {
     CameraInfo const& cameraInfo = view.getCameraInfo();
-    auto& soa = view.getScene()->getRenderableData();
+    auto& soa = view.getRenderableData();
     auto vr = view.getVisibleRenderables();
 
     // populate the RenderPrimitive array with the proper LOD
@@ -560,9 +779,12 @@ void FRenderer::ColorPass::renderColorPass(FEngine& engine,
     DriverApi& driver = engine.getDriverApi();
     view.prepareCamera(cameraInfo, scaledViewport);
     view.commitUniforms(driver);
+}
 
+Slice<RenderPass::Command> FRenderer::ColorPass::buildColorPass(FEngine& engine, JobSystem& js,
+        FView& view, GrowingSlice<Command>& commands) noexcept {
     RenderPass::RenderFlags flags = 0;
-    if (view.hasShadowing())               flags |= RenderPass::HAS_SHADOWING;
+    if (view.hasShadowing() || view.hasShadowAtlas()) flags |= RenderPass::HAS_SHADOWING;
     if (view.hasDirectionalLight())        flags |= RenderPass::HAS_DIRECTIONAL_LIGHT;
     if (view.hasDynamicLighting())         flags |= RenderPass::HAS_DYNAMIC_LIGHTING;
     if (view.isFrontFaceWindingInverted()) flags |= RenderPass::HAS_INVERSE_FRONT_FACES;
@@ -585,10 +807,21 @@ void FRenderer::ColorPass::renderColorPass(FEngine& engine,
             break;
     }
 
+    return RenderPass::buildCommands(engine, js,
+            view.getRenderableData(), view.getVisibleRenderables(),
+            commandType, flags, 1, view.getCameraInfo(), commands);
+}
+
+void FRenderer::ColorPass::executeColorPass(FEngine& engine,
+        JobSystem& js, JobSystem::Job* sync,
+        Handle<HwRenderTarget> const rth, FView& view, filament::Viewport const& scaledViewport,
+        Slice<Command> const& commands) noexcept {
+    DriverApi& driver = engine.getDriverApi();
     ColorPass colorPass("ColorPass", js, sync, view, rth);
     driver.pushGroupMarker("Color Pass");
-    colorPass.render(engine, js, *view.getScene(), vr, commandType, flags,
-            cameraInfo, scaledViewport, commands);
+    View::Stats& stats = view.getCurrentStats();
+    colorPass.execute(engine, view, commands,
+            view.getCameraInfo(), scaledViewport, stats.depthPass, stats.colorPass);
     driver.popGroupMarker();
 }
 
@@ -596,50 +829,167 @@ void FRenderer::ColorPass::renderColorPass(FEngine& engine,
 
 FRenderer::ShadowPass::ShadowPass(const char* name,
         ShadowMap const& shadowMap) noexcept
-        : RenderPass(name), shadowMap(shadowMap) {
+        : RenderPass(name), shadowMap(&shadowMap) {
+}
+
+FRenderer::ShadowPass::ShadowPass(const char* name,
+        ShadowAtlas const& shadowAtlas) noexcept
+        : RenderPass(name), shadowAtlas(&shadowAtlas) {
 }
 
 void FRenderer::ShadowPass::beginRenderPass(driver::DriverApi& driver,
         filament::Viewport const&, const CameraInfo&) noexcept {
-    shadowMap.beginRenderPass(driver);
+    if (shadowMap) {
+        shadowMap->beginRenderPass(driver, cascade);
+    } else {
+        shadowAtlas->beginRenderPass(driver, tile);
+    }
 }
 
 void FRenderer::ShadowPass::renderShadowMap(FEngine& engine, JobSystem& js,
         FView& view, GrowingSlice<Command>& commands) noexcept {
 
-    auto& soa = view.getScene()->getRenderableData();
+    auto& soa = view.getRenderableData();
     auto vr = view.getVisibleShadowCasters();
     ShadowMap const& shadowMap = view.getShadowMap();
-    filament::Viewport const& viewport = shadowMap.getViewport();
-    FCamera const& camera = shadowMap.getCamera();
-
-    CameraInfo cameraInfo = {
-            .projection         = mat4f{ camera.getProjectionMatrix() },
-            .cullingProjection  = mat4f{ camera.getCullingProjectionMatrix() },
-            .model              = camera.getModelMatrix(),
-            .view               = camera.getViewMatrix(),
-            .zn                 = camera.getNear(),
-            .zf                 = camera.getCullingFar(),
+    const size_t cascadeCount = shadowMap.getCascadeCount();
+
+    auto getCameraInfo = [](FCamera const& camera) -> CameraInfo {
+        return {
+                .projection         = mat4f{ camera.getProjectionMatrix() },
+                .cullingProjection  = mat4f{ camera.getCullingProjectionMatrix() },
+                .model              = camera.getModelMatrix(),
+                .view               = camera.getViewMatrix(),
+                .zn                 = camera.getNear(),
+                .zf                 = camera.getCullingFar(),
+        };
     };
 
+    // The cascades' cameras only differ by their projection, the first one is used for
+    // choosing the LODs and sorting the commands of all cascades.
+    const CameraInfo cameraInfo = getCameraInfo(shadowMap.getCamera(0));
+
     // populate the RenderPrimitive array with the proper LOD
     view.updatePrimitivesLod(engine, cameraInfo, soa, vr);
 
-    driver::DriverApi& driver = engine.getDriverApi();
-    view.prepareCamera(cameraInfo, viewport);
-    view.commitUniforms(driver);
-
     RenderPass::RenderFlags flags = 0;
     if (view.hasShadowing())               flags |= RenderPass::HAS_SHADOWING;
     if (view.hasDirectionalLight())        flags |= RenderPass::HAS_DIRECTIONAL_LIGHT;
     if (view.hasDynamicLighting())         flags |= RenderPass::HAS_DYNAMIC_LIGHTING;
     if (view.isFrontFaceWindingInverted()) flags |= RenderPass::HAS_INVERSE_FRONT_FACES;
 
+    // the commands of all the cascades are generated at once, sorted by cascade
+    Slice<Command> work = RenderPass::buildCommands(engine, js, soa, vr,
+            CommandTypeFlags::SHADOW, flags, uint8_t(cascadeCount), cameraInfo, commands);
+
+    driver::DriverApi& driver = engine.getDriverApi();
+    RenderPass::updateInstancesUBO(driver, view, work);
+
     ShadowPass shadowPass("ShadowPass", shadowMap);
     driver.pushGroupMarker("Shadow map Pass");
-    shadowPass.render(engine, js, *view.getScene(), vr,
-            CommandTypeFlags::SHADOW, flags, cameraInfo, viewport, commands);
+    Command* first = work.begin();
+    for (size_t c = 0; c < cascadeCount; c++) {
+        Command* const last = (c + 1 == cascadeCount) ? work.end() :
+                std::lower_bound(first, work.end(), makeField(c + 1, CASCADE_MASK, CASCADE_SHIFT),
+                        [](Command const& lhs, CommandKey key) { return lhs.key < key; });
+
+        // the first cascade always runs, because it clears the whole shadow map
+        if (c == 0 || shadowMap.isCascadeVisible(c)) {
+            const CameraInfo cascadeCameraInfo = getCameraInfo(shadowMap.getCamera(c));
+            const filament::Viewport viewport = shadowMap.getViewport(c);
+            view.prepareCamera(cascadeCameraInfo, viewport);
+            view.commitUniforms(driver);
+
+            shadowPass.cascade = uint8_t(c);
+            shadowPass.beginRenderPass(driver, viewport, cascadeCameraInfo);
+            View::PassStats& stats = view.getCurrentStats().shadowPass;
+            RenderPass::recordDriverCommands(driver, view, { first, last }, stats, stats);
+            shadowPass.endRenderPass(driver, viewport);
+        }
+        first = last;
+    }
+    driver.popGroupMarker();
+
+    // Kick the GPU since we're done with this render target
+    driver.flush();
+    // Wake-up the driver thread
+    engine.flush();
+}
+
+void FRenderer::ShadowPass::renderShadowAtlas(FEngine& engine, JobSystem& js,
+        FView& view, ArenaScope& arena, GrowingSlice<Command>& commands) noexcept {
+
+    auto& soa = view.getRenderableData();
+    auto vr = view.getVisibleShadowCasters();
+    ShadowAtlas const& shadowAtlas = view.getShadowAtlas();
+
+    // populate the RenderPrimitive array with the proper LOD
+    view.updatePrimitivesLod(engine, view.getCameraInfo(), soa, vr);
+
+    // the tiles' jobs below need the summed primitive counts, but can't update them
+    RenderPass::updateSummedPrimitiveCounts(soa, vr);
+
+    RenderPass::RenderFlags flags = RenderPass::HAS_SHADOWING;
+    if (view.hasDirectionalLight())        flags |= RenderPass::HAS_DIRECTIONAL_LIGHT;
+    if (view.hasDynamicLighting())         flags |= RenderPass::HAS_DYNAMIC_LIGHTING;
+    if (view.isFrontFaceWindingInverted()) flags |= RenderPass::HAS_INVERSE_FRONT_FACES;
+
+    // Each tile is culled and its commands built by its own job, into its own visibility mask
+    // and range of the command buffer. The tiles are processed in groups that fit in the
+    // command buffer, the commands of a group are recorded once all its jobs are done.
+    const size_t tileCount = shadowAtlas.getTileCount();
+    const size_t tileCapacity = FScene::getPrimitiveCount(soa, vr.last) + 1; // + SENTINEL
+    const size_t groupSize = std::min(tileCount,
+            std::max(size_t(1), commands.remain() / tileCapacity));
+    uint8_t* const masks = arena.allocate<uint8_t>(groupSize * vr.last, CACHELINE_SIZE);
+    Slice<Command> work[CONFIG_MAX_SHADOW_TILES];
+
+    driver::DriverApi& driver = engine.getDriverApi();
+    ShadowPass shadowPass("ShadowAtlasPass", shadowAtlas);
+    driver.pushGroupMarker("Shadow atlas Pass");
+    for (size_t first = 0; first < tileCount; first += groupSize) {
+        const size_t count = std::min(groupSize, tileCount - first);
+        Command* const buffer = commands.grow(uint32_t(count * tileCapacity));
+
+        // each tile is rendered like the first cascade of a shadow map, with its own casters
+        auto buildTiles = [&](uint32_t start, uint32_t n) {
+            for (size_t i = start; i < start + n; i++) {
+                uint8_t* const mask = masks + i * vr.last;
+                view.prepareShadowAtlasTile(first + i, mask);
+                GrowingSlice<Command> tileCommands(buffer + i * tileCapacity, tileCapacity);
+                work[i] = RenderPass::buildCommands(engine, js, soa, mask, vr,
+                        CommandTypeFlags::SHADOW, flags, 1,
+                        shadowAtlas.getTile(first + i).camera, tileCommands);
+            }
+        };
+        auto job = jobs::parallel_for(js, nullptr, 0, uint32_t(count),
+                std::cref(buildTiles), jobs::CountSplitter<1, 8>());
+        js.runAndWait(job);
+
+        for (size_t i = 0; i < count; i++) {
+            const size_t t = first + i;
+            ShadowAtlas::Tile const& tile = shadowAtlas.getTile(t);
+            RenderPass::updateInstancesUBO(driver, view, work[i]);
+
+            const filament::Viewport viewport = shadowAtlas.getViewport(t);
+            view.prepareCamera(tile.camera, viewport);
+            view.commitUniforms(driver);
+
+            shadowPass.tile = uint8_t(t);
+            shadowPass.beginRenderPass(driver, viewport, tile.camera);
+            View::PassStats& stats = view.getCurrentStats().shadowPass;
+            RenderPass::recordDriverCommands(driver, view, work[i], stats, stats);
+            shadowPass.endRenderPass(driver, viewport);
+        }
+
+        commands.clear();
+    }
     driver.popGroupMarker();
+
+    // Kick the GPU since we're done with this render target
+    driver.flush();
+    // Wake-up the driver thread
+    engine.flush();
 }
 
 void FRenderer::ShadowPass::endRenderPass(DriverApi& driver,
@@ -17,6 +17,8 @@
 #ifndef TNT_UTILS_RENDERPASS_H
 #define TNT_UTILS_RENDERPASS_H
 
+#include <filament/EngineEnums.h>
+#include <filament/View.h>
 #include <filament/Viewport.h>
 
 #include "details/Camera.h"
@@ -30,6 +32,8 @@
 #include <utils/compiler.h>
 #include <utils/Slice.h>
 
+#include <limits>
+
 namespace utils {
 class JobSystem;
 }
@@ -37,6 +41,8 @@ class JobSystem;
 namespace filament {
 namespace details {
 
+class FView;
+
 class RenderPass {
 public:
     static constexpr uint64_t DISTANCE_BITS_MASK            = 0xFFFFFFFFllu;
@@ -72,6 +78,9 @@ public:
     static constexpr uint64_t BLENDING_MASK                 = 0x00E0000000000000llu;
     static constexpr int BLENDING_SHIFT                     = 53;
 
+    static constexpr uint64_t CASCADE_MASK                  = 0x00E0000000000000llu;
+    static constexpr int CASCADE_SHIFT                      = 53;
+
     static constexpr uint64_t PASS_MASK                     = 0xFF00000000000000llu;
     static constexpr int PASS_SHIFT                         = 56;
 
@@ -95,6 +104,7 @@ public:
     //
     // a     = alpha masking
     // bbb   = blending
+    // ccc   = shadow map cascade (shadow pass only)
     // ppp   = priority
     // t     = two-pass transparency ordering
     // 0     = reserved, must be zero
@@ -102,7 +112,7 @@ public:
     // DEPTH command
     // |    8   | 3 | 3 | 2|       16       |               32               |
     // +--------+---+---+--+----------------+--------------------------------+
-    // |00000000|000|ppp|00|0000000000000000|          distanceBits          |
+    // |00000000|ccc|ppp|00|0000000000000000|          distanceBits          |
     // +--------+---+---+-------------------+--------------------------------+
     // | correctness    |     optimizations (truncation allowed)             |
     //
@@ -175,11 +185,18 @@ public:
     struct PrimitiveInfo { // 24 bytes
         FMaterialInstance const* mi = nullptr;              // 8 bytes (4)
         Handle<HwRenderPrimitive> primitiveHandle;          // 4 bytes
-        Handle<HwUniformBuffer> perRenderableBones;         // 4 bytes
+        uint32_t perRenderableBones = 0;                    // 4 bytes, offset in the bones UBO
         Driver::RasterState rasterState;                    // 4 bytes
         uint16_t index = 0;                                 // 2 bytes
         Variant materialVariant;                            // 1 byte
-        uint8_t reserved = { };                             // 1 byte
+        // 1: regular draw, 0: merged into the previous command,
+        // N > 1: instanced draw of this command and the N-1 following ones.
+        uint8_t instanceCount : 7;                          // 1 byte
+        // the instances don't have consecutive indices, they're copied to the scene's
+        // instances UBO and index is the first instance in that UBO.
+        uint8_t instancesUbo : 1;
+
+        PrimitiveInfo() noexcept : instanceCount(1), instancesUbo(false) { }
     };
 
     struct alignas(8) Command {     // 32 bytes
@@ -202,17 +219,71 @@ public:
     static constexpr RenderFlags HAS_DYNAMIC_LIGHTING    = 0x04;
     static constexpr RenderFlags HAS_INVERSE_FRONT_FACES = 0x08;
 
+    static_assert(CONFIG_MAX_INSTANCES < 128,
+            "CONFIG_MAX_INSTANCES must fit in PrimitiveInfo::instanceCount");
+
+    static_assert(CONFIG_MAX_SHADOW_CASCADES <= (CASCADE_MASK >> CASCADE_SHIFT) + 1,
+            "CONFIG_MAX_SHADOW_CASCADES must fit in the command key");
+
     explicit RenderPass(const char* name) noexcept : mName(name) { }
 
     virtual ~RenderPass() noexcept;
 
-    // appends rendering commands for the given view
-    void render(
-            FEngine& engine, utils::JobSystem& js,
-            FScene& scene, utils::Range<uint32_t> visibleRenderables,
-            uint32_t commandTypeFlags, RenderFlags renderFlags,
+    // uploads the instances of commands built by buildCommands() and records them in a render
+    // pass, this must be called from the thread that owns the driver.
+    void execute(FEngine& engine, FView& view, utils::Slice<Command> const& commands,
             const CameraInfo& camera, Viewport const& viewport,
-            utils::GrowingSlice<Command>& commands) noexcept;
+            View::PassStats& depthStats, View::PassStats& colorStats) noexcept;
+
+    // Merges runs of sorted commands that only differ by their renderable (same primitive,
+    // material instance, variant and raster state) into a single instanced command.
+    // Returns the number of instances that must be copied to the instances UBO, instanced
+    // commands whose renderables are consecutive use the renderable UBO directly.
+    static uint32_t instanceCommands(Command* first, Command* last) noexcept;
+
+protected:
+    // Generates the commands for the given renderables, sorts them and merges them into
+    // instanced commands. With the SHADOW command type, each renderable gets one depth command
+    // per shadow cascade it's visible in, sorted by cascade first.
+    // This doesn't use the driver and can run on a job, as long as no other job uses the
+    // renderable data.
+    // Returns the commands to execute, i.e. without the trailing SENTINEL commands.
+    static utils::Slice<Command> buildCommands(
+            FEngine& engine, utils::JobSystem& js,
+            FScene::RenderableSoa& soa, utils::Range<uint32_t> visibleRenderables,
+            uint32_t commandTypeFlags, RenderFlags renderFlags, uint8_t cascadeCount,
+            const CameraInfo& camera, utils::GrowingSlice<Command>& commands) noexcept;
+
+    // Same as above, except that the visibility of the renderables is read from visibleMask
+    // instead of soa, and that the summed primitive counts of soa must be up to date already.
+    // This doesn't write to soa, several can run concurrently with different visibleMasks.
+    static utils::Slice<Command> buildCommands(
+            FEngine& engine, utils::JobSystem& js,
+            FScene::RenderableSoa const& soa, uint8_t const* visibleMask,
+            utils::Range<uint32_t> visibleRenderables,
+            uint32_t commandTypeFlags, RenderFlags renderFlags, uint8_t cascadeCount,
+            const CameraInfo& camera, utils::GrowingSlice<Command>& commands) noexcept;
+
+    // Computes the SUMMED_PRIMITIVE_COUNT of the renderables in vr.
+    static void updateSummedPrimitiveCounts(
+            FScene::RenderableSoa& renderableData, utils::Range<uint32_t> vr) noexcept;
+
+    // Copies the instances of the instanced commands from the view's renderable uniforms to the
+    // scene's instances UBO, this must be called before recording the commands.
+    static void updateInstancesUBO(FEngine::DriverApi& driver, FView& view,
+            utils::Slice<Command> commands) noexcept;
+
+    // The draws of the DEPTH pass commands are counted in depthStats, the other ones in
+    // colorStats.
+    static void recordDriverCommands(FEngine::DriverApi& driver, FView& view,
+            utils::Slice<Command> const& commands,
+            View::PassStats& depthStats, View::PassStats& colorStats) noexcept;
+
+    // Asks the driver to create the pipelines that recordDriverCommands() would need to draw
+    // the commands in a render pass on rth started with params, without drawing anything.
+    static void prewarmDriverCommands(FEngine::DriverApi& driver,
+            utils::Slice<Command> const& commands,
+            Handle<HwRenderTarget> rth, driver::RenderPassParams const& params) noexcept;
 
 private:
     // Called just before rendering, make sure all needed asynchronous tasks are finished.
@@ -238,23 +309,27 @@ private:
             "Size of Commands jobs must be multiple of a cache-line size");
 
     static inline void generateCommands(uint32_t commandTypeFlags, Command* commands,
-            FScene::RenderableSoa const& soa, utils::Range<uint32_t> range, RenderFlags renderFlags,
+            FScene::RenderableSoa const& soa, uint8_t const* visibleMask,
+            utils::Range<uint32_t> range, RenderFlags renderFlags, uint8_t cascadeCount,
             filament::math::float3 cameraPosition, filament::math::float3 cameraForward) noexcept;
 
     template<uint32_t commandTypeFlags>
     static inline void generateCommandsImpl(uint32_t, Command* commands, FScene::RenderableSoa const& soa,
-            utils::Range<uint32_t> range, RenderFlags renderFlags, filament::math::float3 cameraPosition,
-            filament::math::float3 cameraForward) noexcept;
+            uint8_t const* visibleMask, utils::Range<uint32_t> range, RenderFlags renderFlags, uint8_t cascadeCount,
+            filament::math::float3 cameraPosition, filament::math::float3 cameraForward) noexcept;
+
+    // number of commands generated per primitive
+    static uint32_t getCommandsPerPrimitive(uint32_t commandTypeFlags, uint8_t cascadeCount) noexcept {
+        const bool colorPass  = bool(commandTypeFlags & CommandTypeFlags::COLOR);
+        const bool depthPass  = bool(commandTypeFlags & (CommandTypeFlags::DEPTH | CommandTypeFlags::SHADOW));
+        const bool shadowPass = bool(commandTypeFlags & CommandTypeFlags::SHADOW);
+        // double the color pass for transparent objects that need to render twice
+        return uint32_t(colorPass * 2 + depthPass * (shadowPass ? cascadeCount : 1u));
+    }
 
     static void setupColorCommand(Command& cmdDraw, bool hasDepthPass,
             FMaterialInstance const* mi) noexcept;
 
-    static void recordDriverCommands(FEngine::DriverApi& driver, FScene& scene,
-            utils::Slice<Command> const& commands) noexcept;
-
-    static void updateSummedPrimitiveCounts(
-            FScene::RenderableSoa& renderableData, utils::Range<uint32_t> vr) noexcept;
-
     const char* const mName;
 };
 
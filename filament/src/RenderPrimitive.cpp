@@ -24,37 +24,37 @@
 namespace filament {
 namespace details {
 
-void FRenderPrimitive::init(driver::DriverApi& driver,
+void FRenderPrimitive::init(FEngine& engine,
         const RenderableManager::Builder::Entry& entry) noexcept {
 
     assert(entry.materialInstance);
 
-    mHandle = driver.createRenderPrimitive();
     mMaterialInstance = upcast(entry.materialInstance);
     mBlendOrder = entry.blendOrder;
 
     if (entry.indices && entry.vertices) {
-        FVertexBuffer* vertexBuffer = upcast(entry.vertices);
-        FIndexBuffer* indexBuffer = upcast(entry.indices);
-
-        AttributeBitset enabledAttributes = vertexBuffer->getDeclaredAttributes();
-
-        auto const& ebh = vertexBuffer->getHwHandle();
-        auto const& ibh = indexBuffer->getHwHandle();
-
-        driver.setRenderPrimitiveBuffer(mHandle, ebh, ibh, (uint32_t)enabledAttributes.getValue());
-        driver.setRenderPrimitiveRange(mHandle, entry.type,
-                (uint32_t)entry.offset, (uint32_t)entry.minIndex, (uint32_t)entry.maxIndex,
-                (uint32_t)entry.count);
-
-        mPrimitiveType = entry.type;
-        mEnabledAttributes = enabledAttributes;
+        set(engine, entry.type, upcast(entry.vertices), upcast(entry.indices),
+                entry.offset, entry.minIndex, entry.maxIndex, entry.count);
+    } else {
+        // empty primitives are never drawn, they don't need to be shared
+        mHandle = engine.getDriverApi().createRenderPrimitive();
     }
 }
 
 void FRenderPrimitive::terminate(FEngine& engine) {
-    FEngine::DriverApi& driver = engine.getDriverApi();
-    driver.destroyRenderPrimitive(mHandle);
+    releaseHandle(engine);
+}
+
+void FRenderPrimitive::releaseHandle(FEngine& engine) noexcept {
+    if (mHandle) {
+        FEngine::DriverApi& driver = engine.getDriverApi();
+        if (isShared()) {
+            engine.getRenderPrimitiveCache().release(driver, mHandle);
+        } else {
+            driver.destroyRenderPrimitive(mHandle);
+        }
+        mHandle.clear();
+    }
 }
 
 void FRenderPrimitive::set(FEngine& engine, RenderableManager::PrimitiveType type,
@@ -66,10 +66,15 @@ void FRenderPrimitive::set(FEngine& engine, RenderableManager::PrimitiveType typ
 
     FEngine::DriverApi& driver = engine.getDriverApi();
 
-    driver.setRenderPrimitiveBuffer(mHandle, ebh, ibh, (uint32_t)enabledAttributes.getValue());
-    driver.setRenderPrimitiveRange(mHandle, type,
+    // acquire the new primitive first, so we don't destroy it if it's the same one
+    Handle<HwRenderPrimitive> handle = engine.getRenderPrimitiveCache().acquire(driver,
+            ebh, ibh, enabledAttributes, type,
             (uint32_t)offset, (uint32_t)minIndex, (uint32_t)maxIndex, (uint32_t)count);
+    releaseHandle(engine);
 
+    mHandle = handle;
+    mVertexBuffer = ebh;
+    mIndexBuffer = ibh;
     mPrimitiveType = type;
     mEnabledAttributes = enabledAttributes;
 }
@@ -77,8 +82,17 @@ void FRenderPrimitive::set(FEngine& engine, RenderableManager::PrimitiveType typ
 void FRenderPrimitive::set(FEngine& engine, RenderableManager::PrimitiveType type, size_t offset,
         size_t minIndex, size_t maxIndex, size_t count) noexcept {
     FEngine::DriverApi& driver = engine.getDriverApi();
-    driver.setRenderPrimitiveRange(mHandle, type,
-            (uint32_t)offset, (uint32_t)minIndex, (uint32_t)maxIndex, (uint32_t)count);
+    if (isShared()) {
+        // the range is part of the shared primitive's identity, we need to acquire a new one
+        Handle<HwRenderPrimitive> handle = engine.getRenderPrimitiveCache().acquire(driver,
+                mVertexBuffer, mIndexBuffer, mEnabledAttributes, type,
+                (uint32_t)offset, (uint32_t)minIndex, (uint32_t)maxIndex, (uint32_t)count);
+        releaseHandle(engine);
+        mHandle = handle;
+    } else {
+        driver.setRenderPrimitiveRange(mHandle, type,
+                (uint32_t)offset, (uint32_t)minIndex, (uint32_t)maxIndex, (uint32_t)count);
+    }
     mPrimitiveType = type;
 }
 
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RenderPrimitiveCache.h"
+
+#include "driver/DriverApi.h"
+
+#include <assert.h>
+
+namespace filament {
+
+using namespace driver;
+
+void RenderPrimitiveCache::terminate(DriverApi& driver) noexcept {
+    // all renderables should have been destroyed by now, but be safe.
+    for (auto const& item : mEntries) {
+        driver.destroyRenderPrimitive(item.second.handle);
+    }
+    mEntries.clear();
+    mKeys.clear();
+}
+
+Handle<HwRenderPrimitive> RenderPrimitiveCache::acquire(DriverApi& driver,
+        Handle<HwVertexBuffer> vbh, Handle<HwIndexBuffer> ibh,
+        AttributeBitset enabledAttributes, PrimitiveType type,
+        uint32_t offset, uint32_t minIndex, uint32_t maxIndex, uint32_t count) noexcept {
+    const Key key{ vbh.getId(), ibh.getId(), offset, minIndex, maxIndex, count, uint32_t(type) };
+    Entry& entry = mEntries[key];
+    if (!entry.handle) {
+        entry.handle = driver.createRenderPrimitive();
+        driver.setRenderPrimitiveBuffer(entry.handle, vbh, ibh,
+                (uint32_t)enabledAttributes.getValue());
+        driver.setRenderPrimitiveRange(entry.handle, type, offset, minIndex, maxIndex, count);
+        mKeys[entry.handle.getId()] = key;
+    }
+    entry.refs++;
+    return entry.handle;
+}
+
+void RenderPrimitiveCache::release(DriverApi& driver, Handle<HwRenderPrimitive> rph) noexcept {
+    auto pos = mKeys.find(rph.getId());
+    assert(pos != mKeys.end());
+    if (pos != mKeys.end()) {
+        auto entry = mEntries.find(pos->second);
+        assert(entry != mEntries.end() && entry->second.refs > 0);
+        if (--entry->second.refs == 0) {
+            driver.destroyRenderPrimitive(entry->second.handle);
+            mEntries.erase(entry);
+            mKeys.erase(pos);
+        }
+    }
+}
+
+} // namespace filament
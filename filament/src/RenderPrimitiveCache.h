@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_RENDERPRIMITIVECACHE_H
+#define TNT_FILAMENT_RENDERPRIMITIVECACHE_H
+
+#include "driver/DriverApiForward.h"
+#include "driver/Handle.h"
+
+#include <filament/EngineEnums.h>
+#include <filament/driver/DriverEnums.h>
+
+#include <utils/Hash.h>
+
+#include <unordered_map>
+
+namespace filament {
+
+/*
+ * RenderPrimitiveCache hands out the same HwRenderPrimitive for identical geometry
+ * (same vertex buffer, index buffer and range). Renderables that draw the same geometry
+ * end-up with the same primitive handle, which allows RenderPass to draw them with a single
+ * instanced draw call.
+ */
+class RenderPrimitiveCache {
+public:
+    void terminate(driver::DriverApi& driver) noexcept;
+
+    // returns a (possibly shared) render primitive for this geometry, must be released with
+    // release().
+    Handle<HwRenderPrimitive> acquire(driver::DriverApi& driver,
+            Handle<HwVertexBuffer> vbh, Handle<HwIndexBuffer> ibh,
+            AttributeBitset enabledAttributes, driver::PrimitiveType type,
+            uint32_t offset, uint32_t minIndex, uint32_t maxIndex, uint32_t count) noexcept;
+
+    // releases a reference to a render primitive returned by acquire(), the primitive is
+    // destroyed when its last reference is released.
+    void release(driver::DriverApi& driver, Handle<HwRenderPrimitive> rph) noexcept;
+
+    size_t getPrimitiveCount() const noexcept { return mEntries.size(); }
+
+private:
+    struct Key {
+        HandleBase::HandleId vbh;   // 4 bytes
+        HandleBase::HandleId ibh;   // 4 bytes
+        uint32_t offset;            // 4 bytes
+        uint32_t minIndex;          // 4 bytes
+        uint32_t maxIndex;          // 4 bytes
+        uint32_t count;             // 4 bytes
+        uint32_t type;              // 4 bytes
+        bool operator==(Key const& rhs) const noexcept {
+            return vbh == rhs.vbh && ibh == rhs.ibh && offset == rhs.offset &&
+                   minIndex == rhs.minIndex && maxIndex == rhs.maxIndex &&
+                   count == rhs.count && type == rhs.type;
+        }
+    };
+    static_assert(sizeof(Key) == 28, "Key has unexpected size.");
+
+    struct Entry {
+        Handle<HwRenderPrimitive> handle;
+        uint32_t refs = 0;
+    };
+
+    using KeyHashFn = utils::hash::MurmurHashFn<Key>;
+    std::unordered_map<Key, Entry, KeyHashFn> mEntries;
+    std::unordered_map<HandleBase::HandleId, Key> mKeys;
+};
+
+} // namespace filament
+
+#endif // TNT_FILAMENT_RENDERPRIMITIVECACHE_H
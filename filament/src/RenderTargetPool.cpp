@@ -98,6 +98,7 @@ RenderTargetPool::Target const* RenderTargetPool::get(
     entry.age = mCacheAge;
 
     mPoolSize += getSize(&entry);
+    mPeakPoolSize = std::max(mPeakPoolSize, mPoolSize);
 
     // entry not found, create one
     return mEntryArena.make<Entry>(entry);
@@ -74,6 +74,10 @@ public:
     // remove older items in the cache. call this once per frame.
     void gc() noexcept;
 
+    // estimated GPU memory of the targets, in use or cached, and the most it's been
+    size_t getMemorySize() const noexcept { return mPoolSize; }
+    size_t getPeakMemorySize() const noexcept { return mPeakPoolSize; }
+
 private:
     struct Entry : public Target {
         Entry() = default;
@@ -100,6 +104,7 @@ private:
     details::FEngine* mEngine = nullptr;
     mutable std::vector<Entry const*> mPool;
     mutable size_t mPoolSize = 0;
+    mutable size_t mPeakPoolSize = 0;
     // at 60 fps, 32 bit gives us 828 days without overflow
     uint32_t mDeepPurgeCountDown = POOL_ENTRY_MAX_AGE;
     uint32_t mCacheAge = POOL_ENTRY_MAX_AGE;
@@ -36,8 +36,10 @@
 #include <utils/Systrace.h>
 #include <utils/vector.h>
 
-#include <assert.h>
+#include <algorithm>
+#include <type_traits>
 
+#include <assert.h>
 
 using namespace filament::math;
 using namespace utils;
@@ -74,7 +76,7 @@ FRenderer::~FRenderer() noexcept {
     // to free what we can (it would probably mean something when wrong).
 #ifndef NDEBUG
     size_t wm = getCommandsHighWatermark();
-    size_t wmpct = wm / (CONFIG_PER_FRAME_COMMANDS_SIZE / 100);
+    size_t wmpct = wm / (mEngine.getPerFrameCommandsSize() / 100);
     slog.d << "Renderer: Commands High watermark "
     << wm / 1024 << " KiB (" << wmpct << "%), "
     << wm / sizeof(Command) << " commands, " << sizeof(Command) << " bytes/command"
@@ -141,22 +143,223 @@ void FRenderer::render(FView const* view) {
         // create a master job so no other job can escape
         auto masterJob = js.setMasterJob(js.createJob());
 
+        FView& v = const_cast<FView&>(*view);
+        v.beginStats(engine);
+
         // execute the render pass
-        renderJob(rootArena, const_cast<FView&>(*view));
+        renderJob(rootArena, v);
 
         // make sure to flush the command buffer
         engine.flush();
 
+        v.endStats(engine);
+
+        // and wait for all jobs to finish as a safety (this should be a no-op)
+        js.runAndWait(masterJob);
+    }
+}
+
+void FRenderer::render(FView const* const* views, size_t count) {
+    SYSTRACE_CALL();
+
+    assert(mSwapChain);
+
+    FEngine& engine = mEngine;
+    JobSystem& js = engine.getJobSystem();
+
+    size_t i = 0;
+    while (i < count) {
+        // Views are rendered in batches of consecutive views. The views of a batch are
+        // prepared one after the other, then their color pass commands are built in parallel
+        // and finally the passes are executed in order.
+        // Preparing a view sorts the data of its scene in place, so a view whose scene is
+        // prepared again by a following view of the batch builds its commands from a copy.
+        size_t batch[MAX_PARALLEL_VIEWS];
+        size_t batchSize = 0;
+        for (; i < count && batchSize < MAX_PARALLEL_VIEWS; i++) {
+            if (UTILS_LIKELY(views[i] && views[i]->getScene())) {
+                batch[batchSize++] = i;
+            }
+        }
+        if (!batchSize) {
+            break;
+        }
+
+        // create a master job so no other job can escape
+        auto masterJob = js.setMasterJob(js.createJob());
+
+        // each view of the batch needs its own per-renderpass arena
+        using ArenaScopeStorage = std::aligned_storage<sizeof(ArenaScope), alignof(ArenaScope)>::type;
+        ArenaScopeStorage arenas[MAX_PARALLEL_VIEWS];
+        ViewPass passes[MAX_PARALLEL_VIEWS];
+        bool prepared[MAX_PARALLEL_VIEWS] = {};
+
+        for (size_t j = 0; j < batchSize; j++) {
+            FView& view = const_cast<FView&>(*views[batch[j]]);
+            FScene* const scene = view.getScene();
+
+            // the preparation of a shared scene is accounted to the first view using it
+            view.beginStats(engine);
+
+            // The light data of the scene is restored when preparing this view, the
+            // froxelization of the previous views using this scene must be done by then.
+            for (size_t k = 0; k < j; k++) {
+                if (prepared[k] && passes[k].jobFroxelize && views[batch[k]]->getScene() == scene) {
+                    js.waitAndRelease(passes[k].jobFroxelize);
+                }
+            }
+
+            if (view.getSharedCullingIndex() < 0) {
+                // This view isn't part of a group yet: prepare its scene now and cull it for
+                // this view and all the following ones that use the same scene, in a single
+                // pass. Each view sorts the scene's data in place when it's prepared, but the
+                // culling results are sorted along, so they stay valid.
+                Frustum frusta[Culler::MAX_FRUSTUM_COUNT];
+                size_t frustumCount = 0;
+                const mat4f worldOriginScene = scene->getWorldOriginTransform();
+                for (size_t k = batch[j]; k < count && frustumCount < Culler::MAX_FRUSTUM_COUNT; k++) {
+                    FView* const other = const_cast<FView*>(views[k]);
+                    if (other && other->getScene() == scene && other->getSharedCullingIndex() < 0) {
+                        other->setSharedCullingIndex(int8_t(frustumCount));
+                        frusta[frustumCount++] = other->computeCullingFrustum(worldOriginScene);
+                    }
+                }
+
+                scene->prepare(worldOriginScene);
+                scene->saveLightData();
+                {
+                    CpuProfiler::Scope profile(engine.getCpuProfiler(), CpuProfiler::Stage::CULLING);
+                    FView::cullRenderablesForViews(js, scene->getRenderableData(), frusta,
+                            frustumCount);
+                }
+            }
+
+            LinearAllocatorArena* arena = &mPerRenderPassArena;
+            if (j > 0) {
+                std::unique_ptr<LinearAllocatorArena>& parallelArena = mParallelViewArenas[j - 1];
+                if (!parallelArena) {
+                    parallelArena.reset(new LinearAllocatorArena("FRenderer: parallel view arena",
+                            engine.getPerRenderPassArenaSize()));
+                }
+                arena = parallelArena.get();
+            }
+            ArenaScope* const scope = new(&arenas[j]) ArenaScope(*arena);
+            prepared[j] = prepareViewPass(*scope, view, passes[j]);
+
+            if (prepared[j] && std::any_of(batch + j + 1, batch + batchSize,
+                    [=](size_t k) { return views[k]->getScene() == scene; })) {
+                view.detachRenderableData();
+            }
+
+            // the other views are prepared before this one is executed, don't account them
+            view.pauseStats(engine);
+        }
+
+        { // build the commands of all the views of the batch in parallel
+            SYSTRACE_NAME("buildViewPasses");
+            // each view accounts the time of the whole batch
+            JobSystem::Job* parent = js.createJob();
+            for (size_t j = 0; j < batchSize; j++) {
+                FView& view = const_cast<FView&>(*views[batch[j]]);
+                view.resumeStats(engine);
+                if (prepared[j]) {
+                    ViewPass* const pass = &passes[j];
+                    js.run(js.createJob(parent, [this, pass](JobSystem&, JobSystem::Job*) {
+                        buildViewPass(*pass);
+                    }));
+                }
+            }
+            js.runAndWait(parent);
+            for (size_t j = 0; j < batchSize; j++) {
+                const_cast<FView*>(views[batch[j]])->pauseStats(engine);
+            }
+        }
+
+        for (size_t j = 0; j < batchSize; j++) {
+            FView& view = const_cast<FView&>(*views[batch[j]]);
+            view.resumeStats(engine);
+            if (prepared[j]) {
+                executeViewPass(passes[j]);
+            }
+
+            // make sure to flush the command buffer
+            engine.flush();
+
+            view.endStats(engine);
+            view.setSharedCullingIndex(-1);
+
+            reinterpret_cast<ArenaScope*>(&arenas[j])->~ArenaScope();
+        }
+
+        // and wait for all jobs to finish as a safety (this should be a no-op)
+        js.runAndWait(masterJob);
+    }
+}
+
+void FRenderer::prewarm(FView const* view) {
+    SYSTRACE_CALL();
+
+    assert(mSwapChain);
+
+    if (UTILS_LIKELY(view && view->getScene())) {
+        ArenaScope arena(mPerRenderPassArena);
+
+        FEngine& engine = mEngine;
+        JobSystem& js = engine.getJobSystem();
+        FEngine::DriverApi& driver = engine.getDriverApi();
+        RenderTargetPool& rtp = engine.getRenderTargetPool();
+
+        // create a master job so no other job can escape
+        auto masterJob = js.setMasterJob(js.createJob());
+
+        // The pipelines don't depend on the viewport, so dynamic scaling is ignored. Unlike
+        // prepareViewPass(), this doesn't render the shadow maps.
+        FView& v = const_cast<FView&>(*view);
+        filament::Viewport svp = v.getViewport();
+        if (!svp.empty()) {
+            v.prepare(engine, driver, arena, svp, getShaderUserTime());
+
+            RenderTargetPool::Target const* colorTarget = nullptr;
+            if (v.hasPostProcessPass()) {
+                colorTarget = rtp.get(TargetBufferFlags::COLOR_AND_DEPTH,
+                        svp.width, svp.height, v.getSampleCount(), getHdrFormat(v));
+                svp.left = svp.bottom = 0;
+            }
+
+            ColorPass::prepareColorPass(engine, v, svp);
+
+            const size_t commandsCount = engine.getPerFrameCommandsSize() / sizeof(Command);
+            Command* const commandsBuffer = arena.allocate<Command>(commandsCount, CACHELINE_SIZE);
+            GrowingSlice<Command> commands(commandsBuffer, commandsCount);
+            Slice<Command> work = ColorPass::buildColorPass(engine, js, v, commands);
+
+            const Handle<HwRenderTarget> rth = colorTarget ? colorTarget->target : getRenderTarget();
+            RenderPass::prewarmDriverCommands(driver, work, rth,
+                    ColorPass::getRenderPassParams(v, svp));
+
+            if (colorTarget) {
+                rtp.put(colorTarget);
+            }
+            engine.flush();
+        }
+
         // and wait for all jobs to finish as a safety (this should be a no-op)
         js.runAndWait(masterJob);
     }
 }
 
 void FRenderer::renderJob(ArenaScope& arena, FView& view) {
+    ViewPass pass;
+    if (prepareViewPass(arena, view, pass)) {
+        buildViewPass(pass);
+        executeViewPass(pass);
+    }
+}
+
+bool FRenderer::prepareViewPass(ArenaScope& arena, FView& view, ViewPass& pass) {
     FEngine& engine = getEngine();
     JobSystem& js = engine.getJobSystem();
     FEngine::DriverApi& driver = engine.getDriverApi();
-    PostProcessManager& ppm = engine.getPostProcessManager();
     RenderTargetPool& rtp = engine.getRenderTargetPool();
 
     // DEBUG: driver commands must all happen from the same thread. Enforce that on debug builds.
@@ -176,7 +379,7 @@ void FRenderer::renderJob(ArenaScope& arena, FView& view) {
     const bool scaled = any(notEqual(scale, float2(1.0f)));
     filament::Viewport svp = vp.scale(scale);
     if (svp.empty()) {
-        return;
+        return false;
     }
 
     view.prepare(engine, driver, arena, svp, getShaderUserTime());
@@ -189,29 +392,35 @@ void FRenderer::renderJob(ArenaScope& arena, FView& view) {
      * Allocate command buffer.
      */
 
-    const size_t commandsSize = FEngine::CONFIG_PER_FRAME_COMMANDS_SIZE;
+    const size_t commandsSize = engine.getPerFrameCommandsSize();
     const size_t commandsCount = commandsSize / sizeof(Command);
-    GrowingSlice<Command> commands(
-            arena.allocate<Command>(commandsCount, CACHELINE_SIZE), commandsCount);
+    Command* const commandsBuffer = arena.allocate<Command>(commandsCount, CACHELINE_SIZE);
+    GrowingSlice<Command> commands(commandsBuffer, commandsCount);
 
     /*
      * Shadow pass
      */
 
-    if (view.hasShadowing()) {
+    if (view.hasShadowing() && view.needsShadowMapRendering()) {
         ShadowPass::renderShadowMap(engine, js, view, commands);
         recordHighWatermark(commands); // for debugging
         // reset the command buffer
         commands.clear();
     }
 
+    // the spot and point lights shadows, this must run after the directional shadow pass,
+    // because it changes the cascade bits of the shadow casters.
+    if (view.hasShadowAtlas()) {
+        // the command buffer is reset after each tile
+        ShadowPass::renderShadowAtlas(engine, js, view, arena, commands);
+    }
+
     /*
      * Depth + Color passes
      */
 
     const uint8_t useMSAA = view.getSampleCount();
     const TextureFormat hdrFormat = getHdrFormat(view);
-    const TextureFormat ldrFormat = getLdrFormat();
     RenderTargetPool::Target const* colorTarget = nullptr;
 
     if (UTILS_LIKELY(hasPostProcess)) {
@@ -221,10 +430,51 @@ void FRenderer::renderJob(ArenaScope& arena, FView& view) {
         svp.left = svp.bottom = 0;
     }
 
+    ColorPass::prepareColorPass(engine, view, svp);
+
+    pass.view = &view;
+    pass.vp = vp;
+    pass.svp = svp;
+    pass.hasPostProcess = hasPostProcess;
+    pass.useFXAA = useFXAA;
+    pass.scaled = scaled;
+    pass.colorTarget = colorTarget;
     // FIXME: viewRenderTarget doesn't have a depth-buffer, so when skipping post-process, don't rely on it
+    pass.colorRenderTarget = colorTarget ? colorTarget->target : getRenderTarget();
+    pass.jobFroxelize = jobFroxelize;
+    pass.commandsBuffer = commandsBuffer;
+    pass.commandsCapacity = commandsCount;
+    return true;
+}
+
+void FRenderer::buildViewPass(ViewPass& pass) noexcept {
+    FEngine& engine = getEngine();
+    GrowingSlice<Command> commands(pass.commandsBuffer, pass.commandsCapacity);
+    pass.commands = ColorPass::buildColorPass(engine, engine.getJobSystem(), *pass.view, commands);
+}
+
+void FRenderer::executeViewPass(ViewPass& pass) {
+    FEngine& engine = getEngine();
+    JobSystem& js = engine.getJobSystem();
+    FEngine::DriverApi& driver = engine.getDriverApi();
+    PostProcessManager& ppm = engine.getPostProcessManager();
+    RenderTargetPool& rtp = engine.getRenderTargetPool();
+
+    FView& view = *pass.view;
+    filament::Viewport const& vp = pass.vp;
+    filament::Viewport const& svp = pass.svp;
+    const bool hasPostProcess = pass.hasPostProcess;
+    const bool useFXAA = pass.useFXAA;
+    const bool scaled = pass.scaled;
+    RenderTargetPool::Target const* const colorTarget = pass.colorTarget;
+
+    const uint8_t useMSAA = view.getSampleCount();
+    const TextureFormat hdrFormat = getHdrFormat(view);
+    const TextureFormat ldrFormat = getLdrFormat();
     const Handle<HwRenderTarget> viewRenderTarget = getRenderTarget();
-    ColorPass::renderColorPass(engine, js, jobFroxelize,
-            colorTarget ? colorTarget->target : viewRenderTarget, view, svp, commands);
+
+    ColorPass::executeColorPass(engine, js, pass.jobFroxelize,
+            pass.colorRenderTarget, view, svp, pass.commands);
 
     /*
      * Post Processing...
@@ -310,7 +560,7 @@ void FRenderer::renderJob(ArenaScope& arena, FView& view) {
     }
 
     // for debugging
-    recordHighWatermark(commands);
+    recordHighWatermark(pass.commands);
 }
 
 void FRenderer::mirrorFrame(FSwapChain* dstSwapChain, filament::Viewport const& dstViewport,
@@ -446,6 +696,11 @@ void FRenderer::endFrame() {
     rtp.gc();           // gc post-processing targets (this can generate driver commands)
     engine.flush();     // flush command stream
 
+    // trace the size of the commands generated this frame
+    const uint64_t commandBytes = engine.getCommandBytesWritten();
+    SYSTRACE_VALUE32("commandBytes", uint32_t(commandBytes - mCommandBytes));
+    mCommandBytes = commandBytes;
+
     // make sure we're done with the gcs
     js.waitAndRelease(job);
 
@@ -517,6 +772,14 @@ void Renderer::render(View const* view) {
     upcast(this)->render(upcast(view));
 }
 
+void Renderer::render(View const* const* views, size_t count) {
+    upcast(this)->render(reinterpret_cast<FView const* const*>(views), count);
+}
+
+void Renderer::prewarm(View const* view) {
+    upcast(this)->prewarm(upcast(view));
+}
+
 bool Renderer::beginFrame(SwapChain* swapChain) {
     return upcast(this)->beginFrame(upcast(swapChain));
 }
@@ -543,4 +806,16 @@ void Renderer::resetUserTime() {
     upcast(this)->resetUserTime();
 }
 
+void Renderer::setCpuCountersEnabled(bool enabled) noexcept {
+    upcast(this)->getEngine().getCpuProfiler().setEnabled(enabled);
+}
+
+Renderer::CpuCounters Renderer::getCpuCounters(CpuStage stage) const noexcept {
+    return upcast(this)->getEngine().getCpuProfiler().getCounters(stage);
+}
+
+void Renderer::resetCpuCounters() noexcept {
+    upcast(this)->getEngine().getCpuProfiler().reset();
+}
+
 } // namespace filament
@@ -24,6 +24,7 @@
 #include "details/Culler.h"
 #include "details/Engine.h"
 #include "details/IndirectLight.h"
+#include "details/ShadowAtlas.h"
 #include "details/Skybox.h"
 
 #include <utils/compiler.h>
@@ -33,6 +34,8 @@
 
 #include <algorithm>
 
+#include <string.h>
+
 using namespace filament::math;
 using namespace utils;
 
@@ -48,12 +51,30 @@ FScene::FScene(FEngine& engine) :
 
 FScene::~FScene() noexcept = default;
 
+mat4f FScene::getWorldOriginTransform() const noexcept {
+    /*
+     * We apply a "world origin" to "everything" in order to implement the IBL rotation.
+     * The "world origin" could also be useful for other things, like keeping the origin
+     * close to the camera position to improve fp precision in the shader for large scenes.
+     */
+    mat4f worldOriginScene;
+    FIndirectLight const* const ibl = getIndirectLight();
+    if (ibl) {
+        // the IBL transformation must be a rigid transform
+        mat3f rotation{ ibl->getRotation() };
+        // for a rigid-body transform, the inverse is the transpose
+        worldOriginScene = mat4f{ transpose(rotation) };
+    }
+    return worldOriginScene;
+}
+
 
 void FScene::prepare(const filament::math::mat4f& worldOriginTransform) {
     // TODO: can we skip this in most cases? Since we rely on indices staying the same,
     //       we could only skip, if nothing changed in the RCM.
 
     FEngine& engine = mEngine;
+    CpuProfiler::Scope profile(engine.getCpuProfiler(), CpuProfiler::Stage::SCENE_PREPARE);
     EntityManager& em = engine.getEntityManager();
     FRenderableManager& rcm = engine.getRenderableManager();
     FTransformManager& tcm = engine.getTransformManager();
@@ -121,11 +142,12 @@ void FScene::prepare(const filament::math::mat4f& worldOriginTransform) {
                     ri,
                     worldTransform,
                     rcm.getVisibility(ri),
-                    rcm.getBonesUbh(ri),
+                    rcm.getBonesOffset(ri),
                     worldAABB.center,
                     0,
                     rcm.getLayerMask(ri),
                     worldAABB.halfExtent,
+                    0,
                     {}, {});
         }
 
@@ -163,51 +185,104 @@ void FScene::prepare(const filament::math::mat4f& worldOriginTransform) {
     }
 }
 
-void FScene::updateUBOs(utils::Range<uint32_t> visibleRenderables, Handle<HwUniformBuffer> renderableUbh) noexcept {
+void FScene::saveLightData() noexcept {
+    copyLightData(mSavedLightData, mLightData);
+}
+
+void FScene::restoreLightData() noexcept {
+    copyLightData(mLightData, mSavedLightData);
+}
+
+void FScene::copyLightData(LightSoa& dst, LightSoa const& src) noexcept {
+    // only the data gathered by prepare() is copied, the rest is computed by each view
+    dst.clear();
+    if (dst.capacity() < src.capacity()) {
+        dst.setCapacity(src.capacity());
+    }
+    dst.resize(src.size());
+
+    // the padding used by the SIMD code past the end of the array is copied as well
+    const size_t paddedSize = (src.size() + 3) & ~3;
+    std::copy_n(src.data<POSITION_RADIUS>(), paddedSize, dst.data<POSITION_RADIUS>());
+    std::copy_n(src.data<DIRECTION>(),       src.size(), dst.data<DIRECTION>());
+    std::copy_n(src.data<LIGHT_INSTANCE>(),  src.size(), dst.data<LIGHT_INSTANCE>());
+}
+
+void FScene::updateUBOs(utils::Range<uint32_t> visibleRenderables, Handle<HwUniformBuffer> renderableUbh,
+        std::vector<uint8_t>& renderableUniforms) noexcept {
     FEngine::DriverApi& driver = mEngine.getDriverApi();
     const size_t size = visibleRenderables.size() * sizeof(PerRenderableUib);
 
-    // allocate space into the command stream directly
-    void* const buffer = driver.allocate(size);
-
-    auto& sceneData = mRenderableData;
+    // the uniforms are computed once per frame, instanced draws copy them from here
+    if (renderableUniforms.size() < size) {
+        renderableUniforms.resize(size);
+    }
     for (uint32_t i : visibleRenderables) {
-        mat4f const& model = sceneData.elementAt<WORLD_TRANSFORM>(i);
-        const size_t offset = i * sizeof(PerRenderableUib);
-
-        UniformBuffer::setUniform(buffer,
-                offset + offsetof(PerRenderableUib, worldFromModelMatrix),
-                model);
-
-        // Using the inverse-transpose handles non-uniform scaling, but DOESN'T guarantee that
-        // the transformed normals will have unit-length, therefore they need to be normalized
-        // in the shader (that's already the case anyways, since normalization is needed after
-        // interpolation).
-        //
-        // We pre-scale normals by the inverse of the largest scale factor to avoid
-        // large post-transform magnitudes in the shader, especially in the fragment shader, where
-        // we use medium precision.
-        //
-        // Note: if the model matrix is known to be a rigid-transform, we could just use it directly.
-
-        mat3f m = transpose(inverse(model.upperLeft()));
-        m *= mat3f(1.0f / std::sqrt(max(float3{length2(m[0]), length2(m[1]), length2(m[2])})));
-
-        UniformBuffer::setUniform(buffer,
-                offset + offsetof(PerRenderableUib, worldFromModelNormalMatrix), m);
+        writeRenderableUniforms(renderableUniforms.data(), i * sizeof(PerRenderableUib), i);
     }
 
+    // allocate space into the command stream directly
+    void* const buffer = driver.allocate(size);
+    memcpy(buffer, renderableUniforms.data(), size);
+
     // TODO: handle static objects separately
-    mRenderableViewUbh = renderableUbh;
     driver.updateUniformBuffer(renderableUbh, { buffer, size });
+    mUniformBytes += size;
+}
+
+void FScene::writeRenderableUniforms(void* buffer, size_t offset, uint32_t i) const noexcept {
+    mat4f const& model = mRenderableData.elementAt<WORLD_TRANSFORM>(i);
+
+    UniformBuffer::setUniform(buffer,
+            offset + offsetof(PerRenderableUib, worldFromModelMatrix),
+            model);
+
+    // Using the inverse-transpose handles non-uniform scaling, but DOESN'T guarantee that
+    // the transformed normals will have unit-length, therefore they need to be normalized
+    // in the shader (that's already the case anyways, since normalization is needed after
+    // interpolation).
+    //
+    // We pre-scale normals by the inverse of the largest scale factor to avoid
+    // large post-transform magnitudes in the shader, especially in the fragment shader, where
+    // we use medium precision.
+    //
+    // Note: if the model matrix is known to be a rigid-transform, we could just use it directly.
+
+    mat3f m = transpose(inverse(model.upperLeft()));
+    m *= mat3f(1.0f / std::sqrt(max(float3{length2(m[0]), length2(m[1]), length2(m[2])})));
+
+    UniformBuffer::setUniform(buffer,
+            offset + offsetof(PerRenderableUib, worldFromModelNormalMatrix), m);
+}
+
+Handle<HwUniformBuffer> FScene::prepareInstancesUBO(size_t instanceCount) noexcept {
+    const size_t size = instanceCount * sizeof(PerRenderableUib);
+    if (mInstancesUBOSize < size) {
+        // allocate 1/3 extra, to avoid reallocating every time the number of instances grows
+        const size_t count = (4u * instanceCount + 2u) / 3u;
+        FEngine::DriverApi& driver = mEngine.getDriverApi();
+        mInstancesUBOSize = uint32_t(count * sizeof(PerRenderableUib));
+        driver.destroyUniformBuffer(mInstancesUbh);
+        mInstancesUbh = driver.createUniformBuffer(mInstancesUBOSize + getRenderableUBOSlack(),
+                driver::BufferUsage::STREAM);
+    }
+    return mInstancesUbh;
+}
+
+size_t FScene::getRenderableUBOSlack() noexcept {
+    return (CONFIG_MAX_INSTANCES - 1) * sizeof(PerRenderableUib);
+}
+
+Handle<HwUniformBuffer> FScene::getBonesUBO() const noexcept {
+    return mEngine.getRenderableManager().getBonesUbh();
 }
 
 void FScene::terminate(FEngine& engine) {
-    // DO NOT destroy this UBO, it's owned by the View
-    mRenderableViewUbh.clear();
+    engine.getDriverApi().destroyUniformBuffer(mInstancesUbh);
 }
 
-void FScene::prepareDynamicLights(const CameraInfo& camera, ArenaScope& rootArena, Handle<HwUniformBuffer> lightUbh) noexcept {
+void FScene::prepareDynamicLights(const CameraInfo& camera, ArenaScope& rootArena, Handle<HwUniformBuffer> lightUbh,
+        ShadowAtlas const& shadowAtlas) noexcept {
     FEngine::DriverApi& driver = mEngine.getDriverApi();
     FLightManager& lcm = mEngine.getLightManager();
     FScene::LightSoa& lightData = getLightData();
@@ -256,9 +331,11 @@ void FScene::prepareDynamicLights(const CameraInfo& camera, ArenaScope& rootAren
         lp[gpuIndex].colorIntensity       = { lcm.getColor(li), lcm.getIntensity(li) };
         lp[gpuIndex].directionIES         = { directions[i], 0 };
         lp[gpuIndex].spotScaleOffset.xy   = { lcm.getSpotParams(li).scaleOffset };
+        lp[gpuIndex].spotScaleOffset.z    = float(shadowAtlas.getShadowIndex(li));
     }
 
     driver.updateUniformBuffer(lightUbh, { lp, positionalLightCount * sizeof(LightsUib) });
+    mUniformBytes += positionalLightCount * sizeof(LightsUib);
 }
 
 // These methods need to exist so clang honors the __restrict__ keyword, which in turn
@@ -0,0 +1,429 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "details/ShadowAtlas.h"
+
+#include "details/Engine.h"
+
+#include <private/filament/SibGenerator.h>
+
+#include <filament/driver/DriverEnums.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace filament::math;
+using namespace utils;
+
+namespace filament {
+using namespace driver;
+
+namespace details {
+
+// ------------------------------------------------------------------------------------------------
+// ShadowAtlasAllocator
+// ------------------------------------------------------------------------------------------------
+
+ShadowAtlasAllocator::ShadowAtlasAllocator(uint32_t dimension, uint32_t minTileSize) noexcept
+        : mDimension(dimension),
+          mLevelCount(uint8_t(std::ilogbf(float(dimension / minTileSize)) + 1)) {
+    assert(dimension && !(dimension & (dimension - 1)));
+    assert(minTileSize && !(minTileSize & (minTileSize - 1)) && minTileSize <= dimension);
+    mNodes.resize(getNodeIndex(mLevelCount, 0, 0), State::FREE);
+}
+
+void ShadowAtlasAllocator::clear() noexcept {
+    std::fill(mNodes.begin(), mNodes.end(), State::FREE);
+}
+
+size_t ShadowAtlasAllocator::getLevel(uint32_t size) const noexcept {
+    assert(size && !(size & (size - 1)));
+    assert(size >= getMinTileSize() && size <= mDimension);
+    return size_t(std::ilogbf(float(mDimension / size)));
+}
+
+ShadowAtlasAllocator::Tile ShadowAtlasAllocator::allocate(uint32_t size) noexcept {
+    return allocate(0, 0, 0, getLevel(size));
+}
+
+ShadowAtlasAllocator::Tile ShadowAtlasAllocator::allocate(
+        size_t level, uint32_t i, uint32_t j, size_t targetLevel) noexcept {
+    State& state = mNodes[getNodeIndex(level, i, j)];
+    if (state == State::USED) {
+        return {};
+    }
+    if (level == targetLevel) {
+        if (state != State::FREE) {
+            return {};
+        }
+        state = State::USED;
+        const uint32_t size = mDimension >> level;
+        return { uint16_t(i * size), uint16_t(j * size), uint16_t(size) };
+    }
+    // visit the quadrants in order, so that the tiles are packed towards the origin
+    for (uint32_t q = 0; q < 4; q++) {
+        Tile tile = allocate(level + 1, 2 * i + (q & 1u), 2 * j + (q >> 1u), targetLevel);
+        if (tile.isValid()) {
+            state = State::PARTIAL;
+            return tile;
+        }
+    }
+    return {};
+}
+
+bool ShadowAtlasAllocator::allocate(Tile tile) noexcept {
+    const size_t targetLevel = getLevel(tile.size);
+    if ((tile.x % tile.size) || (tile.y % tile.size) ||
+            tile.x + tile.size > mDimension || tile.y + tile.size > mDimension) {
+        return false;
+    }
+    // none of the ancestors can be allocated, and the tile itself must be entirely free
+    for (size_t level = 0; level <= targetLevel; level++) {
+        const uint32_t size = mDimension >> level;
+        State const state = mNodes[getNodeIndex(level, tile.x / size, tile.y / size)];
+        if (state == State::USED || (level == targetLevel && state != State::FREE)) {
+            return false;
+        }
+    }
+    for (size_t level = 0; level <= targetLevel; level++) {
+        const uint32_t size = mDimension >> level;
+        mNodes[getNodeIndex(level, tile.x / size, tile.y / size)] =
+                level == targetLevel ? State::USED : State::PARTIAL;
+    }
+    return true;
+}
+
+void ShadowAtlasAllocator::free(Tile tile) noexcept {
+    const size_t targetLevel = getLevel(tile.size);
+    mNodes[getNodeIndex(targetLevel, tile.x / tile.size, tile.y / tile.size)] = State::FREE;
+    // the ancestors become free when none of their quadrants is allocated anymore
+    for (size_t level = targetLevel; level-- > 0;) {
+        const uint32_t size = mDimension >> level;
+        const uint32_t i = tile.x / size;
+        const uint32_t j = tile.y / size;
+        bool empty = true;
+        for (uint32_t q = 0; q < 4; q++) {
+            empty &= mNodes[getNodeIndex(level + 1, 2 * i + (q & 1u), 2 * j + (q >> 1u))] ==
+                    State::FREE;
+        }
+        mNodes[getNodeIndex(level, i, j)] = empty ? State::FREE : State::PARTIAL;
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+// ShadowAtlas
+// ------------------------------------------------------------------------------------------------
+
+constexpr uint32_t ShadowAtlas::DIMENSION;
+constexpr uint32_t ShadowAtlas::MIN_TILE_SIZE;
+
+ShadowAtlas::ShadowAtlas(FEngine& engine) noexcept
+        : mAllocator(DIMENSION, MIN_TILE_SIZE),
+          mClipSpaceFlipped(engine.getBackend() == Backend::VULKAN ||
+                            engine.getBackend() == Backend::METAL) {
+}
+
+void ShadowAtlas::terminate(DriverApi& driverApi) noexcept {
+    if (mRenderTarget) {
+        driverApi.destroyRenderTarget(mRenderTarget);
+    }
+    if (mTexture) {
+        driverApi.destroyTexture(mTexture);
+    }
+}
+
+uint32_t ShadowAtlas::computeTileSize(float radius, float distance, float projectionScale,
+        float viewportHeight, uint32_t maxSize, float* importance) noexcept {
+    // diameter of the light's sphere of influence on screen, in pixels
+    const float pixels = distance > radius ?
+            radius * projectionScale * viewportHeight / distance : viewportHeight;
+    if (importance) {
+        *importance = pixels;
+    }
+    maxSize = std::max(maxSize, MIN_TILE_SIZE);
+    uint32_t size = MIN_TILE_SIZE;
+    while (size * 2 <= maxSize && float(size) < pixels) {
+        size *= 2;
+    }
+    return size;
+}
+
+void ShadowAtlas::update(FLightManager const& lcm, FScene::LightSoa const& lightData,
+        CameraInfo const& camera, filament::Viewport const& viewport) noexcept {
+
+    // remember where each light was in the previous frame
+    std::swap(mPreviousLights, mLights);
+    for (size_t i = 0; i < mTileCount; i++) {
+        mPreviousTiles[i] = mTiles[i].rect;
+    }
+    mLights.clear();
+    mTileCount = 0;
+    mAllocator.clear();
+
+    struct Candidate {
+        uint32_t index;         // index of the light in lightData
+        uint32_t size;          // size of its tiles
+        float importance;
+        uint8_t tileCount;
+        ShadowAtlasAllocator::Tile rects[6];
+    };
+
+    // keep the CONFIG_MAX_SHADOW_TILES most important lights, sorted by importance
+    std::array<Candidate, CONFIG_MAX_SHADOW_TILES> candidates;
+    size_t candidateCount = 0;
+
+    auto const* UTILS_RESTRICT spheres   = lightData.data<FScene::POSITION_RADIUS>();
+    auto const* UTILS_RESTRICT instances = lightData.data<FScene::LIGHT_INSTANCE>();
+    const float3 cameraPosition = camera.getPosition();
+    for (size_t i = FScene::DIRECTIONAL_LIGHTS_COUNT, c = lightData.size(); i < c; i++) {
+        FLightManager::Instance li = instances[i];
+        if (!lcm.isShadowCaster(li)) {
+            continue;
+        }
+        // a point light needs 6 tiles, which must all fit at once in the atlas
+        const bool isPointLight = lcm.isPointLight(li);
+        const uint32_t maxSize = std::min(lcm.getShadowMapSize(li),
+                isPointLight ? DIMENSION / 4 : DIMENSION / 2);
+
+        Candidate candidate;
+        candidate.index = uint32_t(i);
+        candidate.tileCount = uint8_t(isPointLight ? 6 : 1);
+        candidate.size = computeTileSize(spheres[i].w, length(spheres[i].xyz - cameraPosition),
+                camera.projection[1][1], viewport.height, maxSize, &candidate.importance);
+
+        auto pos = std::upper_bound(candidates.begin(), candidates.begin() + candidateCount,
+                candidate, [](Candidate const& lhs, Candidate const& rhs) {
+                    return lhs.importance > rhs.importance;
+                });
+        if (pos != candidates.end()) {
+            std::move_backward(pos, candidates.begin() + candidateCount,
+                    candidates.begin() + std::min(candidateCount + 1, candidates.size()));
+            *pos = candidate;
+            candidateCount = std::min(candidateCount + 1, candidates.size());
+        }
+    }
+
+    // drop the least important lights that don't fit in the maximum number of tiles
+    size_t tileCount = 0;
+    size_t count = 0;
+    for (size_t i = 0; i < candidateCount; i++) {
+        if (tileCount + candidates[i].tileCount <= CONFIG_MAX_SHADOW_TILES) {
+            tileCount += candidates[i].tileCount;
+            candidates[count++] = candidates[i];
+        }
+    }
+    candidateCount = count;
+
+    // first, the lights whose tiles didn't change size keep them, so that the atlas doesn't
+    // get re-packed needlessly
+    for (size_t i = 0; i < candidateCount; i++) {
+        Candidate& candidate = candidates[i];
+        FLightManager::Instance li = instances[candidate.index];
+        auto pos = std::find_if(mPreviousLights.begin(), mPreviousLights.end(),
+                [li](ShadowedLight const& light) { return light.instance == li; });
+        if (pos == mPreviousLights.end() || pos->tileCount != candidate.tileCount ||
+                mPreviousTiles[pos->firstTile].size != candidate.size) {
+            continue;
+        }
+        size_t t = 0;
+        while (t < candidate.tileCount && mAllocator.allocate(mPreviousTiles[pos->firstTile + t])) {
+            candidate.rects[t] = mPreviousTiles[pos->firstTile + t];
+            t++;
+        }
+        if (t < candidate.tileCount) {
+            // this can only happen if the light's tiles overlap with another light's
+            while (t) {
+                mAllocator.free(candidate.rects[--t]);
+                candidate.rects[t] = {};
+            }
+        }
+    }
+
+    // then, the other lights are packed in the remaining space, with smaller tiles if needed
+    for (size_t i = 0; i < candidateCount; i++) {
+        Candidate& candidate = candidates[i];
+        if (candidate.rects[0].isValid()) {
+            continue;
+        }
+        for (uint32_t size = candidate.size; size >= MIN_TILE_SIZE; size /= 2) {
+            size_t t = 0;
+            while (t < candidate.tileCount &&
+                    (candidate.rects[t] = mAllocator.allocate(size)).isValid()) {
+                t++;
+            }
+            if (t == candidate.tileCount) {
+                break;
+            }
+            while (t) {
+                mAllocator.free(candidate.rects[--t]);
+                candidate.rects[t] = {};
+            }
+        }
+    }
+
+    // finally, compute the cameras of all the tiles
+    auto const* UTILS_RESTRICT directions = lightData.data<FScene::DIRECTION>();
+    for (size_t i = 0; i < candidateCount; i++) {
+        Candidate const& candidate = candidates[i];
+        if (!candidate.rects[0].isValid()) {
+            // no room left for this light
+            continue;
+        }
+        FLightManager::Instance li = instances[candidate.index];
+        FLightManager::ShadowParams const& params = lcm.getShadowParams(li);
+        const float3 position = spheres[candidate.index].xyz;
+        const float radius = spheres[candidate.index].w;
+
+        mLights.push_back({ li, uint8_t(mTileCount), candidate.tileCount });
+        if (candidate.tileCount == 1) {
+            // the spot light's cone angle is recovered from its scale/offset
+            float2 const& scaleOffset = lcm.getSpotParams(li).scaleOffset;
+            const float cosOuter = -scaleOffset.y / scaleOffset.x;
+            const float fov = std::min(float(2.0 * std::acos(cosOuter) * 180.0 / M_PI), 160.0f);
+            Tile& tile = mTiles[mTileCount++];
+            tile.rect = candidate.rects[0];
+            computeTile(tile, position, directions[candidate.index], fov, radius, params);
+        } else {
+            // the faces must match the order used by the shaders: +x, -x, +y, -y, +z, -z
+            static constexpr float3 faces[6] = {
+                    { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 }
+            };
+            for (size_t f = 0; f < 6; f++) {
+                Tile& tile = mTiles[mTileCount++];
+                tile.rect = candidate.rects[f];
+                computeTile(tile, position, faces[f], 90.0f, radius, params);
+            }
+        }
+    }
+}
+
+void ShadowAtlas::computeTile(Tile& tile, float3 const& position, float3 const& direction,
+        float fov, float radius, FLightManager::ShadowParams const& params) noexcept {
+    const float near = std::max(0.01f, radius * (1.0f / 1024.0f));
+    const float far = std::max(radius, 2.0f * near);
+
+    // the up vector can be anything not colinear with the direction, the shaders don't
+    // depend on the orientation of the tile.
+    const float3 up = std::abs(direction.y) > 0.9f ? float3{ 0, 0, 1 } : float3{ 0, 1, 0 };
+    const mat4f model = mat4f::lookAt(position, position + direction, up);
+
+    const mat4f view = FCamera::getViewMatrix(model);
+    const mat4f projection = mat4f::perspective(fov, 1.0f, near, far);
+
+    tile.camera = CameraInfo{
+            .projection         = projection,
+            .cullingProjection  = projection,
+            .model              = model,
+            .view               = view,
+            .zn                 = near,
+            .zf                 = far,
+    };
+    tile.frustum = Frustum(projection * view);
+
+    // remapping from NDC to texture coordinates (i.e. [-1,1] -> [0, 1])
+    const mat4f Mt(mClipSpaceFlipped ? mat4f::row_major_init{
+            0.5f,   0,    0,  0.5f,
+              0, -0.5f,   0,  0.5f,
+              0,    0,  0.5f, 0.5f,
+              0,    0,    0,    1
+    } : mat4f::row_major_init{
+            0.5f,   0,    0,  0.5f,
+              0,  0.5f,   0,  0.5f,
+              0,    0,  0.5f, 0.5f,
+              0,    0,    0,    1
+    });
+
+    // then to the tile's viewport, which has a 1-texel border (see getViewport())
+    const float s = float(tile.rect.size - 2) / DIMENSION;
+    const float ox = float(tile.rect.x + 1) / DIMENSION;
+    const float oy = float(tile.rect.y + 1) / DIMENSION;
+    const mat4f Mv(mat4f::row_major_init{
+            s, 0, 0, ox,
+            0, s, 0, oy,
+            0, 0, 1, 0,
+            0, 0, 0, 1
+    });
+
+    tile.lightSpace = Mv * Mt * projection * view;
+
+    // the normal bias is proportional to the size of a texel, which grows with the distance
+    // to the light
+    const float texelSizeAtOneMeter =
+            2.0f * std::tan(fov * float(M_PI / 360.0)) / (tile.rect.size - 2);
+    tile.bias = { params.shadowConstantBias, params.shadowNormalBias * texelSizeAtOneMeter, 0, 0 };
+}
+
+uint32_t ShadowAtlas::getShadowIndex(FLightManager::Instance light) const noexcept {
+    for (ShadowedLight const& l : mLights) {
+        if (l.instance == light) {
+            return l.firstTile + 1u;
+        }
+    }
+    return 0;
+}
+
+void ShadowAtlas::prepare(DriverApi& driver, SamplerBuffer& sb) noexcept {
+    if (mTexture) {
+        // nothing to do here.
+        return;
+    }
+
+    mTexture = driver.createTexture(
+            Driver::SamplerType::SAMPLER_2D, 1, Driver::TextureFormat::DEPTH16, 1,
+            DIMENSION, DIMENSION, 1, TextureUsage::DEPTH_ATTACHMENT);
+
+    mRenderTarget = driver.createRenderTarget(
+            TargetBufferFlags::SHADOW, DIMENSION, DIMENSION, 1, Driver::TextureFormat::DEPTH16,
+            {}, { mTexture }, {});
+
+    SamplerParams s;
+    s.filterMag = SamplerMagFilter::LINEAR;
+    s.filterMin = SamplerMinFilter::LINEAR;
+    s.compareFunc = SamplerCompareFunc::LE;
+    s.compareMode = SamplerCompareMode::COMPARE_TO_TEXTURE;
+    s.depthStencil = true;
+    sb.setSampler(PerViewSib::SHADOW_ATLAS, { mTexture, s });
+}
+
+filament::Viewport ShadowAtlas::getViewport(size_t tile) const noexcept {
+    // we set a viewport with a 1-texel border for when we index outside of the tile
+    // DON'T CHANGE this unless computeTile() is updated too.
+    ShadowAtlasAllocator::Tile const& rect = mTiles[tile].rect;
+    return { int32_t(rect.x + 1), int32_t(rect.y + 1), rect.size - 2u, rect.size - 2u };
+}
+
+void ShadowAtlas::beginRenderPass(DriverApi& driver, size_t tile) const noexcept {
+    RenderPassParams params = {};
+    if (tile == 0) {
+        // the first tile clears the whole texture, the following ones must preserve it
+        params.flags.clear = TargetBufferFlags::SHADOW;
+        params.flags.discardStart = TargetBufferFlags::DEPTH;
+    }
+    params.flags.discardEnd = TargetBufferFlags::COLOR_AND_STENCIL;
+    params.clearDepth = 1.0;
+    params.viewport.width = DIMENSION;
+    params.viewport.height = DIMENSION;
+    // Disable scissor and viewport to avoid bugs in some drivers where the GPU memory is reloaded
+    // needlessly.
+    params.flags.clear |= RenderPassFlags::IGNORE_SCISSOR | RenderPassFlags::IGNORE_VIEWPORT;
+    driver.beginRenderPass(mRenderTarget, params);
+
+    const filament::Viewport viewport = getViewport(tile);
+    driver.viewport(viewport.left, viewport.bottom, viewport.width, viewport.height);
+}
+
+} // namespace details
+} // namespace filament
@@ -26,6 +26,8 @@
 
 #include <filament/driver/DriverEnums.h>
 
+#include <utils/Hash.h>
+
 #include <limits>
 
 using namespace filament::math;
@@ -46,11 +48,12 @@ ShadowMap::ShadowMap(FEngine& engine) noexcept :
         mEngine(engine),
         mClipSpaceFlipped(engine.getBackend() == Backend::VULKAN ||
                           engine.getBackend() == Backend::METAL) {
-    mCamera = mEngine.createCamera(EntityManager::get().create());
     mDebugCamera = mEngine.createCamera(EntityManager::get().create());
     FDebugRegistry& debugRegistry = engine.getDebugRegistry();
     debugRegistry.registerProperty("d.shadowmap.focus_shadowcasters", &engine.debug.shadowmap.focus_shadowcasters);
     debugRegistry.registerProperty("d.shadowmap.far_uses_shadowcasters", &engine.debug.shadowmap.far_uses_shadowcasters);
+    debugRegistry.registerProperty("d.shadowmap.cache", &engine.debug.shadowmap.cache);
+
     if (ENABLE_LISPSM) {
         debugRegistry.registerProperty("d.shadowmap.lispsm", &engine.debug.shadowmap.lispsm);
         debugRegistry.registerProperty("d.shadowmap.dzn", &engine.debug.shadowmap.dzn);
@@ -59,16 +62,20 @@ ShadowMap::ShadowMap(FEngine& engine) noexcept :
 }
 
 ShadowMap::~ShadowMap() {
-    mEngine.destroy(mCamera->getEntity());
+    for (Cascade const& cascade : mCascades) {
+        if (cascade.camera) {
+            mEngine.destroy(cascade.camera->getEntity());
+        }
+    }
     mEngine.destroy(mDebugCamera->getEntity());
 }
 
 void ShadowMap::prepare(DriverApi& driver, SamplerBuffer& sb) noexcept {
     assert(mShadowMapDimension);
 
-    uint32_t dim = mShadowMapDimension;
-    uint32_t currentDimension = mViewport.width + 2;
-    if (currentDimension == dim) {
+    const uint32_t dim = mShadowMapDimension;
+    const uint8_t cascadeCount = mCascadeCount;
+    if (mTextureDimension == dim && mTextureCascadeCount == cascadeCount) {
         // nothing to do here.
         assert(mShadowMapHandle);
         return;
@@ -83,17 +90,19 @@ void ShadowMap::prepare(DriverApi& driver, SamplerBuffer& sb) noexcept {
     }
 
     // allocate new ones...
-    // we set a viewport with a 1-texel border for when we index outside of the texture
-    // DON'T CHANGE this unless computeLightSpaceMatrix() is updated too.
-    // see: computeLightSpaceMatrix()
-    mViewport = { 1, 1, dim - 2, dim - 2 };
+    // the cascades are stored side by side, in a single row, so that each tile has the same
+    // vertical position regardless of the backend's viewport origin.
+    mTextureDimension = dim;
+    mTextureCascadeCount = cascadeCount;
+    mContentValid = false;
+    const uint32_t width = dim * cascadeCount;
 
     mShadowMapHandle = driver.createTexture(
-            Driver::SamplerType::SAMPLER_2D, 1, Driver::TextureFormat::DEPTH16, 1, dim, dim, 1,
+            Driver::SamplerType::SAMPLER_2D, 1, Driver::TextureFormat::DEPTH16, 1, width, dim, 1,
             TextureUsage::DEPTH_ATTACHMENT);
 
     mShadowMapRenderTarget = driver.createRenderTarget(
-            TargetBufferFlags::SHADOW, dim, dim, 1, Driver::TextureFormat::DEPTH16,
+            TargetBufferFlags::SHADOW, width, dim, 1, Driver::TextureFormat::DEPTH16,
             {}, { mShadowMapHandle }, {});
 
     SamplerParams s;
@@ -105,6 +114,36 @@ void ShadowMap::prepare(DriverApi& driver, SamplerBuffer& sb) noexcept {
     sb.setSampler(PerViewSib::SHADOW_MAP, { mShadowMapHandle, s });
 }
 
+filament::Viewport ShadowMap::getViewport(size_t cascade) const noexcept {
+    // we set a viewport with a 1-texel border for when we index outside of the tile
+    // DON'T CHANGE this unless getTextureCoordsMapping() is updated too.
+    const uint32_t dim = mTextureDimension;
+    return { int32_t(cascade * dim + 1), 1, dim - 2, dim - 2 };
+}
+
+bool ShadowMap::updateCache(uint32_t castersHash) noexcept {
+    if (UTILS_UNLIKELY(!castersHash || !mEngine.debug.shadowmap.cache)) {
+        mContentValid = false;
+        return true;
+    }
+
+    uint32_t hash = castersHash;
+    const uint32_t header[] = {
+            mEngine.getContentVersion(), mShadowMapDimension, mCascadeCount };
+    hash = utils::hash::murmur3(header, sizeof(header) / 4, hash);
+    for (size_t c = 0, n = mCascadeCount; c < n; c++) {
+        Cascade const& cascade = mCascades[c];
+        static_assert(sizeof(cascade.lightSpace) % 4 == 0, "mat4f must be a multiple of 4 bytes");
+        hash = utils::hash::murmur3(reinterpret_cast<uint32_t const*>(&cascade.lightSpace),
+                sizeof(cascade.lightSpace) / 4, hash ^ uint32_t(cascade.visible));
+    }
+
+    const bool needsRendering = !mContentValid || hash != mContentHash;
+    mContentHash = hash;
+    mContentValid = true;
+    return needsRendering;
+}
+
 void ShadowMap::terminate(DriverApi& driverApi) noexcept {
     if (mShadowMapRenderTarget) {
         driverApi.destroyRenderTarget(mShadowMapRenderTarget);
@@ -114,20 +153,24 @@ void ShadowMap::terminate(DriverApi& driverApi) noexcept {
     }
 }
 
-void ShadowMap::beginRenderPass(DriverApi& driver) const noexcept {
+void ShadowMap::beginRenderPass(DriverApi& driver, size_t cascade) const noexcept {
     RenderPassParams params = {};
-    params.flags.clear = TargetBufferFlags::SHADOW;
-    params.flags.discardStart = TargetBufferFlags::DEPTH;
+    if (cascade == 0) {
+        // the first cascade clears the whole texture, the following ones must preserve it
+        params.flags.clear = TargetBufferFlags::SHADOW;
+        params.flags.discardStart = TargetBufferFlags::DEPTH;
+    }
     params.flags.discardEnd = TargetBufferFlags::COLOR_AND_STENCIL;
     params.clearDepth = 1.0;
-    params.viewport.width = params.viewport.height = mShadowMapDimension;
+    params.viewport.width = mTextureDimension * mTextureCascadeCount;
+    params.viewport.height = mTextureDimension;
     // Disable scissor and viewport to avoid bugs in some drivers where the GPU memory is reloaded
     // needlessly.
     params.flags.clear |= RenderPassFlags::IGNORE_SCISSOR | RenderPassFlags::IGNORE_VIEWPORT;
     driver.beginRenderPass(mShadowMapRenderTarget, params);
 
-    driver.viewport(mViewport.left, mViewport.bottom,
-            mViewport.width, mViewport.height);
+    const filament::Viewport viewport = getViewport(cascade);
+    driver.viewport(viewport.left, viewport.bottom, viewport.width, viewport.height);
 }
 
 void ShadowMap::update(
@@ -141,19 +184,11 @@ void ShadowMap::update(
     mShadowMapDimension = std::max(1u, lcm.getShadowMapSize(li));
 
     FLightManager::ShadowParams params = lcm.getShadowParams(li);
+    const float n = camera.zn;
+    const float f = params.shadowFar > 0.0f ? params.shadowFar : camera.zf;
     mat4f projection(camera.cullingProjection);
     if (params.shadowFar > 0.0f) {
-        float n = camera.zn;
-        float f = params.shadowFar;
-        if (std::abs(projection[2].w) <= std::numeric_limits<float>::epsilon()) {
-            // perspective projection
-            projection[2].z =     (f + n) / (n - f);
-            projection[3].z = (2 * f * n) / (n - f);
-        } else {
-            // ortho projection
-            projection[2].z =    2.0f / (n - f);
-            projection[3].z = (f + n) / (n - f);
-        }
+        projection = setNearFar(projection, n, f);
     }
 
     CameraInfo cameraInfo = {
@@ -177,14 +212,21 @@ void ShadowMap::update(
     if (dzf > 0)    dzf =-cameraInfo.dzf / dz;
     else            cameraInfo.dzf =-dzf * dz;
 
+    mCameraInfo = cameraInfo;
+    mHasVisibleShadows = false;
+    mCascadeCount = params.cascades;
+    mShadowMapDimension = std::min(mShadowMapDimension, MAX_TEXTURE_WIDTH / mCascadeCount);
 
     using Type = FLightManager::Type;
     switch (lcm.getType(li)) {
         case Type::SUN:
         case Type::DIRECTIONAL:
-            computeShadowCameraDirectional(
-                    lightData.elementAt<FScene::DIRECTION>(index), scene, cameraInfo,
-                    visibleLayers);
+            // scene bounds in world space, shared by all cascades
+            mLightDirection = lightData.elementAt<FScene::DIRECTION>(index);
+            scene->computeBounds(mWsShadowCastersVolume, mWsShadowReceiversVolume, visibleLayers);
+            mHasVisibleShadows = !mWsShadowCastersVolume.isEmpty() &&
+                                 !mWsShadowReceiversVolume.isEmpty();
+            computeCascadeSplits(mSplits, mCascadeCount, params.cascadeSplitPositions, n, f);
             break;
         case Type::FOCUSED_SPOT:
         case Type::SPOT:
@@ -192,32 +234,86 @@ void ShadowMap::update(
         case Type::POINT:
             break;
     }
-}
 
-void ShadowMap::computeShadowCameraDirectional(
-        filament::math::float3 const& dir, FScene const* scene, CameraInfo const& camera,
-        uint8_t visibleLayers) noexcept {
+    // the cameras are created here rather than in updateCascade(), which can run on any thread
+    for (size_t c = 0; c < mCascadeCount; c++) {
+        if (UTILS_UNLIKELY(!mCascades[c].camera)) {
+            mCascades[c].camera = mEngine.createCamera(EntityManager::get().create());
+        }
+        mCascades[c].visible = false;
+    }
+}
 
-    // scene bounds in world space
-    Aabb wsShadowCastersVolume, wsShadowReceiversVolume;
-    scene->computeBounds(wsShadowCastersVolume, wsShadowReceiversVolume, visibleLayers);
-    if (wsShadowCastersVolume.isEmpty() || wsShadowReceiversVolume.isEmpty()) {
-        mHasVisibleShadows = false;
+void ShadowMap::updateCascade(size_t index) noexcept {
+    assert(index < mCascadeCount);
+    if (!mHasVisibleShadows) {
         return;
     }
 
+    CameraInfo camera = mCameraInfo;
+    if (mCascadeCount > 1) {
+        // restrict the camera frustum to the depth range of this cascade
+        camera.projection = setNearFar(camera.projection, mSplits[index], mSplits[index + 1]);
+        camera.frustum = Frustum(camera.projection * camera.view);
+    }
+
+    // LiSPSM warps the shadow map along the view direction, which is only worth it
+    // when a single shadow map covers the whole depth range.
+    const bool useLispsm = ENABLE_LISPSM && mEngine.debug.shadowmap.lispsm && mCascadeCount == 1;
+
+    computeShadowCameraDirectional(mCascades[index], index, camera, useLispsm);
+}
+
+void ShadowMap::resolveVisibility() noexcept {
+    bool visible = false;
+    for (size_t c = 0; c < mCascadeCount; c++) {
+        visible |= mCascades[c].visible;
+    }
+    mHasVisibleShadows = visible;
+}
+
+void ShadowMap::computeCascadeSplits(float* splits, size_t cascadeCount,
+        float const* splitPositions, float near, float far) noexcept {
+    splits[0] = near;
+    for (size_t c = 1; c < cascadeCount; c++) {
+        splits[c] = near + (far - near) * splitPositions[c - 1];
+    }
+    splits[cascadeCount] = far;
+}
+
+mat4f ShadowMap::setNearFar(mat4f projection, float n, float f) noexcept {
+    if (std::abs(projection[2].w) <= std::numeric_limits<float>::epsilon()) {
+        // perspective projection
+        projection[2].z =     (f + n) / (n - f);
+        projection[3].z = (2 * f * n) / (n - f);
+    } else {
+        // ortho projection
+        projection[2].z =    2.0f / (n - f);
+        projection[3].z = (f + n) / (n - f);
+    }
+    return projection;
+}
+
+void ShadowMap::computeShadowCameraDirectional(Cascade& cascade, size_t index,
+        CameraInfo const& camera, bool useLispsm) noexcept {
+
+    float3 const& dir = mLightDirection;
+    Aabb const& wsShadowCastersVolume = mWsShadowCastersVolume;
+    Aabb const& wsShadowReceiversVolume = mWsShadowReceiversVolume;
+    FrustumBoxIntersection& wsClippedShadowReceiverVolume = cascade.wsClippedShadowReceiverVolume;
+
     float3 wsViewFrustumCorners[8];
     computeFrustumCorners(wsViewFrustumCorners,
             camera.model * FCamera::inverseProjection(camera.projection));
 
     // compute the intersection of the shadow receivers volume with the view volume
     // in world space. This returns a set of points on the convex-hull of the intersection.
-    size_t vertexCount = intersectFrustumWithBox(mWsClippedShadowReceiverVolume,
+    size_t vertexCount = intersectFrustumWithBox(wsClippedShadowReceiverVolume,
             camera.frustum, wsViewFrustumCorners, wsShadowReceiversVolume);
 
-    mHasVisibleShadows = vertexCount >= 2;
-    if (mHasVisibleShadows) {
-        const bool USE_LISPSM = ENABLE_LISPSM && mEngine.debug.shadowmap.lispsm;
+    cascade.visible = vertexCount >= 2;
+    if (cascade.visible) {
+        const bool USE_LISPSM = useLispsm;
 
         /*
          * Compute the light's model matrix
@@ -269,7 +365,7 @@ void ShadowMap::computeShadowCameraDirectional(
         }
         for (size_t i = 0; i < vertexCount; ++i) {
             // far: figure out farthest shadow receivers
-            float3 v = mat4f::project(LMv, mWsClippedShadowReceiverVolume[i]);
+            float3 v = mat4f::project(LMv, wsClippedShadowReceiverVolume[i]);
             lsLightFrustum.min.z = std::min(lsLightFrustum.min.z, v.z);
             if (USE_DEPTH_CLAMP) {
                 // further tighten to the shadow receiver volume
@@ -327,15 +423,15 @@ void ShadowMap::computeShadowCameraDirectional(
         // disable vectorization here because vertexCount is <= 64, not worth the increased code size.
         #pragma clang loop vectorize(disable)
         for (size_t i = 0; i < vertexCount; ++i) {
-            const float3 v = mat4f::project(WLMpMv, mWsClippedShadowReceiverVolume[i]);
+            const float3 v = mat4f::project(WLMpMv, wsClippedShadowReceiverVolume[i]);
             lsLightFrustum.min.xy = min(lsLightFrustum.min.xy, v.xy);
             lsLightFrustum.max.xy = max(lsLightFrustum.max.xy, v.xy);
         }
 
         // For directional lights, we further constraint the light frustum to the
         // intersection of the shadow casters & receivers in light-space.
-        // However, since this relies on the 1-texel shadow map border, this wouldn't directly
-        // work if we were storing several shadow maps in a single texture.
+        // This relies on the 1-texel border around each cascade's tile of the shadow map.
+
         if (mEngine.debug.shadowmap.focus_shadowcasters) {
             intersectWithShadowCasters(lsLightFrustum, WLMpMv, wsShadowCastersVolume);
         }
@@ -344,7 +440,7 @@ void ShadowMap::computeShadowCameraDirectional(
                            (lsLightFrustum.min.y >= lsLightFrustum.max.y))) {
             // this could happen if the only thing visible is a perfectly horizontal or
             // vertical thin line
-            mHasVisibleShadows = false;
+            cascade.visible = false;
             return;
         }
 
@@ -377,16 +473,27 @@ void ShadowMap::computeShadowCameraDirectional(
         // Compute shadow-map texture access transform
         const mat4f MbMt = getTextureCoordsMapping();
 
-        // Final shadowmap texture transform
+        // Final shadowmap texture transform (i.e. within this cascade's tile)
         const mat4f St = mat4f(MbMt * S);
 
-        mTexelSizeWs = texelSizeWorldSpace(St, float3{ 0.5f });
-        mLightSpace = St;
-        mSceneRange = (zfar - znear);
-        mCamera->setCustomProjection(mat4(S), znear, zfar);
+        // place the tile in the shadow map texture
+        const float tileScale = 1.0f / mCascadeCount;
+        const mat4f Ma(mat4f::row_major_init{
+                tileScale, 0, 0, index * tileScale,
+                        0, 1, 0, 0,
+                        0, 0, 1, 0,
+                        0, 0, 0, 1
+        });
+
+        cascade.texelSizeWs = texelSizeWorldSpace(St, float3{ 0.5f });
+        cascade.lightSpace = Ma * St;
+        cascade.sceneRange = (zfar - znear);
+        cascade.camera->setCustomProjection(mat4(S), znear, zfar);
 
-        // for the debug camera, we need to undo the world origin
-        mDebugCamera->setCustomProjection(mat4(S * camera.worldOrigin), znear, zfar);
+        if (index == 0) {
+            // for the debug camera, we need to undo the world origin
+            mDebugCamera->setCustomProjection(mat4(S * camera.worldOrigin), znear, zfar);
+        }
     }
 }
 
@@ -480,7 +587,7 @@ mat4f ShadowMap::getTextureCoordsMapping() const noexcept {
               0,    0,    0,    1
     });
 
-    // apply the 1-texel border viewport transform
+    // apply the 1-texel border viewport transform (each tile has the same border)
     const float o = 1.0f / mShadowMapDimension;
     const float s = 1.0f - 2.0f * o;
     const mat4f Mb(mat4f::row_major_init{
@@ -18,6 +18,7 @@
 
 #include "details/Engine.h"
 #include "details/Stream.h"
+#include "details/TextureStreamer.h"
 
 #include "FilamentAPI-impl.h"
 
@@ -114,12 +115,17 @@ FTexture::FTexture(FEngine& engine, const Builder& builder) {
     FEngine::DriverApi& driver = engine.getDriverApi();
     mHandle = driver.createTexture(
             mTarget, mLevels, mFormat, mSampleCount, mWidth, mHeight, mDepth, mUsage);
+    engine.getTextureMemory().add(getMemorySize());
 }
 
 // frees driver resources, object becomes invalid
 void FTexture::terminate(FEngine& engine) {
+    if (mStreamed) {
+        engine.getTextureStreamer().remove(this);
+    }
     FEngine::DriverApi& driver = engine.getDriverApi();
     driver.destroyTexture(mHandle);
+    engine.getTextureMemory().remove(getMemorySize());
 }
 
 static inline size_t valueForLevel(size_t level, size_t value) {
@@ -141,7 +147,7 @@ size_t FTexture::getDepth(size_t level) const noexcept {
 void FTexture::setImage(FEngine& engine,
         size_t level, uint32_t xoffset, uint32_t yoffset, uint32_t width, uint32_t height,
         Texture::PixelBufferDescriptor&& buffer) const noexcept {
-    if (!mStream && mTarget != Sampler::SAMPLER_CUBEMAP && level < mLevels) {
+    if (!mStream && !mStreamed && mTarget != Sampler::SAMPLER_CUBEMAP && level < mLevels) {
         if (buffer.buffer) {
             engine.getDriverApi().update2DImage(mHandle,
                     uint8_t(level), xoffset, yoffset, width, height, std::move(buffer));
@@ -159,6 +165,37 @@ void FTexture::setImage(FEngine& engine, size_t level,
     }
 }
 
+void FTexture::setStreamingSource(FEngine& engine,
+        StreamingSource* source, float uvDensity) noexcept {
+    if (!ASSERT_POSTCONDITION_NON_FATAL(source && mTarget == Sampler::SAMPLER_2D && !mStream &&
+            mSampleCount == 1, "Only 2D textures can be streamed")) {
+        delete source;
+        return;
+    }
+    engine.getTextureStreamer().add(this, source, uvDensity);
+}
+
+void FTexture::setResidentLevels(FEngine& engine, uint8_t baseLevel,
+        PixelBufferDescriptor* levels) noexcept {
+    FEngine::DriverApi& driver = engine.getDriverApi();
+    const uint8_t count = uint8_t(mLevels - baseLevel);
+    Handle<HwTexture> handle = driver.createTexture(mTarget, count, mFormat, mSampleCount,
+            uint32_t(getWidth(baseLevel)), uint32_t(getHeight(baseLevel)), mDepth, mUsage);
+    for (uint8_t i = 0; i < count; i++) {
+        if (levels[i].buffer) {
+            const size_t level = baseLevel + i;
+            driver.update2DImage(handle, i, 0, 0,
+                    uint32_t(getWidth(level)), uint32_t(getHeight(level)), std::move(levels[i]));
+        }
+    }
+    driver.destroyTexture(mHandle);
+    engine.getTextureMemory().remove(getMemorySize());
+    mHandle = handle;
+    mBaseLevel = baseLevel;
+    mStreamed = true;
+    engine.getTextureMemory().add(getMemorySize());
+}
+
 void FTexture::setExternalImage(FEngine& engine, void* image) noexcept {
     if (mTarget == Sampler::SAMPLER_EXTERNAL) {
         engine.getDriverApi().setExternalImage(mHandle, image);
@@ -199,7 +236,7 @@ void FTexture::generateMipmaps(FEngine& engine) const noexcept {
             "Texture format must be color renderable")) {
         return;
     }
-    if (mLevels == 1 || (mWidth == 1 && mHeight == 1)) {
+    if (mLevels == 1 || (mWidth == 1 && mHeight == 1) || mStreamed) {
         return;
     }
 
@@ -335,6 +372,67 @@ size_t FTexture::getFormatSize(InternalFormat format) noexcept {
     }
 }
 
+size_t FTexture::getLevelSize(InternalFormat format, size_t width, size_t height) noexcept {
+    using TextureFormat = InternalFormat;
+    const size_t formatSize = getFormatSize(format);
+    if (formatSize) {
+        return formatSize * width * height;
+    }
+
+    // compressed formats are made of blocks of 8 or 16 bytes
+    size_t blockWidth = 4;
+    size_t blockHeight = 4;
+    size_t blockSize = 16;
+    switch (format) {
+        case TextureFormat::EAC_R11:
+        case TextureFormat::EAC_R11_SIGNED:
+        case TextureFormat::ETC2_RGB8:
+        case TextureFormat::ETC2_SRGB8:
+        case TextureFormat::ETC2_RGB8_A1:
+        case TextureFormat::ETC2_SRGB8_A1:
+        case TextureFormat::DXT1_RGB:
+        case TextureFormat::DXT1_RGBA:
+            blockSize = 8;
+            break;
+        case TextureFormat::EAC_RG11:
+        case TextureFormat::EAC_RG11_SIGNED:
+        case TextureFormat::ETC2_EAC_RGBA8:
+        case TextureFormat::ETC2_EAC_SRGBA8:
+        case TextureFormat::DXT3_RGBA:
+        case TextureFormat::DXT5_RGBA:
+            break;
+        default: {
+            // ASTC, the RGBA and SRGB8_ALPHA8 variants have the same block sizes, in order
+            static constexpr uint8_t blocks[][2] = {
+                    { 4, 4 }, { 5, 4 }, { 5, 5 }, { 6, 5 }, { 6, 6 }, { 8, 5 }, { 8, 6 },
+                    { 8, 8 }, { 10, 5 }, { 10, 6 }, { 10, 8 }, { 10, 10 }, { 12, 10 },
+                    { 12, 12 }
+            };
+            constexpr size_t count = sizeof(blocks) / sizeof(blocks[0]);
+            size_t i = size_t(format) - size_t(TextureFormat::RGBA_ASTC_4x4);
+            if (i >= 2 * count) {
+                return 0;
+            }
+            i = i % count;
+            blockWidth = blocks[i][0];
+            blockHeight = blocks[i][1];
+            break;
+        }
+    }
+    return blockSize * ((width + blockWidth - 1) / blockWidth) *
+            ((height + blockHeight - 1) / blockHeight);
+}
+
+size_t FTexture::getMemorySize() const noexcept {
+    const size_t faces = isCubemap() ? 6 : 1;
+    size_t size = 0;
+    for (size_t level = mBaseLevel; level < mLevels; level++) {
+        // the depth is halved at each level, like the width and the height
+        size += getLevelSize(mFormat, getWidth(level), getHeight(level)) * getDepth(level);
+    }
+    return size * faces * mSampleCount;
+}
+
 } // namespace details
 
 // ------------------------------------------------------------------------------------------------
@@ -402,6 +500,13 @@ void Texture::generateMipmaps(Engine& engine) const noexcept {
     upcast(this)->generateMipmaps(upcast(engine));
 }
 
+Texture::StreamingSource::~StreamingSource() = default;
+
+void Texture::setStreamingSource(Engine& engine, StreamingSource* source,
+        float uvDensity) noexcept {
+    upcast(this)->setStreamingSource(upcast(engine), source, uvDensity);
+}
+
 bool Texture::isTextureFormatSupported(Engine& engine, InternalFormat format) noexcept {
     return FTexture::isTextureFormatSupported(upcast(engine), format);
 }
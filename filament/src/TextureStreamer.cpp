@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "details/TextureStreamer.h"
+
+#include "details/Engine.h"
+#include "details/Texture.h"
+
+#include <utils/Panic.h>
+#include <utils/Systrace.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace utils;
+
+namespace filament {
+namespace details {
+
+constexpr size_t FTextureStreamer::DEFAULT_BUDGET;
+constexpr uint32_t FTextureStreamer::MIN_RESIDENT_SIZE;
+constexpr size_t FTextureStreamer::MAX_LOADS;
+constexpr size_t FTextureStreamer::MAX_LEVELS;
+
+FTextureStreamer::FTextureStreamer(FEngine& engine) noexcept
+        : mEngine(engine) {
+}
+
+FTextureStreamer::~FTextureStreamer() noexcept = default;
+
+void FTextureStreamer::terminate() noexcept {
+    // the streamed textures remove themselves when they're destroyed
+    assert(mRecords.empty());
+}
+
+size_t FTextureStreamer::getResidentSize() const noexcept {
+    size_t size = 0;
+    for (Record const& record : mRecords) {
+        size += size_t(record.tailSize[record.baseLevel]);
+    }
+    return size;
+}
+
+void FTextureStreamer::add(FTexture* texture,
+        Texture::StreamingSource* source, float uvDensity) noexcept {
+    if (texture->isStreamed()) {
+        remove(texture);
+    }
+
+    Record record;
+    record.texture = texture;
+    record.source = source;
+    record.uvDensity = uvDensity;
+    record.levels = uint8_t(std::min(texture->getLevels(), MAX_LEVELS));
+    record.width = uint32_t(texture->getWidth());
+    record.height = uint32_t(texture->getHeight());
+    for (size_t level = record.levels; level-- > 0;) {
+        record.tailSize[level] = record.tailSize[level + 1] + source->getLevelSize(level);
+    }
+
+    // start with the coarsest levels
+    uint8_t coarsest = 0;
+    while (coarsest < record.levels - 1 &&
+           std::max(texture->getWidth(coarsest), texture->getHeight(coarsest)) > MIN_RESIDENT_SIZE) {
+        coarsest++;
+    }
+    record.coarsestLevel = coarsest;
+    record.baseLevel = coarsest;
+    record.targetLevel = coarsest;
+
+    // they're small enough to be loaded right away, so the texture can always be used
+    std::vector<Texture::PixelBufferDescriptor> levels;
+    levels.reserve(record.levels - coarsest);
+    for (size_t level = coarsest; level < record.levels; level++) {
+        levels.push_back(source->getLevel(level));
+    }
+    Handle<HwTexture> const oldHandle = texture->getHwHandle();
+    texture->setResidentLevels(mEngine, coarsest, levels.data());
+    mEngine.replaceTexture(oldHandle, texture->getHwHandle());
+
+    mHandles[texture->getHwHandle().getId()] = uint32_t(mRecords.size());
+    mRecords.push_back(record);
+}
+
+void FTextureStreamer::remove(FTexture const* texture) noexcept {
+    auto pos = std::find_if(mRecords.begin(), mRecords.end(),
+            [texture](Record const& record) { return record.texture == texture; });
+    if (pos == mRecords.end()) {
+        return;
+    }
+
+    if (pos->load) {
+        mEngine.getJobSystem().waitAndRelease(pos->load->job);
+        delete pos->load;
+    }
+    delete pos->source;
+    mHandles.erase(texture->getHwHandle().getId());
+
+    // move the last record in its place
+    const uint32_t index = uint32_t(pos - mRecords.begin());
+    if (index != mRecords.size() - 1) {
+        *pos = mRecords.back();
+        mHandles[pos->texture->getHwHandle().getId()] = index;
+    }
+    mRecords.pop_back();
+}
+
+void FTextureStreamer::update() noexcept {
+    SYSTRACE_CALL();
+
+    // apply the loads that are done
+    for (Record& record : mRecords) {
+        if (record.load && record.load->done.load(std::memory_order_acquire)) {
+            finishLoad(record);
+        }
+    }
+
+    // start new loads from the requests of the last frame
+    schedule(mRecords.data(), mRecords.size(), mBudget, mFrame, MAX_LOADS, mChanges);
+    for (Change const& change : mChanges) {
+        startLoad(mRecords[change.index], change.baseLevel);
+    }
+
+    for (Record& record : mRecords) {
+        record.pixels = 0.0f;
+    }
+    mFrame++;
+}
+
+uint8_t FTextureStreamer::computeLevel(uint32_t width, uint32_t height, float uvDensity,
+        float pixels, uint8_t levels) noexcept {
+    // the number of texels across the renderable, for each pixel
+    const float ratio = float(std::max(width, height)) * uvDensity / pixels;
+    if (!(ratio > 2.0f)) {
+        // this includes ratio being a NaN or pixels being 0
+        return ratio > 0.0f ? uint8_t(0) : uint8_t(levels - 1);
+    }
+    return uint8_t(std::min(std::ilogb(ratio), int(levels) - 1));
+}
+
+void FTextureStreamer::schedule(Record* records, size_t count, size_t budget, uint32_t frame,
+        size_t maxLoads, std::vector<Change>& changes) noexcept {
+    changes.clear();
+
+    std::vector<uint32_t> loads;        // textures that need finer levels
+    std::vector<uint32_t> evictions;    // textures whose levels can be dropped
+    std::vector<uint32_t> oversized;    // visible textures with more levels than needed
+    size_t committed = 0;
+    size_t loading = 0;
+    for (size_t i = 0; i < count; i++) {
+        Record& record = records[i];
+        committed += record.getCommittedSize();
+        if (record.load) {
+            loading++;
+            continue;
+        }
+        if (record.lastUsed == frame) {
+            record.targetLevel = std::min(record.coarsestLevel, computeLevel(
+                    record.width, record.height, record.uvDensity, record.pixels, record.levels));
+            if (record.targetLevel < record.baseLevel) {
+                loads.push_back(uint32_t(i));
+            } else if (record.targetLevel > record.baseLevel) {
+                oversized.push_back(uint32_t(i));
+            }
+        } else if (record.baseLevel < record.coarsestLevel) {
+            evictions.push_back(uint32_t(i));
+        }
+    }
+
+    // the largest textures on screen are loaded first
+    std::sort(loads.begin(), loads.end(), [records](uint32_t lhs, uint32_t rhs) {
+        return records[lhs].pixels > records[rhs].pixels;
+    });
+
+    // the least recently used textures are evicted first, then the visible textures with
+    // more levels than they need, starting with the smallest on screen
+    std::sort(evictions.begin(), evictions.end(), [records](uint32_t lhs, uint32_t rhs) {
+        return records[lhs].lastUsed < records[rhs].lastUsed;
+    });
+    std::sort(oversized.begin(), oversized.end(), [records](uint32_t lhs, uint32_t rhs) {
+        return records[lhs].pixels < records[rhs].pixels;
+    });
+    evictions.insert(evictions.end(), oversized.begin(), oversized.end());
+
+    auto evictions_it = evictions.begin();
+    auto evict = [&]() {
+        Record const& record = records[*evictions_it];
+        const uint8_t level = record.lastUsed == frame ? record.targetLevel : record.coarsestLevel;
+        committed -= size_t(record.tailSize[record.baseLevel] - record.tailSize[level]);
+        changes.push_back({ *evictions_it, level });
+        ++evictions_it;
+    };
+
+    for (uint32_t i : loads) {
+        if (loading >= maxLoads) {
+            break;
+        }
+        Record const& record = records[i];
+        auto cost = [&record](uint8_t level) {
+            return size_t(record.tailSize[level] - record.tailSize[record.baseLevel]);
+        };
+        uint8_t level = record.targetLevel;
+        while (committed + cost(level) > budget && evictions_it != evictions.end()) {
+            evict();
+        }
+        // if there isn't enough room, settle for fewer levels
+        while (level < record.baseLevel && committed + cost(level) > budget) {
+            level++;
+        }
+        if (level < record.baseLevel) {
+            committed += cost(level);
+            changes.push_back({ i, level });
+            loading++;
+        }
+    }
+
+    // the budget may have been lowered
+    while (committed > budget && evictions_it != evictions.end()) {
+        evict();
+    }
+}
+
+void FTextureStreamer::startLoad(Record& record, uint8_t baseLevel) noexcept {
+    Load* const load = new Load;
+    load->baseLevel = baseLevel;
+    record.load = load;
+
+    // the images are produced by the source in a job, since that's typically where they're
+    // decoded
+    JobSystem& js = mEngine.getJobSystem();
+    Texture::StreamingSource* const source = record.source;
+    const uint8_t levels = record.levels;
+    load->job = js.runAndRetain(js.createJob(nullptr,
+            [load, source, levels](JobSystem&, JobSystem::Job*) {
+                load->levels.reserve(levels - load->baseLevel);
+                for (size_t level = load->baseLevel; level < levels; level++) {
+                    load->levels.push_back(source->getLevel(level));
+                }
+                load->done.store(true, std::memory_order_release);
+            }));
+}
+
+void FTextureStreamer::finishLoad(Record& record) noexcept {
+    Load* const load = record.load;
+    mEngine.getJobSystem().waitAndRelease(load->job);
+
+    FTexture* const texture = record.texture;
+    Handle<HwTexture> const oldHandle = texture->getHwHandle();
+    texture->setResidentLevels(mEngine, load->baseLevel, load->levels.data());
+    Handle<HwTexture> const newHandle = texture->getHwHandle();
+
+    // the material instances using this texture must use the new one
+    mEngine.replaceTexture(oldHandle, newHandle);
+    const uint32_t index = uint32_t(&record - mRecords.data());
+    mHandles.erase(oldHandle.getId());
+    mHandles[newHandle.getId()] = index;
+
+    record.baseLevel = load->baseLevel;
+    record.load = nullptr;
+    delete load;
+}
+
+} // namespace details
+} // namespace filament
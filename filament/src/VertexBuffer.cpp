@@ -146,6 +146,8 @@ FVertexBuffer::FVertexBuffer(FEngine& engine, const VertexBuffer::Builder& build
 
     auto const& declaredAttributes = mDeclaredAttributes;
     auto const& attributes = mAttributes;
+    // each buffer ends with the last of its attributes, like the backends size them
+    size_t bufferSizes[MAX_ATTRIBUTE_BUFFERS_COUNT] = {};
     #pragma nounroll
     for (size_t i = 0, n = attributeArray.size(); i < n; ++i) {
         if (declaredAttributes[i]) {
@@ -154,17 +156,27 @@ FVertexBuffer::FVertexBuffer(FEngine& engine, const VertexBuffer::Builder& build
             attributeArray[i].buffer = attributes[i].buffer;
             attributeArray[i].type   = attributes[i].type;
             attributeArray[i].flags  = attributes[i].flags;
+            if (attributes[i].buffer < MAX_ATTRIBUTE_BUFFERS_COUNT) {
+                size_t& size = bufferSizes[attributes[i].buffer];
+                size = std::max(size,
+                        attributes[i].offset + size_t(mVertexCount) * attributes[i].stride);
+            }
         }
     }
+    for (size_t size : bufferSizes) {
+        mMemorySize += size;
+    }
 
     FEngine::DriverApi& driver = engine.getDriverApi();
     mHandle = driver.createVertexBuffer(
             mBufferCount, attributeCount, mVertexCount, attributeArray, driver::BufferUsage::STATIC);
+    engine.getBufferMemory().add(mMemorySize);
 }
 
 void FVertexBuffer::terminate(FEngine& engine) {
     FEngine::DriverApi& driver = engine.getDriverApi();
     driver.destroyVertexBuffer(mHandle);
+    engine.getBufferMemory().remove(mMemorySize);
 }
 
 size_t FVertexBuffer::getVertexCount() const noexcept {
@@ -181,6 +193,7 @@ void FVertexBuffer::setBufferAt(FEngine& engine, uint8_t bufferIndex,
     if (bufferIndex < mBufferCount) {
         engine.getDriverApi().updateVertexBuffer(mHandle, bufferIndex,
                 std::move(buffer), byteOffset, byteSize);
+        engine.invalidateContent();
     } else {
         ASSERT_PRECONDITION_NON_FATAL(bufferIndex < mBufferCount,
                 "bufferIndex must be < bufferCount");
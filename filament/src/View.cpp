@@ -23,6 +23,7 @@
 #include "details/IndirectLight.h"
 #include "details/MaterialInstance.h"
 #include "details/Renderer.h"
+#include "details/RenderPrimitive.h"
 #include "details/Scene.h"
 #include "details/Skybox.h"
 
@@ -32,6 +33,7 @@
 #include <private/filament/UibGenerator.h>
 
 #include <utils/Allocator.h>
+#include <utils/Hash.h>
 #include <utils/Systrace.h>
 #include <utils/Profiler.h>
 #include <utils/Slice.h>
@@ -39,8 +41,11 @@
 #include <math/scalar.h>
 #include <math/fast.h>
 
+#include <algorithm>
 #include <memory>
 
+#include <string.h>
+
 using namespace filament::math;
 using namespace utils;
 
@@ -50,18 +55,20 @@ using namespace driver;
 
 namespace details {
 
-// values of the 'VISIBLE_MASK' after culling (0: not visible)
-static constexpr size_t VISIBLE_RENDERABLE_BIT = 0u;
-static constexpr size_t VISIBLE_SHADOW_CASTER_BIT = 1u;
-static constexpr uint8_t VISIBLE_RENDERABLE = 1u << VISIBLE_RENDERABLE_BIT;
-static constexpr uint8_t VISIBLE_SHADOW_CASTER = 1u << VISIBLE_SHADOW_CASTER_BIT;
-static constexpr uint8_t VISIBLE_ALL = VISIBLE_RENDERABLE | VISIBLE_SHADOW_CASTER;
+constexpr size_t FView::VISIBLE_RENDERABLE_BIT;
+constexpr size_t FView::VISIBLE_SHADOW_CASTER_BIT;
+constexpr size_t FView::VISIBLE_CASCADE_BIT;
+constexpr uint8_t FView::VISIBLE_RENDERABLE;
+constexpr uint8_t FView::VISIBLE_SHADOW_CASTER;
+constexpr uint8_t FView::VISIBLE_ALL;
+constexpr uint8_t FView::VISIBLE_CASCADES;
 
 FView::FView(FEngine& engine)
     : mFroxelizer(engine),
       mPerViewUb(engine.getPerViewUib()),
       mPerViewSb(engine.getPerViewSib()),
-      mDirectionalShadowMap(engine) {
+      mDirectionalShadowMap(engine),
+      mShadowAtlas(engine) {
     DriverApi& driver = engine.getDriverApi();
 
     // set-up samplers
@@ -92,6 +99,7 @@ void FView::terminate(FEngine& engine) {
     driver.destroySamplerBuffer(mPerViewSbh);
     driver.destroyUniformBuffer(mRenderableUbh);
     mDirectionalShadowMap.terminate(driver);
+    mShadowAtlas.terminate(driver);
     mFroxelizer.terminate(driver);
 }
 
@@ -274,7 +282,7 @@ bool FView::isSkyboxVisible() const noexcept {
     return skybox != nullptr && (skybox->getLayerMask() & mVisibleLayers);
 }
 
-void FView::prepareShadowing(FEngine& engine, driver::DriverApi& driver,
+void FView::prepareShadowing(FEngine& engine, driver::DriverApi& driver, ArenaScope& arena,
         FScene::RenderableSoa& renderableData, FScene::LightSoa const& lightData) noexcept {
     SYSTRACE_CALL();
 
@@ -289,30 +297,112 @@ void FView::prepareShadowing(FEngine& engine, driver::DriverApi& driver,
     FLightManager::Instance directionalLight = lightData.elementAt<FScene::LIGHT_INSTANCE>(0);
     mHasShadowing = mShadowingEnabled && directionalLight && lcm.isShadowCaster(directionalLight);
     if (UTILS_UNLIKELY(mHasShadowing)) {
-        // compute the frustum for this light
+        // compute the scene bounds and the cascades for this light
         ShadowMap& shadowMap = mDirectionalShadowMap;
         shadowMap.update(lightData, 0, scene, mViewingCameraInfo, mVisibleLayers);
         if (shadowMap.hasVisibleShadows()) {
-            // Cull shadow casters
-            Frustum const& frustum = shadowMap.getCamera().getFrustum();
-            FView::prepareVisibleShadowCasters(engine.getJobSystem(), frustum, renderableData);
-
+            // Compute the frustum of each cascade and cull shadow casters
+            FView::prepareVisibleShadowCasters(engine.getJobSystem(), arena,
+                    shadowMap, renderableData);
+        }
+        if (shadowMap.hasVisibleShadows()) {
             // allocates shadowmap driver resources
             shadowMap.prepare(driver, getUs());
 
-            mat4f const& lightFromWorldMatrix = shadowMap.getLightSpaceMatrix();
-            u.setUniform(offsetof(PerViewUib, lightFromWorldMatrix), lightFromWorldMatrix);
-
             // the 2x bias is needed in opengl because the depth maps to -1/1. It may not be
             // needed with other APIs, but at least it won't worsen the acnee there.
-            const float sceneRange = shadowMap.getSceneRange();
-            const float texelSizeWorldSpace = shadowMap.getTexelSizeWorldSpace();
             const float constantBias = lcm.getShadowConstantBias(directionalLight);
             const float normalBias = lcm.getShadowNormalBias(directionalLight);
+            const size_t cascadeCount = shadowMap.getCascadeCount();
+
+            float4 cascadeSplits{ std::numeric_limits<float>::max() };
+            float4 cascadeConstantBias{ 0 };
+            float4 cascadeNormalBias{ 0 };
+            for (size_t c = 0; c < cascadeCount; c++) {
+                u.setUniform(offsetof(PerViewUib, lightFromWorldMatrix) + c * sizeof(mat4f),
+                        shadowMap.getLightSpaceMatrix(c));
+                if (c + 1 < cascadeCount) {
+                    cascadeSplits[c] = shadowMap.getCascadeSplit(c);
+                }
+                cascadeConstantBias[c] = 2 * constantBias / shadowMap.getSceneRange(c);
+                cascadeNormalBias[c] = normalBias * shadowMap.getTexelSizeWorldSpace(c);
+            }
+
             u.setUniform(offsetof(PerViewUib, shadowBias),
-                    float3{ 2 * constantBias / sceneRange, normalBias * texelSizeWorldSpace, 0 });
+                    float3{ cascadeConstantBias[0], cascadeNormalBias[0], 0 });
+            u.setUniform(offsetof(PerViewUib, cascadeSplits), cascadeSplits);
+            u.setUniform(offsetof(PerViewUib, cascadeConstantBias), cascadeConstantBias);
+            u.setUniform(offsetof(PerViewUib, cascadeNormalBias), cascadeNormalBias);
+            u.setUniform(offsetof(PerViewUib, cascades), uint32_t(cascadeCount));
         }
     }
+    if (!hasShadowing()) {
+        // the shaders skip the directional shadow when there are no cascades, which can happen
+        // with HAS_SHADOWING set for the shadow atlas.
+        u.setUniform(offsetof(PerViewUib, cascades), uint32_t(0));
+    }
+}
+
+void FView::prepareShadowAtlas(FEngine& engine, driver::DriverApi& driver,
+        FScene::RenderableSoa& renderableData, FScene::LightSoa const& lightData,
+        filament::Viewport const& viewport) noexcept {
+    SYSTRACE_CALL();
+
+    ShadowAtlas& atlas = mShadowAtlas;
+    atlas.update(engine.getLightManager(), lightData, mViewingCameraInfo, viewport);
+    mHasShadowAtlas = atlas.hasShadows();
+    if (!mHasShadowAtlas) {
+        return;
+    }
+
+    const size_t tileCount = atlas.getTileCount();
+    Frustum frusta[CONFIG_MAX_SHADOW_TILES];
+    for (size_t t = 0; t < tileCount; t++) {
+        frusta[t] = atlas.getTile(t).frustum;
+    }
+
+    float3 const* worldAABBCenter = renderableData.data<FScene::WORLD_AABB_CENTER>();
+    float3 const* worldAABBExtent = renderableData.data<FScene::WORLD_AABB_EXTENT>();
+    uint8_t     * visibleArray    = renderableData.data<FScene::VISIBLE_MASK>();
+
+    // culling job (this runs on multiple threads)
+    auto functor = [&frusta, tileCount, worldAABBCenter, worldAABBExtent, visibleArray]
+            (uint32_t index, uint32_t c) {
+        cullShadowAtlasCasters(
+                visibleArray + index,
+                frusta, tileCount,
+                worldAABBCenter + index,
+                worldAABBExtent + index, c);
+    };
+
+    JobSystem& js = engine.getJobSystem();
+    auto job = jobs::parallel_for(js, nullptr, 0, (uint32_t)Culler::round(renderableData.size()),
+            std::ref(functor), jobs::CountSplitter<Culler::MODULO * Culler::MIN_LOOP_COUNT_HINT, 8>());
+    js.runAndWait(job);
+
+    // allocates the atlas driver resources
+    atlas.prepare(driver, getUs());
+
+    UniformBuffer& u = getUb();
+    for (size_t t = 0; t < tileCount; t++) {
+        ShadowAtlas::Tile const& tile = atlas.getTile(t);
+        u.setUniform(offsetof(PerViewUib, shadowAtlasFromWorldMatrix) + t * sizeof(mat4f),
+                tile.lightSpace);
+        u.setUniform(offsetof(PerViewUib, shadowAtlasBias) + t * sizeof(float4), tile.bias);
+    }
+}
+
+void FView::prepareShadowAtlasTile(size_t tile, uint8_t* visibleMask) const noexcept {
+    FScene::RenderableSoa const& renderableData = mScene->getRenderableData();
+    const Range range = mVisibleShadowCasters;
+    std::copy_n(renderableData.data<FScene::VISIBLE_MASK>() + range.first, range.size(),
+            visibleMask + range.first);
+    cullShadowAtlasTile(visibleMask,
+            renderableData.data<FScene::VISIBILITY_STATE>(),
+            mShadowAtlas.getTile(tile).frustum,
+            renderableData.data<FScene::WORLD_AABB_CENTER>(),
+            renderableData.data<FScene::WORLD_AABB_EXTENT>(),
+            mVisibleShadowCasters);
 }
 
 void FView::prepareLighting(FEngine& engine, FEngine::DriverApi& driver, ArenaScope& arena,
@@ -323,13 +413,14 @@ void FView::prepareLighting(FEngine& engine, FEngine::DriverApi& driver, ArenaSc
     const CameraInfo& camera = mViewingCameraInfo;
     FScene* const scene = mScene;
 
-    scene->prepareDynamicLights(camera, arena, mLightUbh);
+    scene->prepareDynamicLights(camera, arena, mLightUbh, mShadowAtlas);
 
     // here the array of visible lights has been shrunk to CONFIG_MAX_LIGHT_COUNT
     auto const& lightData = scene->getLightData();
 
     // trace the number of visible lights
     SYSTRACE_VALUE32("visibleLights", lightData.size() - FScene::DIRECTIONAL_LIGHTS_COUNT);
+    mStats.visibleLights = uint32_t(lightData.size() - FScene::DIRECTIONAL_LIGHTS_COUNT);
 
     // Exposure
     const float ev100 = camera.ev100;
@@ -385,6 +476,13 @@ void FView::prepareLighting(FEngine& engine, FEngine::DriverApi& driver, ArenaSc
         // Disable the sun if there's no directional light
         float4 sun{ 0.0f, 0.0f, 0.0f, -1.0f };
         u.setUniform(offsetof(PerViewUib, sun), sun);
+        if (mHasShadowAtlas) {
+            // the shadow receiver variants need the directional lighting variant, so we use
+            // a black directional light.
+            mHasDirectionalLight = true;
+            u.setUniform(offsetof(PerViewUib, lightDirection), float3{ 0, 0, 1 });
+            u.setUniform(offsetof(PerViewUib, lightColorIntensity), float4{ 0 });
+        }
     }
 
     // Dynamic lighting
@@ -408,19 +506,8 @@ void FView::prepare(FEngine& engine, driver::DriverApi& driver, ArenaScope& aren
 
     FScene* const scene = getScene();
 
-    /*
-     * We apply a "world origin" to "everything" in order to implement the IBL rotation.
-     * The "world origin" could also be useful for other things, like keeping the origin
-     * close to the camera position to improve fp precision in the shader for large scenes.
-     */
-    mat4f worldOriginScene;
-    FIndirectLight const* const ibl = scene->getIndirectLight();
-    if (ibl) {
-        // the IBL transformation must be a rigid transform
-        mat3f rotation{ scene->getIndirectLight()->getRotation() };
-        // for a rigid-body transform, the inverse is the transpose
-        worldOriginScene = mat4f{ transpose(rotation) };
-    }
+    // the world origin implements the IBL rotation
+    const mat4f worldOriginScene = scene->getWorldOriginTransform();
 
     /*
      * Calculate all camera parameters needed to render this View for this frame.
@@ -452,15 +539,21 @@ void FView::prepare(FEngine& engine, driver::DriverApi& driver, ArenaScope& aren
             // world origin transform, use only for debugging
             .worldOrigin        = worldOriginCamera
     };
-    mCullingFrustum = FCamera::getFrustum(
-            mCullingCamera->getCullingProjectionMatrix(),
-            FCamera::getViewMatrix(worldOriginScene * mCullingCamera->getModelMatrix()));
+    mCullingFrustum = computeCullingFrustum(worldOriginScene);
 
     /*
      * Gather all information needed to render this scene. Apply the world origin to all
      * objects in the scene.
+     * When the scene is shared with other views this frame, this was done by the Renderer
+     * already, we just need to restore the lights, which are culled per view.
      */
-    scene->prepare(worldOriginScene);
+    const bool sharedCulling = mSharedCullingIndex >= 0;
+    mRenderableDataDetached = false;
+    if (UTILS_LIKELY(!sharedCulling)) {
+        scene->prepare(worldOriginScene);
+    } else {
+        scene->restoreLightData();
+    }
 
     /*
      * Light culling: runs in parallel with Renderable culling (below)
@@ -478,14 +571,19 @@ void FView::prepare(FEngine& engine, driver::DriverApi& driver, ArenaScope& aren
     { // all the operations in this scope must happen sequentially
 
         Slice<Culler::result_type> cullingMask = renderableData.slice<FScene::VISIBLE_MASK>();
-        std::uninitialized_fill(cullingMask.begin(), cullingMask.end(), 0);
 
         /*
          * Culling: as soon as possible we perform our camera-culling
          * (this will set the VISIBLE_RENDERABLE bit)
          */
 
-        prepareVisibleRenderables(js, mCullingFrustum, renderableData);
+        if (UTILS_LIKELY(!sharedCulling)) {
+            CpuProfiler::Scope profile(engine.getCpuProfiler(), CpuProfiler::Stage::CULLING);
+            std::uninitialized_fill(cullingMask.begin(), cullingMask.end(), 0);
+            prepareVisibleRenderables(js, mCullingFrustum, renderableData);
+        } else {
+            prepareSharedVisibleRenderables(renderableData);
+        }
 
 
         /*
@@ -493,7 +591,20 @@ void FView::prepare(FEngine& engine, driver::DriverApi& driver, ArenaScope& aren
          * (this will set the VISIBLE_SHADOW_CASTER bit)
          */
 
-        prepareShadowing(engine, driver, renderableData, scene->getLightData());
+        prepareShadowing(engine, driver, arena, renderableData, scene->getLightData());
+
+        /*
+         * Shadow atlas: allocate the shadow maps of the spot and point lights and cull their
+         * shadow casters (this also sets the VISIBLE_SHADOW_CASTER bit).
+         * Relies on prepareVisibleLights()
+         */
+
+        mHasShadowAtlas = false;
+        if (mShadowingEnabled) {
+            js.waitAndRelease(prepareVisibleLightsJob);
+            prepareVisibleLightsJob = nullptr;
+            prepareShadowAtlas(engine, driver, renderableData, scene->getLightData(), viewport);
+        }
 
         /*
          * partition the array of renderable w.r.t their visibility:
@@ -522,6 +633,26 @@ void FView::prepare(FEngine& engine, driver::DriverApi& driver, ArenaScope& aren
         mVisibleShadowCasters = Range{ uint32_t(beginCasters - beginRenderables), iEnd };
         merged = Range{ 0, iEnd };
 
+        size_t shadowCasters = 0;
+        for (size_t i = 0, c = renderableData.size(); i < c; i++) {
+            shadowCasters += visibility[i].castShadows ? 1 : 0;
+        }
+        mStats.renderables = uint32_t(renderableData.size());
+        mStats.visibleRenderables = mVisibleRenderables.size();
+        mStats.shadowCasters = uint32_t(shadowCasters);
+        mStats.visibleShadowCasters = mVisibleShadowCasters.size();
+
+        // request the texture levels needed by the visible renderables
+        if (UTILS_UNLIKELY(!engine.getTextureStreamer().empty())) {
+            prepareTextureStreaming(engine, renderableData, viewport);
+        }
+
+        // skip the shadow pass if neither the light frustums nor the casters changed
+        if (hasShadowing()) {
+            mNeedsShadowMapRendering = mDirectionalShadowMap.updateCache(hashShadowCasters(
+                    engine.getRenderableManager(), renderableData, mVisibleShadowCasters));
+        }
+
         // update those UBOs
         const size_t size = merged.size() * sizeof(PerRenderableUib);
         if (mRenderableUBOSize < size) {
@@ -529,12 +660,13 @@ void FView::prepare(FEngine& engine, driver::DriverApi& driver, ArenaScope& aren
             const size_t count = std::max(size_t(16u), (4u * merged.size() + 2u) / 3u);
             mRenderableUBOSize = uint32_t(count * sizeof(PerRenderableUib));
             driver.destroyUniformBuffer(mRenderableUbh);
-            mRenderableUbh = driver.createUniformBuffer(mRenderableUBOSize,
+            mRenderableUbh = driver.createUniformBuffer(
+                    mRenderableUBOSize + FScene::getRenderableUBOSlack(),
                     driver::BufferUsage::STREAM);
         } else {
             // TODO: should we shrink the underlying UBO at some point?
         }
-        scene->updateUBOs(merged, mRenderableUbh);
+        scene->updateUBOs(merged, mRenderableUbh, mRenderableUniforms);
     }
 
     /*
@@ -543,7 +675,9 @@ void FView::prepare(FEngine& engine, driver::DriverApi& driver, ArenaScope& aren
      * Relies on FScene::prepare() and prepareVisibleLights()
      */
 
-    js.waitAndRelease(prepareVisibleLightsJob);
+    if (prepareVisibleLightsJob) {
+        js.waitAndRelease(prepareVisibleLightsJob);
+    }
     prepareLighting(engine, driver, arena, viewport);
 
     /*
@@ -554,9 +688,8 @@ void FView::prepare(FEngine& engine, driver::DriverApi& driver, ArenaScope& aren
     getUb().setUniform(offsetof(PerViewUib, time), fraction);
     getUb().setUniform(offsetof(PerViewUib, userTime), userTime);
 
-    // upload the renderables's dirty UBOs
-    engine.getRenderableManager().prepare(driver,
-            renderableData.data<FScene::RENDERABLE_INSTANCE>(), merged);
+    // upload the renderables's bones if they changed
+    mStats.uniformBytes += engine.getRenderableManager().prepare(driver);
 
     // set uniforms and samplers
     bindPerViewUniformsAndSamplers(driver);
@@ -577,8 +710,11 @@ void FView::computeVisibilityMasks(
         bool inVisibleLayer = layers[i] & visibleLayers;
         bool visRenderables   = (!v.culling || (mask & VISIBLE_RENDERABLE))    && inVisibleLayer;
         bool visShadowCasters = (!v.culling || (mask & VISIBLE_SHADOW_CASTER)) && inVisibleLayer && v.castShadows;
+        // objects that are not culled are in all the cascades
+        Culler::result_type cascades = v.culling ? (mask & VISIBLE_CASCADES) : VISIBLE_CASCADES;
         visibleMask[i] = Culler::result_type(visRenderables) |
-                         Culler::result_type(visShadowCasters << 1);
+                         Culler::result_type(visShadowCasters << 1) |
+                         Culler::result_type(visShadowCasters ? cascades : 0);
     }
 }
 
@@ -588,10 +724,17 @@ UTILS_NOINLINE
         FScene::RenderableSoa::iterator end,
         uint8_t mask) noexcept {
     return std::partition(begin, end, [mask](auto it) {
-        return it.template get<FScene::VISIBLE_MASK>() == mask;
+        // the cascade bits are ignored here
+        return (it.template get<FScene::VISIBLE_MASK>() & VISIBLE_ALL) == mask;
     });
 }
 
+Frustum FView::computeCullingFrustum(mat4f const& worldOriginScene) const noexcept {
+    return FCamera::getFrustum(
+            mCullingCamera->getCullingProjectionMatrix(),
+            FCamera::getViewMatrix(worldOriginScene * mCullingCamera->getModelMatrix()));
+}
+
 void FView::prepareCamera(const CameraInfo& camera, const filament::Viewport& viewport) const noexcept {
     SYSTRACE_CALL();
 
@@ -624,6 +767,7 @@ void FView::froxelize(FEngine& engine) const noexcept {
     SYSTRACE_CALL();
 
     if (mHasDynamicLighting) {
+        CpuProfiler::Scope profile(engine.getCpuProfiler(), CpuProfiler::Stage::FROXELIZATION);
         // froxelize lights
         mFroxelizer.froxelizeLights(engine, mViewingCameraInfo, mScene->getLightData());
     }
@@ -633,6 +777,7 @@ void FView::commitUniforms(driver::DriverApi& driver) const noexcept {
     if (mPerViewUb.isDirty()) {
         driver.updateUniformBuffer(mPerViewUbh, mPerViewUb.toBufferDescriptor(driver));
         mPerViewUb.clean();
+        mStats.uniformBytes += mPerViewUb.getSize();
     }
 
     if (mPerViewSb.isDirty()) {
@@ -647,6 +792,73 @@ void FView::commitFroxels(driver::DriverApi& driverApi) const noexcept {
     }
 }
 
+void FView::detachRenderableData() noexcept {
+    SYSTRACE_CALL();
+
+    // only the columns read by the command generation are needed, for the visible renderables
+    // (which are at the beginning of the scene's data), plus one summed primitive count
+    FScene::RenderableSoa const& src = mScene->getRenderableData();
+    FScene::RenderableSoa& dst = mRenderableData;
+    const size_t count = mVisibleRenderables.last;
+    dst.resize(count + 1);
+    std::copy_n(src.data<FScene::WORLD_AABB_CENTER>(), count, dst.data<FScene::WORLD_AABB_CENTER>());
+    std::copy_n(src.data<FScene::VISIBLE_MASK>(),      count, dst.data<FScene::VISIBLE_MASK>());
+    std::copy_n(src.data<FScene::VISIBILITY_STATE>(),  count, dst.data<FScene::VISIBILITY_STATE>());
+    std::copy_n(src.data<FScene::BONES_OFFSET>(),      count, dst.data<FScene::BONES_OFFSET>());
+    std::copy_n(src.data<FScene::PRIMITIVES>(),        count, dst.data<FScene::PRIMITIVES>());
+    mRenderableDataDetached = true;
+}
+
+void FView::copyRenderableUniforms(void* buffer, size_t offset, uint32_t i) const noexcept {
+    assert((i + 1) * sizeof(PerRenderableUib) <= mRenderableUniforms.size());
+    memcpy(static_cast<uint8_t*>(buffer) + offset,
+            mRenderableUniforms.data() + i * sizeof(PerRenderableUib), sizeof(PerRenderableUib));
+}
+
+void FView::beginStats(FEngine& engine) noexcept {
+    if (mStatsStarted) {
+        return;
+    }
+    mStatsStarted = true;
+    mStats = {};
+    resumeStats(engine);
+}
+
+static_assert(View::Stats::CPU_STAGE_COUNT == Renderer::CPU_STAGE_COUNT,
+        "View::Stats::cpuTime must have an entry per Renderer::CpuStage");
+
+void FView::resumeStats(FEngine& engine) noexcept {
+    CpuProfiler const& profiler = engine.getCpuProfiler();
+    for (size_t i = 0; i < Renderer::CPU_STAGE_COUNT; i++) {
+        mStatsStart.cpuTime[i] = profiler.getStageTime(Renderer::CpuStage(i));
+    }
+    mStatsStart.commandBytes = engine.getCommandBytesWritten();
+    mStatsStart.uniformBytes = mScene ? mScene->getUniformBytes() : 0;
+}
+
+void FView::pauseStats(FEngine& engine) noexcept {
+    CpuProfiler const& profiler = engine.getCpuProfiler();
+    for (size_t i = 0; i < Renderer::CPU_STAGE_COUNT; i++) {
+        mStats.cpuTime[i] += profiler.getStageTime(Renderer::CpuStage(i)) - mStatsStart.cpuTime[i];
+    }
+    mStats.commandBytes += engine.getCommandBytesWritten() - mStatsStart.commandBytes;
+    if (mScene) {
+        mStats.uniformBytes += mScene->getUniformBytes() - mStatsStart.uniformBytes;
+    }
+}
+
+void FView::endStats(FEngine& engine) noexcept {
+    if (!mStatsStarted) {
+        return;
+    }
+    mStatsStarted = false;
+
+    pauseStats(engine);
+    // the froxelization job has been waited for by the color pass
+    mStats.froxelRecords = mHasDynamicLighting ? uint32_t(mFroxelizer.getRecordCount()) : 0;
+    mLastStats = mStats;
+}
+
 UTILS_NOINLINE
 void FView::prepareVisibleRenderables(JobSystem& js,
         Frustum const& frustum, FScene::RenderableSoa& renderableData) const noexcept {
@@ -660,10 +872,185 @@ void FView::prepareVisibleRenderables(JobSystem& js,
 }
 
 UTILS_NOINLINE
-void FView::prepareVisibleShadowCasters(JobSystem& js,
-        Frustum const& lightFrustum, FScene::RenderableSoa& renderableData) noexcept {
+void FView::prepareSharedVisibleRenderables(FScene::RenderableSoa& renderableData) const noexcept {
+    SYSTRACE_CALL();
+    uint8_t* const UTILS_RESTRICT visibleArray = renderableData.data<FScene::VISIBLE_MASK>();
+    if (UTILS_LIKELY(isFrustumCullingEnabled())) {
+        // the culling was done for all views at once, extract our own bit
+        uint8_t const* const UTILS_RESTRICT viewsArray = renderableData.data<FScene::VISIBLE_VIEWS>();
+        const size_t index = size_t(mSharedCullingIndex);
+        for (size_t i = 0, c = renderableData.size(); i < c; i++) {
+            visibleArray[i] = uint8_t(((viewsArray[i] >> index) & 1u) << VISIBLE_RENDERABLE_BIT);
+        }
+    } else {
+        std::uninitialized_fill(visibleArray, visibleArray + renderableData.size(),
+                VISIBLE_RENDERABLE);
+    }
+}
+
+UTILS_NOINLINE
+void FView::prepareVisibleShadowCasters(JobSystem& js, ArenaScope& arena,
+        ShadowMap& shadowMap, FScene::RenderableSoa& renderableData) noexcept {
     SYSTRACE_CALL();
-    FView::cullRenderables(js, renderableData, lightFrustum, VISIBLE_SHADOW_CASTER_BIT);
+
+    const size_t cascadeCount = shadowMap.getCascadeCount();
+    const size_t count = Culler::round(renderableData.size());
+
+    // Each cascade computes its light frustum and culls all the shadow casters in its own job,
+    // into its own mask so that the jobs don't write into the same bytes.
+    uint8_t* cascadeMasks[CONFIG_MAX_SHADOW_CASCADES];
+    JobSystem::Job* parent = js.createJob();
+    for (size_t c = 0; c < cascadeCount; c++) {
+        uint8_t* const mask = arena.allocate<uint8_t>(count, CACHELINE_SIZE);
+        cascadeMasks[c] = mask;
+        js.run(js.createJob(parent,
+                [&shadowMap, &renderableData, mask, c](JobSystem&, JobSystem::Job*) {
+                    shadowMap.updateCascade(c);
+                    const size_t count = Culler::round(renderableData.size());
+                    std::uninitialized_fill_n(mask, count, 0);
+                    if (shadowMap.isCascadeVisible(c)) {
+                        Culler::intersects(mask, shadowMap.getCamera(c).getFrustum(),
+                                renderableData.data<FScene::WORLD_AABB_CENTER>(),
+                                renderableData.data<FScene::WORLD_AABB_EXTENT>(),
+                                count, VISIBLE_CASCADE_BIT + c);
+                    }
+                }));
+    }
+    js.runAndWait(parent);
+
+    shadowMap.resolveVisibility();
+    if (shadowMap.hasVisibleShadows()) {
+        mergeCascadeVisibility(renderableData.data<FScene::VISIBLE_MASK>(),
+                cascadeMasks, cascadeCount, renderableData.size());
+    }
+}
+
+void FView::mergeCascadeVisibility(uint8_t* UTILS_RESTRICT visibleMask,
+        uint8_t const* const* cascadeMasks, size_t cascadeCount, size_t count) noexcept {
+    for (size_t c = 0; c < cascadeCount; c++) {
+        uint8_t const* const UTILS_RESTRICT cascadeMask = cascadeMasks[c];
+        for (size_t i = 0; i < count; i++) {
+            const uint8_t m = cascadeMask[i];
+            visibleMask[i] |= m | (m ? VISIBLE_SHADOW_CASTER : uint8_t(0));
+        }
+    }
+}
+
+void FView::prepareTextureStreaming(FEngine& engine, FScene::RenderableSoa const& renderableData,
+        filament::Viewport const& viewport) const noexcept {
+    SYSTRACE_CALL();
+
+    FRenderableManager const& rcm = engine.getRenderableManager();
+    FTextureStreamer& streamer = engine.getTextureStreamer();
+    auto const* instances = renderableData.data<FScene::RENDERABLE_INSTANCE>();
+    auto const* centers   = renderableData.data<FScene::WORLD_AABB_CENTER>();
+    auto const* extents   = renderableData.data<FScene::WORLD_AABB_EXTENT>();
+
+    // a sphere of radius r at a distance d is r * projectionScale / d pixels across
+    CameraInfo const& camera = mViewingCameraInfo;
+    const float projectionScale = camera.projection[1][1] * float(viewport.height);
+    const float3 position = camera.getPosition();
+
+    for (uint32_t i : mVisibleRenderables) {
+        const float radius = length(extents[i]);
+        const float distance = std::max(length(centers[i] - position) - radius, camera.zn);
+        const float pixels = radius * projectionScale / distance;
+        for (FRenderPrimitive const& primitive : rcm.getRenderPrimitives(instances[i], 0)) {
+            FMaterialInstance const* const mi = primitive.getMaterialInstance();
+            if (!mi) {
+                continue;
+            }
+            SamplerBuffer const& samplers = mi->getSamplerBuffer();
+            SamplerBuffer::Sampler const* const buffer = samplers.getBuffer();
+            for (size_t j = 0, c = samplers.getSize(); j < c; j++) {
+                streamer.request(buffer[j].t, pixels);
+            }
+        }
+    }
+}
+
+uint32_t FView::hashShadowCasters(FRenderableManager const& rcm,
+        FScene::RenderableSoa const& renderableData, Range range) noexcept {
+    auto const* instances  = renderableData.data<FScene::RENDERABLE_INSTANCE>();
+    auto const* transforms = renderableData.data<FScene::WORLD_TRANSFORM>();
+    auto const* visibility = renderableData.data<FScene::VISIBILITY_STATE>();
+    auto const* bones      = renderableData.data<FScene::BONES_OFFSET>();
+    auto const* masks      = renderableData.data<FScene::VISIBLE_MASK>();
+
+    struct CasterKey {
+        mat4f transform;
+        uint32_t instance;
+        uint32_t bones;
+        uint32_t state;
+    };
+
+    // the per-caster hashes are summed, so the partitioning order doesn't matter
+    uint32_t hash = 0;
+    for (uint32_t i : range) {
+        if (UTILS_UNLIKELY(visibility[i].skinning)) {
+            // the bones can change without any change to the renderable
+            return 0;
+        }
+        uint8_t v;
+        static_assert(sizeof(v) == sizeof(visibility[i]), "Visibility must fit in a byte");
+        memcpy(&v, &visibility[i], sizeof(v));
+
+        const CasterKey key{ transforms[i], instances[i].asValue(), bones[i],
+                uint32_t(v) | (uint32_t(masks[i] & VISIBLE_CASCADES) << 8u) };
+        uint32_t h = utils::hash::MurmurHashFn<CasterKey>()(key);
+        for (FRenderPrimitive const& primitive : rcm.getRenderPrimitives(instances[i], 0)) {
+            const uint64_t mi = uintptr_t(primitive.getMaterialInstance());
+            const uint32_t words[] = {
+                    primitive.getHwHandle().getId(), uint32_t(mi), uint32_t(mi >> 32u) };
+            h = utils::hash::murmur3(words, 3, h);
+        }
+        hash += h;
+    }
+    // 0 is reserved for "can't be tracked"
+    return hash ? hash : 1;
+}
+
+void FView::cullShadowAtlasCasters(uint8_t* UTILS_RESTRICT visibleMask,
+        Frustum const* frusta, size_t tileCount,
+        float3 const* center, float3 const* extent, size_t count) noexcept {
+    // the tiles are culled 8 at a time, into a small buffer that stays in the L1 cache
+    constexpr size_t CHUNK_SIZE = 64;
+    uint8_t masks[CHUNK_SIZE];
+    for (size_t i = 0; i < count; i += CHUNK_SIZE) {
+        const size_t n = std::min(CHUNK_SIZE, count - i);
+        uint8_t visible[CHUNK_SIZE] = {};
+        for (size_t t = 0; t < tileCount; t += Culler::MAX_FRUSTUM_COUNT) {
+            const size_t frustumCount = std::min(Culler::MAX_FRUSTUM_COUNT, tileCount - t);
+            Culler::intersects(masks, frusta + t, frustumCount, center + i, extent + i, n);
+            for (size_t j = 0; j < n; j++) {
+                visible[j] |= masks[j];
+            }
+        }
+        for (size_t j = 0; j < n; j++) {
+            visibleMask[i + j] |= visible[j] ? VISIBLE_SHADOW_CASTER : uint8_t(0);
+        }
+    }
+}
+
+void FView::cullShadowAtlasTile(uint8_t* UTILS_RESTRICT visibleMask,
+        FRenderableManager::Visibility const* UTILS_RESTRICT visibility, Frustum const& frustum,
+        float3 const* center, float3 const* extent, Range range) noexcept {
+    // the Culler works on multiples of 8 objects, so we start on a multiple of 8 and cull into
+    // a separate buffer, to leave the objects before the range untouched.
+    constexpr size_t CHUNK_SIZE = 64;
+    uint8_t masks[CHUNK_SIZE];
+    for (size_t i = range.first & ~(Culler::MODULO - 1); i < range.last; i += CHUNK_SIZE) {
+        const size_t n = Culler::round(std::min(CHUNK_SIZE, range.last - i));
+        std::uninitialized_fill_n(masks, n, 0);
+        Culler::intersects(masks, frustum, center + i, extent + i, n, VISIBLE_CASCADE_BIT);
+        for (size_t j = std::max(i, size_t(range.first)), e = std::min(i + n, size_t(range.last));
+                j < e; j++) {
+            // objects that are not culled are in all the tiles
+            const uint8_t cascade = visibility[j].culling ? masks[j - i] :
+                    uint8_t(1u << VISIBLE_CASCADE_BIT);
+            visibleMask[j] = uint8_t((visibleMask[j] & ~VISIBLE_CASCADES) | cascade);
+        }
+    }
 }
 
 void FView::cullRenderables(JobSystem& js,
@@ -689,6 +1076,31 @@ void FView::cullRenderables(JobSystem& js,
     js.runAndWait(job);
 }
 
+void FView::cullRenderablesForViews(JobSystem& js,
+        FScene::RenderableSoa& renderableData,
+        Frustum const* frusta, size_t frustumCount) noexcept {
+    SYSTRACE_CALL();
+
+    float3 const* worldAABBCenter = renderableData.data<FScene::WORLD_AABB_CENTER>();
+    float3 const* worldAABBExtent = renderableData.data<FScene::WORLD_AABB_EXTENT>();
+    uint8_t     * visibleArray    = renderableData.data<FScene::VISIBLE_VIEWS>();
+
+    // culling job (this runs on multiple threads)
+    auto functor = [frusta, frustumCount, worldAABBCenter, worldAABBExtent, visibleArray]
+            (uint32_t index, uint32_t c) {
+        Culler::intersects(
+                visibleArray + index,
+                frusta, frustumCount,
+                worldAABBCenter + index,
+                worldAABBExtent + index, c);
+    };
+
+    // launch the computation on multiple threads
+    auto job = jobs::parallel_for(js, nullptr, 0, (uint32_t)renderableData.size(),
+            std::ref(functor), jobs::CountSplitter<Culler::MODULO * Culler::MIN_LOOP_COUNT_HINT, 8>());
+    js.runAndWait(job);
+}
+
 void FView::prepareVisibleLights(FLightManager const& lcm, utils::JobSystem&,
         Frustum const& frustum, FScene::LightSoa& lightData) noexcept {
     SYSTRACE_CALL();
@@ -887,6 +1299,10 @@ bool View::isFrontFaceWindingInverted() const noexcept {
     return upcast(this)->isFrontFaceWindingInverted();
 }
 
+View::Stats const& View::getStats() const noexcept {
+    return upcast(this)->getStats();
+}
+
 void View::setDepthPrepass(View::DepthPrepass prepass) noexcept {
     upcast(this)->setDepthPrepass(prepass);
 }
@@ -174,6 +174,20 @@ void FLightManager::create(const FLightManager::Builder& builder, utils::Entity
         shadowParams.shadowNearHint = std::max(builder->mShadowOptions.shadowNearHint, 0.0f);
         shadowParams.shadowFarHint = std::max(builder->mShadowOptions.shadowFarHint, 0.0f);
 
+        // cascades only make sense for directional lights, and the split positions must be
+        // strictly increasing in ]0, 1[.
+        const bool directional = lightType.type == Type::SUN || lightType.type == Type::DIRECTIONAL;
+        const uint8_t cascades = uint8_t(clamp(size_t(builder->mShadowOptions.shadowCascades),
+                size_t(1), directional ? CONFIG_MAX_SHADOW_CASCADES : size_t(1)));
+        shadowParams.cascades = cascades;
+        float previous = 0.0f;
+        for (size_t c = 0; c < CONFIG_MAX_SHADOW_CASCADES - 1; c++) {
+            float p = c + 1u < cascades ? builder->mShadowOptions.cascadeSplitPositions[c] : 1.0f;
+            p = clamp(p, previous, 1.0f);
+            shadowParams.cascadeSplitPositions[c] = p;
+            previous = p;
+        }
+
         // set default values by calling the setters
         setLocalPosition(i, builder->mPosition);
         setLocalDirection(i, builder->mDirection);
@@ -352,6 +366,11 @@ LightManager::getInstance(Entity e) const noexcept {
     return upcast(this)->getInstance(e);
 }
 
+void LightManager::getInstances(Entity const* entities, Instance* instances,
+        size_t count) const noexcept {
+    upcast(this)->getInstances(entities, instances, count);
+}
+
 void LightManager::destroy(Entity e) noexcept {
     return upcast(this)->destroy(e);
 }
@@ -429,4 +448,39 @@ LightManager::Type LightManager::getType(LightManager::Instance i) const noexcep
     return upcast(this)->getType(i);
 }
 
+// ------------------------------------------------------------------------------------------------
+
+void LightManager::ShadowCascades::computeUniformSplits(float* splitPositions, uint8_t cascades) {
+    size_t s = 0;
+    cascades = std::max(cascades, uint8_t(1));
+    for (size_t c = 1; c < cascades; c++) {
+        splitPositions[s++] = float(c) / cascades;
+    }
+}
+
+void LightManager::ShadowCascades::computeLogSplits(float* splitPositions, uint8_t cascades,
+        float near, float far) {
+    size_t s = 0;
+    cascades = std::max(cascades, uint8_t(1));
+    // the logarithmic splits are undefined with a 0 near distance
+    const float n = std::max(near, 1e-4f);
+    for (size_t c = 1; c < cascades; c++) {
+        // split distance is near * (far / near)^(c / cascades), expressed as a position
+        float d = n * std::pow(far / n, float(c) / cascades);
+        splitPositions[s++] = (d - near) / (far - near);
+    }
+}
+
+void LightManager::ShadowCascades::computePracticalSplits(float* splitPositions, uint8_t cascades,
+        float near, float far, float lambda) {
+    float uniformSplits[CONFIG_MAX_SHADOW_CASCADES];
+    float logSplits[CONFIG_MAX_SHADOW_CASCADES];
+    cascades = uint8_t(clamp(size_t(cascades), size_t(1), CONFIG_MAX_SHADOW_CASCADES));
+    computeUniformSplits(uniformSplits, cascades);
+    computeLogSplits(logSplits, cascades, near, far);
+    for (size_t s = 0; s + 1u < cascades; s++) {
+        splitPositions[s] = lambda * logSplits[s] + (1.0f - lambda) * uniformSplits[s];
+    }
+}
+
 } // namespace filament
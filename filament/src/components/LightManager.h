@@ -21,6 +21,7 @@
 
 #include "driver/DriverApiForward.h"
 
+#include <filament/EngineEnums.h>
 #include <filament/LightManager.h>
 
 #include <utils/Entity.h>
@@ -53,6 +54,10 @@ public:
         return mManager.getInstance(e);
     }
 
+    void getInstances(utils::Entity const* entities, Instance* instances, size_t count) const noexcept {
+        mManager.getInstances(entities, instances, count);
+    }
+
     void create(const FLightManager::Builder& builder, utils::Entity entity);
 
     void destroy(utils::Entity e) noexcept;
@@ -84,6 +89,8 @@ public:
         float shadowFar;
         float shadowNearHint;
         float shadowFarHint;
+        float cascadeSplitPositions[CONFIG_MAX_SHADOW_CASCADES - 1];
+        uint8_t cascades;
     };
 
     UTILS_NOINLINE void setLocalPosition(Instance i, const filament::math::float3& position) noexcept;
@@ -154,6 +161,10 @@ public:
         return getShadowParams(i).shadowFar;
     }
 
+    constexpr uint8_t getShadowCascades(Instance i) const noexcept {
+        return getShadowParams(i).cascades;
+    }
+
     constexpr const filament::math::float3& getColor(Instance i) const noexcept {
         return mManager[i].color;
     }
@@ -202,6 +213,9 @@ public:
         return mManager[i].direction;
     }
 
+    size_t getMemoryUsed() const noexcept { return mManager.getMemoryUsed(); }
+    size_t getMemoryReserved() const noexcept { return mManager.getMemoryReserved(); }
+
 private:
     friend class FScene;
 
@@ -224,7 +238,7 @@ private:
             filament::math::float3,   // 12
             filament::math::float3,   // 12
             filament::math::float3,   // 12
-            ShadowParams,   // 12
+            ShadowParams,   // 36
             SpotParams,     // 24
             float,          //  4
             float,          //  4
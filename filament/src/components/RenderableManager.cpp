@@ -26,8 +26,15 @@
 
 #include <filament/driver/DriverEnums.h>
 
+#include <utils/JobSystem.h>
 #include <utils/Log.h>
 #include <utils/Panic.h>
+#include <utils/Systrace.h>
+
+#include <algorithm>
+
+#include <stdlib.h>
+#include <string.h>
 
 using namespace filament::math;
 using namespace utils;
@@ -97,6 +104,18 @@ RenderableManager::Builder& RenderableManager::Builder::geometry(size_t index,
     return *this;
 }
 
+RenderableManager::Builder& RenderableManager::Builder::geometry(size_t index,
+        PrimitiveType type, GeometryArena* arena,
+        GeometryArena::Allocation const& allocation) noexcept {
+    // like a primitive without vertices or indices, an empty allocation is ignored
+    if (!arena || !allocation.vertexCount || !allocation.indexCount) {
+        return *this;
+    }
+    return geometry(index, type, arena->getVertexBuffer(), arena->getIndexBuffer(),
+            allocation.firstIndex, allocation.firstVertex,
+            allocation.firstVertex + allocation.vertexCount - 1, allocation.indexCount);
+}
+
 RenderableManager::Builder& RenderableManager::Builder::material(size_t index,
         MaterialInstance const* materialInstance) noexcept {
     if (index < mImpl->mEntriesCount) {
@@ -267,7 +286,7 @@ void FRenderableManager::create(
         Builder::Entry const * const entries = builder->mEntries;
         FRenderPrimitive* rp = new FRenderPrimitive[builder->mEntriesCount];
         for (size_t i = 0, c = builder->mEntriesCount; i < c; ++i) {
-            rp[i].init(driver, entries[i]);
+            rp[i].init(engine, entries[i]);
         }
         setPrimitives(ci, { rp, size_type(builder->mEntriesCount) });
 
@@ -278,40 +297,23 @@ void FRenderableManager::create(
         setReceiveShadows(ci, builder->mReceiveShadows);
         setCulling(ci, builder->mCulling);
         setSkinning(ci, false);
+        manager[ci].bones = Bones{};
 
         const size_t count = builder->mSkinningBoneCount;
         if (UTILS_UNLIKELY(count)) {
-            std::unique_ptr<Bones>& bones = manager[ci].bones;
-            // Note that we are sizing the bones UBO according to CONFIG_MAX_BONE_COUNT rather than
-            // mSkinningBoneCount. According to the OpenGL ES 3.2 specification in 7.6.3 Uniform
-            // Buffer Object Bindings:
-            //
-            //     the uniform block must be populated with a buffer object with a size no smaller
-            //     than the minimum required size of the uniform block (the value of
-            //     UNIFORM_BLOCK_DATA_SIZE).
-            //
-            // This unfortunately means that we are using a large memory footprint for skinned
-            // renderables. In the future we could try addressing this by implementing a paging
-            // system such that multiple skinned renderables will share regions within a single
-            // large block of bones.
-            bones = std::unique_ptr<Bones>(new Bones{
-                    driver.createUniformBuffer(CONFIG_MAX_BONE_COUNT * sizeof(PerRenderableUibBone),
-                            driver::BufferUsage::DYNAMIC),
-                    UniformBuffer{ count * sizeof(PerRenderableUibBone) },
-                    count
-            });
-            assert(bones);
-            if (bones) {
-                setSkinning(ci, true);
-                if (builder->mUserBones) {
-                    setBones(ci, builder->mUserBones, count);
-                } else if (builder->mUserBoneMatrices) {
-                    setBones(ci, builder->mUserBoneMatrices, count);
-                } else {
-                    // initialize the bones to identity
-                    PerRenderableUibBone* out = (PerRenderableUibBone*)bones->bones.invalidate();
-                    std::uninitialized_fill_n(out, count, PerRenderableUibBone{});
-                }
+            Bones const bones = allocateBones(count);
+            manager[ci].bones = bones;
+            setSkinning(ci, true);
+            if (builder->mUserBones) {
+                setBones(ci, builder->mUserBones, count);
+            } else if (builder->mUserBoneMatrices) {
+                setBones(ci, builder->mUserBoneMatrices, count);
+            } else {
+                // initialize the bones to identity
+                PerRenderableUibBone* out = (PerRenderableUibBone*)mBones.invalidateUniforms(
+                        bones.offset * sizeof(PerRenderableUibBone),
+                        count * sizeof(PerRenderableUibBone));
+                std::uninitialized_fill_n(out, count, PerRenderableUibBone{});
             }
         }
     }
@@ -340,6 +342,10 @@ void FRenderableManager::terminate() noexcept {
             manager.removeComponent(manager.getEntity(ci));
         }
     }
+    if (mBonesUbh) {
+        mEngine.getDriverApi().destroyUniformBuffer(mBonesUbh);
+        mBonesUbh = {};
+    }
 }
 
 // This is basically a Renderable's destructor.
@@ -352,10 +358,11 @@ void FRenderableManager::destroyComponent(Instance ci) noexcept {
     // See create(RenderableManager::Builder&, Entity)
     destroyComponentPrimitives(engine, manager[ci].primitives);
 
-    // destroy the bones structures if any
-    std::unique_ptr<Bones> const& bones = manager[ci].bones;
-    if (bones) {
-        driver.destroyUniformBuffer(bones->handle);
+    // give the bones back to the skinning buffer if any
+    Bones const& bones = manager[ci].bones;
+    if (bones.count) {
+        freeBones(bones);
+        manager[ci].bones = Bones{};
     }
 }
 
@@ -368,25 +375,100 @@ void FRenderableManager::destroyComponentPrimitives(
 }
 
 
-void FRenderableManager::prepare(
-        driver::DriverApi& UTILS_RESTRICT driver,
-        Instance const* UTILS_RESTRICT instances,
-        utils::Range<uint32_t> list) const noexcept {
-    auto& manager = mManager;
+size_t FRenderableManager::prepare(driver::DriverApi& driver) const noexcept {
+    if (UTILS_UNLIKELY(mBones.isDirty())) {
+        // The skinning buffer can be large, so it's copied out of the command stream. It's
+        // uploaded at most once per frame, even when several views are rendered.
+        const size_t size = mBoneCount * sizeof(PerRenderableUibBone);
+        void* const buffer = ::malloc(size);
+        memcpy(buffer, mBones.getBuffer(), size);
+        driver.updateUniformBuffer(mBonesUbh, { buffer, size,
+                [](void* buffer, size_t, void*) { ::free(buffer); }});
+        mBones.clean();
+        return size;
+    }
+    return 0;
+}
 
-    std::unique_ptr<Bones>  const * const UTILS_RESTRICT bones = manager.raw_array<BONES>();
-    for (uint32_t index : list) {
-        size_t i = instances[index].asValue();
-        assert(i);  // we should never get the null instance here
-        if (UTILS_UNLIKELY(bones[i])) {
-            if (bones[i]->bones.isDirty()) {
-                driver.updateUniformBuffer(bones[i]->handle, bones[i]->bones.toBufferDescriptor(driver));
-                bones[i]->bones.clean();
-            }
+FRenderableManager::Bones FRenderableManager::allocateBones(size_t count) noexcept {
+    const uint32_t size = uint32_t((count + BONE_ALIGNMENT - 1) & ~size_t(BONE_ALIGNMENT - 1));
+
+    // first, try to reuse the range of a destroyed renderable
+    auto pos = std::find_if(mFreeBones.begin(), mFreeBones.end(),
+            [size](Bones const& range) { return range.count >= size; });
+    if (pos != mFreeBones.end()) {
+        Bones const bones{ pos->offset, uint32_t(count) };
+        pos->offset += size;
+        pos->count -= size;
+        if (!pos->count) {
+            mFreeBones.erase(pos);
         }
+        return bones;
+    }
+
+    // otherwise append the bones at the end of the buffer
+    Bones const bones{ mBoneCount, uint32_t(count) };
+    mBoneCount += size;
+    const size_t capacity = mBones.getSize() / sizeof(PerRenderableUibBone);
+    if (mBoneCount > capacity) {
+        growBones(std::max({ capacity * 2, size_t(mBoneCount), size_t(CONFIG_MAX_BONE_COUNT * 4) }));
+    }
+    return bones;
+}
+
+void FRenderableManager::freeBones(Bones const& bones) noexcept {
+    const uint32_t size = (bones.count + BONE_ALIGNMENT - 1) & ~(BONE_ALIGNMENT - 1);
+    Bones range{ bones.offset, size };
+
+    // keep the free ranges sorted, and merge the adjacent ones
+    auto pos = std::lower_bound(mFreeBones.begin(), mFreeBones.end(), range,
+            [](Bones const& lhs, Bones const& rhs) { return lhs.offset < rhs.offset; });
+    if (pos != mFreeBones.end() && range.offset + range.count == pos->offset) {
+        range.count += pos->count;
+        pos = mFreeBones.erase(pos);
+    }
+    if (pos != mFreeBones.begin() && (pos - 1)->offset + (pos - 1)->count == range.offset) {
+        --pos;
+        range.offset = pos->offset;
+        range.count += pos->count;
+        pos = mFreeBones.erase(pos);
+    }
+
+    if (range.offset + range.count == mBoneCount) {
+        // this is the end of the buffer
+        mBoneCount = range.offset;
+    } else {
+        mFreeBones.insert(pos, range);
     }
 }
 
+void FRenderableManager::growBones(size_t capacity) noexcept {
+    FEngine::DriverApi& driver = mEngine.getDriverApi();
+
+    UniformBuffer bones(capacity * sizeof(PerRenderableUibBone));
+    if (mBones.getSize()) {
+        memcpy(bones.invalidate(), mBones.getBuffer(), mBones.getSize());
+    }
+    mBones = std::move(bones);
+    // the new buffer must be uploaded entirely
+    mBones.invalidate();
+
+    if (mBonesUbh) {
+        driver.destroyUniformBuffer(mBonesUbh);
+    }
+    // The shaders see CONFIG_MAX_BONE_COUNT bones from the offset of each renderable, because
+    // according to the OpenGL ES 3.2 specification in 7.6.3 Uniform Buffer Object Bindings:
+    //
+    //     the uniform block must be populated with a buffer object with a size no smaller
+    //     than the minimum required size of the uniform block (the value of
+    //     UNIFORM_BLOCK_DATA_SIZE).
+    //
+    // so we need that much space past the last bone.
+    mBonesUbh = driver.createUniformBuffer(
+            (capacity + CONFIG_MAX_BONE_COUNT) * sizeof(PerRenderableUibBone),
+            driver::BufferUsage::DYNAMIC);
+}
+
 void FRenderableManager::setMaterialInstanceAt(Instance instance, uint8_t level,
         size_t primitiveIndex, FMaterialInstance const* mi) noexcept {
     if (instance) {
@@ -465,12 +547,14 @@ void FRenderableManager::setGeometryAt(Instance instance, uint8_t level, size_t
 void FRenderableManager::setBones(Instance ci,
         Bone const* UTILS_RESTRICT transforms, size_t boneCount, size_t offset) noexcept {
     if (ci) {
-        std::unique_ptr<Bones> const& bones = mManager[ci].bones;
-        assert(bones && offset + boneCount <= bones->count);
-        if (bones) {
-            boneCount = std::min(boneCount, bones->count - offset);
-            PerRenderableUibBone* UTILS_RESTRICT out = (PerRenderableUibBone*)bones->bones.invalidateUniforms(
-                    offset * sizeof(PerRenderableUibBone),
+        Bones const& bones = mManager[ci].bones;
+        assert(bones.count && offset + boneCount <= bones.count);
+        if (bones.count) {
+            // the bones can move the shadow casters
+            mEngine.invalidateContent();
+            boneCount = std::min(boneCount, bones.count - offset);
+            PerRenderableUibBone* UTILS_RESTRICT out = (PerRenderableUibBone*)mBones.invalidateUniforms(
+                    (bones.offset + offset) * sizeof(PerRenderableUibBone),
                     boneCount * sizeof(PerRenderableUibBone));
             for (size_t i = 0, c = boneCount; i < c; ++i) {
                 out[i].q = transforms[i].unitQuaternion;
@@ -484,41 +568,157 @@ void FRenderableManager::setBones(Instance ci,
 void FRenderableManager::setBones(Instance ci,
         filament::math::mat4f const* UTILS_RESTRICT transforms, size_t boneCount, size_t offset) noexcept {
     if (ci) {
-        std::unique_ptr<Bones> const& bones = mManager[ci].bones;
-        assert(bones && offset + boneCount <= bones->count);
-        if (bones) {
-            boneCount = std::min(boneCount, bones->count - offset);
-            PerRenderableUibBone* UTILS_RESTRICT out = (PerRenderableUibBone*)bones->bones.invalidateUniforms(
-                    offset * sizeof(PerRenderableUibBone),
+        Bones const& bones = mManager[ci].bones;
+        assert(bones.count && offset + boneCount <= bones.count);
+        if (bones.count) {
+            // the bones can move the shadow casters
+            mEngine.invalidateContent();
+            boneCount = std::min(boneCount, bones.count - offset);
+            PerRenderableUibBone* UTILS_RESTRICT out = (PerRenderableUibBone*)mBones.invalidateUniforms(
+                    (bones.offset + offset) * sizeof(PerRenderableUibBone),
                     boneCount * sizeof(PerRenderableUibBone));
-            for (size_t i = 0, c = boneCount; i < c; ++i) {
-                makeBone(&out[i], transforms[i]);
-            }
+            makeBones(out, transforms, boneCount);
         }
     }
 }
 
-void FRenderableManager::makeBone(PerRenderableUibBone* UTILS_RESTRICT out, filament::math::mat4f const& t) noexcept {
-    mat4f m(t);
+void FRenderableManager::setBones(Instance const* instances, size_t count,
+        filament::math::mat4f const* transforms) noexcept {
+    SYSTRACE_CALL();
 
-    // figure out the scales
-    float4 s = { length(m[0]), length(m[1]), length(m[2]), 0.0f };
-    if (dot(cross(m[0].xyz, m[1].xyz), m[2].xyz) < 0) {
-        s[2] = -s[2];
+    // the position of the bones of a renderable in transforms depends on the bone count of all
+    // the previous ones, which is unknown for an invalid instance
+    for (size_t i = 0; i < count; i++) {
+        Instance const ci = instances[i];
+        Bones const& bones = ci ? mManager[ci].bones : Bones{};
+        if (!ASSERT_PRECONDITION_NON_FATAL(bones.count, "instance %u has no bones", unsigned(i))) {
+            return;
+        }
+    }
+
+    // the bones can move the shadow casters
+    mEngine.invalidateContent();
+
+    // find where the bones of each renderable go, this is also where they're marked dirty
+    std::vector<BonesBatch>& batches = mBonesBatch;
+    batches.clear();
+    for (size_t i = 0; i < count; i++) {
+        Bones const& bones = mManager[instances[i]].bones;
+        PerRenderableUibBone* const out = (PerRenderableUibBone*)mBones.invalidateUniforms(
+                bones.offset * sizeof(PerRenderableUibBone),
+                bones.count * sizeof(PerRenderableUibBone));
+        batches.push_back({ out, transforms, bones.count });
+        transforms += bones.count;
+    }
+
+    // then convert all the bones, in parallel when there are enough renderables
+    auto work = [&batches](uint32_t start, uint32_t count) {
+        for (BonesBatch const& batch : Slice<BonesBatch>{ batches.data() + start, count }) {
+            makeBones(batch.out, batch.transforms, batch.count);
+        }
+    };
+    if (batches.size() >= JOBS_PARALLEL_FOR_COUNT * 2) {
+        JobSystem& js = mEngine.getJobSystem();
+        auto job = jobs::parallel_for(js, nullptr, 0, uint32_t(batches.size()),
+                std::cref(work), jobs::CountSplitter<JOBS_PARALLEL_FOR_COUNT, 8>());
+        js.runAndWait(job);
+    } else {
+        work(0, uint32_t(batches.size()));
     }
+}
 
-    // compute the inverse scales
-    float4 is = { 1.0f/s.x, 1.0f/s.y, 1.0f/s.z, 0.0f };
+void FRenderableManager::makeBone(PerRenderableUibBone* UTILS_RESTRICT out, filament::math::mat4f const& t) noexcept {
+    makeBones(out, &t, 1);
+}
+
+void FRenderableManager::makeBones(PerRenderableUibBone* UTILS_RESTRICT out,
+        filament::math::mat4f const* UTILS_RESTRICT transforms, size_t count) noexcept {
+    // The transforms are converted by batches of BATCH_SIZE, transposed so that each
+    // iteration of the loop below converts one bone. This loop has no branches and gets
+    // vectorized.
+    constexpr size_t BATCH_SIZE = 8;
+    for (size_t first = 0; first < count; first += BATCH_SIZE) {
+        const size_t n = std::min(BATCH_SIZE, count - first);
+
+        // the upper-left 3x3 of the transforms, stored as m[column][row][bone]. The unused
+        // entries of the last batch repeat its last transform.
+        float m[3][3][BATCH_SIZE];
+        for (size_t k = 0; k < BATCH_SIZE; k++) {
+            mat4f const& t = transforms[first + std::min(k, n - 1)];
+            for (size_t i = 0; i < 3; i++) {
+                for (size_t j = 0; j < 3; j++) {
+                    m[i][j][k] = t[i][j];
+                }
+            }
+        }
 
-    // normalize the matrix
-    m[0] *= is[0];
-    m[1] *= is[1];
-    m[2] *= is[2];
+        float s[3][BATCH_SIZE];     // scales
+        float ns[3][BATCH_SIZE];    // inverse scales, normalized
+        float q[4][BATCH_SIZE];     // rotations, as { x, y, z, w }
+        for (size_t k = 0; k < BATCH_SIZE; k++) {
+            // figure out the scales, the last one is negative if there is a reflection
+            const float det =
+                    m[2][0][k] * (m[0][1][k] * m[1][2][k] - m[0][2][k] * m[1][1][k]) +
+                    m[2][1][k] * (m[0][2][k] * m[1][0][k] - m[0][0][k] * m[1][2][k]) +
+                    m[2][2][k] * (m[0][0][k] * m[1][1][k] - m[0][1][k] * m[1][0][k]);
+            const float sx = std::sqrt(
+                    m[0][0][k] * m[0][0][k] + m[0][1][k] * m[0][1][k] + m[0][2][k] * m[0][2][k]);
+            const float sy = std::sqrt(
+                    m[1][0][k] * m[1][0][k] + m[1][1][k] * m[1][1][k] + m[1][2][k] * m[1][2][k]);
+            const float sz = std::copysign(std::sqrt(
+                    m[2][0][k] * m[2][0][k] + m[2][1][k] * m[2][1][k] + m[2][2][k] * m[2][2][k]),
+                    det);
+
+            // compute the inverse scales
+            const float isx = 1.0f / sx;
+            const float isy = 1.0f / sy;
+            const float isz = 1.0f / sz;
+
+            // normalize the matrix
+            const float r00 = m[0][0][k] * isx, r01 = m[0][1][k] * isx, r02 = m[0][2][k] * isx;
+            const float r10 = m[1][0][k] * isy, r11 = m[1][1][k] * isy, r12 = m[1][2][k] * isy;
+            const float r20 = m[2][0][k] * isz, r21 = m[2][1][k] * isz, r22 = m[2][2][k] * isz;
+
+            // Convert it to a quaternion, like mat3f::toQuaternion(). The candidates are
+            // 4 * { w^2, x^2, y^2, z^2 }, the largest one is used to compute the others
+            // accurately; it's picked with selects instead of branches.
+            const float tw = 1.0f + r00 + r11 + r22;
+            const float tx = 1.0f + r00 - r11 - r22;
+            const float ty = 1.0f - r00 + r11 - r22;
+            const float tz = 1.0f - r00 - r11 + r22;
+            const float d01 = r01 - r10, d20 = r20 - r02, d12 = r12 - r21;
+            const float s01 = r01 + r10, s20 = r20 + r02, s12 = r12 + r21;
+            float t = tw, x = d12, y = d20, z = d01, w = tw;
+            bool c = tx > t;
+            t = c ? tx : t;  x = c ? tx  : x;  y = c ? s01 : y;  z = c ? s20 : z;  w = c ? d12 : w;
+            c = ty > t;
+            t = c ? ty : t;  x = c ? s01 : x;  y = c ? ty  : y;  z = c ? s12 : z;  w = c ? d20 : w;
+            c = tz > t;
+            t = c ? tz : t;  x = c ? s20 : x;  y = c ? s12 : y;  z = c ? tz  : z;  w = c ? d01 : w;
+            // the candidates sum to 4, so t >= 1
+            const float f = 0.5f / std::sqrt(t);
+
+            const float nis = 1.0f / std::max({ std::abs(isx), std::abs(isy), std::abs(isz) });
+            s[0][k] = sx;
+            s[1][k] = sy;
+            s[2][k] = sz;
+            ns[0][k] = isx * nis;
+            ns[1][k] = isy * nis;
+            ns[2][k] = isz * nis;
+            q[0][k] = x * f;
+            q[1][k] = y * f;
+            q[2][k] = z * f;
+            q[3][k] = w * f;
+        }
 
-    out->s = s;
-    out->q = m.toQuaternion();
-    out->t = m[3];
-    out->ns = is / max(abs(is));
+        for (size_t k = 0; k < n; k++) {
+            PerRenderableUibBone& bone = out[first + k];
+            bone.q = { q[3][k], q[0][k], q[1][k], q[2][k] };
+            bone.t = transforms[first + k][3];
+            bone.s = { s[0][k], s[1][k], s[2][k], 0.0f };
+            bone.ns = { ns[0][k], ns[1][k], ns[2][k], 0.0f };
+        }
+    }
 }
 
 } // namespace details
@@ -539,6 +739,11 @@ RenderableManager::getInstance(utils::Entity e) const noexcept {
     return upcast(this)->getInstance(e);
 }
 
+void RenderableManager::getInstances(utils::Entity const* entities, Instance* instances,
+        size_t count) const noexcept {
+    upcast(this)->getInstances(entities, instances, count);
+}
+
 void RenderableManager::destroy(utils::Entity e) noexcept {
     return upcast(this)->destroy(e);
 }
@@ -619,4 +824,9 @@ void RenderableManager::setBones(Instance instance,
     upcast(this)->setBones(instance, transforms, boneCount, offset);
 }
 
+void RenderableManager::setBones(Instance const* instances, size_t count,
+        mat4f const* transforms) noexcept {
+    upcast(this)->setBones(instances, count, transforms);
+}
+
 } // namespace filament
@@ -34,8 +34,11 @@
 #include <utils/Slice.h>
 #include <utils/Range.h>
 
+#include <vector>
+
 // for gtest
 class FilamentTest_Bones_Test;
+class FilamentRenderTest_BonesAllocation_Test;
 
 namespace filament {
 namespace details {
@@ -73,15 +76,17 @@ public:
         return mManager.getInstance(e);
     }
 
+    void getInstances(utils::Entity const* entities, Instance* instances, size_t count) const noexcept {
+        mManager.getInstances(entities, instances, count);
+    }
+
     void create(const RenderableManager::Builder& builder, utils::Entity entity);
 
     void destroy(utils::Entity e) noexcept;
 
-    // - instances is a list of Instance (typically the list from a given scene)
-    // - list is a list of index in 'instances' (typically the visible ones)
-    void prepare(driver::DriverApi& driver,
-            RenderableManager::Instance const* instances,
-            utils::Range<uint32_t> list) const noexcept;
+    // uploads the bones of the skinned renderables if they changed since the last call,
+    // returns the number of bytes uploaded
+    size_t prepare(driver::DriverApi& driver) const noexcept;
 
     void gc(utils::EntityManager& em) noexcept {
         mManager.gc(em);
@@ -103,7 +108,7 @@ public:
     inline void setPrimitives(Instance instance, utils::Slice<FRenderPrimitive> const& primitives) noexcept;
     inline void setBones(Instance instance, Bone const* transforms, size_t boneCount, size_t offset = 0) noexcept;
     inline void setBones(Instance instance, filament::math::mat4f const* transforms, size_t boneCount, size_t offset = 0) noexcept;
-
+    void setBones(Instance const* instances, size_t count, filament::math::mat4f const* transforms) noexcept;
 
     inline bool isShadowCaster(Instance instance) const noexcept;
     inline bool isShadowReceiver(Instance instance) const noexcept;
@@ -115,7 +120,15 @@ public:
     inline uint8_t getLayerMask(Instance instance) const noexcept;
     inline uint8_t getPriority(Instance instance) const noexcept;
 
-    inline Handle<HwUniformBuffer> getBonesUbh(Instance instance) const noexcept;
+    // offset in bytes of the bones of this renderable in the skinning buffer, or 0 if it is not
+    // skinned.
+    inline uint32_t getBonesOffset(Instance instance) const noexcept;
+
+    // the skinning buffer, which holds the bones of all the skinned renderables
+    Handle<HwUniformBuffer> getBonesUbh() const noexcept { return mBonesUbh; }
+
+    size_t getMemoryUsed() const noexcept { return mManager.getMemoryUsed(); }
+    size_t getMemoryReserved() const noexcept { return mManager.getMemoryReserved(); }
 
 
     inline size_t getLevelCount(Instance instance) const noexcept { return 1; }
@@ -138,22 +151,44 @@ private:
     static void destroyComponentPrimitives(FEngine& engine,
             utils::Slice<FRenderPrimitive>& primitives) noexcept;
 
+    // a range of the skinning buffer, in bones
     struct Bones {
-        filament::Handle<HwUniformBuffer> handle;
-        UniformBuffer bones;
+        uint32_t offset = 0;
+        uint32_t count = 0;
+    };
+
+    // The bones of each renderable start on a multiple of 4 bones (256 bytes), the largest
+    // offset alignment of uniform buffers.
+    static constexpr uint32_t BONE_ALIGNMENT = 4;
+
+    // a job converts the bones of at least this many renderables
+    static constexpr size_t JOBS_PARALLEL_FOR_COUNT = 4;
+
+    Bones allocateBones(size_t count) noexcept;
+    void freeBones(Bones const& bones) noexcept;
+    void growBones(size_t capacity) noexcept;
+
+    struct BonesBatch {
+        PerRenderableUibBone* out;
+        filament::math::mat4f const* transforms;
         size_t count;
     };
 
     friend class ::FilamentTest_Bones_Test;
+    friend class ::FilamentRenderTest_BonesAllocation_Test;
 
     static void makeBone(PerRenderableUibBone* out, filament::math::mat4f const& transforms) noexcept;
 
+    // converts count transforms to bones, this is vectorized
+    static void makeBones(PerRenderableUibBone* out,
+            filament::math::mat4f const* transforms, size_t count) noexcept;
+
     enum {
         AABB,               // user data
         LAYERS,             // user data
         VISIBILITY,         // user data
         PRIMITIVES,         // user data
-        BONES,              // filament data, UBO storing a pointer to the bones information
+        BONES,              // filament data, range of the skinning buffer storing the bones
     };
 
     using Base = utils::SingleInstanceComponentManager<
@@ -161,7 +196,7 @@ private:
             uint8_t,
             Visibility,
             utils::Slice<FRenderPrimitive>,
-            std::unique_ptr<Bones>
+            Bones
     >;
 
     struct Sim : public Base {
@@ -194,6 +229,15 @@ private:
 
     Sim mManager;
     FEngine& mEngine;
+
+    // The bones of all the skinned renderables are stored in a single buffer, each renderable
+    // binds its own range of it. The first bones are never used, so that an offset of 0 means
+    // that a renderable is not skinned.
+    UniformBuffer mBones;                       // CPU copy of the skinning buffer
+    Handle<HwUniformBuffer> mBonesUbh;
+    uint32_t mBoneCount = BONE_ALIGNMENT;       // end of the allocated ranges
+    std::vector<Bones> mFreeBones;              // free ranges before mBoneCount, sorted
+    std::vector<BonesBatch> mBonesBatch;        // scratch space for setBones()
 };
 
 FILAMENT_UPCAST(RenderableManager)
@@ -289,9 +333,9 @@ Box const& FRenderableManager::getAABB(Instance instance) const noexcept {
     return mManager[instance].aabb;
 }
 
-Handle<HwUniformBuffer> FRenderableManager::getBonesUbh(Instance instance) const noexcept {
-    std::unique_ptr<Bones> const& bones = mManager[instance].bones;
-    return bones ? bones->handle : Handle<HwUniformBuffer>{};
+uint32_t FRenderableManager::getBonesOffset(Instance instance) const noexcept {
+    Bones const& bones = mManager[instance].bones;
+    return bones.offset * uint32_t(sizeof(PerRenderableUibBone));
 }
 
 utils::Slice<FRenderPrimitive> const& FRenderableManager::getRenderPrimitives(
@@ -16,6 +16,11 @@
 
 #include "components/TransformManager.h"
 
+#include <utils/JobSystem.h>
+#include <utils/Systrace.h>
+
+#include <algorithm>
+
 using namespace utils;
 using namespace filament::math;
 
@@ -26,6 +31,10 @@ FTransformManager::FTransformManager() noexcept = default;
 
 FTransformManager::~FTransformManager() noexcept = default;
 
+void FTransformManager::init(JobSystem& js) noexcept {
+    mJobSystem = &js;
+}
+
 void FTransformManager::terminate() noexcept {
 }
 
@@ -37,7 +46,7 @@ void FTransformManager::create(Entity entity, Instance parent, const mat4f& loca
     // this always adds at the end, so all existing instances stay valid
     auto& manager = mManager;
 
-    // TODO: try to keep entries sorted with their siblings/parents to improve cache access
+    // new entries are sorted with their siblings/parents by the next transaction commit
     if (UTILS_UNLIKELY(manager.hasComponent(entity))) {
         destroy(entity);
     }
@@ -46,6 +55,7 @@ void FTransformManager::create(Entity entity, Instance parent, const mat4f& loca
     assert(i != parent);
 
     if (i && i != parent) {
+        mSorted = false;
         manager[i].parent = 0;
         manager[i].next = 0;
         manager[i].prev = 0;
@@ -55,6 +65,51 @@ void FTransformManager::create(Entity entity, Instance parent, const mat4f& loca
     }
 }
 
+void FTransformManager::create(Entity const* entities, int32_t const* parents,
+        const mat4f* localTransforms, size_t count, Instance* instances) {
+    SYSTRACE_CALL();
+
+    auto& manager = mManager;
+
+    // destroy existing components first, as this can move the instances we're about to create
+    for (size_t k = 0; k < count; k++) {
+        if (UTILS_UNLIKELY(manager.hasComponent(entities[k]))) {
+            destroy(entities[k]);
+        }
+    }
+
+    // size the arrays once, so they're not reallocated while adding the components
+    manager.reserve(manager.getComponentCount() + count);
+
+    std::vector<Instance> created(count);
+    const bool transactionOpen = mLocalTransformTransactionOpen;
+    for (size_t k = 0; k < count; k++) {
+        Instance const i = manager.addComponent(entities[k]);
+        created[k] = i;
+        if (UTILS_UNLIKELY(!i)) {
+            continue;
+        }
+        // parents always come before their children, so they're already created
+        assert(parents[k] < int32_t(k));
+        Instance const parent = parents[k] >= 0 ? created[parents[k]] : Instance{};
+        manager[i].parent = 0;
+        manager[i].firstChild = 0;
+        insertNode(i, parent);
+        manager[i].local = localTransforms[k];
+        if (!transactionOpen) {
+            // the new node has no children yet, and the dummy world transform of roots is
+            // the identity
+            mat4f const& pt = manager.raw_array<WORLD>()[parent];
+            manager[i].world = pt * localTransforms[k];
+        }
+    }
+    mSorted = false;
+
+    if (instances) {
+        std::copy(created.begin(), created.end(), instances);
+    }
+}
+
 void FTransformManager::setParent(Instance i, Instance parent) noexcept {
     validateNode(i);
     if (i) {
@@ -62,6 +117,7 @@ void FTransformManager::setParent(Instance i, Instance parent) noexcept {
         Instance oldParent = manager[i].parent;
         if (oldParent != parent) {
             // TODO: on debug builds, ensure that the new parent isn't one of our descendant
+            mSorted = false;
             removeNode(i);
             insertNode(i, parent);
             updateNodeTransform(i);
@@ -75,6 +131,8 @@ void FTransformManager::destroy(Entity e) noexcept {
     Instance i = manager.getInstance(e);
     validateNode(i);
     if (i) {
+        mSorted = false;
+
         // 1) remove the entry from the linked lists
         removeNode(i);
 
@@ -105,21 +163,32 @@ void FTransformManager::setTransform(Instance ci, const mat4f& model) noexcept {
     }
 }
 
+void FTransformManager::setTransforms(Instance const* instances, const mat4f* localTransforms,
+        size_t count) noexcept {
+    // this is just a transaction covering all the given transforms
+    const bool transactionOpen = mLocalTransformTransactionOpen;
+    mLocalTransformTransactionOpen = true;
+    auto& manager = mManager;
+    for (size_t k = 0; k < count; k++) {
+        Instance const ci = instances[k];
+        validateNode(ci);
+        if (ci) {
+            manager[ci].local = localTransforms[k];
+        }
+    }
+    if (!transactionOpen) {
+        commitLocalTransformTransaction();
+    }
+}
+
 void FTransformManager::updateNodeTransform(Instance i) noexcept {
     validateNode(i);
     auto& manager = mManager;
     assert(i);
 
     if (UTILS_UNLIKELY(mLocalTransformTransactionOpen)) {
-        // don't update the world transform until commitLocalTransformTransaction() is called
-        Instance ci = manager[i].firstChild;
-        while (ci) {
-            Instance child = manager[ci].firstChild;
-            ci = manager[ci].next;
-            if (child) {
-                updateNodeTransform(child);
-            }
-        }
+        // don't update the world transform until commitLocalTransformTransaction() is called,
+        // which recomputes all of them.
         return;
     }
 
@@ -145,23 +214,119 @@ void FTransformManager::openLocalTransformTransaction() noexcept {
 void FTransformManager::commitLocalTransformTransaction() noexcept {
     if (mLocalTransformTransactionOpen) {
         mLocalTransformTransactionOpen = false;
-        auto& manager = mManager;
+        if (UTILS_UNLIKELY(!mSorted)) {
+            // the hierarchy changed since the last commit
+            sortBreadthFirst();
+        }
+        updateWorldTransforms();
+    }
+}
 
-        // swapNode() below needs some temporary storage which we provide here
-        auto& soa = manager.getSoA();
-        soa.ensureCapacity(soa.size() + 1);
+// Reorders all nodes breadth-first, i.e. sorted by depth with siblings next to each other.
+// This guarantees that parents are always before their children and that each depth level
+// is contiguous, so it can be processed in parallel once the previous level is done.
+void FTransformManager::sortBreadthFirst() noexcept {
+    SYSTRACE_CALL();
 
-        mat4f const* const UTILS_RESTRICT world = manager.raw_array<WORLD>();
-        for (Instance i = manager.begin(), e = manager.end(); i != e; ++i) {
-            // Ensure that children are always sorted after their parent.
-            if (UTILS_UNLIKELY(Instance(manager[i].parent) > i)) {
-                swapNode(i, manager[i].parent);
-            }
-            Instance parent = manager[i].parent;
-            assert(parent < i);
-            manager[i].world = world[parent] * static_cast<mat4f const&>(manager[i].local);
+    auto& manager = mManager;
+    const size_t count = manager.getComponentCount();
+
+    // compute the breadth-first order, starting with all the roots
+    std::vector<Instance> order;
+    order.reserve(count);
+    for (Instance i = manager.begin(), e = manager.end(); i != e; ++i) {
+        Instance const parent = manager[i].parent;
+        if (!parent) {
+            order.push_back(i);
         }
     }
+
+    mLevels.clear();
+    size_t levelEnd = 0;
+    for (size_t k = 0; k < order.size(); k++) {
+        if (k == levelEnd) {
+            // we've visited all the nodes of the previous level, so all the nodes of
+            // this level are now in order[].
+            mLevels.push_back(Instance(manager.begin() + k));
+            levelEnd = order.size();
+        }
+        for (Instance child = manager[order[k]].firstChild; child; child = manager[child].next) {
+            order.push_back(child);
+        }
+    }
+    mLevels.push_back(Instance(manager.begin() + order.size()));
+
+    // this would mean we have a cycle in the hierarchy
+    assert(order.size() == count);
+
+    // swapNode() below needs some temporary storage which we provide here
+    auto& soa = manager.getSoA();
+    soa.ensureCapacity(soa.size() + 1);
+
+    // now move each node to its place, we need to keep track of where each node is,
+    // since swapNode() moves nodes around.
+    std::vector<Instance> at(count + 1);    // node currently at a given position
+    std::vector<Instance> pos(count + 1);   // current position of a given node
+    for (Instance i = manager.begin(), e = manager.end(); i != e; ++i) {
+        at[i] = i;
+        pos[i] = i;
+    }
+    for (size_t k = 0; k < order.size(); k++) {
+        const Instance dst(manager.begin() + k);
+        const Instance node = order[k];
+        const Instance src = pos[node];
+        if (src != dst) {
+            assert(src > dst);
+            swapNode(dst, src);
+            const Instance moved = at[dst];
+            at[src] = moved;
+            pos[moved] = src;
+            at[dst] = node;
+            pos[node] = dst;
+        }
+    }
+
+    mSorted = true;
+}
+
+void FTransformManager::updateWorldTransforms() noexcept {
+    SYSTRACE_CALL();
+
+    auto& soa = mManager.getSoA();
+    mat4f* const world = soa.data<WORLD>();
+    mat4f const* const local = soa.data<LOCAL>();
+    Instance const* const parent = soa.data<PARENT>();
+
+    auto work = [world, local, parent](uint32_t start, uint32_t count) {
+        transformNodes(world, local, parent, start, start + count);
+    };
+
+    // the levels can only be transformed in parallel from a thread adopted by the JobSystem,
+    // which isn't necessarily the case of the caller
+    const bool parallel = mJobSystem && JobSystem::getJobSystem() == mJobSystem;
+
+    // each level only depends on the previous one
+    for (size_t l = 1; l < mLevels.size(); l++) {
+        const uint32_t first = mLevels[l - 1];
+        const uint32_t last = mLevels[l];
+        if (parallel && last - first >= JOBS_PARALLEL_FOR_COUNT * 2) {
+            JobSystem& js = *mJobSystem;
+            auto job = jobs::parallel_for(js, nullptr, first, last - first,
+                    std::cref(work), jobs::CountSplitter<JOBS_PARALLEL_FOR_COUNT, 8>());
+            js.runAndWait(job);
+        } else {
+            transformNodes(world, local, parent, first, last);
+        }
+    }
+}
+
+void FTransformManager::transformNodes(mat4f* UTILS_RESTRICT world,
+        mat4f const* UTILS_RESTRICT local, Instance const* UTILS_RESTRICT parent,
+        size_t first, size_t last) noexcept {
+    // note: world[0] is the identity, so roots don't need special-casing
+    for (size_t i = first; i < last; i++) {
+        world[i] = world[parent[i]] * local[i];
+    }
 }
 
 // Inserts a parentless node in the hierarchy
@@ -364,6 +529,11 @@ void TransformManager::create(Entity entity, Instance parent, const mat4f& world
     upcast(this)->create(entity, parent, worldTransform);
 }
 
+void TransformManager::create(Entity const* entities, int32_t const* parents,
+        const mat4f* localTransforms, size_t count, Instance* instances) {
+    upcast(this)->create(entities, parents, localTransforms, count, instances);
+}
+
 void TransformManager::destroy(Entity e) noexcept {
     upcast(this)->destroy(e);
 }
@@ -376,10 +546,20 @@ TransformManager::Instance TransformManager::getInstance(Entity e) const noexcep
     return upcast(this)->getInstance(e);
 }
 
+void TransformManager::getInstances(Entity const* entities, Instance* instances,
+        size_t count) const noexcept {
+    upcast(this)->getInstances(entities, instances, count);
+}
+
 void TransformManager::setTransform(Instance ci, const mat4f& model) noexcept {
     upcast(this)->setTransform(ci, model);
 }
 
+void TransformManager::setTransforms(Instance const* instances, const mat4f* localTransforms,
+        size_t count) noexcept {
+    upcast(this)->setTransforms(instances, localTransforms, count);
+}
+
 const mat4f& TransformManager::getTransform(Instance ci) const noexcept {
     return upcast(this)->getTransform(ci);
 }
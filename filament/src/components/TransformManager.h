@@ -28,6 +28,12 @@
 
 #include <math/mat4.h>
 
+#include <vector>
+
+namespace utils {
+class JobSystem;
+} // namespace utils
+
 namespace filament {
 namespace details {
 
@@ -38,6 +44,10 @@ public:
     FTransformManager() noexcept;
     ~FTransformManager() noexcept;
 
+    // the JobSystem is used to update large hierarchies in parallel, if not set, all
+    // updates happen on the calling thread.
+    void init(utils::JobSystem& js) noexcept;
+
     // free-up all resources
     void terminate() noexcept;
 
@@ -54,10 +64,17 @@ public:
         return Instance(mManager.getInstance(e));
     }
 
+    void getInstances(utils::Entity const* entities, Instance* instances, size_t count) const noexcept {
+        mManager.getInstances(entities, instances, count);
+    }
+
     void create(utils::Entity entity);
 
     void create(utils::Entity entity, Instance parent, const filament::math::mat4f& localTransform);
 
+    void create(utils::Entity const* entities, int32_t const* parents,
+            const filament::math::mat4f* localTransforms, size_t count, Instance* instances);
+
     void destroy(utils::Entity e) noexcept;
 
     void setParent(Instance i, Instance newParent) noexcept;
@@ -74,6 +91,9 @@ public:
 
     void setTransform(Instance ci, const filament::math::mat4f& model) noexcept;
 
+    void setTransforms(Instance const* instances,
+            const filament::math::mat4f* localTransforms, size_t count) noexcept;
+
     const filament::math::mat4f& getTransform(Instance ci) const noexcept {
         return mManager[ci].local;
     }
@@ -82,16 +102,27 @@ public:
         return mManager[ci].world;
     }
 
+    size_t getMemoryUsed() const noexcept { return mManager.getMemoryUsed(); }
+    size_t getMemoryReserved() const noexcept { return mManager.getMemoryReserved(); }
+
 private:
     struct Sim;
 
+    // levels smaller than twice this are processed on the calling thread
+    static constexpr size_t JOBS_PARALLEL_FOR_COUNT = 256;
+
     void validateNode(Instance i) noexcept;
     void removeNode(Instance i) noexcept;
     void updateNode(Instance i) noexcept;
     void updateNodeTransform(Instance i) noexcept;
     void insertNode(Instance i, Instance p) noexcept;
     void swapNode(Instance i, Instance j) noexcept;
+    void sortBreadthFirst() noexcept;
+    void updateWorldTransforms() noexcept;
     static void transformChildren(Sim& manager, Instance firstChild) noexcept;
+    static void transformNodes(filament::math::mat4f* UTILS_RESTRICT world,
+            filament::math::mat4f const* UTILS_RESTRICT local,
+            Instance const* UTILS_RESTRICT parent, size_t first, size_t last) noexcept;
 
 
     enum {
@@ -144,6 +175,12 @@ private:
     };
 
     Sim mManager;
+    utils::JobSystem* mJobSystem = nullptr;
+
+    // Instances are sorted breadth-first, mLevels holds the first instance of each depth
+    // level followed by the end of the last level. This is only valid when mSorted is true.
+    std::vector<Instance> mLevels;
+    bool mSorted = true;
     bool mLocalTransformTransactionOpen = false;
 };
 
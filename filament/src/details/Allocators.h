@@ -22,6 +22,8 @@
 namespace filament {
 namespace details {
 
+// The values below are the defaults, they can be changed with Engine::Config.
+
 // per render pass allocations
 // Froxelization needs about 1 MiB. Command buffer needs about 1 MiB.
 static constexpr size_t CONFIG_PER_RENDER_PASS_ARENA_SIZE    = 2 * 1024 * 1024;
@@ -33,30 +35,32 @@ static constexpr size_t CONFIG_PER_FRAME_COMMANDS_SIZE = 1 * 1024 * 1024;
 static constexpr size_t CONFIG_MIN_COMMAND_BUFFERS_SIZE = 1 * 1024 * 1024;
 static constexpr size_t CONFIG_COMMAND_BUFFERS_SIZE     = 3 * CONFIG_MIN_COMMAND_BUFFERS_SIZE;
 
-#ifndef NDEBUG
-
 using HeapAllocatorArena = utils::Arena<
         utils::HeapAllocator,
         utils::LockingPolicy::NoLock>;
 
+// the high watermark is tracked in release builds as well, for Engine::getMemoryStats()
 using LinearAllocatorArena = utils::Arena<
         utils::LinearAllocator,
         utils::LockingPolicy::NoLock,
         utils::TrackingPolicy::HighWatermark>;
 
-#else
-
-using HeapAllocatorArena = utils::Arena<
-        utils::HeapAllocator,
-        utils::LockingPolicy::NoLock>;
+using ArenaScope = utils::ArenaScope<LinearAllocatorArena>;
 
-using LinearAllocatorArena = utils::Arena<
-        utils::LinearAllocator,
-        utils::LockingPolicy::NoLock>;
+// Current and peak size of a kind of resources, updated as they're created and destroyed
+struct MemoryCounter {
+    size_t current = 0;
+    size_t peak = 0;
 
-#endif
+    void add(size_t size) noexcept {
+        current += size;
+        peak = current > peak ? current : peak;
+    }
 
-using ArenaScope = utils::ArenaScope<LinearAllocatorArena>;
+    void remove(size_t size) noexcept {
+        current -= size;
+    }
+};
 
 } // namespace details
 } // namespace filament
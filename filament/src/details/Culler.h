@@ -57,6 +57,18 @@ public:
             filament::math::float3 const* extent,
             size_t count, size_t bit) noexcept;
 
+    /*
+     * returns whether each AABB in an array intersects with each of the given frusta,
+     * bit i of each result is set if the AABB intersects frusta[i].
+     * frustumCount must be <= MAX_FRUSTUM_COUNT.
+     */
+    static constexpr size_t MAX_FRUSTUM_COUNT = sizeof(result_type) * 8;
+    static void intersects(result_type* results,
+            Frustum const* frusta, size_t frustumCount,
+            filament::math::float3 const* center,
+            filament::math::float3 const* extent,
+            size_t count) noexcept;
+
     /*
      * returns whether each sphere in an array intersects with the frustum
      */
@@ -88,6 +100,12 @@ public:
                 filament::math::float3 const* e,
                 size_t count) noexcept;
 
+        static void intersects(result_type* results,
+                Frustum const* frusta, size_t frustumCount,
+                filament::math::float3 const* c,
+                filament::math::float3 const* e,
+                size_t count) noexcept;
+
         static void intersects(result_type* results,
                 Frustum const& frustum,
                 filament::math::float4 const* b,
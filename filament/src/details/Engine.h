@@ -18,7 +18,9 @@
 #define TNT_FILAMENT_DETAILS_ENGINE_H
 
 #include "upcast.h"
+#include "CpuProfiler.h"
 #include "PostProcessManager.h"
+#include "RenderPrimitiveCache.h"
 #include "RenderTargetPool.h"
 
 #include "components/CameraManager.h"
@@ -29,14 +31,17 @@
 #include "details/Allocators.h"
 #include "details/Camera.h"
 #include "details/DebugRegistry.h"
+#include "details/MaterialLoader.h"
 #include "details/ResourceList.h"
 #include "details/Skybox.h"
+#include "details/TextureStreamer.h"
 
 #include "driver/CommandStream.h"
 #include "driver/CommandBufferQueue.h"
 #include "driver/DriverApi.h"
 
 #include <filament/Engine.h>
+#include <filament/GeometryArena.h>
 #include <filament/VertexBuffer.h>
 #include <filament/IndirectLight.h>
 #include <filament/Material.h>
@@ -68,6 +73,7 @@ class Program;
 namespace details {
 
 class FFence;
+class FGeometryArena;
 class FMaterialInstance;
 class FRenderer;
 class FScene;
@@ -107,12 +113,29 @@ public:
     static constexpr size_t CONFIG_MIN_COMMAND_BUFFERS_SIZE     = details::CONFIG_MIN_COMMAND_BUFFERS_SIZE;
     static constexpr size_t CONFIG_COMMAND_BUFFERS_SIZE         = details::CONFIG_COMMAND_BUFFERS_SIZE;
 
+    // Engine::Config resolved to the values actually used (sizes in bytes)
+    struct ConfigValues {
+        size_t commandBufferSize;
+        size_t minCommandBufferSize;
+        size_t perRenderPassArenaSize;
+        size_t perFrameCommandsSize;
+        int32_t driverThreadAffinity;   // -1 means automatic
+        utils::CString driverCapturePath;   // empty when the capture is disabled
+        utils::CString programCachePath;    // empty when the default blob cache is disabled
+    };
+
 public:
     static FEngine* create(Backend backend = Backend::DEFAULT,
-            Platform* platform = nullptr, void* sharedGLContext = nullptr);
+            Platform* platform = nullptr, void* sharedGLContext = nullptr,
+            const Config* config = nullptr);
 
     ~FEngine() noexcept;
 
+    // Creates a platform and its driver without an engine, e.g. to replay a capture. The driver
+    // must be deleted before the platform is destroyed with destroyPlatform().
+    static Driver* createStandaloneDriver(Backend backend, Platform** platform) noexcept;
+    static void destroyPlatform(Platform** platform) noexcept;
+
     Driver& getDriver() const noexcept { return *mDriver; }
     DriverApi& getDriverApi() noexcept { return mCommandStream; }
     DFG* getDFG() const noexcept { return mDFG.get(); }
@@ -131,9 +154,21 @@ public:
     // we'll simply have to use separate Areas (for instance).
     LinearAllocatorArena& getPerRenderPassAllocator() noexcept { return mPerRenderPassAllocator; }
 
+    // size of the high-level commands buffer, allocated from the per-render-pass arena
+    size_t getPerFrameCommandsSize() const noexcept { return mConfig.perFrameCommandsSize; }
+    size_t getPerRenderPassArenaSize() const noexcept { return mConfig.perRenderPassArenaSize; }
+
+    ConfigValues const& getConfig() const noexcept { return mConfig; }
+
     // Material IDs...
     uint32_t getMaterialId() const noexcept { return mMaterialId++; }
 
+    // Incremented each time the content of a vertex or index buffer, or the parameters of a
+    // material instance, are updated. Cached renderings (e.g. shadow maps) are invalidated
+    // when it changes.
+    uint32_t getContentVersion() const noexcept { return mContentVersion; }
+    void invalidateContent() const noexcept { mContentVersion++; }
+
     const FMaterial* getDefaultMaterial() const noexcept { return mDefaultMaterial; }
     const FMaterial* getSkyboxMaterial(bool rgbm) const noexcept;
     const FIndirectLight* getDefaultIndirectLight() const noexcept { return mDefaultIbl; }
@@ -175,6 +210,10 @@ public:
         return mRenderTargetPool;
     }
 
+    RenderPrimitiveCache& getRenderPrimitiveCache() noexcept {
+        return mRenderPrimitiveCache;
+    }
+
     FRenderableManager& getRenderableManager() noexcept {
         return mRenderableManager;
     }
@@ -191,6 +230,26 @@ public:
         return mTransformManager;
     }
 
+    FTextureStreamer& getTextureStreamer() noexcept {
+        return mTextureStreamer;
+    }
+
+    // estimated GPU memory of the textures and of the vertex and index buffers, kept up to
+    // date by these objects
+    MemoryCounter& getTextureMemory() noexcept { return mTextureMemory; }
+    MemoryCounter& getBufferMemory() noexcept { return mBufferMemory; }
+
+    FTextureStreamer const& getTextureStreamer() const noexcept {
+        return mTextureStreamer;
+    }
+
+    FMaterialLoader& getMaterialLoader() noexcept {
+        return mMaterialLoader;
+    }
+
+    // makes all the material instances sampling oldHandle sample newHandle instead
+    void replaceTexture(Handle<HwTexture> oldHandle, Handle<HwTexture> newHandle) noexcept;
+
     utils::EntityManager& getEntityManager() noexcept {
         return mEntityManager;
     }
@@ -207,6 +266,7 @@ public:
 
     utils::JobSystem& getJobSystem() noexcept { return mJobSystem; }
 
+    CpuProfiler& getCpuProfiler() noexcept { return mCpuProfiler; }
 
     Epoch getEngineEpoch() const { return mEngineEpoch; }
     duration getEngineTime() const noexcept {
@@ -220,6 +280,7 @@ public:
 
     FVertexBuffer* createVertexBuffer(const VertexBuffer::Builder& builder) noexcept;
     FIndexBuffer* createIndexBuffer(const IndexBuffer::Builder& builder) noexcept;
+    FGeometryArena* createGeometryArena(const GeometryArena::Builder& builder) noexcept;
     FIndirectLight* createIndirectLight(const IndirectLight::Builder& builder) noexcept;
     FMaterial* createMaterial(const Material::Builder& builder) noexcept;
     FTexture* createTexture(const Texture::Builder& builder) noexcept;
@@ -241,6 +302,7 @@ public:
     void destroy(const FVertexBuffer* p);
     void destroy(const FFence* p);
     void destroy(const FIndexBuffer* p);
+    void destroy(const FGeometryArena* p);
     void destroy(const FIndirectLight* p);
     void destroy(const FMaterial* p);
     void destroy(const FMaterialInstance* p);
@@ -256,6 +318,16 @@ public:
     // flush the current buffer
     void flush();
 
+    // total size of the commands written to the command buffer so far, including the ones
+    // that haven't been flushed yet
+    uint64_t getCommandBytesWritten() noexcept {
+        CircularBuffer const& buffer = mCommandBufferQueue.getCircularBuffer();
+        return buffer.getBytesWritten() +
+                (uintptr_t(buffer.getHead()) - uintptr_t(buffer.getTail()));
+    }
+
+    Engine::MemoryStats getMemoryStats() const noexcept;
+
     void prepare();
     void gc();
 
@@ -274,10 +346,14 @@ public:
     bool execute();
 
 private:
-    FEngine(Backend backend, Platform* platform, void* sharedGLContext);
+    FEngine(Backend backend, Platform* platform, void* sharedGLContext, Config const& config);
     void init();
 
+    static ConfigValues resolveConfig(Config const& config) noexcept;
+
     int loop();
+    // creates the driver, wrapped in a CaptureDriver if the configuration asks for it
+    Driver* createDriver(Platform* platform, void* sharedContext) const noexcept;
     void flushCommandBuffer(CommandBufferQueue& commandBufferQueue);
 
     template<typename T, typename L>
@@ -289,8 +365,14 @@ private:
     Handle<HwProgram> createPostProcessProgram(filaflat::MaterialParser& parser,
             driver::ShaderModel model, PostProcessStage stage) const noexcept;
 
+    size_t getScenesMemoryUsed() const noexcept;
+    size_t getComponentsMemoryUsed() const noexcept;
+    void updateMemoryPeaks() const noexcept;
+
     Driver* mDriver = nullptr;
 
+    const ConfigValues mConfig;
+
     Backend mBackend;
     Platform* mPlatform = nullptr;
     void* mSharedGLContext = nullptr;
@@ -301,12 +383,23 @@ private:
 
     PostProcessManager mPostProcessManager;
     RenderTargetPool mRenderTargetPool;
+    RenderPrimitiveCache mRenderPrimitiveCache;
 
     utils::EntityManager& mEntityManager;
     FRenderableManager mRenderableManager;
     FTransformManager mTransformManager;
     FLightManager mLightManager;
     FCameraManager mCameraManager;
+    FTextureStreamer mTextureStreamer;
+
+    MemoryCounter mTextureMemory;
+    MemoryCounter mBufferMemory;
+    // the scenes and components don't track their peak, it's sampled by prepare() and
+    // getMemoryStats(). They're mutable so that the const getMemoryStats() can fold the current
+    // usage in, and never report a peak below it. Both are only called on the user's thread.
+    mutable size_t mScenesMemoryPeak = 0;
+    mutable size_t mComponentsMemoryPeak = 0;
+    FMaterialLoader mMaterialLoader;
 
     ResourceList<FRenderer> mRenderers{ "Renderer" };
     ResourceList<FView> mViews{ "View" };
@@ -314,6 +407,7 @@ private:
     ResourceList<FFence, utils::LockingPolicy::SpinLock> mFences{"Fence"};
     ResourceList<FSwapChain> mSwapChains{ "SwapChain" };
     ResourceList<FStream> mStreams{ "Stream" };
+    ResourceList<FGeometryArena> mGeometryArenas{ "GeometryArena" };
     ResourceList<FIndexBuffer> mIndexBuffers{ "IndexBuffer" };
     ResourceList<FVertexBuffer> mVertexBuffers{ "VertexBuffer" };
     ResourceList<FIndirectLight> mIndirectLights{ "IndirectLight" };
@@ -322,6 +416,7 @@ private:
     ResourceList<FSkybox> mSkyboxes{ "Skybox" };
 
     mutable uint32_t mMaterialId = 0;
+    mutable uint32_t mContentVersion = 0;
 
     // FMaterialInstance are handled directly by FMaterial
     std::unordered_map<const FMaterial*, ResourceList<FMaterialInstance>> mMaterialInstances;
@@ -345,7 +440,12 @@ private:
     LinearAllocatorArena mPerRenderPassAllocator;
     HeapAllocatorArena mHeapAllocator;
 
-    utils::JobSystem mJobSystem;
+    CpuProfiler mCpuProfiler;
+
+    // only set when we're not using an external JobSystem
+    std::unique_ptr<utils::JobSystem> mOwnJobSystem;
+    utils::JobSystem& mJobSystem;
+    bool mAdoptedThread = false;    // the Engine adopted the thread that created it
 
     Epoch mEngineEpoch;
 
@@ -373,6 +473,7 @@ public:
             bool lispsm = true;
             float dzn = -1.0f;
             float dzf =  1.0f;
+            bool cache = true;
         } shadowmap;
     } debug;
 };
@@ -163,6 +163,9 @@ public:
     const utils::Slice<FroxelEntry>& getFroxelBufferUser() const { return mFroxelBufferUser; }
     const utils::Slice<RecordBufferType>& getRecordBufferUser() const { return mRecordBufferUser; }
 
+    // number of entries of the record buffer used by the last froxelization
+    size_t getRecordCount() const noexcept { return mRecordCount; }
+
     // this is chosen so froxelizePointAndSpotLight() vectorizes 4 froxel tests / spotlight
     // with 256 lights this implies 8 jobs (256 / 32) for froxelization.
     using LightGroupType = uint32_t;
@@ -245,6 +248,7 @@ private:
     uint16_t mFroxelCountY = 0;
     uint16_t mFroxelCountZ = 0;
     uint16_t mFroxelCount = 0;
+    uint16_t mRecordCount = 0;
     filament::math::uint2 mFroxelDimension = {};
 
     filament::math::mat4f mProjection;
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_DETAILS_GEOMETRYARENA_H
+#define TNT_FILAMENT_DETAILS_GEOMETRYARENA_H
+
+#include "upcast.h"
+
+#include "RangeAllocator.h"
+
+#include <filament/GeometryArena.h>
+
+#include <utils/compiler.h>
+
+namespace filament {
+namespace details {
+
+class FEngine;
+class FIndexBuffer;
+class FVertexBuffer;
+
+class FGeometryArena : public GeometryArena {
+public:
+    FGeometryArena(FEngine& engine, const Builder& builder);
+
+    // frees driver resources, object becomes invalid
+    void terminate(FEngine& engine);
+
+    Allocation allocate(uint32_t vertexCount, uint32_t indexCount) noexcept;
+    void free(Allocation const& allocation) noexcept;
+
+    void setVertices(FEngine& engine, Allocation const& allocation, BufferDescriptor&& vertices);
+    void setIndices(FEngine& engine, Allocation const& allocation, BufferDescriptor&& indices,
+            IndexType indexType);
+
+    // Writes count indices of indexType to out, offset by base.
+    static void rebaseIndices(uint32_t* out, void const* indices, size_t count,
+            IndexType indexType, uint32_t base) noexcept;
+
+    uint32_t getVertexStride() const noexcept { return mVertexStride; }
+
+    FVertexBuffer* getVertexBuffer() const noexcept { return mVertexBuffer; }
+    FIndexBuffer* getIndexBuffer() const noexcept { return mIndexBuffer; }
+
+    size_t getFreeVertexCount() const noexcept { return mVertices.getFreeSize(); }
+    size_t getFreeIndexCount() const noexcept { return mIndices.getFreeSize(); }
+
+private:
+    friend class GeometryArena;
+    FVertexBuffer* mVertexBuffer = nullptr;
+    FIndexBuffer* mIndexBuffer = nullptr;
+    RangeAllocator mVertices;
+    RangeAllocator mIndices;
+    uint32_t mVertexStride = 0;
+};
+
+FILAMENT_UPCAST(GeometryArena)
+
+} // namespace details
+} // namespace filament
+
+#endif // TNT_FILAMENT_DETAILS_GEOMETRYARENA_H
@@ -41,6 +41,9 @@ public:
 
     size_t getIndexCount() const noexcept { return mIndexCount; }
 
+    // estimated GPU memory of the buffer
+    size_t getMemorySize() const noexcept { return mMemorySize; }
+
     void setBuffer(FEngine& engine,
             BufferDescriptor&& buffer, uint32_t byteOffset = 0, uint32_t byteSize = 0);
 
@@ -48,6 +51,7 @@ private:
     friend class IndexBuffer;
     Handle<HwIndexBuffer> mHandle;
     uint32_t mIndexCount;
+    size_t mMemorySize = 0;
 };
 
 FILAMENT_UPCAST(IndexBuffer)
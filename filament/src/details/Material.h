@@ -49,6 +49,15 @@ public:
         DefaultMaterialBuilder();
     };
 
+    // Parses and validates a material package, returns nullptr if it can't be used with this
+    // backend and shader model. This doesn't need the engine, so it can run in a job.
+    static filaflat::MaterialParser* parse(driver::Backend backend, ShaderModel shaderModel,
+            const void* payload, size_t size) noexcept;
+
+    // Creates a material from a package returned by parse() and its interface blocks, which
+    // are moved from. Takes ownership of parser.
+    static FMaterial* create(FEngine& engine, filaflat::MaterialParser* parser,
+            UniformInterfaceBlock* uib, SamplerInterfaceBlock* sib);
 
     void terminate(FEngine& engine);
 
@@ -72,6 +81,9 @@ public:
 
     FEngine& getEngine() const noexcept  { return mEngine; }
 
+    // creates the programs of the variants that are needed in most cases ahead of time
+    void prewarm() const noexcept;
+
     Handle<HwProgram> getProgramSlow(uint8_t variantKey) const noexcept;
     Handle<HwProgram> getProgram(uint8_t variantKey) const noexcept {
 
@@ -103,6 +115,7 @@ public:
     bool isDoubleSided() const noexcept { return mDoubleSided; }
     float getMaskThreshold() const noexcept { return mMaskThreshold; }
     bool hasShadowMultiplier() const noexcept { return mHasShadowMultiplier; }
+    bool hasCustomDepthShader() const noexcept { return mHasCustomDepthShader; }
     AttributeBitset getRequiredAttributes() const noexcept { return mRequiredAttributes; }
 
     size_t getParameterCount() const noexcept {
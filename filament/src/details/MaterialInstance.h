@@ -69,6 +69,10 @@ public:
     void setParameter(const char* name,
             Texture const* texture, TextureSampler const& sampler) noexcept;
 
+    // replaces a texture by another one, keeping the sampler parameters. Returns whether this
+    // instance used the texture.
+    bool replaceTexture(Handle<HwTexture> oldHandle, Handle<HwTexture> newHandle) noexcept;
+
     FMaterial const* getMaterial() const noexcept { return mMaterial; }
 
     uint64_t getSortingKey() const noexcept { return mMaterialSortingKey; }
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_DETAILS_MATERIALLOADER_H
+#define TNT_FILAMENT_DETAILS_MATERIALLOADER_H
+
+#include <filament/Material.h>
+
+#include <private/filament/SamplerInterfaceBlock.h>
+#include <private/filament/UniformInterfaceBlock.h>
+
+#include <utils/compiler.h>
+#include <utils/JobSystem.h>
+
+#include <atomic>
+#include <deque>
+
+#include <stddef.h>
+
+namespace filaflat {
+class MaterialParser;
+}
+
+namespace filament {
+namespace details {
+
+class FEngine;
+
+/*
+ * Builds materials asynchronously, for Material::Builder::buildAsync().
+ *
+ * The material package is parsed and validated, and the interface blocks extracted, in a job.
+ * The materials are then created on the engine's thread by publish(), strictly in the order
+ * they were added, so that material ids and callbacks don't depend on the job scheduling.
+ */
+class FMaterialLoader {
+public:
+    explicit FMaterialLoader(FEngine& engine) noexcept;
+    ~FMaterialLoader() noexcept;
+
+    FMaterialLoader(FMaterialLoader const& rhs) = delete;
+    FMaterialLoader& operator=(FMaterialLoader const& rhs) = delete;
+
+    // waits for the jobs in flight and discards all the pending builds
+    void terminate() noexcept;
+
+    bool empty() const noexcept { return mBuilds.empty(); }
+
+    // Starts parsing a material package in a job.
+    void add(const void* payload, size_t size, Material::Builder::BuildCallback callback,
+            void* user, bool prewarm) noexcept;
+
+    // Creates the materials whose job is done, in order, and calls their callbacks. This stops
+    // at the first build still in flight, unless wait is true in which case it waits for all
+    // of them.
+    void publish(bool wait) noexcept;
+
+private:
+    struct Build {
+        utils::JobSystem::Job* job = nullptr;
+        std::atomic<bool> done = { false };
+        filaflat::MaterialParser* parser = nullptr;     // nullptr if the package is invalid
+        UniformInterfaceBlock uib;
+        SamplerInterfaceBlock sib;
+        Material::Builder::BuildCallback callback = nullptr;
+        void* user = nullptr;
+        bool prewarm = false;
+    };
+
+    FEngine& mEngine;
+    std::deque<Build*> mBuilds;     // in the order of add()
+};
+
+} // namespace details
+} // namespace filament
+
+#endif // TNT_FILAMENT_DETAILS_MATERIALLOADER_H
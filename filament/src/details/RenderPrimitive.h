@@ -37,7 +37,7 @@ class FRenderPrimitive {
 public:
     FRenderPrimitive() noexcept = default;
 
-    void init(driver::DriverApi& driver, const RenderableManager::Builder::Entry& entry) noexcept;
+    void init(FEngine& engine, const RenderableManager::Builder::Entry& entry) noexcept;
 
     void set(FEngine& engine, RenderableManager::PrimitiveType type,
             FVertexBuffer* vertices, FIndexBuffer* indices, size_t offset,
@@ -51,6 +51,7 @@ public:
 
     const FMaterialInstance* getMaterialInstance() const noexcept { return mMaterialInstance; }
     Handle<HwRenderPrimitive> getHwHandle() const noexcept { return mHandle; }
+    Handle<HwVertexBuffer> getVertexBufferHandle() const noexcept { return mVertexBuffer; }
     driver::PrimitiveType getPrimitiveType() const noexcept { return mPrimitiveType; }
     AttributeBitset getEnabledAttributes() const noexcept { return mEnabledAttributes; }
     uint16_t getBlendOrder() const noexcept { return mBlendOrder; }
@@ -61,8 +62,14 @@ public:
     }
 
 private:
+    // render primitives with geometry are shared through the engine's RenderPrimitiveCache
+    bool isShared() const noexcept { return bool(mIndexBuffer); }
+    void releaseHandle(FEngine& engine) noexcept;
+
     FMaterialInstance const* mMaterialInstance = nullptr;
     Handle<HwRenderPrimitive> mHandle;
+    Handle<HwVertexBuffer> mVertexBuffer;
+    Handle<HwIndexBuffer> mIndexBuffer;
     driver::PrimitiveType mPrimitiveType = driver::PrimitiveType::NONE;
     AttributeBitset mEnabledAttributes;
     uint16_t mBlendOrder = 0;
@@ -21,6 +21,7 @@
 
 #include "FrameInfo.h"
 #include "RenderPass.h"
+#include "RenderTargetPool.h"
 
 #include "details/Allocators.h"
 #include "details/FrameSkipper.h"
@@ -37,6 +38,8 @@
 #include <utils/JobSystem.h>
 #include <utils/Slice.h>
 
+#include <memory>
+
 namespace filament {
 
 class Driver;
@@ -46,6 +49,7 @@ namespace details {
 
 class FEngine;
 class FView;
+class ShadowAtlas;
 class ShadowMap;
 
 /*
@@ -64,7 +68,12 @@ public:
 
     // do all the work here!
     void render(FView const* view);
+    void render(FView const* const* views, size_t count);
     void renderJob(ArenaScope& arena, FView& view);
+    void prewarm(FView const* view);
+
+    // maximum number of views whose commands are built in parallel by render(views, count)
+    static constexpr size_t MAX_PARALLEL_VIEWS = 4;
 
     void mirrorFrame(FSwapChain* dstSwapChain, Viewport const& dstViewport, Viewport const& srcViewport,
                      MirrorFrameFlag flags);
@@ -84,6 +93,28 @@ private:
     friend class Renderer;
     using Command = RenderPass::Command;
 
+    // The state of a view between the steps of renderJob(). prepareViewPass() and
+    // executeViewPass() use the driver, buildViewPass() doesn't and can run on a job.
+    struct ViewPass {
+        FView* view = nullptr;
+        Viewport vp;
+        Viewport svp;
+        bool hasPostProcess = false;
+        bool useFXAA = false;
+        bool scaled = false;
+        RenderTargetPool::Target const* colorTarget = nullptr;
+        Handle<HwRenderTarget> colorRenderTarget;
+        utils::JobSystem::Job* jobFroxelize = nullptr;
+        Command* commandsBuffer = nullptr;
+        size_t commandsCapacity = 0;
+        utils::Slice<Command> commands;
+    };
+
+    // returns false if the view has nothing to render
+    bool prepareViewPass(ArenaScope& arena, FView& view, ViewPass& pass);
+    void buildViewPass(ViewPass& pass) noexcept;
+    void executeViewPass(ViewPass& pass);
+
     // this class is defined in RenderPass.cpp
     class ColorPass final : public RenderPass {
         using DriverApi = driver::DriverApi;
@@ -96,23 +127,39 @@ private:
     public:
         ColorPass(const char* name, utils::JobSystem& js, utils::JobSystem::Job* jobFroxelize,
                 FView& view, Handle<HwRenderTarget> rth);
-        static void renderColorPass(FEngine& engine,
+        // The color pass is prepared, built and executed in separate steps, so that the
+        // commands of several views can be built in parallel. Only buildColorPass() can run
+        // on a job, the other steps use the driver.
+        static void prepareColorPass(FEngine& engine,
+                FView& view, Viewport const& scaledViewport) noexcept;
+        static driver::RenderPassParams getRenderPassParams(
+                FView const& view, Viewport const& scaledViewport) noexcept;
+        static utils::Slice<Command> buildColorPass(FEngine& engine, utils::JobSystem& js,
+                FView& view, utils::GrowingSlice<Command>& commands) noexcept;
+        static void executeColorPass(FEngine& engine,
                 utils::JobSystem& js, utils::JobSystem::Job* sync,
                 Handle<HwRenderTarget> rth,
                 FView& view, Viewport const& scaledViewport,
-                utils::GrowingSlice<Command>& commands) noexcept;
+                utils::Slice<Command> const& commands) noexcept;
     };
 
     // this class is defined in RenderPass.cpp
     class ShadowPass final : public RenderPass {
         using DriverApi = driver::DriverApi;
-        ShadowMap const& shadowMap;
+        // either shadowMap or shadowAtlas is set
+        ShadowMap const* const shadowMap = nullptr;
+        ShadowAtlas const* const shadowAtlas = nullptr;
+        uint8_t cascade = 0;
+        uint8_t tile = 0;
         void beginRenderPass(driver::DriverApi& driver, Viewport const& viewport, const CameraInfo& camera) noexcept override;
         void endRenderPass(DriverApi& driver, Viewport const& viewport) noexcept override;
     public:
         ShadowPass(const char* name, ShadowMap const& shadowMap) noexcept;
+        ShadowPass(const char* name, ShadowAtlas const& shadowAtlas) noexcept;
         static void renderShadowMap(FEngine& engine, utils::JobSystem& js,
                 FView& view, utils::GrowingSlice<Command>& commands) noexcept;
+        static void renderShadowAtlas(FEngine& engine, utils::JobSystem& js,
+                FView& view, ArenaScope& arena, utils::GrowingSlice<Command>& commands) noexcept;
     };
 
     Handle<HwRenderTarget> getRenderTarget() const noexcept { return mRenderTarget; }
@@ -145,7 +192,9 @@ private:
     Handle<HwRenderTarget> mRenderTarget;
     FSwapChain* mSwapChain = nullptr;
     size_t mCommandsHighWatermark = 0;
+    uint64_t mCommandBytes = 0;     // bytes written to the command buffer as of the last frame
     uint32_t mFrameId = 0;
+
     FrameInfoManager mFrameInfoManager;
     bool mIsRGB16FSupported : 1;
     bool mIsRGB8Supported : 1;
@@ -155,6 +204,10 @@ private:
     // per-frame arena for this Renderer
     LinearAllocatorArena& mPerRenderPassArena;
 
+    // the other views prepared in parallel by render(views, count) each need their own
+    // per-frame arena, they're allocated the first time they're needed.
+    std::unique_ptr<LinearAllocatorArena> mParallelViewArenas[MAX_PARALLEL_VIEWS - 1];
+
 #if EXTRA_TIMING_INFO
     Series<float> mRendering;
     Series<float> mPostProcess;
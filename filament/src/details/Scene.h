@@ -36,6 +36,7 @@
 #include <utils/Range.h>
 
 #include <cstddef>
+#include <vector>
 #include <tsl/robin_set.h>
 
 namespace filament {
@@ -45,6 +46,7 @@ struct CameraInfo;
 class FEngine;
 class FIndirectLight;
 class FRenderer;
+class ShadowAtlas;
 class FSkybox;
 
 
@@ -81,14 +83,16 @@ public:
     ~FScene() noexcept;
     void terminate(FEngine& engine);
 
-    void prepare(const filament::math::mat4f& worldOriginTransform);
-    void prepareDynamicLights(const CameraInfo& camera, ArenaScope& arena, Handle<HwUniformBuffer> lightUbh) noexcept;
-    void computeBounds(Aabb& castersBox, Aabb& receiversBox, uint32_t visibleLayers) const noexcept;
+    FEngine& getEngine() const noexcept { return mEngine; }
 
+    // the world origin used to render this scene, this implements the IBL rotation
+    filament::math::mat4f getWorldOriginTransform() const noexcept;
 
-    filament::Handle<HwUniformBuffer> getRenderableUBO() const noexcept {
-        return mRenderableViewUbh;
-    }
+    void prepare(const filament::math::mat4f& worldOriginTransform);
+    void prepareDynamicLights(const CameraInfo& camera, ArenaScope& arena, Handle<HwUniformBuffer> lightUbh,
+            ShadowAtlas const& shadowAtlas) noexcept;
+
+    void computeBounds(Aabb& castersBox, Aabb& receiversBox, uint32_t visibleLayers) const noexcept;
 
     /*
      * Storage for per-frame renderable data
@@ -98,13 +102,14 @@ public:
         RENDERABLE_INSTANCE,    //  4 instance of the Renderable component
         WORLD_TRANSFORM,        // 16 instance of the Transform component
         VISIBILITY_STATE,       //  1 visibility data of the component
-        BONES_UBH,              //  4 bones uniform buffer handle
+        BONES_OFFSET,           //  4 offset of the bones in the skinning buffer, 0 if none
         WORLD_AABB_CENTER,      // 12 world-space bounding box center of the renderable
         VISIBLE_MASK,           //  1 each bit represents a visibility in a pass
 
         // These are not needed anymore after culling
         LAYERS,                 //  1 layers
         WORLD_AABB_EXTENT,      // 12 world-space bounding box half-extent of the renderable
+        VISIBLE_VIEWS,          //  1 each bit represents a visibility in a view (shared culling)
 
         // These are temporaries and should be stored out of line
         PRIMITIVES,             //  8 level-of-detail'ed primitives
@@ -115,11 +120,12 @@ public:
             utils::EntityInstance<RenderableManager>,
             filament::math::mat4f,
             FRenderableManager::Visibility,
-            Handle<HwUniformBuffer>,
+            uint32_t,
             filament::math::float3,
             Culler::result_type,
             uint8_t,
             filament::math::float3,
+            Culler::result_type,
             utils::Slice<FRenderPrimitive>,
             uint32_t
     >;
@@ -162,15 +168,62 @@ public:
     LightSoa const& getLightData() const noexcept { return mLightData; }
     LightSoa& getLightData() noexcept { return mLightData; }
 
-    void updateUBOs(utils::Range<uint32_t> visibleRenderables, Handle<HwUniformBuffer> renderableUbh) noexcept;
+    // computes the PerRenderableUib of the visible renderables into renderableUniforms, which
+    // belongs to the view, and uploads them to the view's renderableUbh
+    void updateUBOs(utils::Range<uint32_t> visibleRenderables, Handle<HwUniformBuffer> renderableUbh,
+            std::vector<uint8_t>& renderableUniforms) noexcept;
+
+    // returns a UBO large enough to hold the per-instance data of instanceCount instances,
+    // this UBO is used by RenderPass for instanced draws and is updated for each pass.
+    Handle<HwUniformBuffer> prepareInstancesUBO(size_t instanceCount) noexcept;
+
+    // The renderable and instances UBOs are always bound with the size of the whole
+    // ObjectUniforms block, so they need this many bytes of slack after their last entry.
+    static size_t getRenderableUBOSlack() noexcept;
+
+    Handle<HwUniformBuffer> getInstancesUBO() const noexcept {
+        return mInstancesUbh;
+    }
+
+    // bytes of uniform data uploaded for this scene since it was created, View::Stats reports
+    // how much of it was uploaded while the view was rendered
+    uint64_t getUniformBytes() const noexcept { return mUniformBytes; }
+    void addUniformBytes(size_t size) noexcept { mUniformBytes += size; }
+
+    // CPU memory of the renderable and light data, used and allocated
+    size_t getMemoryUsed() const noexcept {
+        return RenderableSoa::getNeededSize(mRenderableData.size()) +
+                LightSoa::getNeededSize(mLightData.size()) +
+                LightSoa::getNeededSize(mSavedLightData.size());
+    }
+    size_t getMemoryReserved() const noexcept {
+        return RenderableSoa::getNeededSize(mRenderableData.capacity()) +
+                LightSoa::getNeededSize(mLightData.capacity()) +
+                LightSoa::getNeededSize(mSavedLightData.capacity());
+    }
+
+    // the skinning buffer, perRenderableBones offsets are relative to it
+    Handle<HwUniformBuffer> getBonesUBO() const noexcept;
+
+    /*
+     * When a scene is prepared once for several views, each view culls and sorts the light
+     * data in place. saveLightData() keeps a copy of the gathered lights that each view
+     * restores with restoreLightData() before doing its own light culling.
+     */
+    void saveLightData() noexcept;
+    void restoreLightData() noexcept;
 
 private:
+    static void copyLightData(LightSoa& dst, LightSoa const& src) noexcept;
+
     static inline void computeLightRanges(filament::math::float2* zrange,
             CameraInfo const& camera, const filament::math::float4* spheres, size_t count) noexcept;
 
     static inline void computeLightCameraPlaneDistances(float* distances,
             const CameraInfo& camera, const filament::math::float4* spheres, size_t count) noexcept;
 
+    void writeRenderableUniforms(void* buffer, size_t offset, uint32_t i) const noexcept;
+
     FEngine& mEngine;
     FSkybox const* mSkybox = nullptr;
     FIndirectLight const* mIndirectLight = nullptr;
@@ -191,7 +244,10 @@ private:
      */
     RenderableSoa mRenderableData;
     LightSoa mLightData;
-    Handle<HwUniformBuffer> mRenderableViewUbh; // This is actually owned by the view.
+    LightSoa mSavedLightData;
+    Handle<HwUniformBuffer> mInstancesUbh;
+    uint32_t mInstancesUBOSize = 0;
+    uint64_t mUniformBytes = 0;
 };
 
 FILAMENT_UPCAST(Scene)
@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_DETAILS_SHADOWATLAS_H
+#define TNT_FILAMENT_DETAILS_SHADOWATLAS_H
+
+#include "components/LightManager.h"
+
+#include "details/Camera.h"
+#include "details/Scene.h"
+
+#include "driver/DriverApiForward.h"
+#include "driver/SamplerBuffer.h"
+
+#include <filament/EngineEnums.h>
+#include <filament/Viewport.h>
+
+#include <math/mat4.h>
+#include <math/vec4.h>
+
+#include <array>
+#include <vector>
+
+#include <stdint.h>
+
+namespace filament {
+namespace details {
+
+/*
+ * A quadtree allocator of square, power-of-two tiles in a square texture.
+ *
+ * Each node of the tree is a tile, its 4 children are its quadrants. Allocating tiles from the
+ * largest to the smallest packs them without any wasted space.
+ */
+class ShadowAtlasAllocator {
+public:
+    struct Tile {
+        uint16_t x = 0;
+        uint16_t y = 0;
+        uint16_t size = 0; // 0 for an invalid tile
+        bool isValid() const noexcept { return size != 0; }
+        bool operator==(Tile const& rhs) const noexcept {
+            return x == rhs.x && y == rhs.y && size == rhs.size;
+        }
+    };
+
+    // dimension and minTileSize must be powers of two
+    ShadowAtlasAllocator(uint32_t dimension, uint32_t minTileSize) noexcept;
+
+    uint32_t getDimension() const noexcept { return mDimension; }
+    uint32_t getMinTileSize() const noexcept { return mDimension >> (mLevelCount - 1u); }
+
+    // frees all the tiles
+    void clear() noexcept;
+
+    // Allocates a tile of the given size, which must be a power of two between getMinTileSize()
+    // and getDimension(). Returns an invalid tile if there is no room left.
+    Tile allocate(uint32_t size) noexcept;
+
+    // Allocates the given tile, typically the one used in the previous frame. Returns false if
+    // it overlaps a tile that's already allocated.
+    bool allocate(Tile tile) noexcept;
+
+    // Frees a tile returned by allocate()
+    void free(Tile tile) noexcept;
+
+private:
+    enum class State : uint8_t {
+        FREE,       // neither this tile nor its children are allocated
+        PARTIAL,    // some of the children are allocated
+        USED        // this tile is allocated
+    };
+
+    // the nodes of each level are stored in row-major order, after all the nodes of the
+    // levels above.
+    static size_t getNodeIndex(size_t level, uint32_t i, uint32_t j) noexcept {
+        return ((size_t(1) << (2u * level)) - 1u) / 3u + (size_t(j) << level) + i;
+    }
+
+    size_t getLevel(uint32_t size) const noexcept;
+
+    Tile allocate(size_t level, uint32_t i, uint32_t j, size_t targetLevel) noexcept;
+
+    std::vector<State> mNodes;
+    uint32_t mDimension;
+    uint8_t mLevelCount;
+};
+
+/*
+ * The shadow maps of the spot and point lights, stored as tiles of a single depth texture.
+ *
+ * Each frame, the visible shadow-casting spot and point lights are given a tile size based on
+ * how large they appear on screen, and are packed in the atlas, most important first. A spot
+ * light uses one tile, a point light uses 6 tiles, one per face of a cube. Lights keep their
+ * tiles from one frame to the next when their size doesn't change.
+ */
+class ShadowAtlas {
+public:
+    static constexpr uint32_t DIMENSION = 2048;
+    static constexpr uint32_t MIN_TILE_SIZE = 64;
+
+    struct Tile {
+        ShadowAtlasAllocator::Tile rect;
+        CameraInfo camera;                      // the light's camera for this tile
+        Frustum frustum;                        // used to cull the shadow casters of this tile
+        filament::math::mat4f lightSpace;       // world space to atlas texture coordinates
+        filament::math::float4 bias;            // constant bias, normal bias per meter, 0, 0
+    };
+
+    explicit ShadowAtlas(FEngine& engine) noexcept;
+
+    void terminate(driver::DriverApi& driverApi) noexcept;
+
+    // Picks the spot and point lights that have a shadow this frame, allocates their tiles and
+    // computes their cameras. lightData must only contain the visible lights.
+    void update(FLightManager const& lcm, FScene::LightSoa const& lightData,
+            CameraInfo const& camera, filament::Viewport const& viewport) noexcept;
+
+    // Allocates the texture if needed. Valid after update().
+    void prepare(driver::DriverApi& driver, SamplerBuffer& sb) noexcept;
+
+    bool hasShadows() const noexcept { return mTileCount > 0; }
+
+    size_t getTileCount() const noexcept { return mTileCount; }
+
+    Tile const& getTile(size_t tile) const noexcept { return mTiles[tile]; }
+
+    // Returns the index of the first tile of this light plus one, or 0 if it has no shadow.
+    uint32_t getShadowIndex(FLightManager::Instance light) const noexcept;
+
+    // Returns the viewport of a tile, it has a 1-texel border.
+    filament::Viewport getViewport(size_t tile) const noexcept;
+
+    // Set-up the render target, call before rendering each tile. The first tile clears the
+    // whole atlas.
+    void beginRenderPass(driver::DriverApi& driver, size_t tile) const noexcept;
+
+    // Returns the size of the tile to use for a light of the given radius, seen from the given
+    // distance, with the given projection and viewport height. The size is a power of two
+    // between MIN_TILE_SIZE and maxSize (or MIN_TILE_SIZE if maxSize is smaller). Also returns the light's projected size in pixels,
+    // used to sort the lights by importance.
+    static uint32_t computeTileSize(float radius, float distance, float projectionScale,
+            float viewportHeight, uint32_t maxSize, float* importance = nullptr) noexcept;
+
+private:
+    struct ShadowedLight {
+        FLightManager::Instance instance;
+        uint8_t firstTile;
+        uint8_t tileCount;
+    };
+
+    void computeTile(Tile& tile, filament::math::float3 const& position,
+            filament::math::float3 const& direction, float fov, float radius,
+            FLightManager::ShadowParams const& params) noexcept;
+
+    ShadowAtlasAllocator mAllocator;
+    std::array<Tile, CONFIG_MAX_SHADOW_TILES> mTiles;
+    std::vector<ShadowedLight> mLights;
+    size_t mTileCount = 0;
+
+    // the tiles of the previous frame, to keep them when possible
+    std::vector<ShadowedLight> mPreviousLights;
+    std::array<ShadowAtlasAllocator::Tile, CONFIG_MAX_SHADOW_TILES> mPreviousTiles;
+
+    Handle<HwTexture> mTexture;
+    Handle<HwRenderTarget> mRenderTarget;
+
+    const bool mClipSpaceFlipped;
+};
+
+} // namespace details
+} // namespace filament
+
+#endif // TNT_FILAMENT_DETAILS_SHADOWATLAS_H
@@ -25,11 +25,14 @@
 #include "driver/DriverApiForward.h"
 #include "driver/SamplerBuffer.h"
 
+#include <filament/EngineEnums.h>
 #include <filament/Viewport.h>
 
 #include <math/mat4.h>
 #include <math/vec4.h>
 
+#include <array>
+
 namespace filament {
 namespace details {
 
@@ -41,40 +44,76 @@ public:
     void terminate(driver::DriverApi& driverApi) noexcept;
 
     // Call once per frame if the light, scene (or visible layers) or camera changes.
-    // This computes the light's camera.
+    // This computes the scene bounds and the cascades' depth ranges, updateCascade() must then
+    // be called for each cascade.
     void update(
             const FScene::LightSoa& lightData, size_t index, FScene const* scene,
             details::CameraInfo const& camera, uint8_t visibleLayers) noexcept;
 
-    // Do we have visible shadows. Valid after calling update().
+    // Computes the light's camera of the given cascade. Valid after calling update().
+    // This can be called concurrently for different cascades.
+    void updateCascade(size_t cascade) noexcept;
+
+    // Call after updateCascade() was called for all cascades.
+    void resolveVisibility() noexcept;
+
+    // Do we have visible shadows. Valid after calling resolveVisibility().
     bool hasVisibleShadows() const noexcept { return mHasVisibleShadows; }
 
+    // Number of cascades. Valid after calling update().
+    size_t getCascadeCount() const noexcept { return mCascadeCount; }
+
+    // Whether this cascade has anything to render. Valid after calling updateCascade().
+    bool isCascadeVisible(size_t cascade) const noexcept { return mCascades[cascade].visible; }
+
+    // Distance from the camera at which this cascade ends. Valid after calling update().
+    float getCascadeSplit(size_t cascade) const noexcept { return mSplits[cascade + 1]; }
+
     // Allocates shadow texture based on user parameters (e.g. dimensions)
     void prepare(driver::DriverApi& driver, SamplerBuffer& buffer) noexcept;
 
-    // Returns the shadow map's viewport. Valid after prepare().
-    Viewport const& getViewport() const noexcept { return mViewport; }
+    // Returns the viewport of a cascade in the shadow map texture. Valid after prepare().
+    Viewport getViewport(size_t cascade) const noexcept;
 
     // Computes the transform to use in the shader to access the shadow map.
-    // Valid after calling update().
-    filament::math::mat4f const& getLightSpaceMatrix() const noexcept { return mLightSpace; }
+    // Valid after calling updateCascade().
+    filament::math::mat4f const& getLightSpaceMatrix(size_t cascade) const noexcept {
+        return mCascades[cascade].lightSpace;
+    }
 
     // return the size of a texel in world space (pre-warping)
-    float getTexelSizeWorldSpace() const noexcept { return mTexelSizeWs; }
+    float getTexelSizeWorldSpace(size_t cascade) const noexcept {
+        return mCascades[cascade].texelSizeWs;
+    }
+
+    // Returns the shadow map's depth range. Valid after calling updateCascade().
+    float getSceneRange(size_t cascade) const noexcept { return mCascades[cascade].sceneRange; }
 
-    // Returns the shadow map's depth range. Valid after init().
-    float getSceneRange() const noexcept { return mSceneRange; }
+    // Returns the light's projection. Valid after calling updateCascade().
+    FCamera const& getCamera(size_t cascade) const noexcept { return *mCascades[cascade].camera; }
 
-    // Returns the light's projection. Valid after calling update().
-    FCamera const& getCamera() const noexcept { return *mCamera; }
+    // Set-up the render target, call before rendering each cascade of the shadow map.
+    void beginRenderPass(driver::DriverApi& driverApi, size_t cascade) const noexcept;
 
-    // Set-up the render target, call before rendering the shadow map.
-    void beginRenderPass(driver::DriverApi& driverApi) const noexcept;
+    // Decides whether the shadow map needs to be rendered this frame. Its content only depends
+    // on the cascades' light-space transforms and on the shadow casters, so it's kept from the
+    // previous frame when none of them changed. castersHash is a hash of the shadow casters'
+    // state, or 0 if it can't be tracked. Call once per frame, after prepare().
+    bool updateCache(uint32_t castersHash) noexcept;
 
     // use only for debugging
     FCamera const& getDebugCamera() const noexcept { return *mDebugCamera; }
 
+    // Computes the distances from the camera at which each cascade starts and ends, i.e.
+    // cascadeCount + 1 values, from near to far. splitPositions are the cascadeCount - 1 split
+    // positions expressed as fractions of the [near, far] range.
+    static void computeCascadeSplits(float* splits, size_t cascadeCount,
+            float const* splitPositions, float near, float far) noexcept;
+
 private:
+    // The cascades are laid out in a single row, whose width can't exceed this.
+    static constexpr uint32_t MAX_TEXTURE_WIDTH = 4096;
+
     struct CameraInfo {
         filament::math::mat4f projection;
         filament::math::mat4f model;
@@ -104,9 +143,22 @@ private:
     // 8 corners, 12 segments w/ 2 intersection max -- all of this twice (8 + 12 * 2) * 2 (768 bytes)
     using FrustumBoxIntersection = std::array<filament::math::float3, 64>;
 
-    void computeShadowCameraDirectional(
-            filament::math::float3 const& direction, FScene const* scene, CameraInfo const& camera,
-            uint8_t visibleLayers) noexcept;
+    struct Cascade {
+        FCamera* camera = nullptr;
+        filament::math::mat4f lightSpace;
+        float sceneRange = 0.0f;
+        float texelSizeWs = 0.0f;
+        bool visible = false;
+        // use a member here (instead of stack) because we don't want to pay the
+        // initialization of the float3 each time
+        FrustumBoxIntersection wsClippedShadowReceiverVolume;
+    };
+
+    void computeShadowCameraDirectional(Cascade& cascade, size_t index,
+            CameraInfo const& camera, bool useLispsm) noexcept;
+
+    static filament::math::mat4f setNearFar(filament::math::mat4f projection,
+            float n, float f) noexcept;
 
     static filament::math::mat4f applyLISPSM(
             CameraInfo const& camera, float dzn, float dzf, const filament::math::mat4f& LMpMv,
@@ -167,24 +219,28 @@ private:
             { 2, 6, 7, 3 },  // top
     };
 
-    FCamera* mCamera = nullptr;
     FCamera* mDebugCamera = nullptr;
-    filament::math::mat4f mLightSpace;
-    float mSceneRange = 0.0f;
-    float mTexelSizeWs = 0.0f;
+    std::array<Cascade, CONFIG_MAX_SHADOW_CASCADES> mCascades;
 
     // set-up in prepare()
-    Viewport mViewport;
     Handle<HwTexture> mShadowMapHandle;
     Handle<HwRenderTarget> mShadowMapRenderTarget;
+    uint32_t mTextureDimension = 0;
+    uint8_t mTextureCascadeCount = 0;
 
     // set-up in update()
     uint32_t mShadowMapDimension = 0;
+    uint8_t mCascadeCount = 1;
     bool mHasVisibleShadows = false;
-
-    // use a member here (instead of stack) because we don't want to pay the
-    // initialization of the float3 each time
-    FrustumBoxIntersection mWsClippedShadowReceiverVolume;
+    CameraInfo mCameraInfo;
+    filament::math::float3 mLightDirection;
+    Aabb mWsShadowCastersVolume;
+    Aabb mWsShadowReceiversVolume;
+    float mSplits[CONFIG_MAX_SHADOW_CASCADES + 1] = {};
+
+    // set-up in updateCache()
+    uint32_t mContentHash = 0;
+    bool mContentValid = false;
 
     FEngine& mEngine;
     const bool mClipSpaceFlipped;
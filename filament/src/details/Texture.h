@@ -72,8 +72,26 @@ public:
 
     FStream const* getStream() const noexcept { return mStream; }
 
+    void setStreamingSource(FEngine& engine, StreamingSource* source, float uvDensity) noexcept;
+
+    bool isStreamed() const noexcept { return mStreamed; }
+
+    // first level held by the hardware texture, only streamed textures don't hold all levels
+    uint8_t getBaseLevel() const noexcept { return mBaseLevel; }
+
+    // Re-creates the hardware texture with the levels starting at baseLevel, and uploads
+    // them. levels holds the images of all these levels. Used by FTextureStreamer.
+    void setResidentLevels(FEngine& engine, uint8_t baseLevel,
+            PixelBufferDescriptor* levels) noexcept;
+
     static size_t getFormatSize(InternalFormat format) noexcept;
 
+    // estimated size of a level of width x height texels, including compressed formats
+    static size_t getLevelSize(InternalFormat format, size_t width, size_t height) noexcept;
+
+    // estimated GPU memory used by the levels held by the hardware texture
+    size_t getMemorySize() const noexcept;
+
 private:
     friend class Texture;
     Handle<HwTexture> mHandle;
@@ -85,6 +103,9 @@ private:
     Sampler mTarget = Sampler::SAMPLER_2D;
     uint8_t mLevels = 1;
     uint8_t mSampleCount = 1;
+    uint8_t mBaseLevel = 0;
+    bool mStreamed = false;
+
     FStream* mStream = nullptr;
     Usage mUsage = Usage::DEFAULT;
 };
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_DETAILS_TEXTURESTREAMER_H
+#define TNT_FILAMENT_DETAILS_TEXTURESTREAMER_H
+
+#include "driver/Handle.h"
+
+#include <filament/Texture.h>
+
+#include <utils/compiler.h>
+#include <utils/JobSystem.h>
+
+#include <tsl/robin_map.h>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace filament {
+namespace details {
+
+class FEngine;
+class FTexture;
+
+/*
+ * Keeps the mip levels of the streamed textures that are needed on screen resident, within a
+ * memory budget.
+ *
+ * A streamed texture starts with only its coarsest levels resident. Each frame, the views
+ * report how large the renderables using it are on screen, which gives the finest level that's
+ * needed. Finer levels are then loaded from the texture's StreamingSource in a job, and the
+ * texture is re-created with the new levels once they're ready. When the budget is exceeded,
+ * the least recently used textures are brought back to their coarsest levels.
+ *
+ * The GPU texture only holds the resident levels, so a change of resident levels re-creates it
+ * and re-uploads all its levels. The coarse levels are small, so this is cheap compared to the
+ * level being added.
+ */
+class FTextureStreamer {
+public:
+    // default memory budget of the streamed textures
+    static constexpr size_t DEFAULT_BUDGET = 256u * 1024u * 1024u;
+
+    // the coarsest level of a streamed texture is the first one no larger than this
+    static constexpr uint32_t MIN_RESIDENT_SIZE = 64;
+
+    // maximum number of textures being loaded at the same time
+    static constexpr size_t MAX_LOADS = 4;
+
+    static constexpr size_t MAX_LEVELS = 16;
+
+    // A change of the resident levels of a texture, in flight
+    struct Load {
+        utils::JobSystem::Job* job = nullptr;
+        std::atomic<bool> done = { false };
+        uint8_t baseLevel = 0;
+        std::vector<Texture::PixelBufferDescriptor> levels; // from baseLevel to the last level
+    };
+
+    struct Record {
+        FTexture* texture = nullptr;
+        Texture::StreamingSource* source = nullptr;
+        Load* load = nullptr;
+        float uvDensity = 1.0f;
+        float pixels = 0.0f;        // largest on-screen size requested this frame
+        uint32_t lastUsed = 0;      // last frame this texture was requested
+        uint8_t levels = 0;         // number of levels of the texture
+        uint8_t baseLevel = 0;      // first resident level
+        uint8_t coarsestLevel = 0;  // the resident levels never start after this one
+        uint8_t targetLevel = 0;    // level needed on screen, valid for the frame of lastUsed
+        uint32_t width = 1;         // size of level 0
+        uint32_t height = 1;
+        uint64_t tailSize[MAX_LEVELS + 1] = {}; // size of the levels from index to the last one
+
+        // size of the resident levels, or of the levels being loaded
+        size_t getCommittedSize() const noexcept {
+            return size_t(tailSize[load ? load->baseLevel : baseLevel]);
+        }
+    };
+
+    // a texture and the level it should start at
+    struct Change {
+        size_t index;
+        uint8_t baseLevel;
+    };
+
+    explicit FTextureStreamer(FEngine& engine) noexcept;
+    ~FTextureStreamer() noexcept;
+
+    FTextureStreamer(FTextureStreamer const& rhs) = delete;
+    FTextureStreamer& operator=(FTextureStreamer const& rhs) = delete;
+
+    void terminate() noexcept;
+
+    void setBudget(size_t bytes) noexcept { mBudget = bytes; }
+    size_t getBudget() const noexcept { return mBudget; }
+
+    // size of the resident levels of all the streamed textures
+    size_t getResidentSize() const noexcept;
+
+    bool empty() const noexcept { return mRecords.empty(); }
+
+    // Starts streaming a texture, its coarsest levels are uploaded right away. Takes
+    // ownership of source.
+    void add(FTexture* texture, Texture::StreamingSource* source, float uvDensity) noexcept;
+
+    // Stops streaming a texture, this waits for its load in flight if any and destroys its
+    // source.
+    void remove(FTexture const* texture) noexcept;
+
+    // Records that the texture with this handle is used by a renderable that's this many
+    // pixels across on screen. Called by FView::prepare() for the visible renderables.
+    void request(Handle<HwTexture> handle, float pixels) noexcept {
+        auto pos = mHandles.find(handle.getId());
+        if (UTILS_UNLIKELY(pos != mHandles.end())) {
+            Record& record = mRecords[pos->second];
+            record.pixels = std::max(record.pixels, pixels);
+            record.lastUsed = mFrame;
+        }
+    }
+
+    // Called once per frame, before the material instances are committed. Applies the loads
+    // that finished, and starts new ones based on the requests since the last call.
+    void update() noexcept;
+
+    // Returns the finest level needed to draw a texture of the given size on a renderable
+    // that's this many pixels across on screen. uvDensity is how many times the texture
+    // repeats across the renderable.
+    static uint8_t computeLevel(uint32_t width, uint32_t height, float uvDensity, float pixels,
+            uint8_t levels) noexcept;
+
+    // Picks the loads and evictions to do given the requests of the current frame. Loads are
+    // ordered by on-screen size, evictions by last use; nothing is loaded past the budget.
+    static void schedule(Record* records, size_t count, size_t budget, uint32_t frame,
+            size_t maxLoads, std::vector<Change>& changes) noexcept;
+
+private:
+    void startLoad(Record& record, uint8_t baseLevel) noexcept;
+    void finishLoad(Record& record) noexcept;
+
+    FEngine& mEngine;
+    std::vector<Record> mRecords;
+    tsl::robin_map<HandleBase::HandleId, uint32_t> mHandles;  // texture handle to record
+    std::vector<Change> mChanges;
+    size_t mBudget = DEFAULT_BUDGET;
+    uint32_t mFrame = 1;
+};
+
+} // namespace details
+} // namespace filament
+
+#endif // TNT_FILAMENT_DETAILS_TEXTURESTREAMER_H
@@ -49,6 +49,9 @@ public:
         return mDeclaredAttributes;
     }
 
+    // estimated GPU memory of the buffers
+    size_t getMemorySize() const noexcept { return mMemorySize; }
+
     // no-op if bufferIndex out of range
     void setBufferAt(FEngine& engine, uint8_t bufferIndex,
             driver::BufferDescriptor&& buffer,
@@ -62,6 +65,7 @@ private:
     AttributeBitset mDeclaredAttributes;
     uint32_t mVertexCount = 0;
     uint8_t mBufferCount = 0;
+    size_t mMemorySize = 0;
 };
 
 FILAMENT_UPCAST(VertexBuffer)
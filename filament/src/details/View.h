@@ -18,6 +18,7 @@
 #define TNT_FILAMENT_DETAILS_VIEW_H
 
 #include <filament/View.h>
+#include <filament/Renderer.h>
 
 #include "upcast.h"
 
@@ -28,6 +29,7 @@
 #include "details/Froxelizer.h"
 #include "details/ShadowMap.h"
 #include "details/Scene.h"
+#include "details/ShadowAtlas.h"
 
 #include "driver/DriverApi.h"
 #include "driver/Handle.h"
@@ -39,6 +41,7 @@
 #include <utils/Range.h>
 
 #include <array>
+#include <vector>
 
 namespace utils {
 class JobSystem;
@@ -56,6 +59,20 @@ class FView : public View {
 public:
     using Range = utils::Range<uint32_t>;
 
+    // values of the 'VISIBLE_MASK' after culling (0: not visible)
+    static constexpr size_t VISIBLE_RENDERABLE_BIT = 0u;
+    static constexpr size_t VISIBLE_SHADOW_CASTER_BIT = 1u;
+    // first of the CONFIG_MAX_SHADOW_CASCADES bits telling in which cascades a caster is visible
+    static constexpr size_t VISIBLE_CASCADE_BIT = 2u;
+    static constexpr uint8_t VISIBLE_RENDERABLE = 1u << VISIBLE_RENDERABLE_BIT;
+    static constexpr uint8_t VISIBLE_SHADOW_CASTER = 1u << VISIBLE_SHADOW_CASTER_BIT;
+    static constexpr uint8_t VISIBLE_ALL = VISIBLE_RENDERABLE | VISIBLE_SHADOW_CASTER;
+    static constexpr uint8_t VISIBLE_CASCADES =
+            ((1u << CONFIG_MAX_SHADOW_CASCADES) - 1u) << VISIBLE_CASCADE_BIT;
+
+    static_assert(VISIBLE_CASCADE_BIT + CONFIG_MAX_SHADOW_CASCADES <= 8,
+            "the cascades visibility bits must fit in the 8-bits culling mask");
+
     explicit FView(FEngine& engine);
     ~FView() noexcept;
 
@@ -64,6 +81,47 @@ public:
     void prepare(FEngine& engine, driver::DriverApi& driver, ArenaScope& arena,
             Viewport const& viewport, filament::math::float4 const& userTime) noexcept;
 
+    // frustum used to cull this view, in the world space of the scene
+    Frustum computeCullingFrustum(filament::math::mat4f const& worldOriginScene) const noexcept;
+
+    // Set by FRenderer when the scene was prepared and culled once for several views, in which
+    // case prepare() doesn't do it again. This is the view's bit in FScene::VISIBLE_VIEWS,
+    // or -1 when this view prepares its scene itself.
+    void setSharedCullingIndex(int8_t index) noexcept { mSharedCullingIndex = index; }
+    int8_t getSharedCullingIndex() const noexcept { return mSharedCullingIndex; }
+
+    // Merges the results of culling the shadow casters against each cascade into visibleMask.
+    // cascadeMasks[c] holds the bit VISIBLE_CASCADE_BIT + c for the casters visible in cascade c.
+    // This sets the cascade bits and the VISIBLE_SHADOW_CASTER bit if any of them is set.
+    static void mergeCascadeVisibility(uint8_t* visibleMask,
+            uint8_t const* const* cascadeMasks, size_t cascadeCount, size_t count) noexcept;
+
+    // Computes a hash of the state of the shadow casters in range that affects the shadow map:
+    // transforms, cascades visibility and primitives. It doesn't depend on the order of the
+    // casters. Returns 0 if the state can't be tracked, which is the case of skinned casters.
+    static uint32_t hashShadowCasters(FRenderableManager const& rcm,
+            FScene::RenderableSoa const& renderableData, Range range) noexcept;
+
+    // Culls count objects (a multiple of Culler::MODULO) against the frusta of the shadow atlas
+    // tiles, and sets the VISIBLE_SHADOW_CASTER bit of the ones visible in any tile.
+    static void cullShadowAtlasCasters(uint8_t* visibleMask,
+            Frustum const* frusta, size_t tileCount,
+            filament::math::float3 const* center, filament::math::float3 const* extent,
+            size_t count) noexcept;
+
+    // Culls the shadow casters in range against the frustum of a single shadow atlas tile.
+    // This sets the bit VISIBLE_CASCADE_BIT of the casters visible in the tile, and clears
+    // their other cascade bits, so that the tile can be rendered like a one-cascade shadow map.
+    static void cullShadowAtlasTile(uint8_t* visibleMask,
+            FRenderableManager::Visibility const* visibility, Frustum const& frustum,
+            filament::math::float3 const* center, filament::math::float3 const* extent,
+            Range range) noexcept;
+
+    // cull the renderables against several views at once (sets the VISIBLE_VIEWS bits)
+    static void cullRenderablesForViews(utils::JobSystem& js,
+            FScene::RenderableSoa& renderableData,
+            Frustum const* frusta, size_t frustumCount) noexcept;
+
     void setScene(FScene* scene) { mScene = scene; }
     FScene const* getScene() const noexcept { return mScene; }
     FScene* getScene() noexcept { return mScene; }
@@ -118,7 +176,7 @@ public:
     }
 
     void prepareCamera(const CameraInfo& camera, const Viewport& viewport) const noexcept;
-    void prepareShadowing(FEngine& engine, driver::DriverApi& driver,
+    void prepareShadowing(FEngine& engine, driver::DriverApi& driver, ArenaScope& arena,
             FScene::RenderableSoa& renderableData, FScene::LightSoa const& lightData) noexcept;
     void prepareLighting(
             FEngine& engine, FEngine::DriverApi& driver, ArenaScope& arena, Viewport const& viewport) noexcept;
@@ -129,6 +187,10 @@ public:
     bool hasDirectionalLight() const noexcept { return mHasDirectionalLight; }
     bool hasDynamicLighting() const noexcept { return mHasDynamicLighting; }
     bool hasShadowing() const noexcept { return mHasShadowing & mDirectionalShadowMap.hasVisibleShadows(); }
+    bool hasShadowAtlas() const noexcept { return mHasShadowAtlas; }
+
+    // whether the shadow map kept from the previous frame is out of date
+    bool needsShadowMapRendering() const noexcept { return mNeedsShadowMapRendering; }
 
     void updatePrimitivesLod(
             FEngine& engine, const CameraInfo& camera,
@@ -138,6 +200,13 @@ public:
 
     ShadowMap const& getShadowMap() const { return mDirectionalShadowMap; }
 
+    ShadowAtlas const& getShadowAtlas() const { return mShadowAtlas; }
+
+    // Selects the shadow casters of a tile of the shadow atlas, before rendering it. This
+    // writes the visibility of the shadow casters in the tile to visibleMask, which is indexed
+    // like the renderable data. Can be called concurrently for different tiles.
+    void prepareShadowAtlasTile(size_t tile, uint8_t* visibleMask) const noexcept;
+
     FCamera const* getDirectionalLightCamera() const noexcept {
         return &mDirectionalShadowMap.getDebugCamera();
     }
@@ -214,17 +283,58 @@ public:
         return mVisibleShadowCasters;
     }
 
+    // The renderable data the commands of this view are built from. This is the scene's data,
+    // unless detachRenderableData() copied it, which the renderer does when another view
+    // sorts the same scene before the commands of this one are built.
+    FScene::RenderableSoa& getRenderableData() noexcept {
+        return mRenderableDataDetached ? mRenderableData : mScene->getRenderableData();
+    }
+    void detachRenderableData() noexcept;
+
+    Handle<HwUniformBuffer> getRenderableUBO() const noexcept { return mRenderableUbh; }
+
+    // copies the PerRenderableUib of renderable i, as computed by the last prepare(),
+    // at the given offset in buffer
+    void copyRenderableUniforms(void* buffer, size_t offset, uint32_t i) const noexcept;
+
     FCamera& getCameraUser() noexcept { return *mCullingCamera; }
     void setCameraUser(FCamera* camera) noexcept { setCullingCamera(camera); }
 
+    // Statistics are collected between beginStats() and endStats(), which publishes them.
+    // beginStats() does nothing if it was already called for this frame, so that the
+    // renderer can start them before preparing a scene shared by several views.
+    void beginStats(FEngine& engine) noexcept;
+    void endStats(FEngine& engine) noexcept;
+
+    // Excludes the work done between pauseStats() and resumeStats() from the statistics,
+    // e.g. while other views are rendered.
+    void pauseStats(FEngine& engine) noexcept;
+    void resumeStats(FEngine& engine) noexcept;
+
+    // statistics of the frame being rendered
+    View::Stats& getCurrentStats() const noexcept { return mStats; }
+
+    // statistics of the last frame rendered
+    View::Stats const& getStats() const noexcept { return mLastStats; }
+
 private:
     static constexpr size_t MAX_FRAMETIME_HISTORY = 32u;
 
     void prepareVisibleRenderables(utils::JobSystem& js,
             Frustum const& frustum, FScene::RenderableSoa& renderableData) const noexcept;
 
-    static void prepareVisibleShadowCasters(utils::JobSystem& js,
-            Frustum const& lightFrustum, FScene::RenderableSoa& renderableData) noexcept;
+    void prepareSharedVisibleRenderables(FScene::RenderableSoa& renderableData) const noexcept;
+
+    static void prepareVisibleShadowCasters(utils::JobSystem& js, ArenaScope& arena,
+            ShadowMap& shadowMap, FScene::RenderableSoa& renderableData) noexcept;
+
+    void prepareShadowAtlas(FEngine& engine, driver::DriverApi& driver,
+            FScene::RenderableSoa& renderableData, FScene::LightSoa const& lightData,
+            filament::Viewport const& viewport) noexcept;
+
+    // tells the texture streamer how large the visible renderables are on screen
+    void prepareTextureStreaming(FEngine& engine, FScene::RenderableSoa const& renderableData,
+            filament::Viewport const& viewport) const noexcept;
 
     static void prepareVisibleLights(
             FLightManager const& lcm, utils::JobSystem& js, Frustum const& frustum,
@@ -271,6 +381,7 @@ private:
     Viewport mViewport;
     LinearColorA mClearColor;
     bool mCulling = true;
+    int8_t mSharedCullingIndex = -1;
     bool mFrontFaceWindingInverted = false;
     bool mClearTargetColor = true;
     bool mClearTargetDepth = true;
@@ -309,7 +420,27 @@ private:
     mutable bool mHasDirectionalLight = false;
     mutable bool mHasDynamicLighting = false;
     mutable bool mHasShadowing = false;
+    bool mNeedsShadowMapRendering = true;
+    bool mHasShadowAtlas = false;
+    bool mRenderableDataDetached = false;
+    // CPU copy of the renderable UBO, so instanced draws don't recompute the transforms
+    std::vector<uint8_t> mRenderableUniforms;
+    FScene::RenderableSoa mRenderableData;
+
     mutable ShadowMap mDirectionalShadowMap;
+    mutable ShadowAtlas mShadowAtlas;
+
+    // counters sampled by beginStats() and resumeStats(), their differences are accumulated
+    // by pauseStats() and endStats()
+    struct StatsSnapshot {
+        uint64_t cpuTime[Renderer::CPU_STAGE_COUNT];
+        uint64_t commandBytes;
+        uint64_t uniformBytes;
+    };
+    mutable View::Stats mStats;
+    View::Stats mLastStats;
+    StatsSnapshot mStatsStart = {};
+    bool mStatsStarted = false;
 };
 
 FILAMENT_UPCAST(View)
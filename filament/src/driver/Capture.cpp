@@ -0,0 +1,387 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "driver/Capture.h"
+
+#include <utility>
+
+namespace filament {
+namespace capture {
+
+using namespace driver;
+using namespace utils;
+
+// ------------------------------------------------------------------------------------------------
+// Writer
+// ------------------------------------------------------------------------------------------------
+
+Writer::Writer(std::ofstream&& file) noexcept : mFile(std::move(file)) {
+    Header header;
+    mFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    mOffset = sizeof(header);
+}
+
+void Writer::writeBytes(void const* data, size_t size) noexcept {
+    const size_t offset = mData.size();
+    mData.resize(offset + size);
+    memcpy(mData.data() + offset, data, size);
+}
+
+void Writer::writeRecord(Command command) noexcept {
+    RecordHeader header{ command, uint32_t(mData.size()) };
+    mFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    mFile.write(mData.data(), mData.size());
+    mOffset += sizeof(header) + mData.size();
+}
+
+void Writer::write(const char* const& string) noexcept {
+    const uint32_t length = string ? uint32_t(strlen(string)) : 0u;
+    write(length);
+    writeBytes(string, length);
+    write('\0');
+}
+
+void Writer::write(CString const& string) noexcept {
+    const uint32_t length = uint32_t(string.size());
+    write(length);
+    writeBytes(string.c_str(), length);
+    write('\0');
+}
+
+void Writer::write(BufferDescriptor const& buffer) noexcept {
+    write(uint64_t(buffer.size));
+    // the content is aligned in the file, so that the replay can use it in place
+    const uint64_t offset = mDataOffset + mData.size();
+    const uint64_t padding = (BUFFER_ALIGNMENT - offset % BUFFER_ALIGNMENT) % BUFFER_ALIGNMENT;
+    mData.resize(mData.size() + padding);
+    if (buffer.buffer) {
+        writeBytes(buffer.buffer, buffer.size);
+    } else {
+        mData.resize(mData.size() + buffer.size);
+    }
+}
+
+void Writer::write(PixelBufferDescriptor const& buffer) noexcept {
+    write(static_cast<BufferDescriptor const&>(buffer));
+    write(buffer.left);
+    write(buffer.top);
+    write(PixelDataType(buffer.type));
+    write(uint8_t(buffer.alignment));
+    if (buffer.type == PixelDataType::COMPRESSED) {
+        write(buffer.imageSize);
+        write(buffer.compressedFormat);
+    } else {
+        write(buffer.stride);
+        write(buffer.format);
+    }
+}
+
+void Writer::write(FaceOffsets const& offsets) noexcept {
+    for (size_t offset : offsets.offsets) {
+        write(offset);
+    }
+}
+
+void Writer::write(Driver::TargetBufferInfo const& info) noexcept {
+    write(info.handle);
+    write(info.level);
+    write(info.layer);  // this is also the face
+}
+
+void Writer::write(Driver::PipelineState const& state) noexcept {
+    write(state.program);
+    write(state.rasterState.u);
+    write(state.polygonOffset);
+}
+
+void Writer::write(SamplerBuffer const& samplers) noexcept {
+    const uint8_t size = uint8_t(samplers.getSize());
+    write(size);
+    for (size_t i = 0; i < size; i++) {
+        SamplerBuffer::Sampler const& sampler = samplers.getBuffer()[i];
+        write(sampler.t);
+        write(sampler.s.u);
+    }
+}
+
+void Writer::write(Program const& program) noexcept {
+    write(program.getName());
+    write(program.getVariant());
+    for (CString const& source : program.getShadersSource()) {
+        write(source);
+    }
+    for (UniformInterfaceBlock const* uib : program.getUniformInterfaceBlocks()) {
+        write(uib);
+    }
+    for (SamplerInterfaceBlock const* sib : program.getSamplerInterfaceBlocks()) {
+        write(sib);
+    }
+    write(program.getSamplerBindings());
+}
+
+void Writer::write(UniformInterfaceBlock const* uib) noexcept {
+    write(bool(uib));
+    if (uib) {
+        write(uib->getName());
+        auto const& list = uib->getUniformInfoList();
+        write(uint32_t(list.size()));
+        for (auto const& info : list) {
+            write(info.name);
+            write(info.size);
+            write(info.type);
+            write(info.precision);
+        }
+    }
+}
+
+void Writer::write(SamplerInterfaceBlock const* sib) noexcept {
+    write(bool(sib));
+    if (sib) {
+        write(sib->getName());
+        auto const& list = sib->getSamplerInfoList();
+        write(uint32_t(list.size()));
+        for (auto const& info : list) {
+            write(info.name);
+            write(info.type);
+            write(info.format);
+            write(info.precision);
+            write(info.multisample);
+        }
+    }
+}
+
+void Writer::write(SamplerBindingMap const* bindings) noexcept {
+    write(bool(bindings));
+    if (bindings) {
+        auto const& list = bindings->getBindingList();
+        write(uint32_t(list.size()));
+        for (SamplerBindingInfo const& info : list) {
+            write(info);
+        }
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+// Reader
+// ------------------------------------------------------------------------------------------------
+
+Reader::Reader(char* data, size_t size) noexcept : mData(data), mSize(size) {
+}
+
+bool Reader::readHeader() noexcept {
+    Header header;
+    if (mSize < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, mData, sizeof(header));
+    mOffset = sizeof(header);
+    mRecordEnd = mOffset;
+    return header.magic == MAGIC && header.version == VERSION &&
+           header.commandCount == uint32_t(Command::COUNT);
+}
+
+bool Reader::next(Command& command) noexcept {
+    // skip what wasn't read from the previous record
+    mOffset = mRecordEnd;
+    RecordHeader header;
+    if (mSize - mOffset < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, mData + mOffset, sizeof(header));
+    mOffset += sizeof(header);
+    if (mSize - mOffset < header.size || uint32_t(header.command) >= uint32_t(Command::COUNT)) {
+        return false;
+    }
+    mRecordEnd = mOffset + header.size;
+    command = header.command;
+    return true;
+}
+
+void Reader::readBytes(void* data, size_t size) noexcept {
+    char const* const p = readBuffer(size);
+    if (UTILS_LIKELY(p)) {
+        memcpy(data, p, size);
+    } else {
+        memset(data, 0, size);
+    }
+}
+
+char* Reader::readBuffer(size_t size) noexcept {
+    if (UTILS_UNLIKELY(mRecordEnd - mOffset < size)) {
+        // the record is truncated
+        mOffset = mRecordEnd;
+        return nullptr;
+    }
+    char* const p = mData + mOffset;
+    mOffset += size;
+    return p;
+}
+
+const char* Reader::read(Type<const char*>) noexcept {
+    const uint32_t length = read<uint32_t>();
+    const char* const string = readBuffer(length + 1u);
+    return string ? string : "";
+}
+
+CString Reader::read(Type<CString>) noexcept {
+    const uint32_t length = read<uint32_t>();
+    const char* const string = readBuffer(length + 1u);
+    return string ? CString(string, length) : CString();
+}
+
+BufferDescriptor Reader::read(Type<BufferDescriptor>) noexcept {
+    const size_t size = size_t(read<uint64_t>());
+    const size_t padding = (BUFFER_ALIGNMENT - mOffset % BUFFER_ALIGNMENT) % BUFFER_ALIGNMENT;
+    readBuffer(padding);
+    // the buffer is used in place, so there is no callback
+    void* const buffer = readBuffer(size);
+    return BufferDescriptor(buffer, buffer ? size : 0);
+}
+
+PixelBufferDescriptor Reader::read(Type<PixelBufferDescriptor>) noexcept {
+    BufferDescriptor buffer = read<BufferDescriptor>();
+    const uint32_t left = read<uint32_t>();
+    const uint32_t top = read<uint32_t>();
+    const PixelDataType type = read<PixelDataType>();
+    const uint8_t alignment = read<uint8_t>();
+    if (type == PixelDataType::COMPRESSED) {
+        const uint32_t imageSize = read<uint32_t>();
+        const CompressedPixelDataType format = read<CompressedPixelDataType>();
+        PixelBufferDescriptor data(buffer.buffer, buffer.size, format, imageSize, nullptr);
+        data.left = left;
+        data.top = top;
+        return data;
+    }
+    const uint32_t stride = read<uint32_t>();
+    const PixelDataFormat format = read<PixelDataFormat>();
+    return PixelBufferDescriptor(buffer.buffer, buffer.size, format, type, alignment,
+            left, top, stride);
+}
+
+FaceOffsets Reader::read(Type<FaceOffsets>) noexcept {
+    FaceOffsets offsets;
+    for (size_t& offset : offsets.offsets) {
+        offset = read<size_t>();
+    }
+    return offsets;
+}
+
+Driver::TargetBufferInfo Reader::read(Type<Driver::TargetBufferInfo>) noexcept {
+    Driver::TargetBufferInfo info;
+    info.handle = read<Driver::TextureHandle>();
+    info.level = read<uint8_t>();
+    info.layer = read<uint16_t>();
+    return info;
+}
+
+Driver::PipelineState Reader::read(Type<Driver::PipelineState>) noexcept {
+    Driver::PipelineState state;
+    state.program = read<Driver::ProgramHandle>();
+    state.rasterState.u = read<uint32_t>();
+    state.polygonOffset = read<Driver::PolygonOffset>();
+    return state;
+}
+
+SamplerBuffer Reader::read(Type<SamplerBuffer>) noexcept {
+    const uint8_t size = read<uint8_t>();
+    SamplerBuffer samplers(size);
+    for (size_t i = 0; i < size; i++) {
+        const Driver::TextureHandle t = read<Driver::TextureHandle>();
+        SamplerParams s;
+        s.u = read<uint32_t>();
+        samplers.setSampler(i, t, s);
+    }
+    return samplers;
+}
+
+Program Reader::read(Type<Program>) noexcept {
+    Program program;
+    CString name = read<CString>();
+    const uint8_t variant = read<uint8_t>();
+    program.diagnostics(std::move(name), variant);
+    for (size_t i = 0; i < Program::NUM_SHADER_TYPES; i++) {
+        program.shader(Program::Shader(i), read<CString>());
+    }
+    for (size_t i = 0; i < Program::NUM_UNIFORM_BINDINGS; i++) {
+        UniformInterfaceBlock const* uib = read<UniformInterfaceBlock const*>();
+        if (uib) {
+            program.addUniformBlock(i, uib);
+        }
+    }
+    for (size_t i = 0; i < Program::NUM_SAMPLER_BINDINGS; i++) {
+        SamplerInterfaceBlock const* sib = read<SamplerInterfaceBlock const*>();
+        if (sib) {
+            program.addSamplerBlock(i, sib);
+        }
+    }
+    program.withSamplerBindings(read<SamplerBindingMap const*>());
+    return program;
+}
+
+UniformInterfaceBlock const* Reader::read(Type<UniformInterfaceBlock const*>) noexcept {
+    if (!read<bool>()) {
+        return nullptr;
+    }
+    UniformInterfaceBlock::Builder builder;
+    builder.name(read<CString>());
+    const uint32_t count = read<uint32_t>();
+    for (size_t i = 0; i < count; i++) {
+        CString name = read<CString>();
+        const uint32_t size = read<uint32_t>();
+        const UniformInterfaceBlock::Type type = read<UniformInterfaceBlock::Type>();
+        const UniformInterfaceBlock::Precision precision =
+                read<UniformInterfaceBlock::Precision>();
+        builder.add(std::move(name), size, type, precision);
+    }
+    mUniformBlocks.emplace_back(new UniformInterfaceBlock(builder.build()));
+    return mUniformBlocks.back().get();
+}
+
+SamplerInterfaceBlock const* Reader::read(Type<SamplerInterfaceBlock const*>) noexcept {
+    if (!read<bool>()) {
+        return nullptr;
+    }
+    SamplerInterfaceBlock::Builder builder;
+    builder.name(read<CString>());
+    const uint32_t count = read<uint32_t>();
+    for (size_t i = 0; i < count; i++) {
+        CString name = read<CString>();
+        const SamplerInterfaceBlock::Type type = read<SamplerInterfaceBlock::Type>();
+        const SamplerInterfaceBlock::Format format = read<SamplerInterfaceBlock::Format>();
+        const SamplerInterfaceBlock::Precision precision =
+                read<SamplerInterfaceBlock::Precision>();
+        const bool multisample = read<bool>();
+        builder.add(std::move(name), type, format, precision, multisample);
+    }
+    mSamplerBlocks.emplace_back(new SamplerInterfaceBlock(builder.build()));
+    return mSamplerBlocks.back().get();
+}
+
+SamplerBindingMap const* Reader::read(Type<SamplerBindingMap const*>) noexcept {
+    if (!read<bool>()) {
+        return nullptr;
+    }
+    SamplerBindingMap* bindings = new SamplerBindingMap;
+    mSamplerBindings.emplace_back(bindings);
+    const uint32_t count = read<uint32_t>();
+    for (size_t i = 0; i < count; i++) {
+        bindings->addSampler(read<SamplerBindingInfo>());
+    }
+    return bindings;
+}
+
+} // namespace capture
+} // namespace filament
@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_DRIVER_CAPTURE_H
+#define TNT_FILAMENT_DRIVER_CAPTURE_H
+
+#include "driver/Driver.h"
+#include "driver/Handle.h"
+#include "driver/Program.h"
+#include "driver/SamplerBuffer.h"
+
+#include <filament/SamplerBindingMap.h>
+
+#include <private/filament/SamplerInterfaceBlock.h>
+#include <private/filament/UniformInterfaceBlock.h>
+
+#include <utils/compiler.h>
+
+#include <tsl/robin_map.h>
+
+#include <fstream>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace filament {
+namespace capture {
+
+/*
+ * A capture of the commands sent to a driver, written by CaptureDriver and read by CaptureReplay.
+ *
+ * The file starts with a Header, followed by one record per command. A record is a
+ * RecordHeader followed by the command's arguments, in the order of DriverAPI.inc. Scalars are
+ * written as is, handles as their id, and buffers as their size followed by their content,
+ * which starts on a 16 bytes boundary of the file.
+ *
+ * Only the asynchronous commands are captured, the synchronous ones don't go through the
+ * command stream.
+ */
+
+static constexpr uint32_t MAGIC = 0x50414346;   // 'FCAP'
+
+// must be incremented each time the format of a command, or DriverAPI.inc, changes
+static constexpr uint32_t VERSION = 2;
+
+// alignment of the content of the buffers in the file
+static constexpr size_t BUFFER_ALIGNMENT = 16;
+
+enum class Command : uint32_t {
+#define DECL_DRIVER_API(methodName, paramsDecl, params)                 methodName,
+#define DECL_DRIVER_API_RETURN(RetType, methodName, paramsDecl, params) methodName,
+#define DECL_DRIVER_API_SYNCHRONOUS(RetType, methodName, paramsDecl, params)
+#include "driver/DriverAPI.inc"
+    COUNT
+};
+
+struct Header {
+    uint32_t magic = MAGIC;
+    uint32_t version = VERSION;
+    uint32_t commandCount = uint32_t(Command::COUNT);
+    uint32_t reserved = 0;
+};
+
+struct RecordHeader {
+    Command command;
+    uint32_t size;  // size of the arguments
+};
+
+// the type a scalar is stored as, sizes are always 64 bits so that captures are portable
+template<typename T> struct Stored { using type = T; };
+template<> struct Stored<size_t> { using type = uint64_t; };
+template<> struct Stored<ssize_t> { using type = int64_t; };
+
+/*
+ * Serializes the commands to a file, see CaptureDriver
+ */
+class Writer {
+public:
+    // the file is closed when the Writer is destroyed
+    explicit Writer(std::ofstream&& file) noexcept;
+
+    Writer(Writer const& rhs) = delete;
+    Writer& operator=(Writer const& rhs) = delete;
+
+    template<typename ... ARGS>
+    void record(Command command, ARGS const& ... args) noexcept {
+        mData.clear();
+        // the arguments are written after the record's header
+        mDataOffset = mOffset + sizeof(RecordHeader);
+        UTILS_UNUSED int dummy[] = { (write(args), 0)... , 0 };
+        writeRecord(command);
+    }
+
+    // bytes written so far
+    uint64_t getSize() const noexcept { return mOffset; }
+
+private:
+    template<typename T>
+    void write(T const& v) noexcept {
+        static_assert(std::is_trivially_copyable<T>::value, "no serializer for this type");
+        const typename Stored<T>::type stored(v);
+        writeBytes(&stored, sizeof(stored));
+    }
+
+    template<typename T>
+    void write(Handle<T> const& h) noexcept {
+        write(h.getId());
+    }
+
+    // native objects can't be replayed, they're not written
+    void write(void* const&) noexcept { }
+
+    void write(const char* const& string) noexcept;
+    void write(utils::CString const& string) noexcept;
+    void write(driver::BufferDescriptor const& buffer) noexcept;
+    void write(driver::PixelBufferDescriptor const& buffer) noexcept;
+    void write(driver::FaceOffsets const& offsets) noexcept;
+    void write(Driver::TargetBufferInfo const& info) noexcept;
+    void write(Driver::PipelineState const& state) noexcept;
+    void write(SamplerBuffer const& samplers) noexcept;
+    void write(Program const& program) noexcept;
+    void write(UniformInterfaceBlock const* uib) noexcept;
+    void write(SamplerInterfaceBlock const* sib) noexcept;
+    void write(SamplerBindingMap const* bindings) noexcept;
+
+    void writeBytes(void const* data, size_t size) noexcept;
+    void writeRecord(Command command) noexcept;
+
+    std::ofstream mFile;
+    std::vector<char> mData;    // arguments of the current record
+    uint64_t mDataOffset = 0;   // offset of mData in the file
+    uint64_t mOffset = 0;       // size of the file
+};
+
+/*
+ * Deserializes the commands of a capture loaded in memory, see CaptureReplay
+ */
+class Reader {
+public:
+    // The data must outlive the commands read from it, their buffers point into it.
+    Reader(char* data, size_t size) noexcept;
+
+    Reader(Reader const& rhs) = delete;
+    Reader& operator=(Reader const& rhs) = delete;
+
+    // Checks the header, returns false if this isn't a capture of this version.
+    bool readHeader() noexcept;
+
+    // Moves to the next record, returns false at the end of the capture or if the record
+    // is truncated.
+    bool next(Command& command) noexcept;
+
+    // Reads the next argument of the current record. Handles are translated to the handles
+    // recorded with mapHandle().
+    template<typename T>
+    T read() noexcept {
+        return read(Type<T>{});
+    }
+
+    // Reads the id of a handle as it was captured.
+    HandleBase::HandleId readHandleId() noexcept {
+        return read(Type<HandleBase::HandleId>{});
+    }
+
+    // The handles captured with the id captured will be replaced by replayed.
+    void mapHandle(HandleBase::HandleId captured, HandleBase::HandleId replayed) noexcept {
+        mHandles[captured] = replayed;
+    }
+
+private:
+    template<typename T>
+    struct Type { };
+
+    template<typename T>
+    T read(Type<T>) noexcept {
+        static_assert(std::is_trivially_copyable<T>::value, "no deserializer for this type");
+        typename Stored<T>::type stored;
+        readBytes(&stored, sizeof(stored));
+        return T(stored);
+    }
+
+    template<typename T>
+    Handle<T> read(Type<Handle<T>>) noexcept {
+        const HandleBase::HandleId id = readHandleId();
+        auto pos = mHandles.find(id);
+        return pos == mHandles.end() ? Handle<T>{} : Handle<T>(pos->second);
+    }
+
+    void* read(Type<void*>) noexcept { return nullptr; }
+
+    const char* read(Type<const char*>) noexcept;
+    utils::CString read(Type<utils::CString>) noexcept;
+    driver::BufferDescriptor read(Type<driver::BufferDescriptor>) noexcept;
+    driver::PixelBufferDescriptor read(Type<driver::PixelBufferDescriptor>) noexcept;
+    driver::FaceOffsets read(Type<driver::FaceOffsets>) noexcept;
+    Driver::TargetBufferInfo read(Type<Driver::TargetBufferInfo>) noexcept;
+    Driver::PipelineState read(Type<Driver::PipelineState>) noexcept;
+    SamplerBuffer read(Type<SamplerBuffer>) noexcept;
+    Program read(Type<Program>) noexcept;
+    UniformInterfaceBlock const* read(Type<UniformInterfaceBlock const*>) noexcept;
+    SamplerInterfaceBlock const* read(Type<SamplerInterfaceBlock const*>) noexcept;
+    SamplerBindingMap const* read(Type<SamplerBindingMap const*>) noexcept;
+
+    void readBytes(void* data, size_t size) noexcept;
+    char* readBuffer(size_t size) noexcept;
+
+    char* const mData;
+    const size_t mSize;
+    size_t mOffset = 0;
+    size_t mRecordEnd = 0;
+    tsl::robin_map<HandleBase::HandleId, HandleBase::HandleId> mHandles;
+
+    // the programs point to these, they're kept for the duration of the replay
+    std::vector<std::unique_ptr<UniformInterfaceBlock>> mUniformBlocks;
+    std::vector<std::unique_ptr<SamplerInterfaceBlock>> mSamplerBlocks;
+    std::vector<std::unique_ptr<SamplerBindingMap>> mSamplerBindings;
+};
+
+} // namespace capture
+} // namespace filament
+
+#endif // TNT_FILAMENT_DRIVER_CAPTURE_H
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "driver/CaptureDriver.h"
+#include "driver/CommandStreamDispatcher.h"
+
+#include <utils/Log.h>
+
+namespace filament {
+
+using namespace utils;
+
+Driver* CaptureDriver::create(Driver* driver, const char* path) noexcept {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        slog.e << "Couldn't create the driver capture " << path << io::endl;
+        return driver;
+    }
+    slog.i << "Capturing the driver commands to " << path << io::endl;
+    return new CaptureDriver(driver, std::move(file));
+}
+
+CaptureDriver::CaptureDriver(Driver* driver, std::ofstream&& file) noexcept
+        : mDriver(driver),
+          mDispatcher(new ConcreteDispatcher<CaptureDriver>(this)),
+          mWriter(std::move(file)) {
+}
+
+CaptureDriver::~CaptureDriver() noexcept {
+    delete mDispatcher;
+    delete mDriver;
+}
+
+void CaptureDriver::purge() noexcept {
+    mDriver->purge();
+}
+
+Driver::ShaderModel CaptureDriver::getShaderModel() const noexcept {
+    return mDriver->getShaderModel();
+}
+
+Driver::MemoryStats CaptureDriver::getMemoryStats() const noexcept {
+    return mDriver->getMemoryStats();
+}
+
+#ifndef NDEBUG
+void CaptureDriver::debugCommand(const char* methodName) {
+    mDriver->debugCommand(methodName);
+}
+#endif
+
+// explicit instantiation of the Dispatcher
+template class ConcreteDispatcher<CaptureDriver>;
+
+} // namespace filament
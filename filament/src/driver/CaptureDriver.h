@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_DRIVER_CAPTUREDRIVER_H
+#define TNT_FILAMENT_DRIVER_CAPTUREDRIVER_H
+
+#include "driver/Capture.h"
+#include "driver/CommandStream.h"
+#include "driver/Driver.h"
+
+#include <utils/compiler.h>
+
+#include <type_traits>
+
+namespace filament {
+
+/*
+ * A Driver that writes the commands it receives to a file, then forwards them to another
+ * Driver. The file can be replayed with CaptureReplay, e.g. with the replay tool.
+ *
+ * Commands are written on the driver thread as they're executed, so the capture has them in
+ * the order the backend sees them.
+ */
+class CaptureDriver final : public Driver {
+    CaptureDriver(Driver* driver, std::ofstream&& file) noexcept;
+    ~CaptureDriver() noexcept override;
+
+public:
+    // Returns a Driver capturing the commands sent to driver in the file at path. Takes
+    // ownership of driver. If the file can't be created, driver is returned.
+    static Driver* create(Driver* driver, const char* path) noexcept;
+
+    void purge() noexcept override;
+
+    ShaderModel getShaderModel() const noexcept override;
+
+    MemoryStats getMemoryStats() const noexcept override;
+
+    Dispatcher& getDispatcher() noexcept override { return *mDispatcher; }
+
+#ifndef NDEBUG
+    void debugCommand(const char* methodName) override;
+#endif
+
+private:
+    // Executes a command on the captured driver, as if it came from its command stream.
+    template<typename Cmd, typename ... ARGS>
+    UTILS_ALWAYS_INLINE void forward(Dispatcher::Execute execute, ARGS&& ... args) {
+        typename std::aligned_storage<sizeof(Cmd), alignof(Cmd)>::type storage;
+        // the command destroys itself when it's executed
+        CommandBase* const command = new(&storage) Cmd(execute, std::forward<ARGS>(args)...);
+        command->execute(*mDriver);
+    }
+
+    Driver* const mDriver;
+    Dispatcher* const mDispatcher;
+    capture::Writer mWriter;
+
+    /*
+     * Driver interface
+     */
+
+    template<typename T>
+    friend class ConcreteDispatcher;
+
+#define DECL_DRIVER_API(methodName, paramsDecl, params)                                         \
+    void methodName(paramsDecl) {                                                               \
+        mWriter.record(capture::Command::methodName, params);                                   \
+        using Cmd = CommandType<decltype(&Driver::methodName)>::Command<&Driver::methodName>;   \
+        forward<Cmd>(mDriver->getDispatcher().methodName##_, params);                           \
+    }
+
+#define DECL_DRIVER_API_SYNCHRONOUS(RetType, methodName, paramsDecl, params)                    \
+    RetType methodName(paramsDecl) override {                                                   \
+        return mDriver->methodName(params);                                                     \
+    }
+
+#define DECL_DRIVER_API_RETURN(RetType, methodName, paramsDecl, params)                         \
+    RetType methodName##Synchronous() noexcept override {                                       \
+        return mDriver->methodName##Synchronous();                                              \
+    }                                                                                           \
+    void methodName(RetType result, paramsDecl) {                                               \
+        mWriter.record(capture::Command::methodName, result, params);                           \
+        using Cmd = CommandType<decltype(&Driver::methodName)>::Command<&Driver::methodName>;   \
+        forward<Cmd>(mDriver->getDispatcher().methodName##_, result, params);                   \
+    }
+
+#include "driver/DriverAPI.inc"
+};
+
+} // namespace filament
+
+#endif // TNT_FILAMENT_DRIVER_CAPTUREDRIVER_H
@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "driver/CaptureReplay.h"
+
+#include "details/Engine.h"
+
+#include "driver/Capture.h"
+#include "driver/CommandBufferQueue.h"
+#include "driver/CommandStream.h"
+#include "driver/Driver.h"
+
+#include <filament/driver/Platform.h>
+
+#include <utils/Log.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace filament {
+
+using namespace driver;
+using namespace utils;
+
+namespace {
+
+// same sizes as the Engine's defaults
+constexpr size_t REQUIRED_SIZE = 1 * 1024 * 1024;
+constexpr size_t BUFFER_SIZE = 3 * REQUIRED_SIZE;
+
+template<typename F, typename TUPLE, size_t ... I>
+decltype(auto) call(F&& f, TUPLE&& args, std::index_sequence<I...>) {
+    return f(std::get<I>(std::forward<TUPLE>(args))...);
+}
+
+// Reads the arguments of a command and calls f with them.
+template<typename ... ARGS, typename F>
+void replayCommand(capture::Reader& reader, void (Driver::*)(ARGS...), F&& f) {
+    // list-initialization guarantees the arguments are read in order
+    std::tuple<std::decay_t<ARGS>...> args{ reader.read<std::decay_t<ARGS>>()... };
+    call(f, std::move(args), std::index_sequence_for<ARGS...>{});
+}
+
+// Same for a command creating an object, which maps the captured handle to the new one.
+template<typename R, typename ... ARGS, typename F>
+void replayCreate(capture::Reader& reader, void (Driver::*)(R, ARGS...), F&& f) {
+    const HandleBase::HandleId captured = reader.readHandleId();
+    std::tuple<std::decay_t<ARGS>...> args{ reader.read<std::decay_t<ARGS>>()... };
+    R result = call(f, std::move(args), std::index_sequence_for<ARGS...>{});
+    reader.mapHandle(captured, result.getId());
+}
+
+} // anonymous namespace
+
+bool CaptureReplay::replay(const char* path, Backend backend, Stats& stats) noexcept {
+    stats = {};
+
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        slog.e << "Couldn't open the capture " << path << io::endl;
+        return false;
+    }
+    std::vector<char> data(size_t(file.tellg()));
+    file.seekg(0);
+    if (!file.read(data.data(), data.size())) {
+        slog.e << "Couldn't read the capture " << path << io::endl;
+        return false;
+    }
+    stats.bytes = data.size();
+
+    capture::Reader reader(data.data(), data.size());
+    if (!reader.readHeader()) {
+        slog.e << path << " isn't a capture of this version of filament" << io::endl;
+        return false;
+    }
+
+    Platform* platform = nullptr;
+    Driver* const driver = details::FEngine::createStandaloneDriver(backend, &platform);
+    if (!driver) {
+        slog.e << "Couldn't create the driver" << io::endl;
+        return false;
+    }
+
+    CommandBufferQueue queue(REQUIRED_SIZE, BUFFER_SIZE);
+    CircularBuffer const& buffer = queue.getCircularBuffer();
+    CommandStream stream(*driver, queue.getCircularBuffer());
+    stream.debugThreading();
+
+    // the driver's thread is this thread, so the commands are executed after each flush
+    auto execute = [&queue, &stream]() {
+        queue.flush();
+        for (auto& item : queue.waitForCommands()) {
+            if (item.begin) {
+                stream.execute(item.begin);
+                queue.releaseBuffer(item);
+            }
+        }
+    };
+
+    using clock = std::chrono::steady_clock;
+    const clock::time_point start = clock::now();
+    clock::time_point frameStart = start;
+
+    capture::Command command;
+    while (reader.next(command)) {
+        switch (command) {
+#define DECL_DRIVER_API(methodName, paramsDecl, params)                                         \
+            case capture::Command::methodName:                                                  \
+                replayCommand(reader, &Driver::methodName, [&stream](auto&& ... args) {         \
+                    stream.methodName(std::forward<decltype(args)>(args)...);                   \
+                });                                                                             \
+                break;
+#define DECL_DRIVER_API_RETURN(RetType, methodName, paramsDecl, params)                         \
+            case capture::Command::methodName:                                                  \
+                replayCreate(reader, &Driver::methodName, [&stream](auto&& ... args) {          \
+                    return stream.methodName(std::forward<decltype(args)>(args)...);            \
+                });                                                                             \
+                break;
+#define DECL_DRIVER_API_SYNCHRONOUS(RetType, methodName, paramsDecl, params)
+#include "driver/DriverAPI.inc"
+            case capture::Command::COUNT:
+                break;
+        }
+        stats.commands++;
+
+        if (command == capture::Command::endFrame) {
+            execute();
+            const clock::time_point now = clock::now();
+            stats.longestFrame = std::max(stats.longestFrame,
+                    uint64_t(std::chrono::nanoseconds(now - frameStart).count()));
+            stats.frames++;
+            frameStart = now;
+        } else if (size_t((char*)buffer.getHead() - (char*)buffer.getTail()) >
+                REQUIRED_SIZE / 2) {
+            // captures made without frames (e.g. at init time) must not overflow the buffer
+            execute();
+        }
+    }
+    execute();
+
+    stats.duration = uint64_t(std::chrono::nanoseconds(clock::now() - start).count());
+
+    driver->purge();
+    driver->terminate();
+    delete driver;
+    details::FEngine::destroyPlatform(&platform);
+    return true;
+}
+
+} // namespace filament
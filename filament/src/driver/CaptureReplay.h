@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_DRIVER_CAPTUREREPLAY_H
+#define TNT_FILAMENT_DRIVER_CAPTUREREPLAY_H
+
+#include <filament/driver/DriverEnums.h>
+
+#include <utils/compiler.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace filament {
+
+/*
+ * Replays a capture written by CaptureDriver on a backend, as fast as possible.
+ *
+ * The commands go through a CommandStream as they do in the Engine, but the stream is executed
+ * on the calling thread, after each frame. Native windows aren't captured, so swap chains are
+ * created without one.
+ */
+class UTILS_PUBLIC CaptureReplay {
+public:
+    struct Stats {
+        size_t commands = 0;        // commands replayed
+        size_t frames = 0;          // endFrame commands replayed
+        uint64_t bytes = 0;         // size of the capture
+        uint64_t duration = 0;      // total duration of the replay, in ns
+        uint64_t longestFrame = 0;  // duration of the longest frame, in ns
+    };
+
+    // Returns false if the capture can't be read or the backend can't be created.
+    static bool replay(const char* path, driver::Backend backend, Stats& stats) noexcept;
+};
+
+} // namespace filament
+
+#endif // TNT_FILAMENT_DRIVER_CAPTUREREPLAY_H
@@ -134,6 +134,7 @@ void* CircularBuffer::alloc(size_t size) noexcept {
 }
 
 void CircularBuffer::circularize() noexcept {
+    mBytesWritten += uintptr_t(mHead) - uintptr_t(mTail);
     if (mUsesAshmem > 0) {
         intptr_t overflow = intptr_t(mHead) - (intptr_t(mData) + ssize_t(mSize));
         if (overflow >= 0) {
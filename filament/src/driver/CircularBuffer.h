@@ -66,6 +66,9 @@ public:
     // call at least once every getRequiredSize() bytes allocated from the buffer
     void circularize() noexcept;
 
+    // total number of bytes allocated from the buffer, updated by circularize()
+    uint64_t getBytesWritten() const noexcept { return mBytesWritten; }
+
 private:
     void* alloc(size_t size) noexcept;
 
@@ -81,6 +84,9 @@ private:
 
     // pointer to the next available command
     void* mHead = nullptr;
+
+    // total number of bytes allocated, for the statistics
+    uint64_t mBytesWritten = 0;
 };
 
 } // namespace filament
@@ -77,9 +77,9 @@ void CommandBufferQueue::flush() noexcept {
     mFreeSpace -= used;
     const size_t requiredSize = mRequiredSize;
 
-#ifndef NDEBUG
     size_t totalUsed = circularBuffer.size() - mFreeSpace;
     mHighWatermark = std::max(mHighWatermark, totalUsed);
+#ifndef NDEBUG
     if (UTILS_UNLIKELY(totalUsed > requiredSize)) {
         slog.d << "CommandStream used too much space: " << totalUsed
             << ", out of " << requiredSize << " (will block)" << io::endl;
@@ -112,6 +112,16 @@ std::vector<CommandBufferQueue::Slice> CommandBufferQueue::waitForCommands() con
     return std::move(mCommandBuffersToExecute);
 }
 
+size_t CommandBufferQueue::getUsedSize() const noexcept {
+    std::lock_guard<utils::Mutex> lock(mLock);
+    return mCircularBuffer.size() - mFreeSpace;
+}
+
+size_t CommandBufferQueue::getHighWatermark() const noexcept {
+    std::lock_guard<utils::Mutex> lock(mLock);
+    return mHighWatermark;
+}
+
 void CommandBufferQueue::releaseBuffer(CommandBufferQueue::Slice const& buffer) {
     std::unique_lock<utils::Mutex> lock(mLock);
     mFreeSpace += uintptr_t(buffer.end) - uintptr_t(buffer.begin);
@@ -56,7 +56,14 @@ public:
 
     CircularBuffer& getCircularBuffer() { return mCircularBuffer; }
 
-    size_t getHigWatermark() noexcept { return mHighWatermark; }
+    // size of the circular buffer
+    size_t getSize() const noexcept { return mCircularBuffer.size(); }
+
+    // space used by the commands flushed but not executed yet
+    size_t getUsedSize() const noexcept;
+
+    // maximum space used by the commands in flight, measured at each flush()
+    size_t getHighWatermark() const noexcept;
 
     // wait for commands to be available and returns an array containing these commands
     std::vector<Slice> waitForCommands() const;
@@ -18,6 +18,8 @@
 #include "driver/Driver.h"
 #include "driver/CommandStream.h"
 
+#include <utils/Log.h>
+
 #include <math/half.h>
 #include <math/quat.h>
 #include <math/vec2.h>
@@ -50,11 +52,39 @@ void DriverBase::purge() noexcept {
     lock.unlock(); // don't remove this, it ensures mBufferToPurge is destroyed without lock held
 }
 
+Driver::MemoryStats DriverBase::getMemoryStats() const noexcept {
+    MemoryStats stats;
+    stats.handleBytes = mHandleAllocator.getUsedSize();
+    stats.handlePeakBytes = mHandleAllocator.getPeakUsedSize();
+    stats.handleAllocatedBytes = mHandleAllocator.getAllocatedSize();
+    return stats;
+}
+
 void DriverBase::scheduleDestroySlow(BufferDescriptor&& buffer) noexcept {
     std::lock_guard<std::mutex> lock(mPurgeLock);
     mBufferToPurge.push_back(std::move(buffer));
 }
 
+#ifndef NDEBUG
+
+void DriverBase::checkHandle(HandleBase::HandleId id) const noexcept {
+    if (UTILS_UNLIKELY(!mHandleAllocator.isValid(id))) {
+        slog.e << "Using handle " << id << " after its object was destroyed" << io::endl;
+        std::terminate();
+    }
+}
+
+void DriverBase::checkType(HandleBase::HandleId id, const char* typeId) const noexcept {
+    const char* actualTypeId = mHandleAllocator.getTypeId(id);
+    if (UTILS_UNLIKELY(actualTypeId != typeId)) {
+        slog.e << "Destroying handle " << id << ", type " << typeId
+               << ", but handle's actual type is " << actualTypeId << io::endl;
+        std::terminate();
+    }
+}
+
+#endif
+
 // ------------------------------------------------------------------------------------------------
 // Texture format data...
 // ------------------------------------------------------------------------------------------------
@@ -216,6 +216,25 @@ public:
         PolygonOffset polygonOffset;
     };
 
+    // Statistics about the GPU memory the backend sub-allocates resources from. Backends that
+    // leave this to the graphics driver report zeros. The handle statistics are about the CPU
+    // memory holding the backend's objects.
+    struct MemoryStats {
+        uint32_t blockCount = 0;            // device memory blocks allocated
+        uint32_t allocationCount = 0;       // resources sub-allocated from these blocks
+        uint64_t usedBytes = 0;             // bytes used by these resources
+        uint64_t unusedBytes = 0;           // bytes of the blocks not used by any resource
+        uint64_t largestUnusedRange = 0;    // largest contiguous range of unused bytes
+        uint64_t handleBytes = 0;           // bytes of the live objects
+        uint64_t handlePeakBytes = 0;       // most bytes of live objects so far
+        uint64_t handleAllocatedBytes = 0;  // bytes allocated for the objects, used or not
+
+        // 0 when the unused bytes are contiguous, closer to 1 as they're split in smaller ranges
+        float getFragmentation() const noexcept {
+            return unusedBytes ? 1.0f - float(largestUnusedRange) / float(unusedBytes) : 0.0f;
+        }
+    };
+
     static SamplerFormat getSamplerFormat(TextureFormat format) noexcept;
     static SamplerPrecision getSamplerPrecision(TextureFormat format) noexcept;
     static size_t getElementTypeSize(ElementType type) noexcept;
@@ -241,6 +260,9 @@ public:
 
     virtual Dispatcher& getDispatcher() noexcept = 0;
 
+    // can be called from any thread, for debugging and profiling.
+    virtual MemoryStats getMemoryStats() const noexcept { return {}; }
+
 #ifndef NDEBUG
     virtual void debugCommand(const char* methodName) {}
 #endif
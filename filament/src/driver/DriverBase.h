@@ -21,6 +21,9 @@
 
 #include <array>
 #include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
 #include <assert.h>
 #include <stdint.h>
 
@@ -30,8 +33,14 @@
 #include <filament/driver/DriverEnums.h>
 
 #include "driver/Driver.h"
+#include "driver/HandleAllocator.h"
+#include "driver/Program.h"
 #include "driver/SamplerBuffer.h"
 
+#if !defined(NDEBUG) && UTILS_HAS_RTTI
+#include <typeinfo>
+#endif
+
 namespace filament {
 
 class Dispatcher;
@@ -41,9 +50,6 @@ class Dispatcher;
  */
 
 struct HwBase {
-#if !defined(NDEBUG) && UTILS_HAS_RTTI
-    const char* typeId = nullptr;
-#endif
 };
 
 struct HwVertexBuffer : public HwBase {
@@ -154,6 +160,9 @@ public:
 
     Dispatcher& getDispatcher() noexcept final { return *mDispatcher; }
 
+    // fills the handle statistics, backends add their own
+    MemoryStats getMemoryStats() const noexcept override;
+
     // --------------------------------------------------------------------------------------------
     // Privates
     // --------------------------------------------------------------------------------------------
@@ -169,7 +178,95 @@ protected:
 
     void scheduleDestroySlow(BufferDescriptor&& buffer) noexcept;
 
+    /*
+     * Handles
+     *
+     * The objects of all the backends are allocated by mHandleAllocator, a handle is allocated
+     * with allocateHandle() or alloc_handle<>() on the client's thread, and its object is
+     * constructed later with construct<>() on the driver's thread.
+     */
+
+    HandleAllocator mHandleAllocator;
+
+    HandleBase::HandleId allocateHandle(size_t size) noexcept {
+        return mHandleAllocator.allocate(size);
+    }
+
+    template<typename D, typename B>
+    Handle<B> alloc_handle() noexcept {
+        static_assert(sizeof(D) <= HandleAllocator::MAX_SIZE, "Handle<> too large");
+        return Handle<B>(mHandleAllocator.allocate(sizeof(D)));
+    }
+
+    template<typename D, typename B, typename ... ARGS>
+    typename std::enable_if<std::is_base_of<B, D>::value, D>::type*
+    construct(Handle<B> const& handle, ARGS&& ... args) noexcept {
+        static_assert(sizeof(D) <= HandleAllocator::MAX_SIZE, "Handle<> too large");
+        D* addr = handle_cast<D*>(handle);
+        new(addr) D(std::forward<ARGS>(args)...);
+#if !defined(NDEBUG) && UTILS_HAS_RTTI
+        mHandleAllocator.setTypeId(handle.getId(), typeid(D).name());
+#endif
+        return addr;
+    }
+
+    template<typename B, typename D,
+            typename = typename std::enable_if<std::is_base_of<B, D>::value, D>::type>
+    void destruct(Handle<B>& handle, D const* p) noexcept {
+        // allow to destroy the nullptr, similarly to operator delete
+        if (p) {
+#if !defined(NDEBUG) && UTILS_HAS_RTTI
+            checkType(handle.getId(), typeid(D).name());
+#endif
+            p->~D();
+            mHandleAllocator.deallocate(handle.getId());
+        }
+    }
+
+    template<typename D, typename B>
+    void destruct(Handle<B>& handle) noexcept {
+        destruct(handle, handle_cast<D const*>(handle));
+    }
+
+    /*
+     * handle_cast
+     *
+     * casts a Handle<> to a pointer to the data it refers to.
+     */
+
+    template<typename Dp, typename B>
+    typename std::enable_if<
+            std::is_pointer<Dp>::value &&
+            std::is_base_of<B, typename std::remove_pointer<Dp>::type>::value, Dp>::type
+    handle_cast(Handle<B> const& handle) noexcept {
+        assert(handle);
+#ifndef NDEBUG
+        checkHandle(handle.getId());
+#endif
+        return static_cast<Dp>(mHandleAllocator.handle_cast(handle.getId()));
+    }
+
+    /*
+     * The state reused by drawDelta(), backends record it in draw() and
+     * bindUniformBufferRange().
+     */
+
+    struct UniformBufferRange {
+        Handle<HwUniformBuffer> ubh;
+        size_t size = 0;
+    };
+
+    PipelineState mDrawPipelineState;
+    std::array<UniformBufferRange, Program::NUM_UNIFORM_BINDINGS> mUniformBufferRanges;
+
 private:
+#ifndef NDEBUG
+    // terminates if the handle's object was destroyed
+    void checkHandle(HandleBase::HandleId id) const noexcept;
+    // terminates if the handle's object isn't of the given type
+    void checkType(HandleBase::HandleId id, const char* typeId) const noexcept;
+#endif
+
     using TF = Driver::TextureFormat;
     using SF = Driver::SamplerFormat;
     using SP = Driver::SamplerPrecision;
@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "driver/HandleAllocator.h"
+
+#include <utils/memalign.h>
+#include <utils/Panic.h>
+
+#include <new>
+
+namespace filament {
+
+constexpr size_t HandleAllocator::MIN_SIZE_SHIFT;
+constexpr size_t HandleAllocator::POOL_COUNT;
+constexpr size_t HandleAllocator::MAX_SIZE;
+
+HandleAllocator::HandleAllocator() noexcept = default;
+
+HandleAllocator::~HandleAllocator() noexcept {
+    for (Pool& pool : mPools) {
+        for (std::atomic<char*>& chunk : pool.chunks) {
+            utils::aligned_free(chunk.load(std::memory_order_relaxed));
+        }
+    }
+}
+
+HandleAllocator::HandleId HandleAllocator::allocate(size_t size) noexcept {
+    assert(size <= MAX_SIZE);
+
+    // the first pool with slots of at least size bytes
+    const size_t pool = size <= (size_t(1) << MIN_SIZE_SHIFT) ? 0 :
+            (32u - utils::clz(uint32_t(size - 1u))) - MIN_SIZE_SHIFT;
+    Pool& p = mPools[pool];
+
+    uint32_t slot;
+    uint64_t head = p.freeList.load(std::memory_order_acquire);
+    while (true) {
+        const uint32_t first = uint32_t(head);
+        if (!first) {
+            // the free list is empty, use a new slot
+            slot = p.count.fetch_add(1, std::memory_order_relaxed);
+            ASSERT_POSTCONDITION(slot <= SLOT_MASK,
+                    "no handles left for objects of %u bytes", 1u << (pool + MIN_SIZE_SHIFT));
+            size_t chunk, offset;
+            locate(slot, chunk, offset);
+            getOrCreateChunk(pool, chunk);
+            break;
+        }
+        // this slot can be popped by another thread in the meantime, in which case its next
+        // link is stale but the tag of the head has changed, so the exchange fails.
+        const uint32_t next = getMetadata(pool, first - 1u).next.load(std::memory_order_relaxed);
+        const uint64_t newHead = (((head >> 32u) + 1u) << 32u) | next;
+        if (p.freeList.compare_exchange_weak(head, newHead,
+                std::memory_order_acquire, std::memory_order_acquire)) {
+            slot = first - 1u;
+            break;
+        }
+    }
+
+    const size_t slotSize = size_t(1) << (pool + MIN_SIZE_SHIFT);
+    const size_t used = mUsedSize.fetch_add(slotSize, std::memory_order_relaxed) + slotSize;
+    size_t peak = mPeakUsedSize.load(std::memory_order_relaxed);
+    while (used > peak && !mPeakUsedSize.compare_exchange_weak(peak, used,
+            std::memory_order_relaxed, std::memory_order_relaxed)) {
+    }
+
+    const uint32_t generation =
+            getMetadata(pool, slot).generation.load(std::memory_order_relaxed);
+    return HandleId((generation << (SLOT_BITS + POOL_BITS)) | (uint32_t(pool) << SLOT_BITS) | slot);
+}
+
+void HandleAllocator::deallocate(HandleId id) noexcept {
+    assert(isValid(id));
+
+    const size_t pool = getPool(id);
+    const uint32_t slot = getSlot(id);
+    Metadata& metadata = getMetadata(pool, slot);
+
+    // the ids of this slot given out so far are now invalid
+    metadata.generation.store(uint8_t((getGeneration(id) + 1u) & GENERATION_MASK),
+            std::memory_order_relaxed);
+
+    Pool& p = mPools[pool];
+    uint64_t head = p.freeList.load(std::memory_order_relaxed);
+    uint64_t newHead;
+    do {
+        metadata.next.store(uint32_t(head), std::memory_order_relaxed);
+        newHead = (((head >> 32u) + 1u) << 32u) | (slot + 1u);
+    } while (!p.freeList.compare_exchange_weak(head, newHead,
+            std::memory_order_release, std::memory_order_relaxed));
+
+    mUsedSize.fetch_sub(size_t(1) << (pool + MIN_SIZE_SHIFT), std::memory_order_relaxed);
+}
+
+bool HandleAllocator::isValid(HandleId id) const noexcept {
+    const size_t pool = getPool(id);
+    const uint32_t slot = getSlot(id);
+    if (pool >= POOL_COUNT || slot >= mPools[pool].count.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    size_t chunk, offset;
+    locate(slot, chunk, offset);
+    if (!mPools[pool].chunks[chunk].load(std::memory_order_acquire)) {
+        return false;
+    }
+    return getMetadata(pool, slot).generation.load(std::memory_order_relaxed) ==
+           getGeneration(id);
+}
+
+#ifndef NDEBUG
+
+void HandleAllocator::setTypeId(HandleId id, const char* typeId) noexcept {
+    getMetadata(getPool(id), getSlot(id)).typeId = typeId;
+}
+
+const char* HandleAllocator::getTypeId(HandleId id) const noexcept {
+    return getMetadata(getPool(id), getSlot(id)).typeId;
+}
+
+#endif
+
+HandleAllocator::Metadata& HandleAllocator::getMetadata(size_t pool, uint32_t slot) const noexcept {
+    size_t chunk, offset;
+    locate(slot, chunk, offset);
+    char* const data = mPools[pool].chunks[chunk].load(std::memory_order_acquire);
+    Metadata* const metadata = reinterpret_cast<Metadata*>(
+            data + (getChunkSlotCount(chunk) << (pool + MIN_SIZE_SHIFT)));
+    return metadata[offset];
+}
+
+UTILS_NOINLINE
+char* HandleAllocator::getOrCreateChunk(size_t pool, size_t chunk) noexcept {
+    std::atomic<char*>& entry = mPools[pool].chunks[chunk];
+    char* data = entry.load(std::memory_order_acquire);
+    if (UTILS_LIKELY(data)) {
+        return data;
+    }
+
+    // Several threads can get here for the same chunk, the first one to publish its chunk wins
+    // and the others free theirs.
+    const size_t count = getChunkSlotCount(chunk);
+    const size_t slotsSize = count << (pool + MIN_SIZE_SHIFT);
+    const size_t size = slotsSize + count * sizeof(Metadata);
+    char* const newData = static_cast<char*>(utils::aligned_alloc(size, 16));
+    ASSERT_POSTCONDITION(newData, "couldn't allocate %u KiB for handles", unsigned(size / 1024));
+
+    Metadata* const metadata = reinterpret_cast<Metadata*>(newData + slotsSize);
+    for (size_t i = 0; i < count; i++) {
+        new(&metadata[i]) Metadata();
+    }
+
+    if (entry.compare_exchange_strong(data, newData,
+            std::memory_order_acq_rel, std::memory_order_acquire)) {
+        mAllocatedSize.fetch_add(size, std::memory_order_relaxed);
+        return newData;
+    }
+    utils::aligned_free(newData);
+    return data;
+}
+
+} // namespace filament
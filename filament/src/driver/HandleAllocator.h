@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_DRIVER_HANDLEALLOCATOR_H
+#define TNT_FILAMENT_DRIVER_HANDLEALLOCATOR_H
+
+#include "driver/Handle.h"
+
+#include <utils/algorithm.h>
+#include <utils/compiler.h>
+
+#include <atomic>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace filament {
+
+/*
+ * Allocates the memory of the driver's objects and maps their handles to it.
+ *
+ * Objects are grouped by size in pools, from 16 bytes to 2 KiB in powers of two. A pool is a
+ * list of chunks, each twice as large as the previous one, which are allocated as the pool
+ * grows. Chunks never move, so growing doesn't invalidate the existing handles.
+ *
+ * Allocation and deallocation are lock-free and can happen on any thread. Freed slots are kept
+ * in a free list per pool.
+ *
+ * A handle id encodes its pool, its slot in the pool, and the generation of the slot, which is
+ * incremented each time the slot is freed. This is used to detect handles used after their
+ * object was destroyed.
+ */
+class HandleAllocator {
+public:
+    using HandleId = HandleBase::HandleId;
+
+    static constexpr size_t MIN_SIZE_SHIFT = 4;     // objects of the first pool are 16 bytes
+    static constexpr size_t POOL_COUNT = 8;
+    static constexpr size_t MAX_SIZE = size_t(1) << (MIN_SIZE_SHIFT + POOL_COUNT - 1);
+
+    HandleAllocator() noexcept;
+    ~HandleAllocator() noexcept;
+
+    HandleAllocator(HandleAllocator const& rhs) = delete;
+    HandleAllocator& operator=(HandleAllocator const& rhs) = delete;
+
+    // Returns the id of an uninitialized slot of at least size bytes, aligned to 16 bytes.
+    HandleId allocate(size_t size) noexcept;
+
+    // Returns a slot to its pool, id must not be used afterwards.
+    void deallocate(HandleId id) noexcept;
+
+    // Returns the address of the slot of an id returned by allocate().
+    void* handle_cast(HandleId id) const noexcept {
+        size_t chunk, offset;
+        locate(getSlot(id), chunk, offset);
+        // The handle was given to this thread through the command stream (or it was created
+        // on this thread), which orders the creation of its chunk before this load.
+        char* const data = mPools[getPool(id)].chunks[chunk].load(std::memory_order_relaxed);
+        return data + (offset << (getPool(id) + MIN_SIZE_SHIFT));
+    }
+
+    // Returns false if the slot of this id was freed since the id was allocated.
+    bool isValid(HandleId id) const noexcept;
+
+    // size of all the chunks allocated by the pools
+    size_t getAllocatedSize() const noexcept {
+        return mAllocatedSize.load(std::memory_order_relaxed);
+    }
+
+    // size of the slots in use, and the most that was ever in use
+    size_t getUsedSize() const noexcept {
+        return mUsedSize.load(std::memory_order_relaxed);
+    }
+    size_t getPeakUsedSize() const noexcept {
+        return mPeakUsedSize.load(std::memory_order_relaxed);
+    }
+
+#ifndef NDEBUG
+    // the type of the object constructed in a slot, to check handle casts
+    void setTypeId(HandleId id, const char* typeId) noexcept;
+    const char* getTypeId(HandleId id) const noexcept;
+#endif
+
+private:
+    // an id is: | 0 | generation:8 | pool:3 | slot:20 |, so it's never nullid
+    static constexpr size_t SLOT_BITS = 20;
+    static constexpr size_t POOL_BITS = 3;
+    static constexpr size_t GENERATION_BITS = 8;
+    static constexpr uint32_t SLOT_MASK = (1u << SLOT_BITS) - 1u;
+    static constexpr uint32_t POOL_MASK = (1u << POOL_BITS) - 1u;
+    static constexpr uint32_t GENERATION_MASK = (1u << GENERATION_BITS) - 1u;
+
+    static_assert(POOL_COUNT <= (1u << POOL_BITS), "too many pools for the pool bits");
+    static_assert(SLOT_BITS + POOL_BITS + GENERATION_BITS < 32, "an id could be nullid");
+
+    // the first chunk of a pool has 16 slots
+    static constexpr size_t FIRST_CHUNK_SHIFT = 4;
+    static constexpr size_t MAX_CHUNKS = SLOT_BITS - FIRST_CHUNK_SHIFT + 1;
+
+    // stored after the slots of a chunk
+    struct Metadata {
+        std::atomic<uint32_t> next;         // next free slot plus one, when this slot is free
+        std::atomic<uint8_t> generation;
+#ifndef NDEBUG
+        const char* typeId;
+#endif
+    };
+
+    struct Pool {
+        // The first free slot plus one, or 0 when the list is empty, in the low 32 bits. The
+        // high 32 bits are incremented each time the head changes to avoid the ABA problem.
+        std::atomic<uint64_t> freeList = { 0 };
+        std::atomic<uint32_t> count = { 0 };    // number of slots ever allocated
+        std::atomic<char*> chunks[MAX_CHUNKS] = {};
+    };
+
+    static uint32_t getSlot(HandleId id) noexcept {
+        return id & SLOT_MASK;
+    }
+
+    static size_t getPool(HandleId id) noexcept {
+        return (id >> SLOT_BITS) & POOL_MASK;
+    }
+
+    static uint32_t getGeneration(HandleId id) noexcept {
+        return (id >> (SLOT_BITS + POOL_BITS)) & GENERATION_MASK;
+    }
+
+    static size_t getChunkSlotCount(size_t chunk) noexcept {
+        return size_t(1) << (chunk + FIRST_CHUNK_SHIFT);
+    }
+
+    // chunk i holds the slots [16 * (2^i - 1), 16 * (2^(i+1) - 1))
+    static void locate(uint32_t slot, size_t& chunk, size_t& offset) noexcept {
+        const uint32_t n = (slot >> FIRST_CHUNK_SHIFT) + 1u;
+        chunk = 31u - utils::clz(n);
+        offset = slot - (((1u << chunk) - 1u) << FIRST_CHUNK_SHIFT);
+    }
+
+    Metadata& getMetadata(size_t pool, uint32_t slot) const noexcept;
+    char* getOrCreateChunk(size_t pool, size_t chunk) noexcept;
+
+    Pool mPools[POOL_COUNT];
+    std::atomic<size_t> mAllocatedSize = { 0 };
+    std::atomic<size_t> mUsedSize = { 0 };
+    std::atomic<size_t> mPeakUsedSize = { 0 };
+};
+
+} // namespace filament
+
+#endif // TNT_FILAMENT_DRIVER_HANDLEALLOCATOR_H
@@ -16,6 +16,15 @@
 
 #include <filament/driver/Platform.h>
 
+#include <utils/Hash.h>
+#include <utils/Log.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
 #if defined(ANDROID)
     #ifndef USE_EXTERNAL_GLES3
         #include "driver/opengl/PlatformEGL.h"
@@ -144,5 +153,89 @@ void Platform::destroy(Platform** context) noexcept {
     *context = nullptr;
 }
 
+// ------------------------------------------------------------------------------------------------
+// Default blob cache
+//
+// Each blob is a file named after the hash of its key. The file starts with the key itself,
+// so that a collision is detected and treated as a miss.
+// ------------------------------------------------------------------------------------------------
+
+void Platform::setBlobCacheDirectory(const char* path) noexcept {
+    mBlobCacheDirectory = utils::CString(path);
+}
+
+bool Platform::hasBlobCache() const noexcept {
+    return !mBlobCacheDirectory.empty();
+}
+
+utils::CString Platform::getBlobPath(const void* key, size_t keySize) const noexcept {
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.blob",
+            (unsigned long long)utils::hash::fnv1a64(key, keySize));
+    std::string path(mBlobCacheDirectory.c_str_safe());
+    path += name;
+    return utils::CString(path.c_str(), path.size());
+}
+
+void Platform::insertBlob(const void* key, size_t keySize,
+        const void* value, size_t valueSize) noexcept {
+    if (!hasBlobCache() || !keySize) {
+        return;
+    }
+    // write to a temporary file first, so another process never reads a partial blob
+    utils::CString path(getBlobPath(key, keySize));
+    std::string temp(path.c_str());
+    temp += ".tmp";
+    {
+        std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+        const uint64_t size = keySize;
+        file.write((const char*)&size, sizeof(size));
+        file.write((const char*)key, keySize);
+        file.write((const char*)value, valueSize);
+        if (!file) {
+            utils::slog.w << "Couldn't write the blob " << temp.c_str() << utils::io::endl;
+            file.close();
+            std::remove(temp.c_str());
+            return;
+        }
+    }
+    if (std::rename(temp.c_str(), path.c_str()) != 0) {
+        std::remove(temp.c_str());
+    }
+}
+
+size_t Platform::retrieveBlob(const void* key, size_t keySize,
+        void* value, size_t valueSize) noexcept {
+    if (!hasBlobCache() || !keySize) {
+        return 0;
+    }
+    std::ifstream file(getBlobPath(key, keySize).c_str(), std::ios::binary | std::ios::ate);
+    if (!file) {
+        return 0;
+    }
+    const uint64_t fileSize = uint64_t(file.tellg());
+    file.seekg(0);
+
+    uint64_t size = 0;
+    file.read((char*)&size, sizeof(size));
+    if (!file || size != keySize || fileSize < sizeof(size) + keySize) {
+        return 0;
+    }
+    std::vector<char> storedKey(keySize);
+    file.read(storedKey.data(), keySize);
+    if (!file || memcmp(storedKey.data(), key, keySize) != 0) {
+        return 0;
+    }
+
+    const size_t blobSize = size_t(fileSize - sizeof(size) - keySize);
+    if (value && valueSize >= blobSize) {
+        file.read((char*)value, blobSize);
+        if (!file) {
+            return 0;
+        }
+    }
+    return blobSize;
+}
+
 } // namespace driver
 } // namespace filament
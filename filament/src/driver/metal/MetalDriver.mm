@@ -132,59 +132,59 @@ void MetalDriver::createVertexBuffer(Driver::VertexBufferHandle vbh, uint8_t buf
         uint8_t attributeCount, uint32_t vertexCount, Driver::AttributeArray attributes,
         Driver::BufferUsage usage) {
     // TODO: Take BufferUsage into account when creating the buffer.
-    construct_handle<MetalVertexBuffer>(mHandleMap, vbh, pImpl->mDevice, bufferCount,
+    construct<MetalVertexBuffer>(vbh, pImpl->mDevice, bufferCount,
             attributeCount, vertexCount, attributes);
 }
 
 void MetalDriver::createIndexBuffer(Driver::IndexBufferHandle ibh, Driver::ElementType elementType,
         uint32_t indexCount, Driver::BufferUsage usage) {
     auto elementSize = (uint8_t) getElementTypeSize(elementType);
-    construct_handle<MetalIndexBuffer>(mHandleMap, ibh, pImpl->mDevice, elementSize, indexCount);
+    construct<MetalIndexBuffer>(ibh, pImpl->mDevice, elementSize, indexCount);
 }
 
 void MetalDriver::createTexture(Driver::TextureHandle th, Driver::SamplerType target, uint8_t levels,
         Driver::TextureFormat format, uint8_t samples, uint32_t width, uint32_t height,
         uint32_t depth, Driver::TextureUsage usage) {
-    construct_handle<MetalTexture>(mHandleMap, th, pImpl->mDevice, target, levels, format, samples,
+    construct<MetalTexture>(th, pImpl->mDevice, target, levels, format, samples,
             width, height, depth, usage);
 }
 
 void MetalDriver::createSamplerBuffer(Driver::SamplerBufferHandle sbh, size_t size) {
-    construct_handle<MetalSamplerBuffer>(mHandleMap, sbh, size);
+    construct<MetalSamplerBuffer>(sbh, size);
 }
 
 void MetalDriver::createUniformBuffer(Driver::UniformBufferHandle ubh, size_t size,
         Driver::BufferUsage usage) {
-    construct_handle<MetalUniformBuffer>(mHandleMap, ubh, pImpl->mDevice, size);
+    construct<MetalUniformBuffer>(ubh, pImpl->mDevice, size);
 }
 
 void MetalDriver::createRenderPrimitive(Driver::RenderPrimitiveHandle rph, int dummy) {
-    construct_handle<MetalRenderPrimitive>(mHandleMap, rph);
+    construct<MetalRenderPrimitive>(rph);
 }
 
 void MetalDriver::createProgram(Driver::ProgramHandle rph, Program&& program) {
-    construct_handle<MetalProgram>(mHandleMap, rph, pImpl->mDevice, program);
+    construct<MetalProgram>(rph, pImpl->mDevice, program);
 }
 
 void MetalDriver::createDefaultRenderTarget(Driver::RenderTargetHandle rth, int dummy) {
-    construct_handle<MetalRenderTarget>(mHandleMap, rth);
+    construct<MetalRenderTarget>(rth);
 }
 
 void MetalDriver::createRenderTarget(Driver::RenderTargetHandle rth,
         Driver::TargetBufferFlags targetBufferFlags, uint32_t width, uint32_t height,
         uint8_t samples, Driver::TextureFormat format, Driver::TargetBufferInfo color,
         Driver::TargetBufferInfo depth, Driver::TargetBufferInfo stencil) {
-    auto renderTarget = construct_handle<MetalRenderTarget>(mHandleMap, rth, width, height);
+    auto renderTarget = construct<MetalRenderTarget>(rth, width, height);
 
     if (color.handle) {
-        auto colorTexture = handle_cast<MetalTexture>(mHandleMap, color.handle);
+        auto colorTexture = handle_cast<MetalTexture*>(color.handle);
         renderTarget->color = [colorTexture->texture retain];
     } else if (targetBufferFlags & TargetBufferFlags::COLOR) {
         ASSERT_POSTCONDITION(false, "A color buffer is required for a render target.");
     }
 
     if (depth.handle) {
-        auto depthTexture = handle_cast<MetalTexture>(mHandleMap, depth.handle);
+        auto depthTexture = handle_cast<MetalTexture*>(depth.handle);
         renderTarget->depth = [depthTexture->texture retain];
     } else if (targetBufferFlags & TargetBufferFlags::DEPTH) {
         MTLTextureDescriptor* depthTextureDesc =
@@ -208,7 +208,7 @@ void MetalDriver::createFence(Driver::FenceHandle, int dummy) {
 
 void MetalDriver::createSwapChain(Driver::SwapChainHandle sch, void* nativeWindow, uint64_t flags) {
     auto* metalLayer = (CAMetalLayer*) nativeWindow;
-    construct_handle<MetalSwapChain>(mHandleMap, sch, pImpl->mDevice, metalLayer);
+    construct<MetalSwapChain>(sch, pImpl->mDevice, metalLayer);
 }
 
 void MetalDriver::createStreamFromTextureId(Driver::StreamHandle, intptr_t externalTextureId,
@@ -266,55 +266,55 @@ Driver::StreamHandle MetalDriver::createStreamFromTextureIdSynchronous() noexcep
 
 void MetalDriver::destroyVertexBuffer(Driver::VertexBufferHandle vbh) {
     if (vbh) {
-        destruct_handle<MetalVertexBuffer>(mHandleMap, vbh);
+        destruct<MetalVertexBuffer>(vbh);
     }
 }
 
 void MetalDriver::destroyIndexBuffer(Driver::IndexBufferHandle ibh) {
     if (ibh) {
-        destruct_handle<MetalIndexBuffer>(mHandleMap, ibh);
+        destruct<MetalIndexBuffer>(ibh);
     }
 }
 
 void MetalDriver::destroyRenderPrimitive(Driver::RenderPrimitiveHandle rph) {
     if (rph) {
-        destruct_handle<MetalRenderPrimitive>(mHandleMap, rph);
+        destruct<MetalRenderPrimitive>(rph);
     }
 }
 
 void MetalDriver::destroyProgram(Driver::ProgramHandle ph) {
     if (ph) {
-        destruct_handle<MetalProgram>(mHandleMap, ph);
+        destruct<MetalProgram>(ph);
     }
 }
 
 void MetalDriver::destroySamplerBuffer(Driver::SamplerBufferHandle sbh) {
     if (sbh) {
-        destruct_handle<MetalSamplerBuffer>(mHandleMap, sbh);
+        destruct<MetalSamplerBuffer>(sbh);
     }
 }
 
 void MetalDriver::destroyUniformBuffer(Driver::UniformBufferHandle ubh) {
     if (ubh) {
-        destruct_handle<MetalUniformBuffer>(mHandleMap, ubh);
+        destruct<MetalUniformBuffer>(ubh);
     }
 }
 
 void MetalDriver::destroyTexture(Driver::TextureHandle th) {
     if (th) {
-        destruct_handle<MetalTexture>(mHandleMap, th);
+        destruct<MetalTexture>(th);
     }
 }
 
 void MetalDriver::destroyRenderTarget(Driver::RenderTargetHandle rth) {
     if (rth) {
-        destruct_handle<MetalRenderTarget>(mHandleMap, rth);
+        destruct<MetalRenderTarget>(rth);
     }
 }
 
 void MetalDriver::destroySwapChain(Driver::SwapChainHandle sch) {
     if (sch) {
-        destruct_handle<MetalSwapChain>(mHandleMap, sch);
+        destruct<MetalSwapChain>(sch);
     }
 }
 
@@ -372,27 +372,27 @@ bool MetalDriver::isFrameTimeSupported() {
 void MetalDriver::updateVertexBuffer(Driver::VertexBufferHandle vbh, size_t index,
         Driver::BufferDescriptor&& data, uint32_t byteOffset, uint32_t byteSize) {
     assert(byteOffset == 0);    // TODO: handle byteOffset for vertex buffers
-    auto* vb = handle_cast<MetalVertexBuffer>(mHandleMap, vbh);
+    auto* vb = handle_cast<MetalVertexBuffer*>(vbh);
     memcpy(vb->buffers[index].contents, data.buffer, data.size);
 }
 
 void MetalDriver::updateIndexBuffer(Driver::IndexBufferHandle ibh, Driver::BufferDescriptor&& data,
         uint32_t byteOffset, uint32_t byteSize) {
     assert(byteOffset == 0);    // TODO: handle byteOffset for index buffers
-    auto* ib = handle_cast<MetalIndexBuffer>(mHandleMap, ibh);
+    auto* ib = handle_cast<MetalIndexBuffer*>(ibh);
     memcpy(ib->buffer.contents, data.buffer, data.size);
 }
 
 void MetalDriver::update2DImage(Driver::TextureHandle th, uint32_t level, uint32_t xoffset,
         uint32_t yoffset, uint32_t width, uint32_t height, Driver::PixelBufferDescriptor&& data) {
-    auto tex = handle_cast<MetalTexture>(mHandleMap, th);
+    auto tex = handle_cast<MetalTexture*>(th);
     tex->load2DImage(level, xoffset, yoffset, width, height, data);
     scheduleDestroy(std::move(data));
 }
 
 void MetalDriver::updateCubeImage(Driver::TextureHandle th, uint32_t level,
         Driver::PixelBufferDescriptor&& data, Driver::FaceOffsets faceOffsets) {
-    auto tex = handle_cast<MetalTexture>(mHandleMap, th);
+    auto tex = handle_cast<MetalTexture*>(th);
     tex->loadCubeImage(data, faceOffsets, level);
     scheduleDestroy(std::move(data));
 }
@@ -407,20 +407,20 @@ void MetalDriver::setExternalStream(Driver::TextureHandle th, Driver::StreamHand
 
 void MetalDriver::updateUniformBuffer(Driver::UniformBufferHandle ubh,
         Driver::BufferDescriptor&& data) {
-    auto buffer = handle_cast<MetalUniformBuffer>(mHandleMap, ubh);
+    auto buffer = handle_cast<MetalUniformBuffer*>(ubh);
     buffer->copyIntoBuffer(data.buffer, data.size);
     scheduleDestroy(std::move(data));
 }
 
 void MetalDriver::updateSamplerBuffer(Driver::SamplerBufferHandle sbh,
         SamplerBuffer&& samplerBuffer) {
-    auto sb = handle_cast<MetalSamplerBuffer>(mHandleMap, sbh);
+    auto sb = handle_cast<MetalSamplerBuffer*>(sbh);
     *sb->sb = samplerBuffer;
 }
 
 void MetalDriver::beginRenderPass(Driver::RenderTargetHandle rth,
         const Driver::RenderPassParams& params) {
-    auto renderTarget = handle_cast<MetalRenderTarget>(mHandleMap, rth);
+    auto renderTarget = handle_cast<MetalRenderTarget*>(rth);
     pImpl->mCurrentRenderTarget = renderTarget;
     pImpl->mCurrentRenderPassFlags = params.flags;
 
@@ -515,16 +515,16 @@ void MetalDriver::resizeRenderTarget(Driver::RenderTargetHandle rth, uint32_t wi
 
 void MetalDriver::setRenderPrimitiveBuffer(Driver::RenderPrimitiveHandle rph,
         Driver::VertexBufferHandle vbh, Driver::IndexBufferHandle ibh, uint32_t enabledAttributes) {
-    auto primitive = handle_cast<MetalRenderPrimitive>(mHandleMap, rph);
-    auto vertexBuffer = handle_cast<MetalVertexBuffer>(mHandleMap, vbh);
-    auto indexBuffer = handle_cast<MetalIndexBuffer>(mHandleMap, ibh);
+    auto primitive = handle_cast<MetalRenderPrimitive*>(rph);
+    auto vertexBuffer = handle_cast<MetalVertexBuffer*>(vbh);
+    auto indexBuffer = handle_cast<MetalIndexBuffer*>(ibh);
     primitive->setBuffers(vertexBuffer, indexBuffer, enabledAttributes);
 }
 
 void MetalDriver::setRenderPrimitiveRange(Driver::RenderPrimitiveHandle rph,
         Driver::PrimitiveType pt, uint32_t offset, uint32_t minIndex, uint32_t maxIndex,
         uint32_t count) {
-    auto primitive = handle_cast<MetalRenderPrimitive>(mHandleMap, rph);
+    auto primitive = handle_cast<MetalRenderPrimitive*>(rph);
     primitive->type = pt;
     primitive->offset = offset * primitive->indexBuffer->elementSize;
     primitive->count = count;
@@ -540,7 +540,7 @@ void MetalDriver::setViewportScissor(int32_t left, int32_t bottom, uint32_t widt
 void MetalDriver::makeCurrent(Driver::SwapChainHandle schDraw, Driver::SwapChainHandle schRead) {
     ASSERT_PRECONDITION_NON_FATAL(schDraw == schRead,
                                   "Metal driver does not support distinct draw/read swap chains.");
-    auto* swapChain = handle_cast<MetalSwapChain>(mHandleMap, schDraw);
+    auto* swapChain = handle_cast<MetalSwapChain*>(schDraw);
     pImpl->mCurrentSurface = swapChain;
 }
 
@@ -583,10 +583,11 @@ void MetalDriver::bindUniformBufferRange(size_t index, Driver::UniformBufferHand
         .ubh = ubh,
         .offset = offset
     });
+    mUniformBufferRanges[index] = { ubh, size };
 }
 
 void MetalDriver::bindSamplers(size_t index, Driver::SamplerBufferHandle sbh) {
-    auto sb = handle_cast<MetalSamplerBuffer>(mHandleMap, sbh);
+    auto sb = handle_cast<MetalSamplerBuffer*>(sbh);
     pImpl->mSamplerBindings[index] = sb;
 }
 
@@ -617,12 +618,14 @@ void MetalDriver::blit(Driver::TargetBufferFlags buffers,
         Driver::RenderTargetHandle src, driver::Viewport srcRect) {
 }
 
-void MetalDriver::draw(Driver::PipelineState ps, Driver::RenderPrimitiveHandle rph) {
+void MetalDriver::draw(Driver::PipelineState ps, Driver::RenderPrimitiveHandle rph,
+        uint32_t instanceCount) {
     ASSERT_PRECONDITION(pImpl->mCurrentCommandEncoder != nullptr,
             "Attempted to draw without a valid command encoder.");
-    auto primitive = handle_cast<MetalRenderPrimitive>(mHandleMap, rph);
-    auto program = handle_cast<MetalProgram>(mHandleMap, ps.program);
+    auto primitive = handle_cast<MetalRenderPrimitive*>(rph);
+    auto program = handle_cast<MetalProgram*>(ps.program);
     const auto& rs = ps.rasterState;
+    mDrawPipelineState = ps;
 
     // Pipeline state
     metal::PipelineState pipelineState {
@@ -691,8 +694,7 @@ void MetalDriver::draw(Driver::PipelineState ps, Driver::RenderPrimitiveHandle r
                 continue;
             }
 
-            const auto* uniform = handle_const_cast<MetalUniformBuffer>(mHandleMap,
-                    uniformState.ubh);
+            const auto* uniform = handle_cast<const MetalUniformBuffer*>(uniformState.ubh);
 
             // We have no way of knowing which uniform buffers will be used by which shader stage
             // so for now, bind the uniform buffer to both the vertex and fragment stages.
@@ -722,7 +724,7 @@ void MetalDriver::draw(Driver::PipelineState ps, Driver::RenderPrimitiveHandle r
     // If so, mark them dirty- we'll rebind all textures / samplers in a single call below.
     enumerateSamplerBuffers(program, [this](const SamplerBuffer::Sampler* sampler,
             uint8_t binding) {
-        const auto metalTexture = handle_const_cast<MetalTexture>(mHandleMap, sampler->t);
+        const auto metalTexture = handle_cast<const MetalTexture*>(sampler->t);
         auto& textureSlot = pImpl->mBoundTextures[binding];
         if (textureSlot != metalTexture->texture) {
             textureSlot = metalTexture->texture;
@@ -772,7 +774,20 @@ void MetalDriver::draw(Driver::PipelineState ps, Driver::RenderPrimitiveHandle r
                                               indexCount:primitive->count
                                                indexType:getIndexType(indexBuffer->elementSize)
                                              indexBuffer:indexBuffer->buffer
-                                       indexBufferOffset:primitive->offset];
+                                       indexBufferOffset:primitive->offset
+                                           instanceCount:instanceCount];
+}
+
+void MetalDriver::drawDelta(uint32_t index, uint32_t offset, Driver::RenderPrimitiveHandle rph,
+        uint32_t instanceCount) {
+    UniformBufferRange const& range = mUniformBufferRanges[index];
+    bindUniformBufferRange(index, range.ubh, offset, range.size);
+    draw(mDrawPipelineState, rph, instanceCount);
+}
+
+void MetalDriver::prewarmPipeline(Driver::PipelineState ps, Driver::RenderPrimitiveHandle rph,
+        Driver::RenderTargetHandle rth, const Driver::RenderPassParams& params) {
+    // TODO: create the MTLRenderPipelineState ahead of time, as the Vulkan backend does
 }
 
 void MetalDriver::enumerateSamplerBuffers(const MetalProgram *program,
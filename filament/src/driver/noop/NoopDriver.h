@@ -31,9 +31,52 @@ class NoopDriver final : public DriverBase {
 public:
     static Driver* create();
 
+    // Counters of the draw commands executed by this driver, these can be used to verify
+    // the number of draw calls issued by the renderer.
+    struct DrawStats {
+        size_t drawCalls = 0;   // number of draw() and drawDelta() commands
+        size_t deltaDrawCalls = 0;  // number of drawDelta() commands
+        size_t instances = 0;   // number of instances drawn by these commands
+        size_t uniformBufferRangeBindings = 0;  // number of bindUniformBufferRange() commands
+        size_t prewarmedPipelines = 0;  // number of prewarmPipeline() commands
+    };
+
+    DrawStats const& getDrawStats() const noexcept { return mDrawStats; }
+    void resetDrawStats() noexcept { mDrawStats = {}; }
+
 private:
     ShaderModel getShaderModel() const noexcept final;
 
+    DrawStats mDrawStats;
+
+    // Every command's arguments are forwarded to onCommand(), the non-template overloads
+    // are picked for the commands we want to track.
+    template<typename ... ARGS>
+    UTILS_ALWAYS_INLINE void onCommand(ARGS const& ...) noexcept { }
+
+    UTILS_ALWAYS_INLINE void onCommand(PipelineState const&, RenderPrimitiveHandle const&,
+            uint32_t const& instanceCount) noexcept {
+        mDrawStats.drawCalls++;
+        mDrawStats.instances += instanceCount;
+    }
+
+    UTILS_ALWAYS_INLINE void onCommand(uint32_t const&, uint32_t const&,
+            RenderPrimitiveHandle const&, uint32_t const& instanceCount) noexcept {
+        mDrawStats.drawCalls++;
+        mDrawStats.deltaDrawCalls++;
+        mDrawStats.instances += instanceCount;
+    }
+
+    UTILS_ALWAYS_INLINE void onCommand(size_t const&, UniformBufferHandle const&,
+            size_t const&, size_t const&) noexcept {
+        mDrawStats.uniformBufferRangeBindings++;
+    }
+
+    UTILS_ALWAYS_INLINE void onCommand(PipelineState const&, RenderPrimitiveHandle const&,
+            RenderTargetHandle const&, RenderPassParams const&) noexcept {
+        mDrawStats.prewarmedPipelines++;
+    }
+
     /*
      * Driver interface
      */
@@ -42,7 +85,7 @@ private:
     friend class ConcreteDispatcher;
 
 #define DECL_DRIVER_API(methodName, paramsDecl, params) \
-    UTILS_ALWAYS_INLINE void methodName(paramsDecl) { }
+    UTILS_ALWAYS_INLINE void methodName(paramsDecl) { onCommand(params); }
 
     // The only reason we return a non-zero value is so that "isTextureFormatSupported"
     // returns true, which is necessary because Engine creates an internal 1x1 texture
@@ -19,6 +19,7 @@
 #include <set>
 
 #include <utils/compiler.h>
+#include <utils/Hash.h>
 #include <utils/Log.h>
 #include <utils/Panic.h>
 #include <utils/Systrace.h>
@@ -99,7 +100,6 @@ Driver* OpenGLDriver::create(
 
 OpenGLDriver::OpenGLDriver(OpenGLPlatform* platform) noexcept
         : DriverBase(new ConcreteDispatcher<OpenGLDriver>(this)),
-          mHandleArena("Handles", 2U * 1024U * 1024U), // TODO: set the amount in configuration
           mSamplerMap(32),
           mPlatform(*platform) {
     state.enables.caps.set(getIndexForCap(GL_DITHER));
@@ -189,6 +189,19 @@ OpenGLDriver::OpenGLDriver(OpenGLPlatform* platform) noexcept
     };
     mShaderModel = shaderModel;
 
+    // Program binaries can only be reloaded by the exact driver that produced them, so the
+    // driver's identity seeds the keys of the program cache.
+    GLint programBinaryFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &programBinaryFormats);
+    if (programBinaryFormats > 0 && mPlatform.hasBlobCache()) {
+        uint64_t seed = hash::fnv1a64(&OpenGLProgram::CACHE_VERSION,
+                sizeof(OpenGLProgram::CACHE_VERSION));
+        for (char const* s : { vendor, renderer, version, shader }) {
+            seed = hash::fnv1a64(s, s ? strlen(s) + 1 : 0, seed);
+        }
+        mProgramCacheSeed = seed;
+    }
+
     /*
      * Set our default state
      */
@@ -226,6 +239,9 @@ OpenGLDriver::OpenGLDriver(OpenGLPlatform* platform) noexcept
         mOpenGLBlitter = new OpenGLBlitter(*this);
         mOpenGLBlitter->init();
     }
+
+    // the streaming ring relies on mapping buffers
+    mUniformRing.disabled = !HAS_MAPBUFFERS;
 }
 
 OpenGLDriver::~OpenGLDriver() noexcept {
@@ -251,6 +267,7 @@ void OpenGLDriver::initExtensionsGLES(GLint major, GLint minor, ExtentionSet con
     ext.EXT_color_buffer_half_float = hasExtension(exts, "GL_EXT_color_buffer_half_float");
     ext.texture_compression_s3tc = hasExtension(exts, "WEBGL_compressed_texture_s3tc");
     ext.EXT_multisampled_render_to_texture = hasExtension(exts, "GL_EXT_multisampled_render_to_texture");
+    ext.EXT_buffer_storage = hasExtension(exts, "GL_EXT_buffer_storage");
 }
 
 void OpenGLDriver::initExtensionsGL(GLint major, GLint minor, ExtentionSet const& exts) {
@@ -260,6 +277,8 @@ void OpenGLDriver::initExtensionsGL(GLint major, GLint minor, ExtentionSet const
     ext.OES_EGL_image_external_essl3 = hasExtension(exts, "GL_OES_EGL_image_external_essl3");
     ext.EXT_debug_marker = hasExtension(exts, "GL_EXT_debug_marker");
     ext.EXT_color_buffer_half_float = true;  // Assumes core profile.
+    ext.EXT_buffer_storage = (major == 4 && minor >= 4) ||
+            hasExtension(exts, "GL_ARB_buffer_storage");
 }
 
 void OpenGLDriver::terminate() {
@@ -272,6 +291,7 @@ void OpenGLDriver::terminate() {
         mOpenGLBlitter->terminate();
     }
     terminateClearProgram();
+    terminateUniformRing();
     mPlatform.terminate();
 }
 
@@ -714,101 +734,6 @@ default_case:
 // Creating driver objects
 // ------------------------------------------------------------------------------------------------
 
-// For reference on a 64-bits machine:
-//    GLFence                   :  8
-//    GLIndexBuffer             : 12        moderate
-//    GLSamplerBuffer           : 16        moderate
-// -- less than 16 bytes
-
-//    GLRenderPrimitive         : 40        many
-//    GLTexture                 : 44        moderate
-//    OpenGLProgram             : 40        moderate
-//    GLRenderTarget            : 56        few
-// -- less than 64 bytes
-
-//    GLVertexBuffer            : 80        moderate
-//    GLStream                  : 120       few
-//    GLUniformBuffer           : 128       many
-// -- less than 128 bytes
-
-
-OpenGLDriver::HandleAllocator::HandleAllocator(const utils::HeapArea& area)
-        : mPool0(area.begin(),
-                  pointermath::add(area.begin(), (1 * area.getSize()) / 16)),
-          mPool1( pointermath::add(area.begin(), (1 * area.getSize()) / 16),
-                  pointermath::add(area.begin(), (6 * area.getSize()) / 16)),
-          mPool2( pointermath::add(area.begin(), (6 * area.getSize()) / 16),
-                  area.end()) {
-
-#ifndef NDEBUG
-    slog.d << "HwFence: " << sizeof(HwFence) << io::endl;
-    slog.d << "GLIndexBuffer: " << sizeof(GLIndexBuffer) << io::endl;
-    slog.d << "GLSamplerBuffer: " << sizeof(GLSamplerBuffer) << io::endl;
-    slog.d << "GLRenderPrimitive: " << sizeof(GLRenderPrimitive) << io::endl;
-    slog.d << "GLTexture: " << sizeof(GLTexture) << io::endl;
-    slog.d << "OpenGLProgram: " << sizeof(OpenGLProgram) << io::endl;
-    slog.d << "GLRenderTarget: " << sizeof(GLRenderTarget) << io::endl;
-    slog.d << "GLVertexBuffer: " << sizeof(GLVertexBuffer) << io::endl;
-    slog.d << "GLUniformBuffer: " << sizeof(GLUniformBuffer) << io::endl;
-    slog.d << "GLStream: " << sizeof(GLStream) << io::endl;
-#endif
-}
-
-void* OpenGLDriver::HandleAllocator::alloc(size_t size, size_t alignment, size_t extra) noexcept {
-    assert(size <= mPool2.getSize());
-    if (size <= mPool0.getSize()) return mPool0.alloc(size, 16, extra);
-    if (size <= mPool1.getSize()) return mPool1.alloc(size, 32, extra);
-    if (size <= mPool2.getSize()) return mPool2.alloc(size, 32, extra);
-    return nullptr;
-}
-
-void OpenGLDriver::HandleAllocator::free(void* p, size_t size) noexcept {
-    if (size <= mPool0.getSize()) { mPool0.free(p); return; }
-    if (size <= mPool1.getSize()) { mPool1.free(p); return; }
-    if (size <= mPool2.getSize()) { mPool2.free(p); return; }
-}
-
-
-// This is "NOINLINE" because it ends-up generating more code than we'd like because of
-// the locking (unfortunately, mHandleArena is accessed from 2 threads)
-UTILS_NOINLINE
-HandleBase::HandleId OpenGLDriver::allocateHandle(size_t size) noexcept {
-    void* addr = mHandleArena.alloc(size);
-    char* const base = (char *)mHandleArena.getArea().begin();
-    size_t offset = (char*)addr - base;
-    return HandleBase::HandleId(offset >> HandleAllocator::MIN_ALIGNMENT_SHIFT);
-}
-
-template<typename D, typename B, typename ... ARGS>
-typename std::enable_if<std::is_base_of<B, D>::value, D>::type*
-OpenGLDriver::construct(Handle<B> const& handle, ARGS&& ... args) noexcept {
-    assert(handle);
-    static_assert(sizeof(D) <= 128, "Handle<> too large");
-    D* addr = handle_cast<D *>(const_cast<Handle<B>&>(handle));
-    new(addr) D(std::forward<ARGS>(args)...);
-#if !defined(NDEBUG) && UTILS_HAS_RTTI
-    addr->typeId = typeid(D).name();
-#endif
-    return addr;
-}
-
-template <typename B, typename D, typename>
-void OpenGLDriver::destruct(Handle<B>& handle, D const* p) noexcept {
-    // allow to destroy the nullptr, similarly to operator delete
-    if (p) {
-#if !defined(NDEBUG) && UTILS_HAS_RTTI
-        if (UTILS_UNLIKELY(p->typeId != typeid(D).name())) {
-            slog.e << "Destroying handle " << handle.getId() << ", type " << typeid(D).name()
-                   << ", but handle's actual type is " << p->typeId << io::endl;
-            std::terminate();
-        }
-        const_cast<D *>(p)->typeId = "(deleted)";
-#endif
-        p->~D();
-        mHandleArena.free(const_cast<D*>(p), sizeof(D));
-    }
-}
-
 Handle<HwVertexBuffer> OpenGLDriver::createVertexBufferSynchronous() noexcept {
     return Handle<HwVertexBuffer>( allocateHandle(sizeof(GLVertexBuffer)) );
 }
@@ -936,6 +861,9 @@ void OpenGLDriver::createUniformBuffer(
     glGenBuffers(1, &ub->gl.ubo.id);
     bindBuffer(GL_UNIFORM_BUFFER, ub->gl.ubo.id);
     glBufferData(GL_UNIFORM_BUFFER, size, nullptr, getBufferUsage(usage));
+    if (usage != driver::BufferUsage::STATIC && !mUniformRing.disabled) {
+        ub->gl.shadow.reset(new uint8_t[size]());
+    }
     CHECK_GL_ERROR(utils::slog.e)
 }
 
@@ -1347,6 +1275,11 @@ void OpenGLDriver::destroyUniformBuffer(Driver::UniformBufferHandle ubh) {
         if (state.buffers.genericBinding[targetIndex] == ub->gl.ubo.id) {
             state.buffers.genericBinding[targetIndex] = 0;
         }
+        for (UniformBinding& binding : mUniformBindings) {
+            if (binding.ub == ub) {
+                binding = {};
+            }
+        }
         destruct(ubh, ub);
     }
 }
@@ -1648,8 +1581,20 @@ void OpenGLDriver::updateUniformBuffer(Driver::UniformBufferHandle ubh, BufferDe
     assert(ub);
 
     if (p.size > 0) {
-        updateBuffer(GL_UNIFORM_BUFFER, &ub->gl.ubo, p,
-                (uint32_t)gets.uniform_buffer_offset_alignment);
+        if (ub->gl.shadow) {
+            // STREAM buffers are entirely replaced by each update, DYNAMIC ones only partially
+            memcpy(ub->gl.shadow.get(), p.buffer, p.size);
+            if (ub->gl.ubo.usage == driver::BufferUsage::STREAM) {
+                ub->gl.shadowSize = (uint32_t)p.size;
+                ub->gl.ubo.size = (uint32_t)p.size;
+            } else {
+                ub->gl.shadowSize = ub->gl.ubo.capacity;
+            }
+            writeUniformShadow(ub);
+        } else {
+            updateBuffer(GL_UNIFORM_BUFFER, &ub->gl.ubo, p,
+                    (uint32_t)gets.uniform_buffer_offset_alignment);
+        }
     }
     scheduleDestroy(std::move(p));
 }
@@ -1714,6 +1659,219 @@ void OpenGLDriver::updateBuffer(GLenum target,
     CHECK_GL_ERROR(utils::slog.e)
 }
 
+void OpenGLDriver::writeUniformShadow(GLUniformBuffer* ub) noexcept {
+    // The whole capacity is reserved so that the buffer can always be bound entirely.
+    uint32_t offset;
+    uint8_t* data = allocateFromUniformRing(ub->gl.ubo.capacity, &offset);
+    if (data) {
+        memcpy(data, ub->gl.shadow.get(), ub->gl.shadowSize);
+        ub->gl.ringOffset = offset;
+        ub->gl.ringFrame = mUniformRing.frame;
+        ub->gl.inRing = true;
+    } else {
+        ub->gl.inRing = false;
+        updateBuffer(GL_UNIFORM_BUFFER, &ub->gl.ubo,
+                BufferDescriptor(ub->gl.shadow.get(), ub->gl.shadowSize),
+                (uint32_t)gets.uniform_buffer_offset_alignment);
+    }
+
+    // the content moved, the binding points using it must follow
+    for (size_t i = 0; i < mUniformBindings.size(); i++) {
+        UniformBinding const& binding = mUniformBindings[i];
+        if (binding.ub == ub) {
+            bindUniformBufferContent(GLuint(i), ub, binding.offset, binding.size);
+        }
+    }
+}
+
+void OpenGLDriver::bindUniformBufferContent(GLuint index, GLUniformBuffer* ub,
+        uint32_t offset, uint32_t size) noexcept {
+    if (ub->gl.inRing) {
+        bindBufferRange(GL_UNIFORM_BUFFER, index, mUniformRing.id,
+                ub->gl.ringOffset + offset, size);
+    } else {
+        bindBufferRange(GL_UNIFORM_BUFFER, index, ub->gl.ubo.id, ub->gl.ubo.base + offset, size);
+    }
+}
+
+uint8_t* OpenGLDriver::allocateFromUniformRing(uint32_t size, uint32_t* offset) noexcept {
+    UniformRing& ring = mUniformRing;
+    if (UTILS_UNLIKELY(!ring.id)) {
+        if (ring.disabled) {
+            return nullptr;
+        }
+        glGenBuffers(1, &ring.id);
+        bindBuffer(GL_UNIFORM_BUFFER, ring.id);
+        // without the headers for buffer storage, the region is mapped while it's written
+#if defined(GL_EXT_buffer_storage) || defined(GL_VERSION_4_4)
+        if (ext.EXT_buffer_storage) {
+#if defined(GL_EXT_buffer_storage)
+            const GLbitfield flags =
+                    GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT_EXT | GL_MAP_COHERENT_BIT_EXT;
+            glBufferStorageEXT(GL_UNIFORM_BUFFER, UniformRing::CAPACITY, nullptr, flags);
+#else
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_UNIFORM_BUFFER, UniformRing::CAPACITY, nullptr, flags);
+#endif
+            ring.persistent = (uint8_t*)glMapBufferRange(GL_UNIFORM_BUFFER, 0,
+                    UniformRing::CAPACITY, flags);
+            if (!ring.persistent) {
+                // the storage is immutable, start over with a regular buffer
+                glDeleteBuffers(1, &ring.id);
+                state.buffers.genericBinding[getIndexForBufferTarget(GL_UNIFORM_BUFFER)] = 0;
+                glGenBuffers(1, &ring.id);
+                bindBuffer(GL_UNIFORM_BUFFER, ring.id);
+            }
+        }
+#endif
+        if (!ring.persistent) {
+            glBufferData(GL_UNIFORM_BUFFER, UniformRing::CAPACITY, nullptr, GL_STREAM_DRAW);
+        }
+        if (glGetError() != GL_NO_ERROR) {
+            slog.w << "Unable to create the uniform ring buffer." << io::endl;
+            terminateUniformRing();
+            ring.disabled = true;
+            return nullptr;
+        }
+    }
+
+    if (!ring.allocate(size, (uint32_t)gets.uniform_buffer_offset_alignment, offset)) {
+        if (!ring.full) {
+            slog.w << "The uniform ring buffer is full, falling back to buffer updates."
+                    << io::endl;
+            ring.full = true;
+        }
+        return nullptr;
+    }
+
+    if (ring.persistent) {
+        return ring.persistent + *offset;
+    }
+    if (!ring.mapped) {
+        // Map what's left of the region, until the next draw. Nothing reads from there until
+        // the region is recycled, which is fenced, so there is no need to synchronize.
+        ring.mappedOffset = *offset;
+        bindBuffer(GL_UNIFORM_BUFFER, ring.id);
+        ring.mapped = (uint8_t*)glMapBufferRange(GL_UNIFORM_BUFFER, ring.mappedOffset,
+                (ring.region + 1) * UniformRing::REGION_SIZE - ring.mappedOffset,
+                GL_MAP_WRITE_BIT |
+                GL_MAP_INVALIDATE_RANGE_BIT |
+                GL_MAP_FLUSH_EXPLICIT_BIT |
+                GL_MAP_UNSYNCHRONIZED_BIT);
+        if (!ring.mapped) {
+            ring.head = *offset - ring.region * UniformRing::REGION_SIZE;
+            return nullptr;
+        }
+    }
+    return ring.mapped + (*offset - ring.mappedOffset);
+}
+
+void OpenGLDriver::unmapUniformRing() noexcept {
+    UniformRing& ring = mUniformRing;
+    assert(ring.mapped);
+    bindBuffer(GL_UNIFORM_BUFFER, ring.id);
+    const uint32_t end = ring.region * UniformRing::REGION_SIZE + ring.head;
+    glFlushMappedBufferRange(GL_UNIFORM_BUFFER, 0, end - ring.mappedOffset);
+    if (glUnmapBuffer(GL_UNIFORM_BUFFER) == GL_FALSE) {
+        // This can happen in rare conditions (e.g. during a screen mode change), the content of
+        // the mapped range is lost. Its buffers get rewritten from their shadow at the next draw.
+        ring.invalidate();
+        ring.recycled = true;
+    }
+    ring.mapped = nullptr;
+}
+
+void OpenGLDriver::prepareUniformRing() noexcept {
+    UniformRing& ring = mUniformRing;
+    if (ring.recycled) {
+        // buffers that are still bound but weren't updated since their storage was recycled
+        ring.recycled = false;
+        for (UniformBinding const& binding : mUniformBindings) {
+            GLUniformBuffer* const ub = binding.ub;
+            if (ub && ub->gl.inRing && ring.isStale(ub->gl.ringFrame)) {
+                writeUniformShadow(ub);
+            }
+        }
+    }
+    // the GPU can't read from a buffer that's mapped without persistence
+    if (ring.mapped) {
+        unmapUniformRing();
+    }
+}
+
+void OpenGLDriver::advanceUniformRing() noexcept {
+    UniformRing& ring = mUniformRing;
+    if (ring.mapped) {
+        unmapUniformRing();
+    }
+    if (ring.head) {
+        ring.fences[ring.region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    // the buffers bound again without being updated must be rewritten to the new region
+    ring.advance();
+    ring.full = false;
+    ring.recycled = true;
+
+    GLsync& fence = ring.fences[ring.region];
+    if (fence) {
+        GLenum status = glClientWaitSync(fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            // The GPU is more than FRAME_COUNT - 1 frames late. Orphaning the buffer right away
+            // would reallocate it at every frame as long as the GPU stays the bottleneck.
+            SYSTRACE_NAME("glClientWaitSync");
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        }
+        if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED) {
+            // The fence might never signal (e.g. after a context loss), so the storage of the
+            // ring is orphaned rather than waited for any longer.
+            slog.w << "Timed out waiting for the uniform ring buffer, orphaning it." << io::endl;
+            orphanUniformRing();
+        } else {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+}
+
+void OpenGLDriver::orphanUniformRing() noexcept {
+    UniformRing& ring = mUniformRing;
+    if (ring.id) {
+        if (ring.mapped || ring.persistent) {
+            bindBuffer(GL_UNIFORM_BUFFER, ring.id);
+            glUnmapBuffer(GL_UNIFORM_BUFFER);
+        }
+        // The GPU keeps the storage alive for as long as it reads from it. The ring is created
+        // again at its next allocation.
+        glDeleteBuffers(1, &ring.id);
+        // bindings of bound buffers are reset to 0
+        const size_t targetIndex = getIndexForBufferTarget(GL_UNIFORM_BUFFER);
+        for (auto& buffer : state.buffers.targets[targetIndex].buffers) {
+            if (buffer.name == ring.id) {
+                buffer.name = 0;
+                buffer.offset = 0;
+                buffer.size = 0;
+            }
+        }
+        state.buffers.genericBinding[targetIndex] = 0;
+        ring.id = 0;
+        ring.persistent = nullptr;
+        ring.mapped = nullptr;
+    }
+    for (GLsync& fence : ring.fences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    // the buffers still bound must be rewritten to the new storage
+    ring.invalidate();
+    ring.recycled = true;
+}
+
+void OpenGLDriver::terminateUniformRing() noexcept {
+    orphanUniformRing();
+    mUniformRing = {};
+}
 
 void OpenGLDriver::updateSamplerBuffer(Driver::SamplerBufferHandle sbh,
         SamplerBuffer&& samplerBuffer) {
@@ -2435,8 +2593,17 @@ void OpenGLDriver::viewport(ssize_t left, ssize_t bottom, size_t width, size_t h
 void OpenGLDriver::bindUniformBuffer(size_t index, Driver::UniformBufferHandle ubh) {
     DEBUG_MARKER()
     GLUniformBuffer* ub = handle_cast<GLUniformBuffer *>(ubh);
-    assert(ub->gl.ubo.base == 0);
-    bindBufferRange(GL_UNIFORM_BUFFER, GLuint(index), ub->gl.ubo.id, 0, ub->gl.ubo.capacity);
+    if (ub->gl.shadow) {
+        if (ub->gl.inRing && mUniformRing.isStale(ub->gl.ringFrame)) {
+            writeUniformShadow(ub);
+        }
+        mUniformBindings[index] = { ub, 0, ub->gl.ubo.capacity };
+        bindUniformBufferContent(GLuint(index), ub, 0, ub->gl.ubo.capacity);
+    } else {
+        assert(ub->gl.ubo.base == 0);
+        mUniformBindings[index] = {};
+        bindBufferRange(GL_UNIFORM_BUFFER, GLuint(index), ub->gl.ubo.id, 0, ub->gl.ubo.capacity);
+    }
     CHECK_GL_ERROR(utils::slog.e)
 }
 
@@ -2448,7 +2615,18 @@ void OpenGLDriver::bindUniformBufferRange(size_t index, Driver::UniformBufferHan
     // TODO: Is this assert really needed? Note that size is only populated for STREAM buffers.
     assert(size <= ub->gl.ubo.size);
     assert(ub->gl.ubo.base + offset + size <= ub->gl.ubo.capacity);
-    bindBufferRange(GL_UNIFORM_BUFFER, GLuint(index), ub->gl.ubo.id, ub->gl.ubo.base + offset, size);
+    if (ub->gl.shadow) {
+        if (ub->gl.inRing && mUniformRing.isStale(ub->gl.ringFrame)) {
+            writeUniformShadow(ub);
+        }
+        mUniformBindings[index] = { ub, uint32_t(offset), uint32_t(size) };
+        bindUniformBufferContent(GLuint(index), ub, uint32_t(offset), uint32_t(size));
+    } else {
+        mUniformBindings[index] = {};
+        bindBufferRange(GL_UNIFORM_BUFFER, GLuint(index), ub->gl.ubo.id,
+                ub->gl.ubo.base + offset, size);
+    }
+    mUniformBufferRanges[index] = { ubh, size };
     CHECK_GL_ERROR(utils::slog.e)
 }
 
@@ -2606,6 +2784,9 @@ void OpenGLDriver::endFrame(uint32_t frameId) {
     //SYSTRACE_NAME("glFinish");
     //glFinish();
     insertEventMarker("endFrame");
+    if (mUniformRing.id) {
+        advanceUniformRing();
+    }
 }
 
 void OpenGLDriver::flush(int) {
@@ -2750,25 +2931,53 @@ void OpenGLDriver::blit(TargetBufferFlags buffers,
 
 void OpenGLDriver::draw(
         Driver::PipelineState state,
-        Driver::RenderPrimitiveHandle rph) {
+        Driver::RenderPrimitiveHandle rph,
+        uint32_t instanceCount) {
     DEBUG_MARKER()
 
+    mDrawPipelineState = state;
+
+    if (UTILS_UNLIKELY(mUniformRing.recycled || mUniformRing.mapped)) {
+        prepareUniformRing();
+    }
+
     OpenGLProgram* p = handle_cast<OpenGLProgram*>(state.program);
     useProgram(p);
 
     const GLRenderPrimitive* rp = handle_cast<const GLRenderPrimitive *>(rph);
+
     bindVertexArray(rp);
 
     setRasterState(state.rasterState);
 
     polygonOffset(state.polygonOffset.slope, state.polygonOffset.constant);
 
-    glDrawRangeElements(GLenum(rp->type), rp->minIndex, rp->maxIndex, rp->count,
-            rp->gl.indicesType, reinterpret_cast<const void*>(rp->offset));
+    if (UTILS_LIKELY(instanceCount <= 1)) {
+        glDrawRangeElements(GLenum(rp->type), rp->minIndex, rp->maxIndex, rp->count,
+                rp->gl.indicesType, reinterpret_cast<const void*>(rp->offset));
+    } else {
+        glDrawElementsInstanced(GLenum(rp->type), rp->count,
+                rp->gl.indicesType, reinterpret_cast<const void*>(rp->offset),
+                GLsizei(instanceCount));
+    }
 
     CHECK_GL_ERROR(utils::slog.e)
 }
 
+void OpenGLDriver::drawDelta(uint32_t index, uint32_t offset,
+        Driver::RenderPrimitiveHandle rph, uint32_t instanceCount) {
+    DEBUG_MARKER()
+
+    UniformBufferRange const& range = mUniformBufferRanges[index];
+    bindUniformBufferRange(index, range.ubh, offset, range.size);
+    draw(mDrawPipelineState, rph, instanceCount);
+}
+
+void OpenGLDriver::prewarmPipeline(Driver::PipelineState, Driver::RenderPrimitiveHandle,
+        Driver::RenderTargetHandle, const Driver::RenderPassParams&) {
+    // GL has no pipeline objects, programs are linked when they're created
+}
+
 // explicit instantiation of the Dispatcher
 template class ConcreteDispatcher<OpenGLDriver>;
 
@@ -20,14 +20,15 @@
 #include "driver/Driver.h"
 #include "driver/DriverBase.h"
 #include "driver/opengl/GLUtils.h"
+#include "driver/opengl/UniformRingRegions.h"
 
 #include <utils/compiler.h>
-#include <utils/Allocator.h>
 
 #include <math/vec4.h>
 
 #include <tsl/robin_map.h>
 
+#include <memory>
 #include <set>
 
 #include <assert.h>
@@ -79,6 +80,13 @@ public:
         }
         struct {
             GLBuffer ubo;
+            // DYNAMIC and STREAM buffers are written to the streaming ring, the shadow keeps
+            // their content for when the ring recycles their storage.
+            std::unique_ptr<uint8_t[]> shadow;
+            uint32_t shadowSize = 0;        // bytes of the shadow that are used
+            uint32_t ringOffset = 0;        // where the content is in the ring
+            uint64_t ringFrame = 0;         // frame the content was written to the ring
+            bool inRing = false;            // false if the content is in ubo
         } gl;
     };
 
@@ -210,59 +218,6 @@ private:
 #include "driver/DriverAPI.inc"
 
 
-    // Memory management...
-
-    class HandleAllocator {
-        utils::PoolAllocator< 16, 16>   mPool0;
-        utils::PoolAllocator< 64, 32>   mPool1;
-        utils::PoolAllocator<128, 32>   mPool2;
-    public:
-        static constexpr size_t MIN_ALIGNMENT_SHIFT = 4;
-        explicit HandleAllocator(const utils::HeapArea& area);
-        void* alloc(size_t size, size_t alignment, size_t extra = 0) noexcept;
-        void free(void* p, size_t size) noexcept;
-    };
-
-    // the arenas for handle allocation needs to be thread-safe
-#ifndef NDEBUG
-    using HandleArena = utils::Arena<HandleAllocator,
-            utils::LockingPolicy::SpinLock,
-            utils::TrackingPolicy::HighWatermark>;
-#else
-    using HandleArena = utils::Arena<HandleAllocator,
-            utils::LockingPolicy::SpinLock>;
-#endif
-
-    HandleArena mHandleArena;
-
-    HandleBase::HandleId allocateHandle(size_t size) noexcept;
-
-    template<typename D, typename B, typename ... ARGS>
-    typename std::enable_if<std::is_base_of<B, D>::value, D>::type*
-            construct(Handle<B> const& handle, ARGS&& ... args) noexcept;
-
-    template<typename B, typename D,
-            typename = typename std::enable_if<std::is_base_of<B, D>::value, D>::type>
-    void destruct(Handle<B>& handle, D const* p) noexcept;
-
-
-    /*
-     * handle_cast
-     *
-     * casts a Handle<> to a pointer to the data it refers to.
-     */
-
-    template<typename Dp, typename B>
-    inline
-    typename std::enable_if<
-            std::is_pointer<Dp>::value &&
-            std::is_base_of<B, typename std::remove_pointer<Dp>::type>::value, Dp>::type
-    handle_cast(Handle<B>& handle) noexcept {
-        char* const base = (char *)mHandleArena.getArea().begin();
-        size_t offset = handle.getId() << HandleAllocator::MIN_ALIGNMENT_SHIFT;
-        return static_cast<Dp>(static_cast<void *>(base + offset));
-    }
-
     typedef filament::math::details::TVec4<GLint> vec4gli;
 
     friend class OpenGLProgram;
@@ -534,6 +489,7 @@ private:
         bool EXT_debug_marker = false;
         bool EXT_color_buffer_half_float = false;
         bool EXT_multisampled_render_to_texture = false;
+        bool EXT_buffer_storage = false;
     } ext;
 
     struct {
@@ -567,9 +523,46 @@ private:
 
     driver::OpenGLPlatform& mPlatform;
 
+    // seeds the keys of the program binary cache, 0 when the cache isn't used
+    uint64_t mProgramCacheSeed = 0;
+
     OpenGLBlitter* mOpenGLBlitter = nullptr;
     void updateStream(GLTexture* t, driver::DriverApi* driver) noexcept;
     void updateBuffer(GLenum target, GLBuffer* buffer, BufferDescriptor const& p, uint32_t alignment = 16) noexcept;
+
+    // Streaming ring holding the content of the DYNAMIC and STREAM uniform buffers, so that
+    // updating them needs neither a map nor a glBufferSubData() each. Each region is fenced at
+    // the end of its frame, so a buffer bound in a frame that didn't write it is rewritten first.
+    // The ring is persistently mapped when buffer storage is supported, otherwise the region is
+    // mapped unsynchronized while uniforms are written.
+    struct UniformRing : public UniformRingRegions {
+        GLuint id = 0;
+        bool disabled = false;              // the ring isn't supported or couldn't be created
+        bool full = false;                  // the current region ran out of space
+        bool recycled = false;              // bindings must be checked for recycled storage
+        uint8_t* persistent = nullptr;      // the whole ring, if persistently mapped
+        uint8_t* mapped = nullptr;          // otherwise, the mapped part of the current region
+        uint32_t mappedOffset = 0;          // offset of mapped in the ring
+        GLsync fences[FRAME_COUNT] = {};
+    } mUniformRing;
+
+    // uniform buffers whose content may be in the ring, by binding point
+    struct UniformBinding {
+        GLUniformBuffer* ub = nullptr;
+        uint32_t offset = 0;
+        uint32_t size = 0;
+    };
+    std::array<UniformBinding, Program::NUM_UNIFORM_BINDINGS> mUniformBindings;
+
+    void writeUniformShadow(GLUniformBuffer* ub) noexcept;
+    void bindUniformBufferContent(GLuint index, GLUniformBuffer* ub,
+            uint32_t offset, uint32_t size) noexcept;
+    uint8_t* allocateFromUniformRing(uint32_t size, uint32_t* offset) noexcept;
+    void unmapUniformRing() noexcept;
+    void prepareUniformRing() noexcept;
+    void advanceUniformRing() noexcept;
+    void orphanUniformRing() noexcept;
+    void terminateUniformRing() noexcept;
 };
 
 // ------------------------------------------------------------------------------------------------
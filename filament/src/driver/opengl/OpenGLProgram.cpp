@@ -17,8 +17,11 @@
 #include "driver/opengl/OpenGLProgram.h"
 
 #include <cctype>
+#include <memory>
 #include <sstream>
+#include <vector>
 
+#include <utils/Hash.h>
 #include <utils/Log.h>
 #include <utils/compiler.h>
 #include <utils/Panic.h>
@@ -41,12 +44,73 @@ static char* copy_n(char const* s, size_t n, char* d) noexcept {
     return d;
 }
 
-OpenGLProgram::OpenGLProgram(OpenGLDriver* gl, const Program& programBuilder) noexcept
-        :  HwProgram(programBuilder.getName()), mIsValid(false) {
+// A cached program is a ProgramBlobHeader, followed by the sources it was built from and its
+// binary. The sources are compared on load, because the key is only a hash of them.
+struct ProgramBlobHeader {
+    GLenum format;
+    uint32_t sourcesSize;
+};
+
+// Reloads a program from the cache, returns 0 if it isn't there or the driver rejects it.
+static GLuint loadProgramBinary(driver::Platform& platform,
+        void const* key, size_t keySize, std::vector<char> const& sources) noexcept {
+    const size_t size = platform.retrieveBlob(key, keySize, nullptr, 0);
+    const size_t binaryOffset = sizeof(ProgramBlobHeader) + sources.size();
+    if (size <= binaryOffset) {
+        return 0;
+    }
+    std::unique_ptr<uint8_t[]> blob(new uint8_t[size]);
+    if (platform.retrieveBlob(key, keySize, blob.get(), size) != size) {
+        return 0;
+    }
+    ProgramBlobHeader header;
+    memcpy(&header, blob.get(), sizeof(header));
+    if (header.sourcesSize != sources.size() ||
+            memcmp(blob.get() + sizeof(header), sources.data(), sources.size()) != 0) {
+        // another program has the same key
+        return 0;
+    }
 
-    using Shader = Program::Shader;
+    GLint status;
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.format,
+            blob.get() + binaryOffset, GLsizei(size - binaryOffset));
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (UTILS_UNLIKELY(status != GL_TRUE)) {
+        // this happens when the driver is updated, the program is then rebuilt from source
+        glGetError(); // an unsupported format sets an error, which we don't care about
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
 
-    const auto& shadersSource = programBuilder.getShadersSource();
+// Stores a linked program in the cache.
+static void saveProgramBinary(driver::Platform& platform,
+        void const* key, size_t keySize, std::vector<char> const& sources, GLuint program) noexcept {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+    const size_t binaryOffset = sizeof(ProgramBlobHeader) + sources.size();
+    std::unique_ptr<uint8_t[]> blob(new uint8_t[binaryOffset + length]);
+    ProgramBlobHeader header = { 0, uint32_t(sources.size()) };
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &header.format, blob.get() + binaryOffset);
+    if (written > 0) {
+        memcpy(blob.get(), &header, sizeof(header));
+        memcpy(blob.get() + sizeof(header), sources.data(), sources.size());
+        platform.insertBlob(key, keySize, blob.get(), binaryOffset + size_t(written));
+    }
+}
+
+constexpr uint32_t OpenGLProgram::CACHE_VERSION;
+
+GLuint OpenGLProgram::compileProgram(
+        std::array<CString, Program::NUM_SHADER_TYPES> const& shadersSource,
+        bool retrievable) noexcept {
+    using Shader = Program::Shader;
 
     // build all shaders
     #pragma nounroll
@@ -74,7 +138,7 @@ OpenGLProgram::OpenGLProgram(OpenGLDriver* gl, const Program& programBuilder) no
             if (UTILS_UNLIKELY(status != GL_TRUE)) {
                 logCompilationError(slog.e, shaderId, source);
                 glDeleteShader(shaderId);
-                return;
+                return 0;
             }
             this->gl.shaders[i] = shaderId;
             mValidShaderSet |= 1U << i;
@@ -84,25 +148,61 @@ OpenGLProgram::OpenGLProgram(OpenGLDriver* gl, const Program& programBuilder) no
     // we need at least a vertex and fragment program
     const uint8_t validShaderSet = mValidShaderSet;
     const uint8_t mask = VERTEX_SHADER_BIT | FRAGMENT_SHADER_BIT;
-    if (UTILS_LIKELY((mValidShaderSet & mask) == mask)) {
-        GLint status;
-        GLuint program = glCreateProgram();
-        for (size_t i = 0; i < Program::NUM_SHADER_TYPES; i++) {
-            if (validShaderSet & (1U << i)) {
-                glAttachShader(program, this->gl.shaders[i]);
-            }
+    if (UTILS_UNLIKELY((validShaderSet & mask) != mask)) {
+        return 0;
+    }
+
+    GLint status;
+    GLuint program = glCreateProgram();
+    for (size_t i = 0; i < Program::NUM_SHADER_TYPES; i++) {
+        if (validShaderSet & (1U << i)) {
+            glAttachShader(program, this->gl.shaders[i]);
         }
-        glLinkProgram(program);
+    }
+    if (retrievable) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(program);
+
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (UTILS_UNLIKELY(status != GL_TRUE)) {
+        char error[512];
+        glGetProgramInfoLog(program, sizeof(error), nullptr, error);
 
-        glGetProgramiv(program, GL_LINK_STATUS, &status);
-        if (UTILS_UNLIKELY(status != GL_TRUE)) {
-            char error[512];
-            glGetProgramInfoLog(program, sizeof(error), nullptr, error);
+        slog.e << "LINKING: " << error << io::endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
 
-            slog.e << "LINKING: " << error << io::endl;
-            glDeleteProgram(program);
-            return;
+OpenGLProgram::OpenGLProgram(OpenGLDriver* gl, const Program& programBuilder) noexcept
+        :  HwProgram(programBuilder.getName()), mIsValid(false) {
+
+    const auto& shadersSource = programBuilder.getShadersSource();
+
+    // the program cache is keyed by the driver and the shaders' source, the sources are
+    // concatenated with their null terminators, so that each shader's boundary is kept
+    uint64_t cacheKey[2] = { gl->mProgramCacheSeed, 0 };
+    std::vector<char> sources;
+    if (cacheKey[0]) {
+        for (size_t i = 0; i < Program::NUM_SHADER_TYPES; i++) {
+            char const* const source = shadersSource[i].c_str_safe();
+            sources.insert(sources.end(), source, source + shadersSource[i].length() + 1);
         }
+        cacheKey[1] = hash::fnv1a64(sources.data(), sources.size());
+    }
+
+    GLuint program = cacheKey[0] ?
+            loadProgramBinary(gl->mPlatform, cacheKey, sizeof(cacheKey), sources) : 0;
+    if (!program) {
+        program = compileProgram(shadersSource, cacheKey[0] != 0);
+        if (program && cacheKey[0]) {
+            saveProgramBinary(gl->mPlatform, cacheKey, sizeof(cacheKey), sources, program);
+        }
+    }
+
+    if (UTILS_LIKELY(program)) {
         this->gl.program = program;
 
         // Associate each UniformBlock in the program to a known binding.
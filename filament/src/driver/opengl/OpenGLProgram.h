@@ -66,6 +66,9 @@ public:
 
     static void logCompilationError(utils::io::ostream& out, GLuint shaderId, char const* source) noexcept;
 
+    // incremented when the content of the program cache changes, which invalidates it
+    static constexpr uint32_t CACHE_VERSION = 2;
+
 private:
     static constexpr uint8_t NUM_TEXTURE_UNITS = OpenGLDriver::MAX_TEXTURE_UNITS;
     static constexpr uint8_t VERTEX_SHADER_BIT   = uint8_t(1) << size_t(Program::Shader::VERTEX);
@@ -94,6 +97,10 @@ private:
     std::array<uint8_t, NUM_TEXTURE_UNITS> mIndicesRuns;    // 16 bytes
 
     void updateSamplers(OpenGLDriver* gl) noexcept;
+
+    // compiles and links the program from source, returns 0 on failure
+    GLuint compileProgram(std::array<utils::CString, Program::NUM_SHADER_TYPES> const& shadersSource,
+            bool retrievable) noexcept;
 };
 
 
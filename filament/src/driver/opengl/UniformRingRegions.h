@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_DRIVER_OPENGL_UNIFORMRINGREGIONS_H
+#define TNT_FILAMENT_DRIVER_OPENGL_UNIFORMRINGREGIONS_H
+
+#include <stdint.h>
+
+namespace filament {
+
+/*
+ * The bookkeeping of the OpenGL uniform streaming ring, which is split in one region per frame
+ * in flight. A region is only fenced by the frame that wrote it, so its content becomes stale as
+ * soon as that frame ends, even if the following frames still use it: they must rewrite it.
+ */
+struct UniformRingRegions {
+    static constexpr uint32_t FRAME_COUNT = 3;
+    static constexpr uint32_t REGION_SIZE = 2 * 1024 * 1024;
+    static constexpr uint32_t CAPACITY = FRAME_COUNT * REGION_SIZE;
+
+    uint32_t region = 0;                // region of the current frame
+    uint32_t head = 0;                  // next free byte in the current region
+    uint64_t frame = 0;                 // number of frames ended since the ring exists
+    uint64_t oldestFrame = 0;           // content written before this frame must be rewritten
+
+    // Returns false if the current region has no room left for size bytes. The offset is in
+    // the ring and a multiple of alignment, which must be a power of two.
+    bool allocate(uint32_t size, uint32_t alignment, uint32_t* offset) noexcept {
+        const uint32_t start = (head + (alignment - 1u)) & ~(alignment - 1u);
+        if (start + size > REGION_SIZE) {
+            return false;
+        }
+        head = start + size;
+        *offset = region * REGION_SIZE + start;
+        return true;
+    }
+
+    // Ends the current frame, the next one writes to the next region.
+    void advance() noexcept {
+        region = (region + 1) % FRAME_COUNT;
+        head = 0;
+        frame++;
+        oldestFrame = frame;
+    }
+
+    // The content written so far is lost, including the current frame's.
+    void invalidate() noexcept {
+        oldestFrame = frame + 1;
+    }
+
+    bool isStale(uint64_t writtenFrame) const noexcept {
+        return writtenFrame < oldestFrame;
+    }
+};
+
+} // namespace filament
+
+#endif // TNT_FILAMENT_DRIVER_OPENGL_UNIFORMRINGREGIONS_H
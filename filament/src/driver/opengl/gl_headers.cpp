@@ -36,6 +36,9 @@ PFNGLPOPGROUPMARKEREXTPROC glPopGroupMarkerEXT;
 #if GL_EXT_multisampled_render_to_texture
 PFNGLFRAMEBUFFERTEXTURE2DMULTISAMPLEEXTPROC glFramebufferTexture2DMultisampleEXT;
 #endif
+#ifdef GL_EXT_buffer_storage
+PFNGLBUFFERSTORAGEEXTPROC glBufferStorageEXT;
+#endif
 }
 
 using namespace glext;
@@ -77,6 +80,11 @@ public:
         glFramebufferTexture2DMultisampleEXT =
                 (PFNGLFRAMEBUFFERTEXTURE2DMULTISAMPLEEXTPROC)eglGetProcAddress(
                         "glFramebufferTexture2DMultisampleEXT");
+#endif
+#ifdef GL_EXT_buffer_storage
+        glBufferStorageEXT =
+                (PFNGLBUFFERSTORAGEEXTPROC)eglGetProcAddress(
+                        "glBufferStorageEXT");
 #endif
     }
 } instance;
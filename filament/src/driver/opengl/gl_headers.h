@@ -38,6 +38,9 @@
 #endif
 #if GL_EXT_multisampled_render_to_texture
         extern PFNGLFRAMEBUFFERTEXTURE2DMULTISAMPLEEXTPROC glFramebufferTexture2DMultisampleEXT;
+#endif
+#ifdef GL_EXT_buffer_storage
+        extern PFNGLBUFFERSTORAGEEXTPROC glBufferStorageEXT;
 #endif
     }
 
@@ -16,9 +16,12 @@
 
 #include "driver/vulkan/VulkanBinder.h"
 
+#include <utils/JobSystem.h>
 #include <utils/Panic.h>
 #include <utils/trap.h>
 
+#include <algorithm>
+
 #define FILAMENT_VULKAN_VERBOSE 0
 
 // Vulkan functions often immediately dereference pointers, so it's fine to pass in a pointer
@@ -43,18 +46,6 @@ static constexpr uint32_t MAX_NUM_DESCRIPTORS = 1000;
 static VulkanBinder::RasterState createDefaultRasterState();
 
 VulkanBinder::VulkanBinder() : mDefaultRasterState(createDefaultRasterState()) {
-    mColorBlendState = VkPipelineColorBlendStateCreateInfo{};
-    mColorBlendState.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    mColorBlendState.attachmentCount = 1;
-    mColorBlendState.pAttachments = &mPipelineKey.rasterState.blending;
-    mShaderStages[0] = VkPipelineShaderStageCreateInfo{};
-    mShaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    mShaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-    mShaderStages[0].pName = "main";
-    mShaderStages[1] = VkPipelineShaderStageCreateInfo{};
-    mShaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    mShaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    mShaderStages[1].pName = "main";
     resetBindings();
 
     mDescriptorKey = {};
@@ -72,12 +63,20 @@ bool VulkanBinder::getOrCreateDescriptor(VkDescriptorSet* descriptor,
     }
 
     // If no bindings have been dirtied, update the timestamp (most recent access) and return false
-    // to indicate there's no need to re-bind.
+    // to indicate there's no need to re-bind, unless the dynamic offsets have changed.
     if (!mDirtyDescriptor) {
         assert(mCurrentDescriptor && mCurrentDescriptor->bound);
         *descriptor = mCurrentDescriptor->handle;
         mCurrentDescriptor->timestamp = mCurrentTime;
-        return false;
+        if (!mDirtyOffsets) {
+            return false;
+        }
+        *pipelineLayout = mPipelineLayout;
+        if (changes) {
+            *changes = nullptr;
+        }
+        mDirtyOffsets = false;
+        return true;
     }
 
     // Release the previously bound descriptor and update its time stamp.
@@ -96,6 +95,7 @@ bool VulkanBinder::getOrCreateDescriptor(VkDescriptorSet* descriptor,
         mCurrentDescriptor->timestamp = mCurrentTime;
         mCurrentDescriptor->bound = true;
         mDirtyDescriptor = false;
+        mDirtyOffsets = false;
         *pipelineLayout = mPipelineLayout;
         if (changes) {
             *changes = nullptr;
@@ -122,6 +122,7 @@ bool VulkanBinder::getOrCreateDescriptor(VkDescriptorSet* descriptor,
     mCurrentDescriptor = &mDescriptorSets.emplace(std::make_pair(mDescriptorKey, DescriptorVal {
         *descriptor, mCurrentTime, true })).first.value();
     mDirtyDescriptor = false;
+    mDirtyOffsets = false;
 
     // Mutate the descriptor by setting all non-null bindings.
     uint32_t& nwrites = mDescriptorUpdateOp.count;
@@ -131,7 +132,7 @@ bool VulkanBinder::getOrCreateDescriptor(VkDescriptorSet* descriptor,
         if (mDescriptorKey.uniformBuffers[binding]) {
             VkDescriptorBufferInfo& bufferInfo = mDescriptorBuffers[binding];
             bufferInfo.buffer = mDescriptorKey.uniformBuffers[binding];
-            bufferInfo.offset = mDescriptorKey.uniformBufferOffsets[binding];
+            bufferInfo.offset = 0;
             bufferInfo.range = mDescriptorKey.uniformBufferSizes[binding];
             VkWriteDescriptorSet& writeInfo = writes[nwrites++];
             writeInfo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
@@ -140,7 +141,7 @@ bool VulkanBinder::getOrCreateDescriptor(VkDescriptorSet* descriptor,
             writeInfo.dstBinding = binding;
             writeInfo.dstArrayElement = 0;
             writeInfo.descriptorCount = 1;
-            writeInfo.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            writeInfo.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
             writeInfo.pImageInfo = nullptr;
             writeInfo.pBufferInfo = &bufferInfo;
             writeInfo.pTexelBufferView = nullptr;
@@ -190,10 +191,16 @@ bool VulkanBinder::getOrCreatePipeline(VkPipeline* pipeline) noexcept {
         mCurrentPipeline->bound = false;
     }
 
+    // The pipeline might have been created ahead of time on the background thread.
+    auto iter = mPipelines.find(mPipelineKey);
+    if (UTILS_UNLIKELY(iter == mPipelines.end()) && mPrewarmThread.joinable()) {
+        acquirePrewarmedPipeline(mPipelineKey);
+        iter = mPipelines.find(mPipelineKey);
+    }
+
     // If a cached object exists, update the timestamp (most recent access) and return true to
     // indicate that the caller should call vmCmdBind. Note that robin_map iterators proffer a value
     // method for obtaining a stable reference.
-    auto iter = mPipelines.find(mPipelineKey);
     if (UTILS_LIKELY(iter != mPipelines.end())) {
         mCurrentPipeline = &iter.value();
         *pipeline = mCurrentPipeline->handle;
@@ -204,18 +211,180 @@ bool VulkanBinder::getOrCreatePipeline(VkPipeline* pipeline) noexcept {
     }
 
     // If we reach this point, we need to create and stash a brand new pipeline object.
-    mShaderStages[0].module = mPipelineKey.shaders[0];
-    mShaderStages[1].module = mPipelineKey.shaders[1];
+    *pipeline = createPipeline(mPipelineKey);
+
+    // Here we construct a PipelineVal in place, then stash its pointer to allow fast subsequent
+    // calls to getOrCreatePipeline when nothing has been dirtied. Note that the robin_map
+    // iterator type proffers a "value" method, which returns a stable reference.
+    mCurrentPipeline = &mPipelines.emplace(std::make_pair(mPipelineKey, PipelineVal {
+        *pipeline, mCurrentTime, true, false })).first.value();
+    mDirtyPipeline = false;
+    return true;
+}
+
+void VulkanBinder::prewarmPipeline(const ProgramBundle& bundle, const RasterState& rasterState,
+        VkRenderPass renderPass, VkPrimitiveTopology topology,
+        const VertexArray& varray) noexcept {
+    // The key must come out exactly as the bind methods would make it, see bindVertexArray.
+    PipelineKey key = {};
+    key.shaders[0] = bundle.vertex;
+    key.shaders[1] = bundle.fragment;
+    key.rasterState = rasterState;
+    key.renderPass = renderPass;
+    key.topology = topology;
+    for (size_t i = 0; i < MAX_VERTEX_ATTRIBUTES; i++) {
+        key.vertexAttributes[i] = varray.attributes[i];
+        key.vertexBuffers[i].binding = varray.buffers[i].binding;
+        key.vertexBuffers[i].stride = varray.buffers[i].stride;
+        key.vertexBuffers[i].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    }
+    assert(key.shaders[0] && "Vertex shader is not bound.");
+
+    if (mPipelines.find(key) != mPipelines.end()) {
+        return;
+    }
+
+    // The background thread needs the pipeline layout, which is created lazily.
+    if (!mPipelineLayout) {
+        createLayoutsAndDescriptors();
+    }
+
+    std::unique_lock<utils::Mutex> lock(mPrewarmLock);
+    const PipelineEqual equal;
+    if ((mPrewarmBusy && equal(mPrewarmCurrent, key)) ||
+            mPrewarmedPipelines.find(key) != mPrewarmedPipelines.end() ||
+            std::any_of(mPrewarmQueue.begin(), mPrewarmQueue.end(),
+                    [&](const PipelineKey& queued) { return equal(queued, key); })) {
+        return;
+    }
+    mPrewarmQueue.push_back(key);
+    if (!mPrewarmThread.joinable()) {
+        mPrewarmExit = false;
+        mPrewarmThread = std::thread(&VulkanBinder::prewarmLoop, this);
+    }
+    lock.unlock();
+    mPrewarmCondition.notify_one();
+}
+
+void VulkanBinder::acquirePrewarmedPipeline(const PipelineKey& key) noexcept {
+    std::unique_lock<utils::Mutex> lock(mPrewarmLock);
+    const PipelineEqual equal;
+
+    // A pipeline still waiting for its turn is created right away by the caller, the background
+    // thread is no faster at it. One that's being created is waited for, rather than duplicated.
+    auto queued = std::find_if(mPrewarmQueue.begin(), mPrewarmQueue.end(),
+            [&](const PipelineKey& k) { return equal(k, key); });
+    if (queued != mPrewarmQueue.end()) {
+        mPrewarmQueue.erase(queued);
+        return;
+    }
+    mPrewarmCondition.wait(lock, [&]() -> bool {
+        return !mPrewarmBusy || !equal(mPrewarmCurrent, key);
+    });
+
+    auto iter = mPrewarmedPipelines.find(key);
+    if (iter != mPrewarmedPipelines.end()) {
+        mPipelines.emplace(std::make_pair(key,
+                PipelineVal { iter->second.handle, mCurrentTime, false, true }));
+        mPrewarmedPipelines.erase(iter);
+    }
+}
+
+void VulkanBinder::prewarmLoop() noexcept {
+    utils::JobSystem::setThreadName("VulkanBinder::prewarm");
+    std::unique_lock<utils::Mutex> lock(mPrewarmLock);
+    while (true) {
+        mPrewarmCondition.wait(lock, [this]() -> bool {
+            return mPrewarmExit || !mPrewarmQueue.empty();
+        });
+        if (mPrewarmExit) {
+            break;
+        }
+        mPrewarmCurrent = mPrewarmQueue.front();
+        mPrewarmQueue.pop_front();
+        mPrewarmBusy = true;
+        lock.unlock();
+
+        VkPipeline pipeline = createPipeline(mPrewarmCurrent);
+
+        lock.lock();
+        mPrewarmedPipelines.emplace(mPrewarmCurrent, PrewarmedPipeline { pipeline, mPrewarmTime });
+        mPrewarmBusy = false;
+        mPrewarmCondition.notify_all();
+    }
+}
+
+void VulkanBinder::stopPrewarming() noexcept {
+    if (!mPrewarmThread.joinable()) {
+        return;
+    }
+    std::unique_lock<utils::Mutex> lock(mPrewarmLock);
+    mPrewarmExit = true;
+    mPrewarmQueue.clear();
+    lock.unlock();
+    mPrewarmCondition.notify_all();
+    mPrewarmThread.join();
+
+    for (auto& iter : mPrewarmedPipelines) {
+        vkDestroyPipeline(mDevice, iter.second.handle, VKALLOC);
+    }
+    mPrewarmedPipelines.clear();
+}
+
+// Removes the queued pipelines that pass the given filter, waits for the one being created if it
+// passes too, then destroys the prewarmed pipelines that pass it. These can't be kept around
+// since their keys could match objects that are later created with the same handles.
+void VulkanBinder::cancelPrewarming(std::function<bool(const PipelineKey&)> filter) noexcept {
+    if (!mPrewarmThread.joinable()) {
+        return;
+    }
+    std::unique_lock<utils::Mutex> lock(mPrewarmLock);
+    mPrewarmQueue.erase(std::remove_if(mPrewarmQueue.begin(), mPrewarmQueue.end(), filter),
+            mPrewarmQueue.end());
+    mPrewarmCondition.wait(lock, [&]() -> bool {
+        return !mPrewarmBusy || !filter(mPrewarmCurrent);
+    });
+
+    // Due to robin_map restrictions, we cannot use auto or a range-based loop.
+    decltype(mPrewarmedPipelines)::const_iterator iter;
+    for (iter = mPrewarmedPipelines.begin(); iter != mPrewarmedPipelines.end();) {
+        if (filter(iter->first)) {
+            vkDestroyPipeline(mDevice, iter->second.handle, VKALLOC);
+            iter = mPrewarmedPipelines.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+}
+
+VkPipeline VulkanBinder::createPipeline(const PipelineKey& key) const noexcept {
+    const bool hasFragmentShader = key.shaders[1] != VK_NULL_HANDLE;
+
+    VkPipelineShaderStageCreateInfo shaderStages[NUM_SHADER_MODULES] = {};
+    shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderStages[0].module = key.shaders[0];
+    shaderStages[0].pName = "main";
+    shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderStages[1].module = key.shaders[1];
+    shaderStages[1].pName = "main";
+
+    // There are no color attachments if there is no bound fragment shader.  (e.g. shadow map gen)
+    VkPipelineColorBlendStateCreateInfo colorBlendState = {};
+    colorBlendState.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlendState.attachmentCount = hasFragmentShader ? 1 : 0;
+    colorBlendState.pAttachments = &key.rasterState.blending;
 
     // We don't store array sizes to save space, but it's quick to count all non-zero
     // entries because these arrays have a small fixed-size capacity.
     uint32_t numVertexAttribs = 0;
     uint32_t numVertexBuffers = 0;
     for (uint32_t i = 0; i < MAX_VERTEX_ATTRIBUTES; i++) {
-        if (mPipelineKey.vertexAttributes[i].format > 0) {
+        if (key.vertexAttributes[i].format > 0) {
             numVertexAttribs++;
         }
-        if (mPipelineKey.vertexBuffers[i].stride > 0) {
+        if (key.vertexBuffers[i].stride > 0) {
             numVertexBuffers++;
         }
     }
@@ -223,13 +392,13 @@ bool VulkanBinder::getOrCreatePipeline(VkPipeline* pipeline) noexcept {
     VkPipelineVertexInputStateCreateInfo vertexInputState = {};
     vertexInputState.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
     vertexInputState.vertexBindingDescriptionCount = numVertexBuffers;
-    vertexInputState.pVertexBindingDescriptions = mPipelineKey.vertexBuffers;
+    vertexInputState.pVertexBindingDescriptions = key.vertexBuffers;
     vertexInputState.vertexAttributeDescriptionCount = numVertexAttribs;
-    vertexInputState.pVertexAttributeDescriptions = mPipelineKey.vertexAttributes;
+    vertexInputState.pVertexAttributeDescriptions = key.vertexAttributes;
 
     VkPipelineInputAssemblyStateCreateInfo inputAssemblyState = {};
     inputAssemblyState.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssemblyState.topology = mPipelineKey.topology;
+    inputAssemblyState.topology = key.topology;
 
     VkPipelineViewportStateCreateInfo viewportState = {};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
@@ -245,45 +414,35 @@ bool VulkanBinder::getOrCreatePipeline(VkPipeline* pipeline) noexcept {
     dynamicState.pDynamicStates = dynamicStateEnables;
     dynamicState.dynamicStateCount = 2;
 
-    const bool hasFragmentShader = mShaderStages[1].module != VK_NULL_HANDLE;
-
     VkGraphicsPipelineCreateInfo pipelineCreateInfo = {};
     pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
     pipelineCreateInfo.layout = mPipelineLayout;
-    pipelineCreateInfo.renderPass = mPipelineKey.renderPass;
+    pipelineCreateInfo.renderPass = key.renderPass;
     pipelineCreateInfo.stageCount = hasFragmentShader ? NUM_SHADER_MODULES : 1;
-    pipelineCreateInfo.pStages = mShaderStages;
+    pipelineCreateInfo.pStages = shaderStages;
     pipelineCreateInfo.pVertexInputState = &vertexInputState;
     pipelineCreateInfo.pInputAssemblyState = &inputAssemblyState;
-    pipelineCreateInfo.pRasterizationState = &mPipelineKey.rasterState.rasterization;
-    pipelineCreateInfo.pColorBlendState = &mColorBlendState;
-    pipelineCreateInfo.pMultisampleState = &mPipelineKey.rasterState.multisampling;
+    pipelineCreateInfo.pRasterizationState = &key.rasterState.rasterization;
+    pipelineCreateInfo.pColorBlendState = &colorBlendState;
+    pipelineCreateInfo.pMultisampleState = &key.rasterState.multisampling;
     pipelineCreateInfo.pViewportState = &viewportState;
-    pipelineCreateInfo.pDepthStencilState = &mPipelineKey.rasterState.depthStencil;
+    pipelineCreateInfo.pDepthStencilState = &key.rasterState.depthStencil;
     pipelineCreateInfo.pDynamicState = &dynamicState;
 
-    // There are no color attachments if there is no bound fragment shader.  (e.g. shadow map gen)
-    mColorBlendState.attachmentCount = hasFragmentShader ? 1 : 0;
-
     #if FILAMENT_VULKAN_VERBOSE
     utils::slog.d << "vkCreateGraphicsPipelines with shaders = ("
-            << mShaderStages[0].module << ", " << mShaderStages[1].module << ")" << utils::io::endl;
+            << shaderStages[0].module << ", " << shaderStages[1].module << ")" << utils::io::endl;
     #endif
 
-    VkResult err = vkCreateGraphicsPipelines(mDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo,
-            VKALLOC, pipeline);
+    // The pipeline cache is internally synchronized, so it's shared with the background thread.
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkResult err = vkCreateGraphicsPipelines(mDevice, mPipelineCache, 1, &pipelineCreateInfo,
+            VKALLOC, &pipeline);
     if (err) {
         utils::slog.e << "vkCreateGraphicsPipelines error " << err << utils::io::endl;
         utils::debug_trap();
     }
-
-    // Here we construct a PipelineVal in place, then stash its pointer to allow fast subsequent
-    // calls to getOrCreatePipeline when nothing has been dirtied. Note that the robin_map
-    // iterator type proffers a "value" method, which returns a stable reference.
-    mCurrentPipeline = &mPipelines.emplace(std::make_pair(mPipelineKey, PipelineVal {
-        *pipeline, mCurrentTime, true })).first.value();
-    mDirtyPipeline = false;
-    return true;
+    return pipeline;
 }
 
 void VulkanBinder::bindProgramBundle(const ProgramBundle& bundle) noexcept {
@@ -369,7 +528,7 @@ void VulkanBinder::unbindUniformBuffer(VkBuffer uniformBuffer) noexcept {
         if (key.uniformBuffers[bindingIndex] == uniformBuffer) {
             key.uniformBuffers[bindingIndex] = {};
             key.uniformBufferSizes[bindingIndex] = {};
-            key.uniformBufferOffsets[bindingIndex] = {};
+            mDynamicOffsets[bindingIndex] = 0;
             mDirtyDescriptor = true;
         }
     }
@@ -404,6 +563,19 @@ void VulkanBinder::unbindImageView(VkImageView imageView) noexcept {
     });
 }
 
+void VulkanBinder::unbindProgramBundle(const ProgramBundle& bundle) noexcept {
+    cancelPrewarming([bundle] (const PipelineKey& key) {
+        return key.shaders[0] == bundle.vertex ||
+                (bundle.fragment && key.shaders[1] == bundle.fragment);
+    });
+}
+
+void VulkanBinder::unbindRenderPass(VkRenderPass renderPass) noexcept {
+    cancelPrewarming([renderPass] (const PipelineKey& key) {
+        return key.renderPass == renderPass;
+    });
+}
+
 // Discards all descriptor sets that pass the given filter. Immediately removes the cache entries,
 // but defers calling vkFreeDescriptorSets until the next eviction cycle.
 void VulkanBinder::evictDescriptors(std::function<bool(const DescriptorKey&)> filter) noexcept {
@@ -428,13 +600,15 @@ void VulkanBinder::bindUniformBuffer(uint32_t bindingIndex, VkBuffer uniformBuff
             bindingIndex, NUM_UBUFFER_BINDINGS);
     auto& key = mDescriptorKey;
     if (key.uniformBuffers[bindingIndex] != uniformBuffer ||
-        key.uniformBufferOffsets[bindingIndex] != offset ||
         key.uniformBufferSizes[bindingIndex] != size) {
         key.uniformBuffers[bindingIndex] = uniformBuffer;
-        key.uniformBufferOffsets[bindingIndex] = offset;
         key.uniformBufferSizes[bindingIndex] = size;
         mDirtyDescriptor = true;
     }
+    if (mDynamicOffsets[bindingIndex] != offset) {
+        mDynamicOffsets[bindingIndex] = (uint32_t) offset;
+        mDirtyOffsets = true;
+    }
 }
 
 void VulkanBinder::bindSampler(uint32_t bindingIndex, VkDescriptorImageInfo samplerInfo) noexcept {
@@ -452,6 +626,9 @@ void VulkanBinder::bindSampler(uint32_t bindingIndex, VkDescriptorImageInfo samp
 }
 
 void VulkanBinder::destroyCache() noexcept {
+    // The background thread uses the pipeline layout, so it must be stopped first.
+    stopPrewarming();
+
     // Symmetric to createLayoutsAndDescriptors.
     destroyLayoutsAndDescriptors();
     for (auto& iter : mPipelines) {
@@ -465,6 +642,7 @@ void VulkanBinder::destroyCache() noexcept {
 void VulkanBinder::resetBindings() noexcept {
     mDirtyPipeline = true;
     mDirtyDescriptor = true;
+    mDirtyOffsets = true;
 }
 
 // Frees up old descriptor sets and pipelines, then nulls out their key.
@@ -492,13 +670,28 @@ void VulkanBinder::gc() noexcept {
     for (decltype(mPipelines)::const_iterator iter = mPipelines.begin();
             iter != mPipelines.end();) {
         auto& cacheEntry = iter->second;
-        if (cacheEntry.timestamp < evictTime && !cacheEntry.bound) {
+        const uint32_t lifetime = cacheEntry.prewarmed ?
+                PREWARMED_TIME_BEFORE_EVICTION : TIME_BEFORE_EVICTION;
+        if (cacheEntry.timestamp + lifetime < mCurrentTime && !cacheEntry.bound) {
             vkDestroyPipeline(mDevice, cacheEntry.handle, VKALLOC);
             iter = mPipelines.erase(iter);
         } else {
             ++iter;
         }
     }
+    // The prewarmed pipelines that were never used aren't referenced by any command buffer.
+    if (mPrewarmThread.joinable()) {
+        std::lock_guard<utils::Mutex> lock(mPrewarmLock);
+        mPrewarmTime = mCurrentTime;
+        for (auto iter = mPrewarmedPipelines.begin(); iter != mPrewarmedPipelines.end();) {
+            if (iter->second.timestamp + PREWARMED_TIME_BEFORE_EVICTION < mCurrentTime) {
+                vkDestroyPipeline(mDevice, iter->second.handle, VKALLOC);
+                iter = mPrewarmedPipelines.erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+    }
     // The graveyard is composed of descriptors that contain references to extinct objects. We
     // take care only to free the ones that are old enough to be evicted, since they might be
     // referenced in a command buffer that hasn't finished executing.
@@ -523,7 +716,7 @@ void VulkanBinder::createLayoutsAndDescriptors() noexcept {
     binding.stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS; // NOTE: This is potentially non-optimal.
 
     // The first range of binding slots is reserved for UBO's.
-    binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     for (uint32_t i = 0; i < NUM_UBUFFER_BINDINGS; i++) {
         binding.binding = i;
         bindings[i] = binding;
@@ -561,7 +754,7 @@ void VulkanBinder::createLayoutsAndDescriptors() noexcept {
         .maxSets = MAX_NUM_DESCRIPTORS,
         .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT
     };
-    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     poolSizes[0].descriptorCount = poolInfo.maxSets * NUM_UBUFFER_BINDINGS;
     poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
     poolSizes[1].descriptorCount = poolInfo.maxSets * NUM_SAMPLER_BINDINGS;
@@ -601,7 +794,6 @@ bool VulkanBinder::DescEqual::operator()(const VulkanBinder::DescriptorKey& k1,
         const VulkanBinder::DescriptorKey& k2) const {
     for (uint32_t i = 0; i < NUM_UBUFFER_BINDINGS; i++) {
         if (k1.uniformBuffers[i] != k2.uniformBuffers[i] ||
-            k1.uniformBufferOffsets[i] != k2.uniformBufferOffsets[i] ||
             k1.uniformBufferSizes[i] != k2.uniformBufferSizes[i]) {
             return false;
         }
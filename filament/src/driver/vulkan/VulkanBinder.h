@@ -20,9 +20,15 @@
 #include <filament/EngineEnums.h>
 
 #include <bluevk/BlueVK.h>
+#include <utils/Condition.h>
 #include <utils/Hash.h>
+#include <utils/Mutex.h>
 
 #include <tsl/robin_map.h>
+
+#include <deque>
+#include <functional>
+#include <thread>
 #include <vector>
 
 namespace filament {
@@ -66,6 +72,13 @@ namespace driver {
 // - Descriptor sets are never mutated using vkUpdateDescriptorSets, except upon creation.
 // - Assumes that viewport and scissor should be dynamic. (not baked into VkPipeline)
 // - Assumes that uniform buffers should be visible across all shader stages.
+// - Uniform buffers are always bound with dynamic offsets, so that moving a binding within the
+//   same buffer (e.g. to the next object, or to the next slice of a ring buffer) does not create a
+//   new descriptor set.
+//
+// Pipelines can also be created ahead of time with prewarmPipeline(), which hands the work to a
+// background thread so that the first draw using them doesn't stall. This is the only part of the
+// binder that is not confined to the thread calling it.
 //
 class VulkanBinder {
 public:
@@ -114,25 +127,41 @@ public:
     ~VulkanBinder();
     void setDevice(VkDevice device) { mDevice = device; }
 
+    // Sets the VkPipelineCache used to create pipelines. The cache is owned by the client and
+    // must outlive the binder's pipelines, i.e. it can only be destroyed after destroyCache().
+    void setPipelineCache(VkPipelineCache cache) { mPipelineCache = cache; }
+
     // Clients should initialize their copy of the raster state using this method. They can then
     // mutate their copy and pass it back through bindRasterState().
     const RasterState& getDefaultRasterState() const { return mDefaultRasterState; }
 
     // Returns true if vkCmdBindDescriptorSets is required. Additionally, if mutations to the set
     // are required (i.e., vkUpdateDescriptorSets) then "changes" is set to non-null.
+    // vkCmdBindDescriptorSets must be given the NUM_UBUFFER_BINDINGS offsets of getDynamicOffsets().
     bool getOrCreateDescriptor(VkDescriptorSet* descriptor, VkPipelineLayout* pipelineLayout,
             DescriptorUpdateOp** changes = nullptr) noexcept;
+    const uint32_t* getDynamicOffsets() const noexcept { return mDynamicOffsets; }
 
     // Returns true if any pipeline bindings have changed. (i.e., vkCmdBindPipeline is required)
     bool getOrCreatePipeline(VkPipeline* pipeline) noexcept;
 
+    // Queues the creation of the pipeline matching the given bindings on a background thread.
+    // getOrCreatePipeline() picks it up when these bindings are used, waiting for it if it's still
+    // being created. Prewarmed pipelines can be created long before they're used, or be used
+    // intermittently, so they're evicted after PREWARMED_TIME_BEFORE_EVICTION frames without use
+    // instead of TIME_BEFORE_EVICTION.
+    void prewarmPipeline(const ProgramBundle& bundle, const RasterState& rasterState,
+            VkRenderPass renderPass, VkPrimitiveTopology topology,
+            const VertexArray& varray) noexcept;
+
     // Each bind method is fast and does not make Vulkan calls.
     void bindProgramBundle(const ProgramBundle& bundle) noexcept;
     void bindRasterState(const RasterState& rasterState) noexcept;
     void bindRenderPass(VkRenderPass renderPass) noexcept;
     void bindPrimitiveTopology(VkPrimitiveTopology topology) noexcept;
+    // The size can't be VK_WHOLE_SIZE, since the offset is applied as a dynamic offset.
     void bindUniformBuffer(uint32_t bindingIndex, VkBuffer uniformBuffer,
-            VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE) noexcept;
+            VkDeviceSize offset, VkDeviceSize size) noexcept;
     void bindSampler(uint32_t bindingIndex, VkDescriptorImageInfo imageInfo) noexcept;
     void bindVertexArray(const VertexArray& varray) noexcept;
 
@@ -146,6 +175,12 @@ public:
     // This is only necessary when the client knows that a texture is about to be destroyed.
     void unbindImageView(VkImageView imageView) noexcept;
 
+    // Forgets the prewarmed pipelines that refer to the given shaders or render pass, and waits
+    // for the background thread if it's creating one of them. This is only necessary when the
+    // client knows that the program or render pass is about to be destroyed.
+    void unbindProgramBundle(const ProgramBundle& bundle) noexcept;
+    void unbindRenderPass(VkRenderPass renderPass) noexcept;
+
     // NOTE: In theory we should proffer "unbindSampler" but in practice we never destroy samplers.
 
     // Destroys all managed Vulkan objects. This should be called before changing the VkDevice, or
@@ -194,6 +229,7 @@ private:
         VkPipeline handle;
         uint32_t timestamp;
         bool bound;
+        bool prewarmed;
         // move-only (disallow copy) to allow keeping a pointer to the "current" value in the map.
         PipelineVal(PipelineVal const&) = delete;
         PipelineVal& operator=(PipelineVal const&) = delete;
@@ -204,17 +240,16 @@ private:
     // The descriptor key is a POD that represents all currently bound states that go into the
     // descriptor set. We apply a hash function to its contents only if has been mutated since
     // the previous call to getOrCreateDescriptor.
+    // The offsets of the uniform buffers are not part of it, they're dynamic offsets.
     struct alignas(8) DescriptorKey {
         VkBuffer uniformBuffers[NUM_UBUFFER_BINDINGS];
         VkDescriptorImageInfo samplers[NUM_SAMPLER_BINDINGS];
-        VkDeviceSize uniformBufferOffsets[NUM_UBUFFER_BINDINGS];
         VkDeviceSize uniformBufferSizes[NUM_UBUFFER_BINDINGS];
     };
 
     static_assert(sizeof(DescriptorKey) ==
         sizeof(DescriptorKey::uniformBuffers) +
         sizeof(DescriptorKey::samplers) +
-        sizeof(DescriptorKey::uniformBufferOffsets) +
         sizeof(DescriptorKey::uniformBufferSizes),
         "Implicit padding is not allowed for fast hashing");
 
@@ -241,12 +276,21 @@ private:
     void destroyLayoutsAndDescriptors() noexcept;
     void evictDescriptors(std::function<bool(const DescriptorKey&)> filter) noexcept;
 
+    // Makes the VkPipeline object described by the key. This is called on the background thread
+    // for prewarmed pipelines, so it must only read state that's immutable while that thread runs.
+    VkPipeline createPipeline(const PipelineKey& key) const noexcept;
+
+    // Moves the prewarmed pipeline matching the key, if any, to the cache of pipelines.
+    void acquirePrewarmedPipeline(const PipelineKey& key) noexcept;
+    void prewarmLoop() noexcept;
+    void stopPrewarming() noexcept;
+    void cancelPrewarming(std::function<bool(const PipelineKey&)> filter) noexcept;
+
     VkDevice mDevice = nullptr;
+    VkPipelineCache mPipelineCache = VK_NULL_HANDLE;
     const RasterState mDefaultRasterState;
 
     // Info structs used only in a transient way but they are stored for convenience.
-    VkPipelineShaderStageCreateInfo mShaderStages[NUM_SHADER_MODULES];
-    VkPipelineColorBlendStateCreateInfo mColorBlendState;
     VkDescriptorBufferInfo mDescriptorBuffers[NUM_UBUFFER_BINDINGS];
     VkDescriptorImageInfo mDescriptorSamplers[NUM_SAMPLER_BINDINGS];
     DescriptorUpdateOp mDescriptorUpdateOp;
@@ -256,6 +300,7 @@ private:
     // uniform buffers).
     PipelineKey mPipelineKey;
     DescriptorKey mDescriptorKey;
+    uint32_t mDynamicOffsets[NUM_UBUFFER_BINDINGS] = {};
 
     // Weak references to the currently bound pipeline and descriptor set.
     PipelineVal* mCurrentPipeline = nullptr;
@@ -265,6 +310,7 @@ private:
     // a new pipeline or descriptor set needs to be retrieved from the cache or created.
     bool mDirtyPipeline = true;
     bool mDirtyDescriptor = true;
+    bool mDirtyOffsets = true;
 
     // Cached Vulkan objects. These objects are owned by the Binder.
     VkDescriptorSetLayout mDescriptorSetLayout = VK_NULL_HANDLE;
@@ -277,6 +323,23 @@ private:
     // Store the current "time" (really just a frame count) and LRU eviction parameters.
     uint32_t mCurrentTime = 0;
     static constexpr uint32_t TIME_BEFORE_EVICTION = 2;
+    static constexpr uint32_t PREWARMED_TIME_BEFORE_EVICTION = 300;
+
+    // Background creation of pipelines. Everything below is guarded by mPrewarmLock, but the
+    // background thread reads mPrewarmCurrent without it while mPrewarmBusy is set.
+    struct PrewarmedPipeline {
+        VkPipeline handle;
+        uint32_t timestamp;     // when it was created
+    };
+    std::thread mPrewarmThread;
+    utils::Mutex mPrewarmLock;
+    utils::Condition mPrewarmCondition;
+    std::deque<PipelineKey> mPrewarmQueue;
+    tsl::robin_map<PipelineKey, PrewarmedPipeline, PipelineHashFn, PipelineEqual> mPrewarmedPipelines;
+    PipelineKey mPrewarmCurrent;
+    uint32_t mPrewarmTime = 0;  // copy of mCurrentTime for the background thread
+    bool mPrewarmBusy = false;
+    bool mPrewarmExit = false;
 };
 
 } // namespace filament
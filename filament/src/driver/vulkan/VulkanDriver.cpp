@@ -41,7 +41,8 @@ namespace driver {
 VulkanDriver::VulkanDriver(VulkanPlatform* platform,
         const char* const* ppEnabledExtensions, uint32_t enabledExtensionCount) noexcept :
         DriverBase(new ConcreteDispatcher<VulkanDriver>(this)),
-        mContextManager(*platform), mStagePool(mContext), mFramebufferCache(mContext),
+        mContextManager(*platform), mStagePool(mContext), mRingBuffer(mContext),
+        mFramebufferCache(mContext),
         mSamplerCache(mContext) {
     mContext.rasterState = mBinder.getDefaultRasterState();
 
@@ -156,6 +157,7 @@ VulkanDriver::VulkanDriver(VulkanPlatform* platform,
     // Initialize device and graphicsQueue.
     createVirtualDevice(mContext);
     mBinder.setDevice(mContext.device);
+    createPipelineCache();
 
     // Choose a depth format that meets our requirements. Take care not to include stencil formats
     // just yet, since that would require a corollary change to the "aspect" flags for the VkImage.
@@ -182,16 +184,36 @@ ShaderModel VulkanDriver::getShaderModel() const noexcept {
 #endif
 }
 
+Driver::MemoryStats VulkanDriver::getMemoryStats() const noexcept {
+    MemoryStats result = DriverBase::getMemoryStats();
+    if (!mContext.allocator) {
+        return result;
+    }
+    // VMA synchronizes this with the allocations made on the driver thread
+    VmaStats stats;
+    vmaCalculateStats(mContext.allocator, &stats);
+    result.blockCount = stats.total.blockCount;
+    result.allocationCount = stats.total.allocationCount;
+    result.usedBytes = stats.total.usedBytes;
+    result.unusedBytes = stats.total.unusedBytes;
+    result.largestUnusedRange = stats.total.unusedRangeSizeMax;
+    return result;
+}
+
 void VulkanDriver::terminate() {
     if (!mContext.instance) {
         return;
     }
     waitForIdle(mContext);
     mBinder.destroyCache();
+    destroyPipelineCache();
     mStagePool.reset();
+    mRingBuffer.reset();
     mFramebufferCache.reset();
     mSamplerCache.reset();
+    destroyImagePools(mContext);
     vmaDestroyAllocator(mContext.allocator);
+    mContext.allocator = VK_NULL_HANDLE;
     vkDestroyCommandPool(mContext.device, mContext.commandPool, VKALLOC);
     vkDestroyDevice(mContext.device, VKALLOC);
     if (mDebugCallback) {
@@ -202,6 +224,73 @@ void VulkanDriver::terminate() {
     mContext.instance = nullptr;
 }
 
+// Key of the pipeline cache in the platform's blob cache. The data of a pipeline cache can only be
+// used by the device and driver that made it.
+struct PipelineCacheKey {
+    char tag[8];
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint32_t driverVersion;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+};
+
+static PipelineCacheKey getPipelineCacheKey(const VkPhysicalDeviceProperties& props) {
+    PipelineCacheKey key = { { 'V', 'k', 'P', 'S', 'O' },
+            props.vendorID, props.deviceID, props.driverVersion };
+    memcpy(key.pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE);
+    return key;
+}
+
+void VulkanDriver::createPipelineCache() noexcept {
+    const PipelineCacheKey key = getPipelineCacheKey(mContext.physicalDeviceProperties);
+    std::vector<uint8_t> data;
+    if (mContextManager.hasBlobCache()) {
+        const size_t size = mContextManager.retrieveBlob(&key, sizeof(key), nullptr, 0);
+        if (size) {
+            data.resize(size);
+            if (mContextManager.retrieveBlob(&key, sizeof(key), data.data(), size) != size) {
+                data.clear();
+            }
+        }
+    }
+
+    VkPipelineCacheCreateInfo info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .initialDataSize = data.size(),
+        .pInitialData = data.data()
+    };
+    VkResult result = vkCreatePipelineCache(mContext.device, &info, VKALLOC, &mPipelineCache);
+    if (result != VK_SUCCESS && !data.empty()) {
+        // the driver is allowed to reject stale data, start from an empty cache then
+        info.initialDataSize = 0;
+        info.pInitialData = nullptr;
+        result = vkCreatePipelineCache(mContext.device, &info, VKALLOC, &mPipelineCache);
+    }
+    if (result != VK_SUCCESS) {
+        mPipelineCache = VK_NULL_HANDLE;
+    }
+    mBinder.setPipelineCache(mPipelineCache);
+}
+
+void VulkanDriver::destroyPipelineCache() noexcept {
+    if (mPipelineCache == VK_NULL_HANDLE) {
+        return;
+    }
+    if (mContextManager.hasBlobCache()) {
+        size_t size = 0;
+        vkGetPipelineCacheData(mContext.device, mPipelineCache, &size, nullptr);
+        std::vector<uint8_t> data(size);
+        if (size && vkGetPipelineCacheData(mContext.device, mPipelineCache, &size,
+                data.data()) == VK_SUCCESS) {
+            const PipelineCacheKey key = getPipelineCacheKey(mContext.physicalDeviceProperties);
+            mContextManager.insertBlob(&key, sizeof(key), data.data(), size);
+        }
+    }
+    mBinder.setPipelineCache(VK_NULL_HANDLE);
+    vkDestroyPipelineCache(mContext.device, mPipelineCache, VKALLOC);
+    mPipelineCache = VK_NULL_HANDLE;
+}
+
 void VulkanDriver::beginFrame(int64_t monotonic_clock_ns, uint32_t frameId) {
     // We allow multiple beginFrame / endFrame pairs before commit(), so gracefully return early
     // if the swap chain has already been acquired.
@@ -212,6 +301,9 @@ void VulkanDriver::beginFrame(int64_t monotonic_clock_ns, uint32_t frameId) {
     acquireCommandBuffer(mContext);
     SwapContext& swapContext = getSwapContext(mContext);
 
+    // The previous frame using this swap context is done, so is its part of the ring buffer.
+    mRingBuffer.beginFrame(swapContext.fence);
+
     // vkCmdBindPipeline and vkCmdBindDescriptorSets establish bindings to a specific command
     // buffer; they are not global to the device. Since VulkanBinder doesn't have context about the
     // current command buffer, we need to reset its bindings after swapping over to a new command
@@ -233,7 +325,9 @@ void VulkanDriver::beginFrame(int64_t monotonic_clock_ns, uint32_t frameId) {
 
     // Free old unused objects.
     mStagePool.gc();
-    mFramebufferCache.gc();
+    mFramebufferCache.gc([this](VkRenderPass renderPass) {
+        mBinder.unbindRenderPass(renderPass);
+    });
     mBinder.gc();
 }
 
@@ -251,53 +345,53 @@ void VulkanDriver::flush(int) {
 void VulkanDriver::createVertexBuffer(Driver::VertexBufferHandle vbh, uint8_t bufferCount,
         uint8_t attributeCount, uint32_t elementCount, Driver::AttributeArray attributes,
         Driver::BufferUsage usage) {
-    construct_handle<VulkanVertexBuffer>(mHandleMap, vbh, mContext, mStagePool, bufferCount,
+    construct<VulkanVertexBuffer>(vbh, mContext, mStagePool, bufferCount,
             attributeCount, elementCount, attributes);
 }
 
 void VulkanDriver::createIndexBuffer(Driver::IndexBufferHandle ibh, Driver::ElementType elementType,
         uint32_t indexCount, Driver::BufferUsage usage) {
     auto elementSize = (uint8_t) getElementTypeSize(elementType);
-    construct_handle<VulkanIndexBuffer>(mHandleMap, ibh, mContext, mStagePool, elementSize,
+    construct<VulkanIndexBuffer>(ibh, mContext, mStagePool, elementSize,
             indexCount);
 }
 
 void VulkanDriver::createTexture(Driver::TextureHandle th, SamplerType target, uint8_t levels,
         TextureFormat format, uint8_t samples, uint32_t w, uint32_t h, uint32_t depth,
         TextureUsage usage) {
-    construct_handle<VulkanTexture>(mHandleMap, th, mContext, target, levels, format, samples,
+    construct<VulkanTexture>(th, mContext, target, levels, format, samples,
             w, h, depth, usage, mStagePool);
 }
 
 void VulkanDriver::createSamplerBuffer(Driver::SamplerBufferHandle sbh, size_t count) {
-    construct_handle<VulkanSamplerBuffer>(mHandleMap, sbh, mContext, count);
+    construct<VulkanSamplerBuffer>(sbh, mContext, count);
 }
 
 void VulkanDriver::createUniformBuffer(Driver::UniformBufferHandle ubh, size_t size,
         Driver::BufferUsage usage) {
-    construct_handle<VulkanUniformBuffer>(mHandleMap, ubh, mContext, mStagePool, size, usage);
+    construct<VulkanUniformBuffer>(ubh, mContext, mStagePool, mRingBuffer, size, usage);
 }
 
 void VulkanDriver::createRenderPrimitive(Driver::RenderPrimitiveHandle rph, int) {
-    construct_handle<VulkanRenderPrimitive>(mHandleMap, rph, mContext);
+    construct<VulkanRenderPrimitive>(rph, mContext);
 }
 
 void VulkanDriver::createProgram(Driver::ProgramHandle ph, Program&& program) {
-    construct_handle<VulkanProgram>(mHandleMap, ph, mContext, program);
+    construct<VulkanProgram>(ph, mContext, program);
 }
 
 void VulkanDriver::createDefaultRenderTarget(Driver::RenderTargetHandle rth, int) {
-    construct_handle<VulkanRenderTarget>(mHandleMap, rth, mContext);
+    construct<VulkanRenderTarget>(rth, mContext);
 }
 
 void VulkanDriver::createRenderTarget(Driver::RenderTargetHandle rth,
         Driver::TargetBufferFlags targets, uint32_t width, uint32_t height, uint8_t samples,
         TextureFormat format, Driver::TargetBufferInfo color, Driver::TargetBufferInfo depth,
         Driver::TargetBufferInfo stencil) {
-    auto& renderTarget = *construct_handle<VulkanRenderTarget>(mHandleMap, rth, mContext,
+    auto& renderTarget = *construct<VulkanRenderTarget>(rth, mContext,
             width, height, color.level);
     if (color.handle) {
-        auto colorTexture = handle_cast<VulkanTexture>(mHandleMap, color.handle);
+        auto colorTexture = handle_cast<VulkanTexture*>(color.handle);
         renderTarget.setColorImage({
             .image = colorTexture->textureImage,
             .view = colorTexture->imageView,
@@ -307,7 +401,7 @@ void VulkanDriver::createRenderTarget(Driver::RenderTargetHandle rth,
         renderTarget.createColorImage(getVkFormat(format));
     }
     if (depth.handle) {
-        auto depthTexture = handle_cast<VulkanTexture>(mHandleMap, depth.handle);
+        auto depthTexture = handle_cast<VulkanTexture*>(depth.handle);
         renderTarget.setDepthImage({
             .image = depthTexture->textureImage,
             .view = depthTexture->imageView,
@@ -323,7 +417,7 @@ void VulkanDriver::createFence(Driver::FenceHandle fh, int) {
 
 void VulkanDriver::createSwapChain(Driver::SwapChainHandle sch, void* nativeWindow,
         uint64_t flags) {
-    auto* swapChain = construct_handle<VulkanSwapChain>(mHandleMap, sch);
+    auto* swapChain = construct<VulkanSwapChain>(sch);
     VulkanSurfaceContext& sc = swapChain->surfaceContext;
     sc.surface = (VkSurfaceKHR) mContextManager.createVkSurfaceKHR(nativeWindow,
             mContext.instance, &sc.clientSize.width, &sc.clientSize.height);
@@ -395,28 +489,29 @@ Handle<HwStream> VulkanDriver::createStreamFromTextureIdSynchronous() noexcept {
 void VulkanDriver::destroyVertexBuffer(Driver::VertexBufferHandle vbh) {
     if (vbh) {
         waitForIdle(mContext);
-        destruct_handle<VulkanVertexBuffer>(mHandleMap, vbh);
+        destruct<VulkanVertexBuffer>(vbh);
     }
 }
 
 void VulkanDriver::destroyIndexBuffer(Driver::IndexBufferHandle ibh) {
     if (ibh) {
         waitForIdle(mContext);
-        destruct_handle<VulkanIndexBuffer>(mHandleMap, ibh);
+        destruct<VulkanIndexBuffer>(ibh);
     }
 }
 
 void VulkanDriver::destroyRenderPrimitive(Driver::RenderPrimitiveHandle rph) {
     if (rph) {
         waitForIdle(mContext);
-        destruct_handle<VulkanRenderPrimitive>(mHandleMap, rph);
+        destruct<VulkanRenderPrimitive>(rph);
     }
 }
 
 void VulkanDriver::destroyProgram(Driver::ProgramHandle ph) {
     if (ph) {
         waitForIdle(mContext);
-        destruct_handle<VulkanProgram>(mHandleMap, ph);
+        mBinder.unbindProgramBundle(handle_cast<VulkanProgram*>(ph)->bundle);
+        destruct<VulkanProgram>(ph);
     }
 }
 
@@ -426,47 +521,52 @@ void VulkanDriver::destroySamplerBuffer(Driver::SamplerBufferHandle sbh) {
         // not map to any Vulkan objects. To handle destruction, the only thing we need to do is
         // ensure that the next draw call doesn't try to access a zombie sampler buffer. Therefore,
         // simply replace all weak references with null.
-        auto* hwsb = handle_cast<VulkanSamplerBuffer>(mHandleMap, sbh);
+        auto* hwsb = handle_cast<VulkanSamplerBuffer*>(sbh);
         for (auto& binding : mSamplerBindings) {
             if (binding == hwsb) {
                 binding = nullptr;
             }
         }
-        destruct_handle<VulkanSamplerBuffer>(mHandleMap, sbh);
+        destruct<VulkanSamplerBuffer>(sbh);
     }
 }
 
 void VulkanDriver::destroyUniformBuffer(Driver::UniformBufferHandle ubh) {
     if (ubh) {
-        auto* buffer = handle_cast<VulkanUniformBuffer>(mHandleMap, ubh);
-        mBinder.unbindUniformBuffer(buffer->getGpuBuffer());
+        auto* buffer = handle_cast<VulkanUniformBuffer*>(ubh);
+        mBinder.unbindUniformBuffer(buffer->getDeviceBuffer());
+        for (UniformBinding& binding : mUniformBindings) {
+            if (binding.buffer == buffer) {
+                binding = {};
+            }
+        }
         waitForIdle(mContext);
-        destruct_handle<VulkanUniformBuffer>(mHandleMap, ubh);
+        destruct<VulkanUniformBuffer>(ubh);
     }
 }
 
 void VulkanDriver::destroyTexture(Driver::TextureHandle th) {
     if (th) {
-        auto* tex = handle_cast<VulkanTexture>(mHandleMap, th);
+        auto* tex = handle_cast<VulkanTexture*>(th);
         mBinder.unbindImageView(tex->imageView);
         waitForIdle(mContext);
-        destruct_handle<VulkanTexture>(mHandleMap, th);
+        destruct<VulkanTexture>(th);
     }
 }
 
 void VulkanDriver::destroyRenderTarget(Driver::RenderTargetHandle rth) {
     if (rth) {
         waitForIdle(mContext);
-        destruct_handle<VulkanRenderTarget>(mHandleMap, rth);
+        destruct<VulkanRenderTarget>(rth);
     }
 }
 
 void VulkanDriver::destroySwapChain(Driver::SwapChainHandle sch) {
     if (sch) {
         waitForIdle(mContext);
-        VulkanSurfaceContext& sc = handle_cast<VulkanSwapChain>(mHandleMap, sch)->surfaceContext;
+        VulkanSurfaceContext& sc = handle_cast<VulkanSwapChain*>(sch)->surfaceContext;
         destroySurfaceContext(mContext, sc);
-        destruct_handle<VulkanSwapChain>(mHandleMap, sch);
+        destruct<VulkanSwapChain>(sch);
     }
 }
 
@@ -524,14 +624,14 @@ bool VulkanDriver::isFrameTimeSupported() {
 
 void VulkanDriver::updateVertexBuffer(Driver::VertexBufferHandle vbh, size_t index,
         BufferDescriptor&& p, uint32_t byteOffset, uint32_t byteSize) {
-    auto& vb = *handle_cast<VulkanVertexBuffer>(mHandleMap, vbh);
+    auto& vb = *handle_cast<VulkanVertexBuffer*>(vbh);
     vb.buffers[index]->loadFromCpu(p.buffer, byteOffset, byteSize);
     scheduleDestroy(std::move(p));
 }
 
 void VulkanDriver::updateIndexBuffer(Driver::IndexBufferHandle ibh, BufferDescriptor&& p,
         uint32_t byteOffset, uint32_t byteSize) {
-    auto& ib = *handle_cast<VulkanIndexBuffer>(mHandleMap, ibh);
+    auto& ib = *handle_cast<VulkanIndexBuffer*>(ibh);
     ib.buffer->loadFromCpu(p.buffer, byteOffset, byteSize);
     scheduleDestroy(std::move(p));
 }
@@ -540,13 +640,13 @@ void VulkanDriver::update2DImage(Driver::TextureHandle th,
         uint32_t level, uint32_t xoffset, uint32_t yoffset, uint32_t width, uint32_t height,
         PixelBufferDescriptor&& data) {
     assert(xoffset == 0 && yoffset == 0 && "Offsets not yet supported.");
-    handle_cast<VulkanTexture>(mHandleMap, th)->update2DImage(data, width, height, level);
+    handle_cast<VulkanTexture*>(th)->update2DImage(data, width, height, level);
     scheduleDestroy(std::move(data));
 }
 
 void VulkanDriver::updateCubeImage(Driver::TextureHandle th, uint32_t level,
         PixelBufferDescriptor&& data, FaceOffsets faceOffsets) {
-    handle_cast<VulkanTexture>(mHandleMap, th)->updateCubeImage(data, faceOffsets, level);
+    handle_cast<VulkanTexture*>(th)->updateCubeImage(data, faceOffsets, level);
     scheduleDestroy(std::move(data));
 }
 
@@ -558,7 +658,7 @@ void VulkanDriver::setExternalStream(Driver::TextureHandle th, Driver::StreamHan
 
 void VulkanDriver::updateUniformBuffer(Driver::UniformBufferHandle ubh, BufferDescriptor&& data) {
     if (data.size > 0) {
-        auto* buffer = handle_cast<VulkanUniformBuffer>(mHandleMap, ubh);
+        auto* buffer = handle_cast<VulkanUniformBuffer*>(ubh);
         buffer->loadFromCpu(data.buffer, (uint32_t) data.size);
         scheduleDestroy(std::move(data));
     }
@@ -566,7 +666,7 @@ void VulkanDriver::updateUniformBuffer(Driver::UniformBufferHandle ubh, BufferDe
 
 void VulkanDriver::updateSamplerBuffer(Driver::SamplerBufferHandle sbh,
         SamplerBuffer&& samplerBuffer) {
-    auto* sb = handle_cast<VulkanSamplerBuffer>(mHandleMap, sbh);
+    auto* sb = handle_cast<VulkanSamplerBuffer*>(sbh);
     *sb->sb = samplerBuffer;
 }
 
@@ -577,7 +677,7 @@ void VulkanDriver::beginRenderPass(Driver::RenderTargetHandle rth,
     assert(mContext.currentSurface);
     VulkanSurfaceContext& surface = *mContext.currentSurface;
     const SwapContext& swapContext = surface.swapContexts[surface.currentSwapIndex];
-    mCurrentRenderTarget = handle_cast<VulkanRenderTarget>(mHandleMap, rth);
+    mCurrentRenderTarget = handle_cast<VulkanRenderTarget*>(rth);
     VulkanRenderTarget* rt = mCurrentRenderTarget;
     const VkExtent2D extent = rt->getExtent();
     assert(extent.width > 0 && extent.height > 0);
@@ -586,26 +686,8 @@ void VulkanDriver::beginRenderPass(Driver::RenderTargetHandle rth,
     const auto depth = rt->getDepth();
     const bool hasColor = color.format != VK_FORMAT_UNDEFINED;
     const bool hasDepth = depth.format != VK_FORMAT_UNDEFINED;
-    const bool depthOnly = hasDepth && !hasColor;
 
-    VkImageLayout finalLayout;
-    if (!rt->isOffscreen()) {
-        finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-    } else if (depthOnly) {
-        finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
-    } else {
-        finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    }
-
-    VkRenderPass renderPass = mFramebufferCache.getRenderPass({
-        .finalLayout = finalLayout,
-        .colorFormat = color.format,
-        .depthFormat = depth.format,
-        .flags.clear         = params.flags.clear,
-        .flags.discardStart  = params.flags.discardStart,
-        .flags.discardEnd    = params.flags.discardEnd,
-        .flags.dependencies  = params.flags.dependencies
-    });
+    VkRenderPass renderPass = getRenderPass(rt, params);
     mBinder.bindRenderPass(renderPass);
 
     VulkanFboCache::FboKey fbo { .renderPass = renderPass };
@@ -652,6 +734,34 @@ void VulkanDriver::beginRenderPass(Driver::RenderTargetHandle rth,
     mContext.currentRenderPass = renderPassInfo;
 }
 
+VkRenderPass VulkanDriver::getRenderPass(VulkanRenderTarget* rt,
+        const Driver::RenderPassParams& params) {
+    const auto color = rt->getColor();
+    const auto depth = rt->getDepth();
+    const bool hasColor = color.format != VK_FORMAT_UNDEFINED;
+    const bool hasDepth = depth.format != VK_FORMAT_UNDEFINED;
+    const bool depthOnly = hasDepth && !hasColor;
+
+    VkImageLayout finalLayout;
+    if (!rt->isOffscreen()) {
+        finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    } else if (depthOnly) {
+        finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+    } else {
+        finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    }
+
+    return mFramebufferCache.getRenderPass({
+        .finalLayout = finalLayout,
+        .colorFormat = color.format,
+        .depthFormat = depth.format,
+        .flags.clear         = params.flags.clear,
+        .flags.discardStart  = params.flags.discardStart,
+        .flags.discardEnd    = params.flags.discardEnd,
+        .flags.dependencies  = params.flags.dependencies
+    });
+}
+
 void VulkanDriver::endRenderPass(int) {
     assert(mContext.cmdbuffer);
     assert(mContext.currentSurface);
@@ -673,15 +783,15 @@ void VulkanDriver::resizeRenderTarget(Driver::RenderTargetHandle rth,
 void VulkanDriver::setRenderPrimitiveBuffer(Driver::RenderPrimitiveHandle rph,
         Driver::VertexBufferHandle vbh, Driver::IndexBufferHandle ibh,
         uint32_t enabledAttributes) {
-    auto primitive = handle_cast<VulkanRenderPrimitive>(mHandleMap, rph);
-    primitive->setBuffers(handle_cast<VulkanVertexBuffer>(mHandleMap, vbh),
-            handle_cast<VulkanIndexBuffer>(mHandleMap, ibh), enabledAttributes);
+    auto primitive = handle_cast<VulkanRenderPrimitive*>(rph);
+    primitive->setBuffers(handle_cast<VulkanVertexBuffer*>(vbh),
+            handle_cast<VulkanIndexBuffer*>(ibh), enabledAttributes);
 }
 
 void VulkanDriver::setRenderPrimitiveRange(Driver::RenderPrimitiveHandle rph,
         Driver::PrimitiveType pt, uint32_t offset,
         uint32_t minIndex, uint32_t maxIndex, uint32_t count) {
-    auto& primitive = *handle_cast<VulkanRenderPrimitive>(mHandleMap, rph);
+    auto& primitive = *handle_cast<VulkanRenderPrimitive*>(rph);
     primitive.setPrimitiveType(pt);
     primitive.offset = offset * primitive.indexBuffer->elementSize;
     primitive.count = count;
@@ -711,7 +821,7 @@ void VulkanDriver::setViewportScissor(
 void VulkanDriver::makeCurrent(Driver::SwapChainHandle drawSch, Driver::SwapChainHandle readSch) {
     ASSERT_PRECONDITION_NON_FATAL(drawSch == readSch,
                                   "Vulkan driver does not support distinct draw/read swap chains.");
-    VulkanSurfaceContext& sContext = handle_cast<VulkanSwapChain>(mHandleMap, drawSch)->surfaceContext;
+    VulkanSurfaceContext& sContext = handle_cast<VulkanSwapChain*>(drawSch)->surfaceContext;
     mContext.currentSurface = &sContext;
 }
 
@@ -720,9 +830,10 @@ void VulkanDriver::commit(Driver::SwapChainHandle sch) {
     ASSERT_POSTCONDITION(mContext.cmdbuffer,
             "Vulkan driver requires at least one frame before a commit.");
     releaseCommandBuffer(mContext);
+    mRingBuffer.endFrame(getSwapContext(mContext).fence);
 
     // Present the backbuffer.
-    VulkanSurfaceContext& surface = handle_cast<VulkanSwapChain>(mHandleMap, sch)->surfaceContext;
+    VulkanSurfaceContext& surface = handle_cast<VulkanSwapChain*>(sch)->surfaceContext;
     VkPresentInfoKHR presentInfo {
         .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
         .waitSemaphoreCount = 1,
@@ -760,21 +871,19 @@ void VulkanDriver::viewport(ssize_t left, ssize_t bottom, size_t width, size_t h
 }
 
 void VulkanDriver::bindUniformBuffer(size_t index, Driver::UniformBufferHandle ubh) {
-    auto* buffer = handle_cast<VulkanUniformBuffer>(mHandleMap, ubh);
-    // The driver API does not currently expose offset / range, but it will do so in the future.
-    const VkDeviceSize offset = 0;
-    const VkDeviceSize size = VK_WHOLE_SIZE;
-    mBinder.bindUniformBuffer((uint32_t) index, buffer->getGpuBuffer(), offset, size);
+    auto* buffer = handle_cast<VulkanUniformBuffer*>(ubh);
+    mUniformBindings[index] = { buffer, 0, buffer->getSize() };
 }
 
 void VulkanDriver::bindUniformBufferRange(size_t index, Driver::UniformBufferHandle ubh,
         size_t offset, size_t size) {
-    auto* buffer = handle_cast<VulkanUniformBuffer>(mHandleMap, ubh);
-    mBinder.bindUniformBuffer((uint32_t)index, buffer->getGpuBuffer(), offset, size);
+    auto* buffer = handle_cast<VulkanUniformBuffer*>(ubh);
+    mUniformBindings[index] = { buffer, (uint32_t) offset, (uint32_t) size };
+    mUniformBufferRanges[index] = { ubh, size };
 }
 
 void VulkanDriver::bindSamplers(size_t index, Driver::SamplerBufferHandle sbh) {
-    auto* hwsb = handle_cast<VulkanSamplerBuffer>(mHandleMap, sbh);
+    auto* hwsb = handle_cast<VulkanSamplerBuffer*>(sbh);
     mSamplerBindings[index] = hwsb;
 }
 
@@ -817,8 +926,8 @@ void VulkanDriver::readStreamPixels(Driver::StreamHandle sh, uint32_t x, uint32_
 void VulkanDriver::blit(TargetBufferFlags buffers,
         Driver::RenderTargetHandle dst, driver::Viewport dstRect,
         Driver::RenderTargetHandle src, driver::Viewport srcRect) {
-    auto dstTarget = handle_cast<VulkanRenderTarget>(mHandleMap, dst);
-    auto srcTarget = handle_cast<VulkanRenderTarget>(mHandleMap, src);
+    auto dstTarget = handle_cast<VulkanRenderTarget*>(dst);
+    auto srcTarget = handle_cast<VulkanRenderTarget*>(src);
 
     // In debug builds, verify that the two render targets have blittable formats.
 #ifndef NDEBUG
@@ -876,25 +985,10 @@ void VulkanDriver::blit(TargetBufferFlags buffers,
     }
 }
 
-void VulkanDriver::draw(Driver::PipelineState pipelineState, Driver::RenderPrimitiveHandle rph) {
-    VkCommandBuffer cmdbuffer = mContext.cmdbuffer;
-    ASSERT_POSTCONDITION(cmdbuffer, "Draw calls can occur only within a beginFrame / endFrame.");
-    const VulkanRenderPrimitive& prim = *handle_cast<VulkanRenderPrimitive>(mHandleMap, rph);
-
-    Driver::ProgramHandle programHandle = pipelineState.program;
-    Driver::RasterState rasterState = pipelineState.rasterState;
-    Driver::PolygonOffset depthOffset = pipelineState.polygonOffset;
-
-    // If this is a debug build, validate the current shader.
-    auto* program = handle_cast<VulkanProgram>(mHandleMap, programHandle);
-#if !defined(NDEBUG)
-    if (program->bundle.vertex == VK_NULL_HANDLE || program->bundle.fragment == VK_NULL_HANDLE) {
-        utils::slog.e << "Binding missing shader: " << program->name.c_str() << utils::io::endl;
-    }
-#endif
-
-    // Update the VK raster state.
-    mContext.rasterState.depthStencil = {
+// Converts Filament's raster state to the Vulkan structures used by the binder.
+static void updateRasterState(VulkanBinder::RasterState& vkstate,
+        Driver::RasterState rasterState, Driver::PolygonOffset depthOffset) {
+    vkstate.depthStencil = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
         .depthTestEnable = VK_TRUE,
         .depthWriteEnable = (VkBool32) rasterState.depthWrite,
@@ -903,7 +997,7 @@ void VulkanDriver::draw(Driver::PipelineState pipelineState, Driver::RenderPrimi
         .stencilTestEnable = VK_FALSE,
     };
 
-    mContext.rasterState.blending = {
+    vkstate.blending = {
         .blendEnable = (VkBool32) rasterState.hasBlending(),
         .srcColorBlendFactor = getBlendFactor(rasterState.blendFunctionSrcRGB),
         .dstColorBlendFactor = getBlendFactor(rasterState.blendFunctionDstRGB),
@@ -914,24 +1008,51 @@ void VulkanDriver::draw(Driver::PipelineState pipelineState, Driver::RenderPrimi
         .colorWriteMask = (VkColorComponentFlags) (rasterState.colorWrite ? 0xf : 0x0),
     };
 
-    auto& vkraster = mContext.rasterState.rasterization;
+    auto& vkraster = vkstate.rasterization;
     vkraster.cullMode = getCullMode(rasterState.culling);
     vkraster.frontFace = getFrontFace(rasterState.inverseFrontFaces);
     vkraster.depthBiasEnable = (depthOffset.constant || depthOffset.slope) ? VK_TRUE : VK_FALSE;
     vkraster.depthBiasConstantFactor = depthOffset.constant;
     vkraster.depthBiasSlopeFactor = depthOffset.slope;
+}
 
-    // Remove the fragment shader from depth-only passes to avoid a validation warning.
-    VulkanBinder::ProgramBundle shaderHandles = program->bundle;
-    VulkanRenderTarget* rt = mCurrentRenderTarget;
-    const auto color = rt->getColor();
-    const auto depth = rt->getDepth();
-    const bool hasColor = color.format != VK_FORMAT_UNDEFINED;
-    const bool hasDepth = depth.format != VK_FORMAT_UNDEFINED;
-    const bool depthOnly = hasDepth && !hasColor;
-    if (depthOnly) {
-        shaderHandles.fragment = VK_NULL_HANDLE;
+// Depth-only render targets get no fragment shader, to avoid a validation warning.
+static VulkanBinder::ProgramBundle getProgramBundle(const VulkanProgram& program,
+        const VulkanRenderTarget& rt) {
+    VulkanBinder::ProgramBundle bundle = program.bundle;
+    const bool hasColor = rt.getColor().format != VK_FORMAT_UNDEFINED;
+    const bool hasDepth = rt.getDepth().format != VK_FORMAT_UNDEFINED;
+    if (hasDepth && !hasColor) {
+        bundle.fragment = VK_NULL_HANDLE;
+    }
+    return bundle;
+}
+
+void VulkanDriver::draw(Driver::PipelineState pipelineState, Driver::RenderPrimitiveHandle rph,
+        uint32_t instanceCount) {
+    VkCommandBuffer cmdbuffer = mContext.cmdbuffer;
+    ASSERT_POSTCONDITION(cmdbuffer, "Draw calls can occur only within a beginFrame / endFrame.");
+    const VulkanRenderPrimitive& prim = *handle_cast<VulkanRenderPrimitive*>(rph);
+    mDrawPipelineState = pipelineState;
+
+    Driver::ProgramHandle programHandle = pipelineState.program;
+    Driver::RasterState rasterState = pipelineState.rasterState;
+    Driver::PolygonOffset depthOffset = pipelineState.polygonOffset;
+
+    // If this is a debug build, validate the current shader.
+    auto* program = handle_cast<VulkanProgram*>(programHandle);
+#if !defined(NDEBUG)
+    if (program->bundle.vertex == VK_NULL_HANDLE || program->bundle.fragment == VK_NULL_HANDLE) {
+        utils::slog.e << "Binding missing shader: " << program->name.c_str() << utils::io::endl;
     }
+#endif
+
+    // Update the VK raster state.
+    updateRasterState(mContext.rasterState, rasterState, depthOffset);
+
+    // Remove the fragment shader from depth-only passes to avoid a validation warning.
+    const VulkanBinder::ProgramBundle shaderHandles =
+            getProgramBundle(*program, *mCurrentRenderTarget);
 
     // Push state changes to the VulkanBinder instance. This is fast and does not make VK calls.
     mBinder.bindProgramBundle(shaderHandles);
@@ -962,7 +1083,7 @@ void VulkanDriver::draw(Driver::PipelineState pipelineState, Driver::RenderPrimi
                     &group)) {
                 const SamplerParams& samplerParams = sampler->s;
                 VkSampler vksampler = mSamplerCache.getSampler(samplerParams);
-                const auto* tex = handle_const_cast<VulkanTexture>(mHandleMap, sampler->t);
+                const auto* tex = handle_cast<const VulkanTexture*>(sampler->t);
                 mBinder.bindSampler(binding, {
                     .sampler = vksampler,
                     .imageView = tex->imageView,
@@ -974,16 +1095,26 @@ void VulkanDriver::draw(Driver::PipelineState pipelineState, Driver::RenderPrimi
         }
     }
 
-    // Bind a new descriptor set if it needs to change.
+    // Resolve where the content of the uniform buffers currently is.
+    for (uint32_t index = 0; index < VulkanBinder::NUM_UBUFFER_BINDINGS; index++) {
+        UniformBinding const& binding = mUniformBindings[index];
+        if (binding.buffer) {
+            binding.buffer->refresh();
+            mBinder.bindUniformBuffer(index, binding.buffer->getGpuBuffer(),
+                    binding.buffer->getGpuOffset() + binding.offset, binding.size);
+        }
+    }
+
+    // Bind a new descriptor set if it needs to change, or if the uniform buffer offsets did.
     VkDescriptorSet descriptor;
     VkPipelineLayout pipelineLayout;
     if (mBinder.getOrCreateDescriptor(&descriptor, &pipelineLayout)) {
         vkCmdBindDescriptorSets(cmdbuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1,
-                &descriptor, 0, nullptr);
+                &descriptor, VulkanBinder::NUM_UBUFFER_BINDINGS, mBinder.getDynamicOffsets());
     }
 
     // Bind the pipeline if it changed. This can happen, for example, if the raster state changed.
-    // Creating a new pipeline is slow, so we should consider using pipeline cache objects.
+    // Creating a new pipeline is slow, which prewarmPipeline() and the pipeline cache mitigate.
     VkPipeline pipeline;
     if (mBinder.getOrCreatePipeline(&pipeline)) {
         vkCmdBindPipeline(cmdbuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
@@ -998,14 +1129,42 @@ void VulkanDriver::draw(Driver::PipelineState pipelineState, Driver::RenderPrimi
             prim.indexBuffer->indexType);
 
     // Finally, make the actual draw call. TODO: support subranges
+    // The first instance must be 0 because shaders index the per-renderable data with
+    // gl_InstanceIndex, which includes it.
     const uint32_t indexCount = prim.count;
-    const uint32_t instanceCount = 1;
     const uint32_t firstIndex = prim.offset / prim.indexBuffer->elementSize;
     const int32_t vertexOffset = 0;
-    const uint32_t firstInstId = 1;
+    const uint32_t firstInstId = 0;
     vkCmdDrawIndexed(cmdbuffer, indexCount, instanceCount, firstIndex, vertexOffset, firstInstId);
 }
 
+void VulkanDriver::drawDelta(uint32_t index, uint32_t offset, Driver::RenderPrimitiveHandle rph,
+        uint32_t instanceCount) {
+    UniformBufferRange const& range = mUniformBufferRanges[index];
+    bindUniformBufferRange(index, range.ubh, offset, range.size);
+    draw(mDrawPipelineState, rph, instanceCount);
+}
+
+void VulkanDriver::prewarmPipeline(Driver::PipelineState pipelineState,
+        Driver::RenderPrimitiveHandle rph, Driver::RenderTargetHandle rth,
+        const Driver::RenderPassParams& params) {
+    const VulkanRenderPrimitive& prim = *handle_cast<VulkanRenderPrimitive*>(rph);
+    const auto* program = handle_cast<VulkanProgram*>(pipelineState.program);
+    VulkanRenderTarget* rt = handle_cast<VulkanRenderTarget*>(rth);
+
+    // The attachments of the default render target are only known once there is a surface.
+    if (!rt->isOffscreen() && !mContext.currentSurface) {
+        return;
+    }
+
+    // Same state as draw() would bind, starting from the default state like mContext does.
+    VulkanBinder::RasterState rasterState = mBinder.getDefaultRasterState();
+    updateRasterState(rasterState, pipelineState.rasterState, pipelineState.polygonOffset);
+
+    mBinder.prewarmPipeline(getProgramBundle(*program, *rt), rasterState,
+            getRenderPass(rt, params), prim.primitiveTopology, prim.varray);
+}
+
 #ifndef NDEBUG
 void VulkanDriver::debugCommand(const char* methodName) {
     static const std::set<utils::StaticString> OUTSIDE_COMMANDS = {
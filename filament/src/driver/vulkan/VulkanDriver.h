@@ -20,6 +20,7 @@
 #include "VulkanBinder.h"
 #include "VulkanDriverImpl.h"
 #include "VulkanFboCache.h"
+#include "VulkanRingBuffer.h"
 #include "VulkanSamplerCache.h"
 #include "VulkanStagePool.h"
 
@@ -29,7 +30,6 @@
 #include <utils/compiler.h>
 #include <utils/Allocator.h>
 
-#include <unordered_map>
 #include <vector>
 
 namespace filament {
@@ -37,6 +37,7 @@ namespace driver {
 
 struct VulkanRenderTarget;
 struct VulkanSamplerBuffer;
+struct VulkanUniformBuffer;
 
 class VulkanDriver final : public DriverBase {
 public:
@@ -56,6 +57,8 @@ private:
 
     ShaderModel getShaderModel() const noexcept final;
 
+    MemoryStats getMemoryStats() const noexcept final;
+
     template<typename T>
     friend class ::filament::ConcreteDispatcher;
 
@@ -75,77 +78,32 @@ private:
     VulkanDriver& operator = (VulkanDriver const&) = delete;
 
 private:
-    driver::VulkanPlatform& mContextManager;
+    VkRenderPass getRenderPass(VulkanRenderTarget* rt, const Driver::RenderPassParams& params);
 
-    // For now we're not bothering to store handles in pools, just simple on-demand allocation.
-    // We have a little map from integer handles to "blobs" which get replaced with the Hw objects.
-    using Blob = std::vector<uint8_t>;
-    using HandleMap = std::unordered_map<HandleBase::HandleId, Blob>;
-    HandleMap mHandleMap;
-    std::mutex mHandleMapMutex;
-    HandleBase::HandleId mNextId = 1;
-
-    template<typename Dp, typename B>
-    Handle<B> alloc_handle() {
-        std::lock_guard<std::mutex> lock(mHandleMapMutex);
-        mHandleMap[mNextId] = Blob(sizeof(Dp));
-        return Handle<B>(mNextId++);
-    }
-
-    template<typename Dp, typename B>
-    Dp* handle_cast(HandleMap& handleMap, Handle<B>& handle) noexcept {
-        std::lock_guard<std::mutex> lock(mHandleMapMutex);
-        assert(handle);
-        auto iter = handleMap.find(handle.getId());
-        assert(iter != handleMap.end());
-        Blob& blob = iter->second;
-        assert(blob.size() == sizeof(Dp));
-        return reinterpret_cast<Dp*>(blob.data());
-    }
-
-    template<typename Dp, typename B>
-    const Dp* handle_const_cast(HandleMap& handleMap, const Handle<B>& handle) noexcept {
-        std::lock_guard<std::mutex> lock(mHandleMapMutex);
-        assert(handle);
-        auto iter = handleMap.find(handle.getId());
-        assert(iter != handleMap.end());
-        Blob& blob = iter->second;
-        assert(blob.size() == sizeof(Dp));
-        return reinterpret_cast<const Dp*>(blob.data());
-    }
-
-    template<typename Dp, typename B, typename ... ARGS>
-    Dp* construct_handle(HandleMap& handleMap, Handle<B>& handle, ARGS&& ... args) noexcept {
-        std::lock_guard<std::mutex> lock(mHandleMapMutex);
-        auto iter = handleMap.find(handle.getId());
-        assert(iter != handleMap.end());
-        Blob& blob = iter->second;
-        assert(blob.size() == sizeof(Dp));
-        Dp* addr = reinterpret_cast<Dp*>(blob.data());
-        new(addr) Dp(std::forward<ARGS>(args)...);
-        return addr;
-    }
-
-    template<typename Dp, typename B>
-    void destruct_handle(HandleMap& handleMap, Handle<B>& handle) noexcept {
-        std::lock_guard<std::mutex> lock(mHandleMapMutex);
-        // Call the destructor, remove the blob, don't bother reclaiming the integer id.
-        auto iter = handleMap.find(handle.getId());
-        assert(iter != handleMap.end());
-        Blob& blob = iter->second;
-        assert(blob.size() == sizeof(Dp));
-        reinterpret_cast<Dp*>(blob.data())->~Dp();
-        handleMap.erase(handle.getId());
-    }
+    // The pipeline cache is persisted in the platform's blob cache, if it has one.
+    void createPipelineCache() noexcept;
+    void destroyPipelineCache() noexcept;
+
+    driver::VulkanPlatform& mContextManager;
 
     VulkanContext mContext = {};
     VulkanBinder mBinder;
     VulkanStagePool mStagePool;
+    VulkanRingBuffer mRingBuffer;
     VulkanFboCache mFramebufferCache;
     VulkanSamplerCache mSamplerCache;
     VulkanRenderTarget* mCurrentRenderTarget = nullptr;
     VulkanSamplerBuffer* mSamplerBindings[VulkanBinder::NUM_SAMPLER_BINDINGS] = {};
+
+    // Uniform buffers are given to the binder at each draw, since their storage can move.
+    struct UniformBinding {
+        VulkanUniformBuffer* buffer;
+        uint32_t offset;
+        uint32_t size;
+    };
+    UniformBinding mUniformBindings[VulkanBinder::NUM_UBUFFER_BINDINGS] = {};
     VkDebugReportCallbackEXT mDebugCallback = VK_NULL_HANDLE;
+    VkPipelineCache mPipelineCache = VK_NULL_HANDLE;
 };
 
 } // namespace driver
@@ -376,23 +376,9 @@ void createDepthBuffer(VulkanContext& context, VulkanSurfaceContext& surfaceCont
         .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
         .samples = VK_SAMPLE_COUNT_1_BIT,
     };
-    VkResult error = vkCreateImage(context.device, &imageInfo, VKALLOC, &depthImage);
-    ASSERT_POSTCONDITION(!error, "Unable to create depth image.");
-
-    // Allocate memory for the VkImage and bind it.
-    VkMemoryRequirements memReqs;
-    vkGetImageMemoryRequirements(context.device, depthImage, &memReqs);
-    VkMemoryAllocateInfo allocInfo {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .allocationSize = memReqs.size,
-        .memoryTypeIndex = selectMemoryType(context, memReqs.memoryTypeBits,
-                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
-    };
-    error = vkAllocateMemory(context.device, &allocInfo, nullptr,
+    VkResult error = createImage(context, VulkanImageKind::ATTACHMENT, imageInfo, &depthImage,
             &surfaceContext.depth.memory);
-    ASSERT_POSTCONDITION(!error, "Unable to allocate depth memory.");
-    error = vkBindImageMemory(context.device, depthImage, surfaceContext.depth.memory, 0);
-    ASSERT_POSTCONDITION(!error, "Unable to bind depth memory.");
+    ASSERT_POSTCONDITION(!error, "Unable to create depth image.");
 
     // Create a VkImageView so that we can attach depth to the framebuffer.
     VkImageView depthView;
@@ -503,8 +489,7 @@ void destroySurfaceContext(VulkanContext& context, VulkanSurfaceContext& surface
     vkDestroySemaphore(context.device, surfaceContext.renderingFinished, VKALLOC);
     vkDestroySurfaceKHR(context.instance, surfaceContext.surface, VKALLOC);
     vkDestroyImageView(context.device, surfaceContext.depth.view, VKALLOC);
-    vkDestroyImage(context.device, surfaceContext.depth.image, VKALLOC);
-    vkFreeMemory(context.device, surfaceContext.depth.memory, VKALLOC);
+    destroyImage(context, surfaceContext.depth.image, surfaceContext.depth.memory);
     if (context.currentSurface == &surfaceContext) {
         context.currentSurface = nullptr;
     }
@@ -523,6 +508,75 @@ uint32_t selectMemoryType(VulkanContext& context, uint32_t flags, VkFlags reqs)
     return (uint32_t) ~0ul;
 }
 
+// Whether an image with the given usage can be transient, i.e. it's only ever accessed as an
+// attachment within render passes. Images that are blitted, copied or sampled need their memory.
+bool isTransientAttachment(VkImageUsageFlags usage) {
+    constexpr VkImageUsageFlags attachmentUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+    return usage && !(usage & ~attachmentUsage);
+}
+
+// Creates the image and binds it to memory sub-allocated from the pool of its kind. The usage of
+// transient attachments is amended with VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT when the device
+// has lazily allocated memory, in which case imageInfo is updated accordingly.
+VkResult createImage(VulkanContext& context, VulkanImageKind kind, VkImageCreateInfo& imageInfo,
+        VkImage* image, VmaAllocation* memory) {
+    VmaAllocationCreateInfo allocInfo { .usage = VMA_MEMORY_USAGE_GPU_ONLY };
+    uint32_t memoryTypeIndex;
+    if (kind == VulkanImageKind::ATTACHMENT && isTransientAttachment(imageInfo.usage)) {
+        // Tiled GPUs don't need to back transient attachments with physical memory at all, as
+        // long as they stay in tile memory.
+        VkImageCreateInfo transientInfo = imageInfo;
+        transientInfo.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+        const VmaAllocationCreateInfo lazyInfo {
+            .requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+                    VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT
+        };
+        if (vmaFindMemoryTypeIndexForImageInfo(context.allocator, &transientInfo, &lazyInfo,
+                &memoryTypeIndex) == VK_SUCCESS) {
+            imageInfo = transientInfo;
+            allocInfo = lazyInfo;
+        }
+    }
+    VkResult result = vmaFindMemoryTypeIndexForImageInfo(context.allocator, &imageInfo,
+            &allocInfo, &memoryTypeIndex);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    VmaPool& pool = context.imagePools[size_t(kind)][memoryTypeIndex];
+    if (!pool) {
+        // The pools only ever hold images with optimal tiling, so there's no need to keep
+        // them apart from linear resources.
+        assert(imageInfo.tiling == VK_IMAGE_TILING_OPTIMAL);
+        const VmaPoolCreateInfo poolInfo {
+            .memoryTypeIndex = memoryTypeIndex,
+            .flags = VMA_POOL_CREATE_IGNORE_BUFFER_IMAGE_GRANULARITY_BIT
+        };
+        result = vmaCreatePool(context.allocator, &poolInfo, &pool);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+    }
+    allocInfo.pool = pool;
+    return vmaCreateImage(context.allocator, &imageInfo, &allocInfo, image, memory, nullptr);
+}
+
+void destroyImage(VulkanContext& context, VkImage image, VmaAllocation memory) {
+    vmaDestroyImage(context.allocator, image, memory);
+}
+
+void destroyImagePools(VulkanContext& context) {
+    for (auto& pools : context.imagePools) {
+        for (VmaPool& pool : pools) {
+            if (pool) {
+                vmaDestroyPool(context.allocator, pool);
+                pool = VK_NULL_HANDLE;
+            }
+        }
+    }
+}
+
 VkFormat getVkFormat(ElementType type, bool normalized) {
     using ElementType = ElementType;
     if (normalized) {
@@ -42,6 +42,14 @@ using VulkanTaskQueue = std::vector<VulkanTask>;
 
 struct VulkanSurfaceContext;
 
+// Images are sub-allocated from VMA pools, one per kind of image and memory type, so that
+// render targets that come and go don't fragment the blocks holding long-lived textures.
+enum class VulkanImageKind : uint8_t {
+    SAMPLED,        // textures, including those that are also rendered into
+    ATTACHMENT,     // attachments that are never sampled
+    COUNT
+};
+
 // For now we only support a single-device, single-instance scenario. Our concept of "context" is a
 // bundle of state containing the Device, the Instance, and various globally-useful Vulkan objects.
 struct VulkanContext {
@@ -63,13 +71,14 @@ struct VulkanContext {
     VkViewport viewport;
     VkFormat depthFormat;
     VmaAllocator allocator;
+    VmaPool imagePools[size_t(VulkanImageKind::COUNT)][VK_MAX_MEMORY_TYPES];
 };
 
 struct VulkanAttachment {
     VkFormat format;
     VkImage image;
     VkImageView view;
-    VkDeviceMemory memory;
+    VmaAllocation memory;
 };
 
 // The SwapContext is the set of objects that gets "swapped" at each beginFrame().
@@ -110,6 +119,11 @@ void transitionDepthBuffer(VulkanContext& context, VulkanSurfaceContext& sc, VkF
 void createCommandBuffersAndFences(VulkanContext& context, VulkanSurfaceContext& sc);
 void destroySurfaceContext(VulkanContext& context, VulkanSurfaceContext& sc);
 uint32_t selectMemoryType(VulkanContext& context, uint32_t flags, VkFlags reqs);
+VkResult createImage(VulkanContext& context, VulkanImageKind kind, VkImageCreateInfo& imageInfo,
+        VkImage* image, VmaAllocation* memory);
+void destroyImage(VulkanContext& context, VkImage image, VmaAllocation memory);
+bool isTransientAttachment(VkImageUsageFlags usage);
+void destroyImagePools(VulkanContext& context);
 VkFormat getVkFormat(ElementType type, bool normalized);
 VkFormat getVkFormat(TextureFormat format);
 uint32_t getBytesPerPixel(TextureFormat format);
@@ -187,7 +187,7 @@ void VulkanFboCache::reset() noexcept {
 
 // Frees up old framebuffers and render passes, then nulls out their key.  Doesn't bother removing
 // the actual map entry since it is fairly small.
-void VulkanFboCache::gc() noexcept {
+void VulkanFboCache::gc(std::function<void(VkRenderPass)> const& beforeDestroy) noexcept {
     mCurrentTime++;
     const uint32_t evictTime = mCurrentTime - TIME_BEFORE_EVICTION;
     for (auto iter = mFramebufferCache.begin(); iter != mFramebufferCache.end(); ++iter) {
@@ -199,6 +199,7 @@ void VulkanFboCache::gc() noexcept {
     for (auto iter = mRenderPassCache.begin(); iter != mRenderPassCache.end(); ++iter) {
         VkRenderPass handle = iter->second.handle;
         if (iter->second.timestamp < evictTime && mRenderPassRefCount[handle] == 0) {
+            beforeDestroy(handle);
             vkDestroyRenderPass(mContext.device, handle, VKALLOC);
             iter.value().handle = VK_NULL_HANDLE;
         }
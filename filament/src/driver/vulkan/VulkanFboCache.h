@@ -23,6 +23,8 @@
 
 #include <tsl/robin_map.h>
 
+#include <functional>
+
 namespace filament {
 namespace driver {
 
@@ -92,8 +94,9 @@ public:
     // Retrieves or creates a VkRenderPass handle.
     VkRenderPass getRenderPass(RenderPassKey config) noexcept;
 
-    // Evicts old unused Vulkan objects. Call this once per frame.
-    void gc() noexcept;
+    // Evicts old unused Vulkan objects. Call this once per frame. The given function is called
+    // with each render pass right before it's destroyed.
+    void gc(std::function<void(VkRenderPass)> const& beforeDestroy) noexcept;
 
     // Frees all Vulkan objects. Call this during shutdown before the device is destroyed.
     void reset() noexcept;
@@ -98,13 +98,11 @@ VulkanProgram::~VulkanProgram() {
 VulkanRenderTarget::~VulkanRenderTarget() {
     if (!mSharedColorImage) {
         vkDestroyImageView(mContext.device, mColor.view, VKALLOC);
-        vkDestroyImage(mContext.device, mColor.image, VKALLOC);
-        vkFreeMemory(mContext.device, mColor.memory, VKALLOC);
+        destroyImage(mContext, mColor.image, mColor.memory);
     }
     if (!mSharedDepthImage) {
         vkDestroyImageView(mContext.device, mDepth.view, VKALLOC);
-        vkDestroyImage(mContext.device, mDepth.image, VKALLOC);
-        vkFreeMemory(mContext.device, mDepth.memory, VKALLOC);
+        destroyImage(mContext, mDepth.image, mDepth.memory);
     }
 }
 
@@ -176,7 +174,8 @@ void VulkanRenderTarget::createColorImage(VkFormat format) {
     assert(mOffscreen);
     this->mColor.format = format;
     mSharedColorImage = false;
-    // Create an appropriately-sized device-only VkImage for the color attachment.
+    // Create an appropriately-sized device-only VkImage for the color attachment. It can be the
+    // source or the destination of a blit, so it can't be transient.
     VkImageCreateInfo colorImageInfo {
         .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
         .imageType = VK_IMAGE_TYPE_2D,
@@ -184,26 +183,14 @@ void VulkanRenderTarget::createColorImage(VkFormat format) {
         .format = mColor.format,
         .mipLevels = 1,
         .arrayLayers = 1,
-        .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+        .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+                VK_IMAGE_USAGE_TRANSFER_DST_BIT,
         .samples = VK_SAMPLE_COUNT_1_BIT,
     };
-    VkResult error = vkCreateImage(mContext.device, &colorImageInfo, VKALLOC, &mColor.image);
+    VkResult error = createImage(mContext, VulkanImageKind::ATTACHMENT, colorImageInfo,
+            &mColor.image, &mColor.memory);
     ASSERT_POSTCONDITION(!error, "Unable to create color attachment.");
 
-    // Allocate memory for the color image and bind it.
-    VkMemoryRequirements memReqs;
-    vkGetImageMemoryRequirements(mContext.device, mColor.image, &memReqs);
-    VkMemoryAllocateInfo allocInfo {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .allocationSize = memReqs.size,
-        .memoryTypeIndex = selectMemoryType(mContext, memReqs.memoryTypeBits,
-                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
-    };
-    error = vkAllocateMemory(mContext.device, &allocInfo, nullptr, &mColor.memory);
-    ASSERT_POSTCONDITION(!error, "Unable to allocate color memory.");
-    error = vkBindImageMemory(mContext.device, mColor.image, mColor.memory, 0);
-    ASSERT_POSTCONDITION(!error, "Unable to bind color memory.");
-
     // Transition the color image into an optimal layout.
     VkImageMemoryBarrier barrier {
         .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
@@ -249,23 +236,10 @@ void VulkanRenderTarget::createDepthImage(VkFormat format) {
         .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
         .samples = VK_SAMPLE_COUNT_1_BIT,
     };
-    VkResult error = vkCreateImage(mContext.device, &depthImageInfo, VKALLOC, &mDepth.image);
+    VkResult error = createImage(mContext, VulkanImageKind::ATTACHMENT, depthImageInfo,
+            &mDepth.image, &mDepth.memory);
     ASSERT_POSTCONDITION(!error, "Unable to create depth attachment.");
 
-    // Allocate memory for the depth image and bind it.
-    VkMemoryRequirements memReqs;
-    vkGetImageMemoryRequirements(mContext.device, mDepth.image, &memReqs);
-    VkMemoryAllocateInfo depthAllocInfo {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .allocationSize = memReqs.size,
-        .memoryTypeIndex = selectMemoryType(mContext, memReqs.memoryTypeBits,
-                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
-    };
-    error = vkAllocateMemory(mContext.device, &depthAllocInfo, nullptr, &mDepth.memory);
-    ASSERT_POSTCONDITION(!error, "Unable to allocate depth memory.");
-    error = vkBindImageMemory(mContext.device, mDepth.image, mDepth.memory, 0);
-    ASSERT_POSTCONDITION(!error, "Unable to bind depth memory.");
-
     // Transition the depth image into an optimal layout and assume there's no need to read from it.
     VkImageMemoryBarrier depthBarrier {
         .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
@@ -325,8 +299,8 @@ VulkanVertexBuffer::VulkanVertexBuffer(VulkanContext& context, VulkanStagePool&
 }
 
 VulkanUniformBuffer::VulkanUniformBuffer(VulkanContext& context, VulkanStagePool& stagePool,
-        uint32_t numBytes, driver::BufferUsage usage)
-        : mContext(context), mStagePool(stagePool) {
+        VulkanRingBuffer& ringBuffer, uint32_t numBytes, driver::BufferUsage usage)
+        : mContext(context), mStagePool(stagePool), mRingBuffer(ringBuffer), mSize(numBytes) {
     // Create the VkBuffer.
     VkBufferCreateInfo bufferInfo {
         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
@@ -337,9 +311,50 @@ VulkanUniformBuffer::VulkanUniformBuffer(VulkanContext& context, VulkanStagePool
         .usage = VMA_MEMORY_USAGE_GPU_ONLY
     };
     vmaCreateBuffer(mContext.allocator, &bufferInfo, &allocInfo, &mGpuBuffer, &mGpuMemory, nullptr);
+    mCurrentBuffer = mGpuBuffer;
+
+    // Frequently updated buffers are written directly to the ring buffer. The device buffer is
+    // still needed, for when the ring buffer is full.
+    if (usage == driver::BufferUsage::DYNAMIC || usage == driver::BufferUsage::STREAM) {
+        mShadow.reset(new uint8_t[numBytes]());
+    }
 }
 
 void VulkanUniformBuffer::loadFromCpu(const void* cpuData, uint32_t numBytes) {
+    assert(numBytes <= mSize);
+    if (mShadow) {
+        memcpy(mShadow.get(), cpuData, numBytes);
+        writeShadow();
+        return;
+    }
+    upload(cpuData, numBytes);
+}
+
+void VulkanUniformBuffer::refresh() {
+    if (mAllocation.buffer && !mRingBuffer.isCurrent(mAllocation)) {
+        writeShadow();
+    }
+}
+
+void VulkanUniformBuffer::writeShadow() {
+    // Each update gets new storage, so the draws recorded before it still see the old content
+    // and there is nothing to synchronize with.
+    mAllocation = mRingBuffer.allocate(mSize);
+    if (mAllocation.buffer) {
+        memcpy(mAllocation.data, mShadow.get(), mSize);
+        mRingBuffer.flush(mAllocation, mSize);
+        mCurrentBuffer = mAllocation.buffer;
+        mCurrentOffset = mAllocation.offset;
+        return;
+    }
+
+    // The ring buffer is full, the whole content must be copied to the device buffer.
+    upload(mShadow.get(), mSize);
+    mCurrentBuffer = mGpuBuffer;
+    mCurrentOffset = 0;
+}
+
+void VulkanUniformBuffer::upload(const void* cpuData, uint32_t numBytes) {
     VulkanStage const* stage = mStagePool.acquireStage(numBytes);
     void* mapped;
     vmaMapMemory(mContext.allocator, stage->memory, &mapped);
@@ -418,9 +433,10 @@ VulkanTexture::VulkanTexture(VulkanContext& context, SamplerType target, uint8_t
         imageInfo.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
     }
 
-    VkResult error = vkCreateImage(context.device, &imageInfo, VKALLOC, &textureImage);
+    VkResult error = createImage(context, VulkanImageKind::SAMPLED, imageInfo, &textureImage,
+            &textureImageMemory);
     if (error) {
-        utils::slog.d << "vkCreateImage: "
+        utils::slog.d << "createImage: "
             << "result = " << error << ", "
             << "extent = " << w << "x" << h << "x"<< depth << ", "
             << "mipLevels = " << levels << ", "
@@ -428,20 +444,6 @@ VulkanTexture::VulkanTexture(VulkanContext& context, SamplerType target, uint8_t
     }
     ASSERT_POSTCONDITION(!error, "Unable to create image.");
 
-    // Allocate memory for the VkImage and bind it.
-    VkMemoryRequirements memReqs = {};
-    vkGetImageMemoryRequirements(context.device, textureImage, &memReqs);
-    VkMemoryAllocateInfo allocInfo = {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .allocationSize = memReqs.size,
-        .memoryTypeIndex = selectMemoryType(context, memReqs.memoryTypeBits,
-                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
-    };
-    error = vkAllocateMemory(context.device, &allocInfo, nullptr, &textureImageMemory);
-    ASSERT_POSTCONDITION(!error, "Unable to allocate image memory.");
-    error = vkBindImageMemory(context.device, textureImage, textureImageMemory, 0);
-    ASSERT_POSTCONDITION(!error, "Unable to bind image.");
-
     // Create a VkImageView so that shaders can sample from the image.
     VkImageViewCreateInfo viewInfo = {};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -467,9 +469,8 @@ VulkanTexture::VulkanTexture(VulkanContext& context, SamplerType target, uint8_t
 
 VulkanTexture::~VulkanTexture() {
     assert(!hasPendingWork(mContext) && "Texture destroyed while work is pending.");
-    vkDestroyImage(mContext.device, textureImage, VKALLOC);
     vkDestroyImageView(mContext.device, imageView, VKALLOC);
-    vkFreeMemory(mContext.device, textureImageMemory, VKALLOC);
+    destroyImage(mContext, textureImage, textureImageMemory);
 }
 
 void VulkanTexture::update2DImage(const PixelBufferDescriptor& data, uint32_t width,
@@ -24,6 +24,8 @@
 #include <filament/EngineEnums.h>
 #include <filament/SamplerBindingMap.h>
 
+#include <memory>
+
 namespace filament {
 namespace driver {
 
@@ -101,16 +103,38 @@ struct VulkanIndexBuffer : public HwIndexBuffer {
 };
 
 struct VulkanUniformBuffer : public HwUniformBuffer {
-    VulkanUniformBuffer(VulkanContext& context, VulkanStagePool& stagePool, uint32_t numBytes,
-            driver::BufferUsage usage);
+    VulkanUniformBuffer(VulkanContext& context, VulkanStagePool& stagePool,
+            VulkanRingBuffer& ringBuffer, uint32_t numBytes, driver::BufferUsage usage);
     ~VulkanUniformBuffer();
     void loadFromCpu(const void* cpuData, uint32_t numBytes);
-    VkBuffer getGpuBuffer() const { return mGpuBuffer; }
+
+    // Moves the content of a buffer that wasn't updated in the current frame to new ring buffer
+    // storage, since its storage is reused once the frame that wrote it is done, even if the
+    // current frame still uses it. Must be called before binding it.
+    void refresh();
+
+    // Where the current content is. DYNAMIC and STREAM buffers are given new storage in the ring
+    // buffer at each update, so this must be queried when binding them for a draw.
+    VkBuffer getGpuBuffer() const { return mCurrentBuffer; }
+    uint32_t getGpuOffset() const { return mCurrentOffset; }
+    uint32_t getSize() const { return mSize; }
+
+    // The buffer owned by this object, which the binder must forget when it's destroyed.
+    VkBuffer getDeviceBuffer() const { return mGpuBuffer; }
 private:
+    void upload(const void* cpuData, uint32_t numBytes);
+    void writeShadow();
     VulkanContext& mContext;
     VulkanStagePool& mStagePool;
+    VulkanRingBuffer& mRingBuffer;
     VkBuffer mGpuBuffer;
     VmaAllocation mGpuMemory;
+    VkBuffer mCurrentBuffer;
+    uint32_t mCurrentOffset = 0;
+    VulkanRingBuffer::Allocation mAllocation = {};
+    const uint32_t mSize;
+    // Content of ring buffer backed buffers, so that an update of a part of it can be completed.
+    std::unique_ptr<uint8_t[]> mShadow;
 };
 
 struct VulkanSamplerBuffer : public HwSamplerBuffer {
@@ -135,7 +159,7 @@ struct VulkanTexture : public HwTexture {
     VkFormat vkformat;
     VkImageView imageView = VK_NULL_HANDLE;
     VkImage textureImage = VK_NULL_HANDLE;
-    VkDeviceMemory textureImageMemory = VK_NULL_HANDLE;
+    VmaAllocation textureImageMemory = VK_NULL_HANDLE;
 private:
 
     // Issues a copy from a VkBuffer to a specified miplevel in a VkImage. The given width and
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "driver/vulkan/VulkanRingBuffer.h"
+
+#include <utils/Log.h>
+
+#include <algorithm>
+
+namespace filament {
+namespace driver {
+
+VulkanRingBuffer::Allocation VulkanRingBuffer::allocate(uint32_t numBytes) noexcept {
+    // The buffer is created when it's first needed, the allocator doesn't exist before that.
+    if (UTILS_UNLIKELY(mBuffer == VK_NULL_HANDLE)) {
+        VkBufferCreateInfo bufferInfo {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .size = CAPACITY,
+            .usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT
+        };
+        VmaAllocationCreateInfo allocInfo {
+            .flags = VMA_ALLOCATION_CREATE_MAPPED_BIT,
+            .usage = VMA_MEMORY_USAGE_CPU_TO_GPU
+        };
+        VmaAllocationInfo info;
+        VkResult result = vmaCreateBuffer(mContext.allocator, &bufferInfo, &allocInfo,
+                &mBuffer, &mMemory, &info);
+        if (result != VK_SUCCESS) {
+            utils::slog.e << "Unable to create the uniform ring buffer." << utils::io::endl;
+            mBuffer = VK_NULL_HANDLE;
+            return {};
+        }
+        mMapped = (uint8_t*) info.pMappedData;
+        mAlignment = (uint32_t) std::max(VkDeviceSize(16),
+                mContext.physicalDeviceProperties.limits.minUniformBufferOffsetAlignment);
+    }
+
+    const uint64_t size = (numBytes + mAlignment - 1) & ~uint64_t(mAlignment - 1);
+    uint64_t position;
+    if (!mRing.allocate(size, &position)) {
+        if (!mFull) {
+            utils::slog.w << "The uniform ring buffer is full, falling back to copies."
+                    << utils::io::endl;
+            mFull = true;
+        }
+        return {};
+    }
+
+    const uint32_t offset = uint32_t(position % CAPACITY);
+    return { mBuffer, offset, mMapped + offset, position };
+}
+
+void VulkanRingBuffer::flush(Allocation const& allocation, uint32_t numBytes) noexcept {
+    // this is a no-op on host-coherent memory
+    vmaFlushAllocation(mContext.allocator, mMemory, allocation.offset, numBytes);
+}
+
+void VulkanRingBuffer::beginFrame(VkFence fence) noexcept {
+    if (mRing.beginFrame(fence)) {
+        mFull = false;
+    }
+}
+
+void VulkanRingBuffer::endFrame(VkFence fence) noexcept {
+    mRing.endFrame(fence);
+}
+
+void VulkanRingBuffer::reset() noexcept {
+    if (mBuffer != VK_NULL_HANDLE) {
+        vmaDestroyBuffer(mContext.allocator, mBuffer, mMemory);
+        mBuffer = VK_NULL_HANDLE;
+        mMemory = VK_NULL_HANDLE;
+        mMapped = nullptr;
+    }
+    mRing.reset();
+}
+
+bool VulkanRingBuffer::Ring::allocate(uint64_t size, uint64_t* position) noexcept {
+    uint64_t head = mHead;
+    // allocations don't wrap around, skip the end of the buffer instead
+    if (head % mCapacity + size > mCapacity) {
+        head += mCapacity - head % mCapacity;
+    }
+    if (head + size - mTail > mCapacity) {
+        return false;
+    }
+    mHead = head + size;
+    *position = head;
+    return true;
+}
+
+bool VulkanRingBuffer::Ring::beginFrame(VkFence fence) noexcept {
+    auto iter = std::find_if(mFrameEnds.begin(), mFrameEnds.end(),
+            [fence](FrameEnd const& end) { return end.fence == fence; });
+    if (iter == mFrameEnds.end()) {
+        return false;
+    }
+    // the GPU executes frames in order, so everything allocated up to that frame is available
+    mTail = std::max(mTail, iter->head);
+    mFrameEnds.erase(iter);
+    return true;
+}
+
+void VulkanRingBuffer::Ring::endFrame(VkFence fence) noexcept {
+    mFrameEnds.push_back({ fence, mHead });
+    // the following allocations are made for the next frame
+    mFrameStart = mHead;
+}
+
+void VulkanRingBuffer::Ring::reset() noexcept {
+    mHead = mTail = mFrameStart = 0;
+    mFrameEnds.clear();
+}
+
+} // namespace driver
+} // namespace filament
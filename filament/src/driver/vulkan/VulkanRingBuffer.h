@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_DRIVER_VULKANRINGBUFFER_H
+#define TNT_FILAMENT_DRIVER_VULKANRINGBUFFER_H
+
+#include "VulkanDriverImpl.h"
+
+#include <vector>
+
+namespace filament {
+namespace driver {
+
+// A persistently mapped, host-visible uniform buffer from which the content of frequently updated
+// uniform buffers is sub-allocated. Writing to it needs neither a copy nor a barrier: each update
+// gets new storage, and the storage is recycled once the GPU is done with the frame that made it.
+class VulkanRingBuffer {
+public:
+    static constexpr uint32_t CAPACITY = 4 * 1024 * 1024;
+
+    // The bookkeeping of the positions in the ring, which only grow. The offset in the buffer
+    // is position % capacity.
+    class Ring {
+    public:
+        explicit Ring(uint64_t capacity) noexcept : mCapacity(capacity) {}
+
+        // Returns false if there is no room for size bytes in the ring. Allocations don't wrap
+        // around.
+        bool allocate(uint64_t size, uint64_t* position) noexcept;
+
+        // Whether the allocation at the given position was made for the current frame. Storage is
+        // recycled once the frame that made it is done, regardless of the frames that used it
+        // afterwards, so content used in a later frame must be copied to a new allocation.
+        bool isCurrent(uint64_t position) const noexcept { return position >= mFrameStart; }
+
+        // Returns whether storage was recycled.
+        bool beginFrame(VkFence fence) noexcept;
+        void endFrame(VkFence fence) noexcept;
+        void reset() noexcept;
+
+    private:
+        struct FrameEnd {
+            VkFence fence;
+            uint64_t head;
+        };
+        const uint64_t mCapacity;
+        uint64_t mHead = 0;
+        uint64_t mTail = 0;
+        uint64_t mFrameStart = 0;
+        // Position of the head when the frames in flight were submitted.
+        std::vector<FrameEnd> mFrameEnds;
+    };
+
+    struct Allocation {
+        VkBuffer buffer;
+        uint32_t offset;
+        void* data;
+        uint64_t position;
+    };
+
+    explicit VulkanRingBuffer(VulkanContext& context) noexcept
+            : mContext(context), mRing(CAPACITY) {}
+
+    // Returns storage for the given number of bytes, aligned for use as a uniform buffer range,
+    // or an allocation whose buffer is null if the ring is full. The storage must be written
+    // before the frame using it is committed, and flushed with flush().
+    Allocation allocate(uint32_t numBytes) noexcept;
+    void flush(Allocation const& allocation, uint32_t numBytes) noexcept;
+
+    // Whether an allocation was made for the current frame. The storage of the other ones may be
+    // recycled while the current frame is in flight, their content must be written to a new
+    // allocation before use.
+    bool isCurrent(Allocation const& allocation) const noexcept {
+        return mRing.isCurrent(allocation.position);
+    }
+
+    // Recycles the storage of the frame that was last submitted with the given fence, which must
+    // have been waited on. Call this at each beginFrame().
+    void beginFrame(VkFence fence) noexcept;
+
+    // Marks the end of the allocations made for the frame submitted with the given fence. Call
+    // this when the frame's command buffer is submitted.
+    void endFrame(VkFence fence) noexcept;
+
+    // Destroys the buffer. This should be called while the context's VkDevice is still alive.
+    void reset() noexcept;
+
+private:
+    VulkanContext& mContext;
+    VkBuffer mBuffer = VK_NULL_HANDLE;
+    VmaAllocation mMemory = VK_NULL_HANDLE;
+    uint8_t* mMapped = nullptr;
+    uint32_t mAlignment = 0;
+    Ring mRing;
+    bool mFull = false;
+};
+
+} // namespace driver
+} // namespace filament
+
+#endif // TNT_FILAMENT_DRIVER_VULKANRINGBUFFER_H
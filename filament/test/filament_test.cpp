@@ -14,8 +14,15 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <fstream>
 #include <iostream>
 #include <random>
+#include <string>
+#include <thread>
+
+#include <stdlib.h>
+#include <unistd.h>
 
 #include <gtest/gtest.h>
 
@@ -28,19 +35,51 @@
 #include <filament/Frustum.h>
 #include <filament/Material.h>
 #include <filament/Engine.h>
+#include <filament/IndexBuffer.h>
+#include <filament/LightManager.h>
+#include <filament/Renderer.h>
+#include <filament/Scene.h>
+#include <filament/VertexBuffer.h>
+#include <filament/View.h>
+#include <filament/driver/Platform.h>
 
 #include <private/filament/UniformInterfaceBlock.h>
 #include <private/filament/UibGenerator.h>
 
+#include <utils/Path.h>
+
 #include "details/Allocators.h"
 #include "details/Material.h"
 #include "details/Camera.h"
+#include "details/Culler.h"
 #include "details/Froxelizer.h"
 #include "details/Engine.h"
+#include "details/GeometryArena.h"
+#include "details/RenderPrimitive.h"
+#include "details/ShadowAtlas.h"
+#include "details/ShadowMap.h"
+#include "details/Texture.h"
+#include "details/TextureStreamer.h"
+#include "details/View.h"
 #include "components/RenderableManager.h"
 #include "components/TransformManager.h"
+#include "driver/Capture.h"
+#include "driver/CommandBufferQueue.h"
+#include "driver/CommandStream.h"
+#include "driver/HandleAllocator.h"
+#include "driver/noop/NoopDriver.h"
+#include "driver/opengl/UniformRingRegions.h"
+#include "CpuProfiler.h"
+#include "RangeAllocator.h"
+#include "RenderPass.h"
 #include "UniformBuffer.h"
 
+#if defined(FILAMENT_DRIVER_SUPPORTS_VULKAN)
+#include "driver/vulkan/VulkanRingBuffer.h"
+#endif
+
+#include "generated/resources/materials.h"
+
 using namespace filament;
 using namespace filament::math;
 using namespace utils;
@@ -146,6 +185,93 @@ TEST(FilamentTest, TransformManager) {
     EXPECT_EQ(tcm.getWorldTransform(child), mat4f{ float4{ 8 }});
 }
 
+TEST(FilamentTest, TransformManagerBreadthFirst) {
+    filament::details::FTransformManager tcm;
+    EntityManager& em = EntityManager::get();
+    std::array<Entity, 5> entities;
+    em.create(entities.size(), entities.data());
+
+    // create the hierarchy 0 -> 1 -> 2 -> 3, and 4 a root, in the "wrong" order
+    for (size_t i = 0; i < entities.size(); i++) {
+        tcm.create(entities[entities.size() - 1 - i]);
+    }
+    tcm.setParent(tcm.getInstance(entities[3]), tcm.getInstance(entities[2]));
+    tcm.setParent(tcm.getInstance(entities[2]), tcm.getInstance(entities[1]));
+    tcm.setParent(tcm.getInstance(entities[1]), tcm.getInstance(entities[0]));
+
+    std::array<TransformManager::Instance, 5> instances;
+    std::array<mat4f, 5> transforms;
+    for (size_t i = 0; i < entities.size(); i++) {
+        instances[i] = tcm.getInstance(entities[i]);
+        transforms[i] = mat4f::translate(float3{ float(1 << i), 0, 0 });
+    }
+    tcm.setTransforms(instances.data(), transforms.data(), instances.size());
+
+    // Instances are invalidated
+    for (size_t i = 0; i < entities.size(); i++) {
+        instances[i] = tcm.getInstance(entities[i]);
+    }
+
+    // roots come first, and each node comes after its parent
+    EXPECT_LT(instances[0], instances[1]);
+    EXPECT_LT(instances[4], instances[1]);
+    EXPECT_LT(instances[1], instances[2]);
+    EXPECT_LT(instances[2], instances[3]);
+
+    EXPECT_EQ(tcm.getWorldTransform(instances[0]), mat4f::translate(float3{ 1, 0, 0 }));
+    EXPECT_EQ(tcm.getWorldTransform(instances[1]), mat4f::translate(float3{ 3, 0, 0 }));
+    EXPECT_EQ(tcm.getWorldTransform(instances[2]), mat4f::translate(float3{ 7, 0, 0 }));
+    EXPECT_EQ(tcm.getWorldTransform(instances[3]), mat4f::translate(float3{ 15, 0, 0 }));
+    EXPECT_EQ(tcm.getWorldTransform(instances[4]), mat4f::translate(float3{ 16, 0, 0 }));
+
+    // the ordering is stable if the hierarchy doesn't change
+    transforms[0] = mat4f::translate(float3{ 0, 1, 0 });
+    tcm.setTransforms(&instances[0], &transforms[0], 1);
+    EXPECT_EQ(instances[3], tcm.getInstance(entities[3]));
+    EXPECT_EQ(tcm.getWorldTransform(instances[3]), mat4f::translate(float3{ 14, 1, 0 }));
+
+    for (Entity e : entities) {
+        tcm.destroy(e);
+    }
+    em.destroy(entities.size(), entities.data());
+}
+
+TEST(FilamentTest, TransformManagerBulkCreate) {
+    filament::details::FTransformManager tcm;
+    EntityManager& em = EntityManager::get();
+    std::array<Entity, 4> entities;
+    em.create(entities.size(), entities.data());
+
+    // 0 -> 1 -> 2, and 3 a child of 0
+    const std::array<int32_t, 4> parents = { -1, 0, 1, 0 };
+    std::array<mat4f, 4> transforms;
+    for (size_t i = 0; i < entities.size(); i++) {
+        transforms[i] = mat4f::translate(float3{ float(1 << i), 0, 0 });
+    }
+    std::array<TransformManager::Instance, 4> instances;
+    tcm.create(entities.data(), parents.data(), transforms.data(), entities.size(),
+            instances.data());
+
+    for (size_t i = 0; i < entities.size(); i++) {
+        EXPECT_EQ(instances[i], tcm.getInstance(entities[i]));
+    }
+    EXPECT_EQ(tcm.getWorldTransform(instances[2]), mat4f::translate(float3{ 7, 0, 0 }));
+    EXPECT_EQ(tcm.getWorldTransform(instances[3]), mat4f::translate(float3{ 9, 0, 0 }));
+
+    // the hierarchy is linked as with create()
+    transforms[0] = mat4f::translate(float3{ 0, 1, 0 });
+    tcm.setTransform(instances[0], transforms[0]);
+    EXPECT_EQ(tcm.getWorldTransform(tcm.getInstance(entities[2])),
+            mat4f::translate(float3{ 6, 1, 0 }));
+    EXPECT_EQ(tcm.getWorldTransform(tcm.getInstance(entities[3])),
+            mat4f::translate(float3{ 8, 1, 0 }));
+
+    for (Entity e : entities) {
+        tcm.destroy(e);
+    }
+    em.destroy(entities.size(), entities.data());
+}
+
 TEST(FilamentTest, UniformInterfaceBlock) {
 
     UniformInterfaceBlock::Builder b;
@@ -373,6 +499,43 @@ TEST(FilamentTest, BoxCulling) {
     EXPECT_TRUE( frustum.intersects( { 0, 200 }) );
 }
 
+TEST(FilamentTest, MultiFrustumBoxCulling) {
+    using filament::details::Culler;
+
+    // two frusta, the 2nd one is translated by 50 along x
+    const Frustum frusta[2] = {
+            Frustum(mat4f::frustum(-1, 1, -1, 1, 1, 100)),
+            Frustum(mat4f::frustum(-1, 1, -1, 1, 1, 100) * mat4f::translate(float3{ -50, 0, 0 }))
+    };
+
+    // the culler works with multiples of 8 elements
+    float3 centers[Culler::MODULO] = {
+            {  0, 0, -10 },     // visible in the 1st frustum only
+            { 50, 0, -10 },     // visible in the 2nd frustum only
+            { 25, 0, -50 },     // visible in both
+            {  0, 0,   0 },     // visible in neither
+    };
+    float3 extents[Culler::MODULO];
+    std::fill(std::begin(extents), std::end(extents), float3{ 0.5f });
+    Culler::result_type results[Culler::MODULO];
+
+    Culler::Test::intersects(results, frusta, 2, centers, extents, Culler::MODULO);
+
+    EXPECT_EQ(0x1, results[0]);
+    EXPECT_EQ(0x2, results[1]);
+    EXPECT_EQ(0x3, results[2]);
+    EXPECT_EQ(0x0, results[3]);
+
+    // must match the single frustum version, bit by bit
+    for (size_t i = 0; i < 2; i++) {
+        Culler::result_type single[Culler::MODULO] = {};
+        Culler::Test::intersects(single, frusta[i], centers, extents, Culler::MODULO);
+        for (size_t j = 0; j < Culler::MODULO; j++) {
+            EXPECT_EQ(bool(single[j]), bool(results[j] & (1u << i)));
+        }
+    }
+}
+
 TEST(FilamentTest, SphereCulling) {
     Frustum frustum(mat4f::frustum(-1, 1, -1, 1, 1, 100));
 
@@ -627,7 +790,10 @@ TEST(FilamentTest, Bones) {
         static void check(mat4f const& m) noexcept {
             PerRenderableUibBone b;
             FRenderableManager::makeBone(&b, m);
+            check(m, b);
+        }
 
+        static void check(mat4f const& m, PerRenderableUibBone const& b) noexcept {
             expect_eq(Shader::vertice(b), m);
 
             mat3f n = transpose(inverse(m.upperLeft()));
@@ -692,6 +858,1377 @@ TEST(FilamentTest, Bones) {
         float3 p(rand_gen(), rand_gen(), rand_gen());
         Test::check(m, p);
     }
+
+    // rotations where w is 0
+    Test::check(mat4f::rotate(M_PI, float3{1,0,0}));
+    Test::check(mat4f::rotate(M_PI, float3{0,1,0}));
+    Test::check(mat4f::rotate(M_PI, float3{0,0,1}));
+    Test::check(mat4f::rotate(M_PI, float3{1,-1,0}));
+
+    // the bones converted by batches match their transforms, including in the partial last batch
+    mat4f transforms[13];
+    for (mat4f& t : transforms) {
+        const float3 axis = normalize(float3{ rand_gen(), rand_gen(), rand_gen() });
+        t = mat4f::translate(float3{ rand_gen(), rand_gen(), rand_gen() }) *
+            mat4f::rotate(rand_gen(), axis) *
+            mat4f::scale(float3{ rand_gen(), rand_gen(), rand_gen() } * 0.01f);
+    }
+    PerRenderableUibBone bones[13];
+    FRenderableManager::makeBones(bones, transforms, 13);
+    for (size_t i = 0; i < 13; i++) {
+        Test::check(transforms[i], bones[i]);
+    }
+}
+
+// Runs the renderer on the NOOP backend. The objects made with the helpers are destroyed
+// after the test.
+class FilamentRenderTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        fengine = ::filament::details::FEngine::create(Engine::Backend::NOOP);
+        engine = fengine;
+        swapChain = engine->createSwapChain(nullptr);
+        renderer = engine->createRenderer();
+        camera = engine->createCamera();
+        ib = IndexBuffer::Builder()
+                .indexCount(3)
+                .bufferType(IndexBuffer::IndexType::USHORT)
+                .build(*engine);
+    }
+
+    void TearDown() override {
+        for (View* view : views) {
+            engine->destroy(view);
+        }
+        for (Scene* scene : scenes) {
+            engine->destroy(scene);
+        }
+        for (Entity e : entities) {
+            engine->destroy(e);
+        }
+        EntityManager::get().destroy(entities.size(), entities.data());
+        for (VertexBuffer* vb : vbs) {
+            engine->destroy(vb);
+        }
+        engine->destroy(ib);
+        engine->destroy(camera);
+        engine->destroy(renderer);
+        engine->destroy(swapChain);
+        fengine->shutdown();
+        delete fengine;
+    }
+
+    NoopDriver& getNoopDriver() {
+        return static_cast<NoopDriver&>(fengine->getDriver());
+    }
+
+    VertexBuffer* createVertexBuffer() {
+        vbs.push_back(VertexBuffer::Builder()
+                .vertexCount(3)
+                .bufferCount(1)
+                .attribute(VertexAttribute::POSITION, 0, VertexBuffer::AttributeType::FLOAT3)
+                .build(*engine));
+        return vbs.back();
+    }
+
+    Scene* createScene() {
+        scenes.push_back(engine->createScene());
+        return scenes.back();
+    }
+
+    // The view shows the scene through the camera, without post-processing.
+    View* createView(Scene* scene) {
+        View* view = engine->createView();
+        view->setScene(scene);
+        view->setCamera(camera);
+        view->setViewport({ 0, 0, 64, 64 });
+        view->setPostProcessingEnabled(false);
+        views.push_back(view);
+        return view;
+    }
+
+    Entity createEntity() {
+        entities.push_back(EntityManager::get().create());
+        return entities.back();
+    }
+
+    // A triangle of the given vertex buffer with the default material.
+    RenderableManager::Builder renderable(VertexBuffer* vb) {
+        RenderableManager::Builder builder(1);
+        builder.geometry(0, RenderableManager::PrimitiveType::TRIANGLES, vb, ib)
+                .material(0, engine->getDefaultMaterial()->getDefaultInstance())
+                .boundingBox({{ 0, 0, 0 }, { 1, 1, 1 }});
+        return builder;
+    }
+
+    void renderFrame(View* view) {
+        ASSERT_TRUE(renderer->beginFrame(swapChain));
+        renderer->render(view);
+        renderer->endFrame();
+        Fence::waitAndDestroy(engine->createFence());
+    }
+
+    ::filament::details::FEngine* fengine = nullptr;
+    Engine* engine = nullptr;
+    SwapChain* swapChain = nullptr;
+    Renderer* renderer = nullptr;
+    Camera* camera = nullptr;
+    IndexBuffer* ib = nullptr;
+    std::vector<VertexBuffer*> vbs;
+    std::vector<Scene*> scenes;
+    std::vector<View*> views;
+    std::vector<Entity> entities;
+};
+
+TEST_F(FilamentRenderTest, BonesAllocation) {
+    using namespace ::filament::details;
+
+    FRenderableManager& rcm = fengine->getRenderableManager();
+    VertexBuffer* vb = createVertexBuffer();
+    auto build = [&](size_t boneCount) {
+        Entity e = createEntity();
+        renderable(vb).skinning(boneCount).build(*engine, e);
+        return rcm.getInstance(e);
+    };
+    constexpr uint32_t BONE_SIZE = sizeof(PerRenderableUibBone);
+
+    // the ranges start after the reserved bones, on a multiple of 4 bones
+    EXPECT_EQ(4 * BONE_SIZE, rcm.getBonesOffset(build(3)));
+    EXPECT_EQ(8 * BONE_SIZE, rcm.getBonesOffset(build(5)));
+    EXPECT_EQ(16 * BONE_SIZE, rcm.getBonesOffset(build(4)));
+    EXPECT_EQ(20u, rcm.mBoneCount);
+
+    // adjacent free ranges are merged...
+    rcm.destroy(entities[0]);
+    rcm.destroy(entities[1]);
+    ASSERT_EQ(1u, rcm.mFreeBones.size());
+    EXPECT_EQ(4u, rcm.mFreeBones[0].offset);
+    EXPECT_EQ(12u, rcm.mFreeBones[0].count);
+
+    // ...so that a larger renderable fits in them
+    EXPECT_EQ(4 * BONE_SIZE, rcm.getBonesOffset(build(10)));
+    EXPECT_TRUE(rcm.mFreeBones.empty());
+
+    // freeing the end of the buffer shrinks it
+    rcm.destroy(entities[2]);
+    EXPECT_EQ(16u, rcm.mBoneCount);
+    rcm.destroy(entities[3]);
+    EXPECT_EQ(4u, rcm.mBoneCount);
+    EXPECT_TRUE(rcm.mFreeBones.empty());
+
+    // the bones set in a batch, converted in parallel, land in the range of each renderable
+    RenderableManager::Instance instances[8];
+    mat4f transforms[8 * 3];
+    for (size_t i = 0; i < 8; i++) {
+        instances[i] = build(3);
+    }
+    for (size_t i = 0; i < 8 * 3; i++) {
+        const float f = float(i);
+        transforms[i] = mat4f::translate(float3{ f, 2 * f, 3 * f }) *
+                        mat4f::rotate(0.1f * f, float3{ 0, 0, 1 }) *
+                        mat4f::scale(float3{ 1 + f, 2, 3 });
+    }
+    rcm.setBones(instances, 8, transforms);
+    PerRenderableUibBone expected[8 * 3];
+    FRenderableManager::makeBones(expected, transforms, 8 * 3);
+    auto const* buffer = static_cast<const char*>(rcm.mBones.getBuffer());
+    for (size_t i = 0; i < 8; i++) {
+        auto const* bones = reinterpret_cast<PerRenderableUibBone const*>(
+                buffer + rcm.getBonesOffset(instances[i]));
+        for (size_t j = 0; j < 3; j++) {
+            EXPECT_EQ(expected[i * 3 + j].q, bones[j].q);
+            EXPECT_EQ(expected[i * 3 + j].t, bones[j].t);
+            EXPECT_EQ(expected[i * 3 + j].s, bones[j].s);
+            EXPECT_EQ(expected[i * 3 + j].ns, bones[j].ns);
+        }
+    }
+}
+
+TEST(FilamentTest, NoopDriverDrawStats) {
+    Driver* driver = NoopDriver::create();
+    NoopDriver& noop = static_cast<NoopDriver&>(*driver);
+    CommandBufferQueue queue(CircularBuffer::BLOCK_SIZE, 3 * CircularBuffer::BLOCK_SIZE);
+    CommandStream stream(*driver, queue.getCircularBuffer());
+
+    Driver::PipelineState pipeline;
+    Handle<HwRenderPrimitive> rph;
+    stream.draw(pipeline, rph, 1);
+    stream.draw(pipeline, rph, 10);
+    queue.flush();
+
+    // nothing is executed until the command buffer is processed
+    EXPECT_EQ(0, noop.getDrawStats().drawCalls);
+
+    for (auto& item : queue.waitForCommands()) {
+        stream.execute(item.begin);
+        queue.releaseBuffer(item);
+    }
+
+    EXPECT_EQ(2, noop.getDrawStats().drawCalls);
+    EXPECT_EQ(11, noop.getDrawStats().instances);
+
+    noop.resetDrawStats();
+    EXPECT_EQ(0, noop.getDrawStats().drawCalls);
+    EXPECT_EQ(0, noop.getDrawStats().instances);
+
+    delete driver;
+}
+
+TEST(FilamentTest, CommandStreamDrawDelta) {
+    constexpr size_t DRAW_COUNT = 32;
+
+    Driver* driver = NoopDriver::create();
+    NoopDriver& noop = static_cast<NoopDriver&>(*driver);
+    CommandBufferQueue queue(CircularBuffer::BLOCK_SIZE, 3 * CircularBuffer::BLOCK_SIZE);
+    CommandStream stream(*driver, queue.getCircularBuffer());
+    CircularBuffer const& buffer = queue.getCircularBuffer();
+
+    auto execute = [&]() {
+        queue.flush();
+        for (auto& item : queue.waitForCommands()) {
+            stream.execute(item.begin);
+            queue.releaseBuffer(item);
+        }
+    };
+
+    Driver::PipelineState pipeline;
+    Handle<HwRenderPrimitive> rph;
+    Handle<HwUniformBuffer> ubh;
+
+    // a binding and a full draw for each renderable...
+    uint64_t start = buffer.getBytesWritten();
+    for (size_t i = 0; i < DRAW_COUNT; i++) {
+        stream.bindUniformBufferRange(BindingPoints::PER_RENDERABLE, ubh, i * 256, 256);
+        stream.draw(pipeline, rph, 1);
+    }
+    execute();
+    const uint64_t fullSize = buffer.getBytesWritten() - start;
+
+    // ...or a full draw followed by deltas
+    start = buffer.getBytesWritten();
+    stream.bindUniformBufferRange(BindingPoints::PER_RENDERABLE, ubh, 0, 256);
+    stream.draw(pipeline, rph, 1);
+    for (size_t i = 1; i < DRAW_COUNT; i++) {
+        stream.drawDelta(BindingPoints::PER_RENDERABLE, uint32_t(i * 256), rph, 1);
+    }
+    execute();
+    const uint64_t deltaSize = buffer.getBytesWritten() - start;
+
+    EXPECT_EQ(2 * DRAW_COUNT, noop.getDrawStats().drawCalls);
+    EXPECT_EQ(DRAW_COUNT - 1, noop.getDrawStats().deltaDrawCalls);
+    EXPECT_LT(deltaSize * 2, fullSize);
+
+    delete driver;
+}
+
+TEST_F(FilamentRenderTest, RenderPassDrawDelta) {
+    NoopDriver& noop = getNoopDriver();
+
+    // each renderable has its own primitive, so that they are not instanced
+    constexpr size_t COUNT = 8;
+    Entity renderables[COUNT];
+    for (Entity& e : renderables) {
+        e = createEntity();
+        renderable(createVertexBuffer()).culling(false).build(*engine, e);
+    }
+    Scene* scene = createScene();
+    View* view = createView(scene);
+
+    scene->addEntity(renderables[0]);
+    noop.resetDrawStats();
+    renderFrame(view);
+    const NoopDriver::DrawStats one = noop.getDrawStats();
+    const View::Stats stats = view->getStats();
+    const size_t passes = stats.depthPass.drawCalls + stats.colorPass.drawCalls;
+    EXPECT_LE(passes, one.drawCalls);
+    EXPECT_EQ(0u, one.deltaDrawCalls);
+
+    for (size_t i = 1; i < COUNT; i++) {
+        scene->addEntity(renderables[i]);
+    }
+    noop.resetDrawStats();
+    renderFrame(view);
+    const NoopDriver::DrawStats all = noop.getDrawStats();
+
+    // the other renderables only change the per-renderable offset, each of them is a
+    // drawDelta() that doesn't re-bind the per-renderable range. The range is bound at
+    // most once more, when the first pass ends on another renderable than the second's.
+    EXPECT_EQ(one.drawCalls + passes * (COUNT - 1), all.drawCalls);
+    EXPECT_EQ(passes * (COUNT - 1), all.deltaDrawCalls);
+    EXPECT_LE(all.uniformBufferRangeBindings, one.uniformBufferRangeBindings + passes - 1);
+}
+
+TEST_F(FilamentRenderTest, RendererPrewarm) {
+    NoopDriver& noop = getNoopDriver();
+
+    // each renderable has its own primitive, so each of them needs its own pipeline
+    constexpr size_t COUNT = 4;
+    Scene* scene = createScene();
+    for (size_t i = 0; i < COUNT; i++) {
+        Entity e = createEntity();
+        renderable(createVertexBuffer()).culling(false).build(*engine, e);
+        scene->addEntity(e);
+    }
+    // the passes are prewarmed for the post-processing target
+    View* view = createView(scene);
+    view->setPostProcessingEnabled(true);
+
+    // prewarming doesn't draw anything
+    noop.resetDrawStats();
+    ASSERT_TRUE(renderer->beginFrame(swapChain));
+    renderer->prewarm(view);
+    renderer->endFrame();
+    Fence::waitAndDestroy(engine->createFence());
+    const NoopDriver::DrawStats prewarm = noop.getDrawStats();
+    EXPECT_EQ(0u, prewarm.drawCalls);
+    EXPECT_GE(prewarm.prewarmedPipelines, COUNT);
+
+    // and it covers every draw of the view's passes
+    noop.resetDrawStats();
+    renderFrame(view);
+    const View::Stats stats = view->getStats();
+    EXPECT_EQ(prewarm.prewarmedPipelines,
+            stats.depthPass.drawCalls + stats.colorPass.drawCalls);
+    EXPECT_EQ(0u, noop.getDrawStats().prewarmedPipelines);
+}
+
+TEST(FilamentTest, CaptureRoundTrip) {
+    const char* path = "filament_test_capture.bin";
+    const uint32_t content[] = { 1, 2, 3, 4, 5 };
+    const char* marker = "abc";
+
+    Driver::PipelineState pipeline;
+    pipeline.program = Handle<HwProgram>(12);
+    pipeline.rasterState.culling = driver::CullingMode::FRONT;
+    pipeline.polygonOffset = { 1.0f, 2.0f };
+
+    {
+        capture::Writer writer(std::ofstream(path, std::ios::binary | std::ios::trunc));
+        writer.record(capture::Command::createRenderPrimitive, Handle<HwRenderPrimitive>(7), 0);
+        // an odd sized string, so that the next buffer must be padded
+        writer.record(capture::Command::insertEventMarker, marker, size_t(3));
+        writer.record(capture::Command::updateVertexBuffer, Handle<HwVertexBuffer>(), size_t(1),
+                driver::BufferDescriptor(content, sizeof(content)), uint32_t(16), uint32_t(20));
+        writer.record(capture::Command::draw, pipeline, Handle<HwRenderPrimitive>(7));
+    }
+
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    std::vector<char> data(size_t(file.tellg()));
+    file.seekg(0);
+    file.read(data.data(), data.size());
+    file.close();
+    remove(path);
+
+    capture::Reader reader(data.data(), data.size());
+    ASSERT_TRUE(reader.readHeader());
+
+    // the objects are created with new handles when they're replayed
+    capture::Command command;
+    ASSERT_TRUE(reader.next(command));
+    EXPECT_TRUE(command == capture::Command::createRenderPrimitive);
+    EXPECT_EQ(7u, reader.readHandleId());
+    reader.mapHandle(7, 42);
+
+    ASSERT_TRUE(reader.next(command));
+    EXPECT_TRUE(command == capture::Command::insertEventMarker);
+    EXPECT_STREQ(marker, reader.read<const char*>());
+    EXPECT_EQ(3u, reader.read<size_t>());
+
+    ASSERT_TRUE(reader.next(command));
+    EXPECT_TRUE(command == capture::Command::updateVertexBuffer);
+    EXPECT_FALSE(reader.read<Handle<HwVertexBuffer>>());
+    EXPECT_EQ(1u, reader.read<size_t>());
+    driver::BufferDescriptor buffer(reader.read<driver::BufferDescriptor>());
+    ASSERT_EQ(sizeof(content), buffer.size);
+    EXPECT_EQ(0u, (uintptr_t(buffer.buffer) - uintptr_t(data.data())) % capture::BUFFER_ALIGNMENT);
+    EXPECT_EQ(0, memcmp(content, buffer.buffer, sizeof(content)));
+    EXPECT_EQ(16u, reader.read<uint32_t>());
+    EXPECT_EQ(20u, reader.read<uint32_t>());
+
+    // handles that weren't created in the capture are replayed as null handles
+    ASSERT_TRUE(reader.next(command));
+    EXPECT_TRUE(command == capture::Command::draw);
+    Driver::PipelineState state(reader.read<Driver::PipelineState>());
+    EXPECT_FALSE(state.program);
+    EXPECT_EQ(pipeline.rasterState.u, state.rasterState.u);
+    EXPECT_EQ(2.0f, state.polygonOffset.constant);
+    EXPECT_EQ(42u, reader.read<Handle<HwRenderPrimitive>>().getId());
+
+    EXPECT_FALSE(reader.next(command));
+}
+
+TEST(FilamentTest, RenderPassInstancing) {
+    using namespace ::filament::details;
+    using Command = RenderPass::Command;
+
+    // we only compare material instance pointers, they're never dereferenced
+    FMaterialInstance const* mi0 = reinterpret_cast<FMaterialInstance const*>(uintptr_t(0x100));
+    FMaterialInstance const* mi1 = reinterpret_cast<FMaterialInstance const*>(uintptr_t(0x200));
+
+    auto make = [](uint64_t key, FMaterialInstance const* mi, HandleBase::HandleId rph) {
+        Command c;
+        c.key = key;
+        c.primitive.mi = mi;
+        c.primitive.primitiveHandle = Handle<HwRenderPrimitive>(rph);
+        return c;
+    };
+
+    std::vector<Command> commands;
+    commands.push_back(make(1, mi0, 1));    // instanced x3
+    commands.push_back(make(1, mi0, 1));
+    commands.push_back(make(1, mi0, 1));
+    commands.push_back(make(2, mi1, 1));    // different material instance
+    commands.push_back(make(3, mi1, 2));    // different primitive, instanced x2
+    commands.push_back(make(3, mi1, 2));
+    commands.push_back(make(4, mi1, 2));    // different raster state
+    commands.back().primitive.rasterState.culling = driver::CullingMode::FRONT;
+    commands.push_back(make(5, mi1, 3));    // skinned, never instanced
+    commands.back().primitive.perRenderableBones = 256;
+    commands.push_back(make(5, mi1, 3));
+    commands.back().primitive.perRenderableBones = 512;
+    commands.push_back(make(uint64_t(RenderPass::Pass::SENTINEL), nullptr, 4));
+
+    uint32_t instanceCount = RenderPass::instanceCommands(
+            commands.data(), commands.data() + commands.size());
+    EXPECT_EQ(5, instanceCount);
+
+    const uint8_t expected[] = { 3, 0, 0, 1, 2, 0, 1, 1, 1 };
+    for (size_t i = 0; i < sizeof(expected); i++) {
+        EXPECT_EQ(expected[i], commands[i].primitive.instanceCount);
+    }
+    // all the commands use renderable 0, the instances must be copied
+    EXPECT_TRUE(commands[0].primitive.instancesUbo);
+    EXPECT_TRUE(commands[4].primitive.instancesUbo);
+    EXPECT_FALSE(commands[3].primitive.instancesUbo);
+
+    // consecutive renderables are drawn from the renderable UBO, without a copy
+    commands.clear();
+    for (uint16_t i = 0; i < 3; i++) {
+        commands.push_back(make(1, mi0, 1));
+        commands.back().primitive.index = uint16_t(10 + i);
+    }
+    for (uint16_t i : { 20, 22 }) {
+        commands.push_back(make(2, mi0, 1));
+        commands.back().primitive.index = i;
+    }
+    commands.push_back(make(uint64_t(RenderPass::Pass::SENTINEL), nullptr, 4));
+
+    instanceCount = RenderPass::instanceCommands(
+            commands.data(), commands.data() + commands.size());
+    EXPECT_EQ(2, instanceCount);
+    EXPECT_EQ(3, commands[0].primitive.instanceCount);
+    EXPECT_FALSE(commands[0].primitive.instancesUbo);
+    EXPECT_EQ(10, commands[0].primitive.index);
+    EXPECT_EQ(2, commands[3].primitive.instanceCount);
+    EXPECT_TRUE(commands[3].primitive.instancesUbo);
+
+    // runs are limited to CONFIG_MAX_INSTANCES instances
+    commands.clear();
+    for (size_t i = 0; i < CONFIG_MAX_INSTANCES + 2; i++) {
+        commands.push_back(make(1, mi0, 1));
+    }
+    commands.push_back(make(uint64_t(RenderPass::Pass::SENTINEL), nullptr, 4));
+
+    instanceCount = RenderPass::instanceCommands(
+            commands.data(), commands.data() + commands.size());
+    EXPECT_EQ(CONFIG_MAX_INSTANCES + 2, instanceCount);
+    EXPECT_EQ(CONFIG_MAX_INSTANCES, commands[0].primitive.instanceCount);
+    EXPECT_EQ(2, commands[CONFIG_MAX_INSTANCES].primitive.instanceCount);
+}
+
+TEST_F(FilamentRenderTest, RenderMultipleViews) {
+    // two scenes with a different number of renderables, the first one is seen by two views,
+    // and its first renderable is only visible in the second one
+    VertexBuffer* vb = createVertexBuffer();
+    Scene* scenes[2] = { createScene(), createScene() };
+    const size_t renderableCounts[2] = { 3, 5 };
+    for (size_t i = 0, e = 0; i < 2; i++) {
+        for (size_t j = 0; j < renderableCounts[i]; j++, e++) {
+            Entity entity = createEntity();
+            renderable(vb)
+                    .culling(false)
+                    .layerMask(0x3, e == 0 ? 0x2 : 0x1)
+                    .build(*engine, entity);
+            scenes[i]->addEntity(entity);
+        }
+    }
+
+    View* views[3];
+    for (size_t i = 0; i < 3; i++) {
+        views[i] = createView(scenes[i == 2 ? 1 : 0]);
+    }
+    views[1]->setVisibleLayers(0x3, 0x3);
+
+    // render the views one by one...
+    View::Stats expected[3];
+    ASSERT_TRUE(renderer->beginFrame(swapChain));
+    for (size_t i = 0; i < 3; i++) {
+        renderer->render(views[i]);
+        expected[i] = views[i]->getStats();
+    }
+    renderer->endFrame();
+    EXPECT_EQ(2u, expected[0].colorPass.commands);
+    EXPECT_EQ(3u, expected[1].colorPass.commands);
+    EXPECT_EQ(5u, expected[2].colorPass.commands);
+
+    // ...and together, their commands are built in parallel, even for the views sharing
+    // a scene, which sort its renderables differently
+    ASSERT_TRUE(renderer->beginFrame(swapChain));
+    renderer->render(views, 3);
+    renderer->endFrame();
+    for (size_t i = 0; i < 3; i++) {
+        View::Stats const& stats = views[i]->getStats();
+        EXPECT_EQ(expected[i].visibleRenderables, stats.visibleRenderables);
+        EXPECT_EQ(expected[i].colorPass.commands, stats.colorPass.commands);
+        EXPECT_EQ(expected[i].colorPass.drawCalls, stats.colorPass.drawCalls);
+        EXPECT_EQ(expected[i].depthPass.commands, stats.depthPass.commands);
+    }
+}
+
+TEST_F(FilamentRenderTest, ViewStats) {
+    // the first two renderables are in front of the camera, the last one is behind it
+    VertexBuffer* vb = createVertexBuffer();
+    Scene* scene = createScene();
+    Entity renderables[3];
+    const float z[3] = { -2, -3, 5 };
+    for (size_t i = 0; i < 3; i++) {
+        renderables[i] = createEntity();
+        renderable(vb)
+                .boundingBox({{ -0.5f, -0.5f, z[i] - 0.5f }, { 0.5f, 0.5f, z[i] + 0.5f }})
+                .castShadows(i == 0)
+                .build(*engine, renderables[i]);
+        scene->addEntity(renderables[i]);
+    }
+
+    camera->setProjection(Camera::Projection::ORTHO, -1, 1, -1, 1, 0.1, 10);
+    View* view = createView(scene);
+
+    EXPECT_EQ(0u, view->getStats().renderables);
+    EXPECT_EQ(0u, view->getStats().colorPass.drawCalls);
+
+    renderFrame(view);
+
+    View::Stats stats = view->getStats();
+    EXPECT_EQ(3u, stats.renderables);
+    EXPECT_EQ(2u, stats.visibleRenderables);
+    EXPECT_EQ(1u, stats.getCulledRenderables());
+    EXPECT_EQ(1u, stats.shadowCasters);
+    EXPECT_EQ(0u, stats.visibleLights);
+    EXPECT_EQ(2u, stats.colorPass.commands);
+    EXPECT_LE(1u, stats.colorPass.drawCalls);
+    EXPECT_LE(stats.colorPass.drawCalls, stats.colorPass.commands);
+    EXPECT_LT(0u, stats.commandBytes);
+    EXPECT_LT(0u, stats.uniformBytes);
+
+    // the statistics are those of the last frame, they're not accumulated
+    scene->remove(renderables[1]);
+    renderFrame(view);
+
+    stats = view->getStats();
+    EXPECT_EQ(2u, stats.renderables);
+    EXPECT_EQ(1u, stats.visibleRenderables);
+    EXPECT_EQ(1u, stats.colorPass.commands);
+}
+
+TEST(FilamentTest, ShadowCascadeSplits) {
+    using namespace ::filament::details;
+    using ShadowCascades = LightManager::ShadowCascades;
+
+    float positions[3];
+    ShadowCascades::computeUniformSplits(positions, 4);
+    EXPECT_FLOAT_EQ(0.25f, positions[0]);
+    EXPECT_FLOAT_EQ(0.50f, positions[1]);
+    EXPECT_FLOAT_EQ(0.75f, positions[2]);
+
+    // logarithmic splits have a constant far/near ratio per cascade
+    const float near = 1.0f;
+    const float far = 1000.0f;
+    ShadowCascades::computeLogSplits(positions, 3, near, far);
+    EXPECT_NEAR(10.0f, near + positions[0] * (far - near), 1e-3f);
+    EXPECT_NEAR(100.0f, near + positions[1] * (far - near), 1e-2f);
+
+    // a 0 near distance still gives increasing positions
+    float zeroNear[3];
+    ShadowCascades::computeLogSplits(zeroNear, 3, 0.0f, far);
+    EXPECT_LT(0.0f, zeroNear[0]);
+    EXPECT_LT(zeroNear[0], zeroNear[1]);
+    EXPECT_GT(1.0f, zeroNear[1]);
+
+    float practical[3];
+    ShadowCascades::computePracticalSplits(practical, 3, near, far, 0.0f);
+    EXPECT_FLOAT_EQ(1.0f / 3.0f, practical[0]);
+    ShadowCascades::computePracticalSplits(practical, 3, near, far, 1.0f);
+    EXPECT_FLOAT_EQ(positions[0], practical[0]);
+    EXPECT_FLOAT_EQ(positions[1], practical[1]);
+
+    // distances of the cascades from the camera
+    float splits[CONFIG_MAX_SHADOW_CASCADES + 1];
+    const float splitPositions[3] = { 0.1f, 0.3f, 0.6f };
+    ShadowMap::computeCascadeSplits(splits, 4, splitPositions, 0.5f, 100.5f);
+    EXPECT_FLOAT_EQ(0.5f, splits[0]);
+    EXPECT_FLOAT_EQ(10.5f, splits[1]);
+    EXPECT_FLOAT_EQ(30.5f, splits[2]);
+    EXPECT_FLOAT_EQ(60.5f, splits[3]);
+    EXPECT_FLOAT_EQ(100.5f, splits[4]);
+
+    // a single cascade covers the whole range
+    ShadowMap::computeCascadeSplits(splits, 1, splitPositions, 0.5f, 100.5f);
+    EXPECT_FLOAT_EQ(0.5f, splits[0]);
+    EXPECT_FLOAT_EQ(100.5f, splits[1]);
+}
+
+TEST(FilamentTest, ShadowCascadeVisibility) {
+    using namespace ::filament::details;
+
+    // cull 4 boxes against 2 cascade frusta lined-up along -z, as the cascade jobs do
+    Frustum cascades[2] = {
+            Frustum(mat4f::ortho(-1, 1, -1, 1, 0, 10)),
+            Frustum(mat4f::ortho(-1, 1, -1, 1, 10, 20)),
+    };
+    float3 centers[8] = {
+            { 0, 0,  -5 },      // cascade 0
+            { 0, 0, -15 },      // cascade 1
+            { 0, 0, -10 },      // both
+            { 5, 0,  -5 },      // neither
+    };
+    float3 extents[8] = {
+            { 0.5f }, { 0.5f }, { 0.5f }, { 0.5f },
+    };
+    uint8_t masks[2][8] = {};
+    for (size_t c = 0; c < 2; c++) {
+        Culler::intersects(masks[c], cascades[c], centers, extents, 8,
+                FView::VISIBLE_CASCADE_BIT + c);
+    }
+
+    // the renderable bit, from the camera culling, is preserved
+    uint8_t visibility[8] = { FView::VISIBLE_RENDERABLE, 0, 0, FView::VISIBLE_RENDERABLE };
+    uint8_t const* cascadeMasks[2] = { masks[0], masks[1] };
+    FView::mergeCascadeVisibility(visibility, cascadeMasks, 2, 4);
+
+    const uint8_t c0 = 1u << FView::VISIBLE_CASCADE_BIT;
+    const uint8_t c1 = 1u << (FView::VISIBLE_CASCADE_BIT + 1);
+    EXPECT_EQ(FView::VISIBLE_ALL | c0, visibility[0]);
+    EXPECT_EQ(FView::VISIBLE_SHADOW_CASTER | c1, visibility[1]);
+    EXPECT_EQ(FView::VISIBLE_SHADOW_CASTER | c0 | c1, visibility[2]);
+    EXPECT_EQ(FView::VISIBLE_RENDERABLE, visibility[3]);
+}
+
+TEST(FilamentTest, ShadowMapCache) {
+    using namespace ::filament::details;
+
+    FEngine* engine = FEngine::create();
+    {
+        ShadowMap shadowMap(*engine);
+
+        // the first frame always renders
+        EXPECT_TRUE(shadowMap.updateCache(42));
+        EXPECT_FALSE(shadowMap.updateCache(42));
+
+        // the casters changed
+        EXPECT_TRUE(shadowMap.updateCache(43));
+        EXPECT_FALSE(shadowMap.updateCache(43));
+
+        // a buffer or a material instance changed
+        engine->invalidateContent();
+        EXPECT_TRUE(shadowMap.updateCache(43));
+        EXPECT_FALSE(shadowMap.updateCache(43));
+
+        // casters that can't be tracked always render, and invalidate the cache
+        EXPECT_TRUE(shadowMap.updateCache(0));
+        EXPECT_TRUE(shadowMap.updateCache(0));
+        EXPECT_TRUE(shadowMap.updateCache(43));
+        EXPECT_FALSE(shadowMap.updateCache(43));
+
+        // the cache can be disabled for debugging
+        engine->debug.shadowmap.cache = false;
+        EXPECT_TRUE(shadowMap.updateCache(43));
+    }
+    engine->shutdown();
+    delete engine;
+}
+
+TEST(FilamentTest, MaterialBuildAsync) {
+    using namespace ::filament::details;
+
+    FEngine* engine = FEngine::create();
+    {
+        struct Result {
+            std::vector<Material*> materials;
+        } result;
+        auto callback = [](Material* material, void* user) {
+            static_cast<Result*>(user)->materials.push_back(material);
+        };
+
+        // an invalid package in the middle doesn't change the order of the others
+        static const uint8_t garbage[64] = {};
+        for (size_t i = 0; i < 3; i++) {
+            Material::Builder builder;
+            if (i == 1) {
+                builder.package(garbage, sizeof(garbage));
+            } else {
+                builder.package(MATERIALS_DEFAULTMATERIAL_DATA, MATERIALS_DEFAULTMATERIAL_SIZE);
+            }
+            builder.buildAsync(*engine, callback, &result, i == 2);
+        }
+        EXPECT_TRUE(result.materials.empty());
+
+        engine->publishMaterials(true);
+        ASSERT_EQ(3u, result.materials.size());
+        ASSERT_NE(nullptr, result.materials[0]);
+        EXPECT_EQ(nullptr, result.materials[1]);
+        ASSERT_NE(nullptr, result.materials[2]);
+        EXPECT_LT(upcast(result.materials[0])->getId(), upcast(result.materials[2])->getId());
+        EXPECT_TRUE(engine->getMaterialLoader().empty());
+
+        // the material is the same as a synchronous build's
+        EXPECT_STREQ(engine->getDefaultMaterial()->getName().c_str(),
+                result.materials[0]->getName());
+        EXPECT_EQ(engine->getDefaultMaterial()->getParameterCount(),
+                result.materials[0]->getParameterCount());
+
+        engine->destroy(upcast(result.materials[0]));
+        engine->destroy(upcast(result.materials[2]));
+
+        // builds still pending at shutdown are discarded
+        Material::Builder()
+                .package(MATERIALS_DEFAULTMATERIAL_DATA, MATERIALS_DEFAULTMATERIAL_SIZE)
+                .buildAsync(*engine, callback, &result);
+    }
+    engine->shutdown();
+    delete engine;
+}
+
+TEST(FilamentTest, ShadowAtlasAllocator) {
+    using namespace ::filament::details;
+    using Tile = ShadowAtlasAllocator::Tile;
+
+    ShadowAtlasAllocator allocator(1024, 128);
+    EXPECT_EQ(128u, allocator.getMinTileSize());
+
+    // tiles are packed from the largest to the smallest, without overlapping
+    Tile a = allocator.allocate(512);
+    Tile b = allocator.allocate(256);
+    Tile c = allocator.allocate(256);
+    EXPECT_EQ((Tile{ 0, 0, 512 }), a);
+    EXPECT_EQ((Tile{ 512, 0, 256 }), b);
+    EXPECT_EQ((Tile{ 768, 0, 256 }), c);
+
+    // the atlas is full
+    EXPECT_TRUE(allocator.allocate(512).isValid());
+    EXPECT_TRUE(allocator.allocate(512).isValid());
+    EXPECT_TRUE(allocator.allocate(256).isValid());
+    EXPECT_TRUE(allocator.allocate(256).isValid());
+    EXPECT_FALSE(allocator.allocate(128).isValid());
+
+    // a freed tile can be reused, but not a larger one
+    allocator.free(b);
+    EXPECT_FALSE(allocator.allocate(512).isValid());
+    EXPECT_EQ((Tile{ 512, 0, 128 }), allocator.allocate(128));
+
+    // a tile from the previous frame can be reserved when it's free
+    allocator.clear();
+    EXPECT_TRUE(allocator.allocate(Tile{ 256, 256, 256 }));
+    EXPECT_FALSE(allocator.allocate(Tile{ 0, 0, 512 }));
+    EXPECT_FALSE(allocator.allocate(Tile{ 384, 256, 128 }));
+    EXPECT_FALSE(allocator.allocate(Tile{ 100, 0, 128 }));
+    EXPECT_TRUE(allocator.allocate(Tile{ 0, 0, 256 }));
+    EXPECT_EQ((Tile{ 256, 0, 256 }), allocator.allocate(256));
+
+    // freeing all the tiles of a quadrant frees the quadrant
+    allocator.free(Tile{ 256, 256, 256 });
+    allocator.free(Tile{ 0, 0, 256 });
+    allocator.free(Tile{ 256, 0, 256 });
+    EXPECT_EQ((Tile{ 0, 0, 1024 }), allocator.allocate(1024));
+}
+
+TEST(FilamentTest, ShadowAtlasTileSize) {
+    using namespace ::filament::details;
+
+    // a light of radius 1m, seen from 10m with a 90 degrees vertical fov covers 10% of the
+    // viewport, the tile is the next power of two
+    float importance = 0;
+    EXPECT_EQ(128u, ShadowAtlas::computeTileSize(1, 10, 1, 1000, 1024, &importance));
+    EXPECT_FLOAT_EQ(100, importance);
+
+    // the size is clamped
+    EXPECT_EQ(ShadowAtlas::MIN_TILE_SIZE, ShadowAtlas::computeTileSize(1, 1000, 1, 1000, 1024));
+    EXPECT_EQ(256u, ShadowAtlas::computeTileSize(1, 2, 1, 1000, 256));
+    EXPECT_EQ(256u, ShadowAtlas::computeTileSize(1, 2, 1, 1000, 500));
+
+    // the camera is inside the light's sphere of influence
+    EXPECT_EQ(1024u, ShadowAtlas::computeTileSize(10, 1, 1, 1000, 1024, &importance));
+    EXPECT_FLOAT_EQ(1000, importance);
+}
+
+TEST(FilamentTest, ShadowAtlasCulling) {
+    using namespace ::filament::details;
+
+    // two tiles looking down -z, side by side
+    Frustum frusta[2] = {
+            Frustum(mat4f::ortho(-2, 0, -1, 1, 0, 10)),
+            Frustum(mat4f::ortho( 0, 2, -1, 1, 0, 10)),
+    };
+    float3 centers[8] = {
+            { -1, 0, -5 },      // tile 0
+            {  1, 0, -5 },      // tile 1
+            {  5, 0, -5 },      // neither
+            {  0, 0, -5 },      // both
+            { -1, 0, -5 },      // tile 0, not culled
+            {  5, 0, -5 },      // neither, not culled
+    };
+    float3 extents[8] = {
+            { 0.5f }, { 0.5f }, { 0.5f }, { 0.5f }, { 0.5f }, { 0.5f },
+    };
+
+    // the shadow caster bit is set for the objects visible in any tile
+    uint8_t visibleMask[8] = { FView::VISIBLE_RENDERABLE };
+    FView::cullShadowAtlasCasters(visibleMask, frusta, 2, centers, extents, 8);
+    EXPECT_EQ(FView::VISIBLE_ALL, visibleMask[0]);
+    EXPECT_EQ(FView::VISIBLE_SHADOW_CASTER, visibleMask[1]);
+    EXPECT_EQ(0, visibleMask[2]);
+    EXPECT_EQ(FView::VISIBLE_SHADOW_CASTER, visibleMask[3]);
+
+    // each tile selects its own casters with the first cascade bit, the objects outside of
+    // the range are untouched, and the objects that are not culled are in all the tiles
+    FRenderableManager::Visibility visibility[8] = {};
+    for (auto& v : visibility) {
+        v.culling = true;
+    }
+    visibility[5].culling = false;
+
+    const uint8_t c0 = 1u << FView::VISIBLE_CASCADE_BIT;
+    const uint8_t c1 = 1u << (FView::VISIBLE_CASCADE_BIT + 1);
+    uint8_t masks[8] = { 0, c1, c1, c1, c1, c1, 0, 0 };
+    FView::cullShadowAtlasTile(masks, visibility, frusta[1], centers, extents, { 1, 6 });
+    EXPECT_EQ(0, masks[0]);
+    EXPECT_EQ(c0, masks[1]);
+    EXPECT_EQ(0, masks[2]);
+    EXPECT_EQ(c0, masks[3]);
+    EXPECT_EQ(0, masks[4]);
+    EXPECT_EQ(c0, masks[5]);
+}
+
+TEST(FilamentTest, TextureStreamingLevel) {
+    using namespace ::filament::details;
+
+    // one texel per pixel or more needs the full resolution
+    EXPECT_EQ(0, FTextureStreamer::computeLevel(1024, 512, 1.0f, 1024.0f, 11));
+    EXPECT_EQ(0, FTextureStreamer::computeLevel(1024, 512, 1.0f, 2048.0f, 11));
+    EXPECT_EQ(0, FTextureStreamer::computeLevel(1024, 512, 1.0f, 512.0f, 11));
+
+    // each halving of the on-screen size drops a level
+    EXPECT_EQ(1, FTextureStreamer::computeLevel(1024, 512, 1.0f, 500.0f, 11));
+    EXPECT_EQ(3, FTextureStreamer::computeLevel(1024, 512, 1.0f, 100.0f, 11));
+
+    // a repeated texture needs finer levels
+    EXPECT_EQ(0, FTextureStreamer::computeLevel(1024, 512, 0.25f, 200.0f, 11));
+    EXPECT_EQ(5, FTextureStreamer::computeLevel(1024, 512, 4.0f, 100.0f, 11));
+
+    // not visible or too small
+    EXPECT_EQ(10, FTextureStreamer::computeLevel(1024, 512, 1.0f, 0.0f, 11));
+    EXPECT_EQ(10, FTextureStreamer::computeLevel(1024, 512, 1.0f, 0.01f, 11));
+}
+
+TEST(FilamentTest, TextureStreamingSchedule) {
+    using namespace ::filament::details;
+    using Record = FTextureStreamer::Record;
+    using Change = FTextureStreamer::Change;
+
+    // 256x256 RGBA8 textures, streaming starts at level 2 (64x64)
+    auto makeRecord = [](uint8_t baseLevel, uint32_t lastUsed, float pixels) {
+        Record record;
+        record.levels = 5;
+        record.width = 256;
+        record.height = 256;
+        for (size_t level = record.levels; level-- > 0;) {
+            const size_t size = 256u >> level;
+            record.tailSize[level] = record.tailSize[level + 1] + size * size * 4;
+        }
+        record.coarsestLevel = 2;
+        record.baseLevel = baseLevel;
+        record.lastUsed = lastUsed;
+        record.pixels = pixels;
+        return record;
+    };
+    const size_t full = 349184;     // levels 0 to 4
+    const size_t coarse = 21504;    // levels 2 to 4
+
+    std::vector<Change> changes;
+
+    // the largest texture on screen is loaded first, the other one doesn't fit
+    Record records[3] = { makeRecord(2, 10, 100), makeRecord(2, 10, 256) };
+    FTextureStreamer::schedule(records, 2, full + coarse, 10, 4, changes);
+    ASSERT_EQ(1u, changes.size());
+    EXPECT_EQ(1u, changes[0].index);
+    EXPECT_EQ(0, changes[0].baseLevel);
+
+    // with more room, the other one gets the level it needs
+    FTextureStreamer::schedule(records, 2, full + coarse + 65536, 10, 4, changes);
+    ASSERT_EQ(2u, changes.size());
+    EXPECT_EQ(0u, changes[1].index);
+    EXPECT_EQ(1, changes[1].baseLevel);
+
+    // no more loads than allowed
+    FTextureStreamer::schedule(records, 2, full * 2, 10, 1, changes);
+    ASSERT_EQ(1u, changes.size());
+    EXPECT_EQ(1u, changes[0].index);
+
+    // a texture that's not visible is evicted to make room
+    records[2] = makeRecord(0, 5, 0);
+    FTextureStreamer::schedule(records, 3, full + coarse * 2, 10, 4, changes);
+    ASSERT_EQ(2u, changes.size());
+    EXPECT_EQ(2u, changes[0].index);
+    EXPECT_EQ(2, changes[0].baseLevel);
+    EXPECT_EQ(1u, changes[1].index);
+    EXPECT_EQ(0, changes[1].baseLevel);
+
+    // textures that are not visible stay resident while they fit in the budget...
+    Record unused[2] = { makeRecord(0, 3, 0), makeRecord(0, 5, 0) };
+    FTextureStreamer::schedule(unused, 2, full * 2, 10, 4, changes);
+    EXPECT_TRUE(changes.empty());
+
+    // ...and the least recently used one is evicted first when they don't
+    FTextureStreamer::schedule(unused, 2, full * 2 - 1, 10, 4, changes);
+    ASSERT_EQ(1u, changes.size());
+    EXPECT_EQ(0u, changes[0].index);
+    EXPECT_EQ(2, changes[0].baseLevel);
+}
+
+TEST(FilamentTest, HandleAllocatorStress) {
+    constexpr size_t THREAD_COUNT = 4;
+    constexpr size_t HANDLE_COUNT = 100000;
+    constexpr size_t HANDLES_PER_THREAD = HANDLE_COUNT / THREAD_COUNT;
+
+    HandleAllocator allocator;
+    std::vector<HandleAllocator::HandleId> ids(HANDLE_COUNT);
+
+    // all threads allocate objects of various sizes at the same time
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < THREAD_COUNT; t++) {
+        threads.emplace_back([&allocator, &ids, t]() {
+            for (size_t i = t * HANDLES_PER_THREAD; i < (t + 1) * HANDLES_PER_THREAD; i++) {
+                const size_t size = size_t(8) << (i % 5);
+                ids[i] = allocator.allocate(size);
+                memset(allocator.handle_cast(ids[i]), int(i & 0xFF), size);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    threads.clear();
+
+    // none of the objects overlap
+    for (size_t i = 0; i < HANDLE_COUNT; i++) {
+        const uint8_t* p = static_cast<const uint8_t*>(allocator.handle_cast(ids[i]));
+        const size_t size = size_t(8) << (i % 5);
+        ASSERT_TRUE(std::all_of(p, p + size, [i](uint8_t b) { return b == uint8_t(i & 0xFF); }));
+        ASSERT_TRUE(allocator.isValid(ids[i]));
+    }
+    std::vector<HandleAllocator::HandleId> sorted(ids);
+    std::sort(sorted.begin(), sorted.end());
+    EXPECT_EQ(sorted.end(), std::adjacent_find(sorted.begin(), sorted.end()));
+
+    // objects are freed from other threads than the ones that allocated them
+    for (size_t t = 0; t < THREAD_COUNT; t++) {
+        threads.emplace_back([&allocator, &ids, t]() {
+            for (size_t i = t; i < HANDLE_COUNT; i += THREAD_COUNT) {
+                allocator.deallocate(ids[i]);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    // the freed ids are detected and their slots are reused
+    const size_t allocatedSize = allocator.getAllocatedSize();
+    for (size_t i = 0; i < HANDLE_COUNT; i++) {
+        EXPECT_FALSE(allocator.isValid(ids[i]));
+    }
+    for (size_t i = 0; i < HANDLE_COUNT; i++) {
+        HandleAllocator::HandleId id = allocator.allocate(size_t(8) << (i % 5));
+        EXPECT_TRUE(allocator.isValid(id));
+    }
+    EXPECT_EQ(allocatedSize, allocator.getAllocatedSize());
+}
+
+TEST(FilamentTest, HandleAllocatorGrowth) {
+    HandleAllocator allocator;
+
+    // growing doesn't move the existing objects
+    HandleAllocator::HandleId first = allocator.allocate(sizeof(uint32_t));
+    uint32_t* p = static_cast<uint32_t*>(allocator.handle_cast(first));
+    *p = 0xDEADBEEF;
+    for (size_t i = 0; i < 10000; i++) {
+        allocator.allocate(sizeof(uint32_t));
+    }
+    EXPECT_EQ(p, allocator.handle_cast(first));
+    EXPECT_EQ(0xDEADBEEFu, *p);
+
+    // a reused slot gets a new id
+    allocator.deallocate(first);
+    HandleAllocator::HandleId second = allocator.allocate(sizeof(uint32_t));
+    EXPECT_EQ(p, allocator.handle_cast(second));
+    EXPECT_NE(first, second);
+    EXPECT_FALSE(allocator.isValid(first));
+    EXPECT_TRUE(allocator.isValid(second));
+    EXPECT_NE(HandleBase::HandleId(HandleBase::nullid), second);
+}
+
+TEST(FilamentTest, UniformRingRegions) {
+    UniformRingRegions ring;
+    constexpr uint32_t REGION_SIZE = UniformRingRegions::REGION_SIZE;
+
+    // allocations are aligned and stay in the current region
+    uint32_t a, b;
+    ASSERT_TRUE(ring.allocate(100, 256, &a));
+    ASSERT_TRUE(ring.allocate(100, 256, &b));
+    EXPECT_EQ(0u, a);
+    EXPECT_EQ(256u, b);
+    uint32_t c;
+    EXPECT_FALSE(ring.allocate(REGION_SIZE - 256, 256, &c));
+    ASSERT_TRUE(ring.allocate(REGION_SIZE - 512, 256, &c));
+    EXPECT_EQ(512u, c);
+    const uint64_t written = ring.frame;
+    EXPECT_FALSE(ring.isStale(written));
+
+    // the content is stale as soon as its frame ends, even though its region isn't reused yet:
+    // the frames in flight that use it after that don't fence it
+    ring.advance();
+    EXPECT_TRUE(ring.isStale(written));
+    ASSERT_TRUE(ring.allocate(100, 256, &a));
+    EXPECT_EQ(REGION_SIZE, a);
+    EXPECT_FALSE(ring.isStale(ring.frame));
+
+    // the regions are reused in order
+    for (uint32_t i = 1; i < UniformRingRegions::FRAME_COUNT; i++) {
+        ring.advance();
+    }
+    ASSERT_TRUE(ring.allocate(100, 256, &a));
+    EXPECT_EQ(0u, a);
+
+    // all the content is lost when the ring is invalidated
+    ring.invalidate();
+    EXPECT_TRUE(ring.isStale(ring.frame));
+}
+
+#if defined(FILAMENT_DRIVER_SUPPORTS_VULKAN)
+TEST(FilamentTest, VulkanRingBufferRecycling) {
+    using Ring = driver::VulkanRingBuffer::Ring;
+    // the fences are only compared
+    const VkFence fence1 = reinterpret_cast<VkFence>(uintptr_t(1));
+    const VkFence fence2 = reinterpret_cast<VkFence>(uintptr_t(2));
+    Ring ring(1024);
+
+    // frame 1 writes a buffer
+    uint64_t a;
+    ASSERT_TRUE(ring.allocate(256, &a));
+    EXPECT_TRUE(ring.isCurrent(a));
+    ring.endFrame(fence1);
+
+    // frame 2 uses it without updating it, it must be copied to a new allocation since its
+    // storage is recycled once frame 1 is done
+    EXPECT_FALSE(ring.beginFrame(fence2));
+    EXPECT_FALSE(ring.isCurrent(a));
+    uint64_t b;
+    ASSERT_TRUE(ring.allocate(256, &b));
+    EXPECT_TRUE(ring.isCurrent(b));
+    ring.endFrame(fence2);
+
+    // frame 1 is done, only its storage is recycled: frame 2 may still be in flight
+    EXPECT_TRUE(ring.beginFrame(fence1));
+    uint64_t p;
+    for (int i = 0; i < 3; i++) {
+        ASSERT_TRUE(ring.allocate(256, &p));
+        EXPECT_NE(b % 1024, p % 1024);
+    }
+    EXPECT_FALSE(ring.allocate(256, &p));
+    ring.endFrame(fence1);
+
+    // the whole ring is available once both frames are done
+    EXPECT_TRUE(ring.beginFrame(fence2));
+    EXPECT_TRUE(ring.beginFrame(fence1));
+    ASSERT_TRUE(ring.allocate(512, &p));
+    EXPECT_EQ(256u, p % 1024);
+    ASSERT_TRUE(ring.allocate(256, &p));
+    EXPECT_EQ(768u, p % 1024);
+    ASSERT_TRUE(ring.allocate(256, &p));
+    EXPECT_EQ(0u, p % 1024);
+    EXPECT_FALSE(ring.allocate(16, &p));
+}
+
+TEST(FilamentTest, VulkanTransientAttachments) {
+    using driver::isTransientAttachment;
+    // the attachments the driver creates for render targets
+    EXPECT_TRUE(isTransientAttachment(VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT));
+    EXPECT_FALSE(isTransientAttachment(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+            VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT));
+    EXPECT_TRUE(isTransientAttachment(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+            VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT));
+    // attachments that are sampled or blitted need their memory
+    EXPECT_FALSE(isTransientAttachment(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+            VK_IMAGE_USAGE_SAMPLED_BIT));
+    EXPECT_FALSE(isTransientAttachment(VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+            VK_IMAGE_USAGE_TRANSFER_SRC_BIT));
+    EXPECT_FALSE(isTransientAttachment(0));
+}
+#endif
+
+TEST(FilamentTest, DefaultBlobCache) {
+    // the blob cache only needs a Platform, not a driver
+    struct TestPlatform : public driver::Platform {
+        int getOSVersion() const noexcept override { return 0; }
+        Driver* createDriver(void*) noexcept override { return nullptr; }
+    } platform;
+
+    const uint64_t key[] = { 1, 2 };
+    const uint64_t otherKey[] = { 1, 3 };
+    const char value[] = "program binary";
+    char buffer[sizeof(value)] = {};
+
+    // the cache is disabled until it has a directory
+    EXPECT_FALSE(platform.hasBlobCache());
+    platform.insertBlob(key, sizeof(key), value, sizeof(value));
+    EXPECT_EQ(0u, platform.retrieveBlob(key, sizeof(key), buffer, sizeof(buffer)));
+
+    // the files are written in a new temporary directory
+    const char* tmp = getenv("TMPDIR");
+    std::string name = std::string(tmp && *tmp ? tmp : "/tmp") + "/filament_test_blobsXXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(&name[0]));
+    Path directory(name);
+    platform.setBlobCacheDirectory(directory.c_str());
+    EXPECT_TRUE(platform.hasBlobCache());
+
+    platform.insertBlob(key, sizeof(key), value, sizeof(value));
+    EXPECT_EQ(0u, platform.retrieveBlob(otherKey, sizeof(otherKey), buffer, sizeof(buffer)));
+
+    // querying the size doesn't copy the value
+    EXPECT_EQ(sizeof(value), platform.retrieveBlob(key, sizeof(key), nullptr, 0));
+    EXPECT_EQ(sizeof(value), platform.retrieveBlob(key, sizeof(key), buffer, sizeof(buffer)));
+    EXPECT_STREQ(value, buffer);
+
+    // a new value replaces the old one
+    platform.insertBlob(key, sizeof(key), "new", 4);
+    EXPECT_EQ(4u, platform.retrieveBlob(key, sizeof(key), buffer, sizeof(buffer)));
+    EXPECT_STREQ("new", buffer);
+
+    for (Path& file : directory.listContents()) {
+        file.unlinkFile();
+    }
+    rmdir(directory.c_str());
+}
+
+TEST(FilamentTest, CpuProfilerScope) {
+    using filament::details::CpuProfiler;
+    CpuProfiler profiler;
+
+    // nothing is sampled while the profiler is disabled, but the stage time is accumulated
+    {
+        CpuProfiler::Scope scope(profiler, CpuProfiler::Stage::SORT);
+    }
+    EXPECT_EQ(0u, profiler.getCounters(CpuProfiler::Stage::SORT).samples);
+    const uint64_t sortTime = profiler.getStageTime(CpuProfiler::Stage::SORT);
+
+    profiler.setEnabled(true);
+    for (size_t i = 0; i < 3; i++) {
+        CpuProfiler::Scope scope(profiler, CpuProfiler::Stage::SORT);
+    }
+    std::thread([&profiler]() {
+        CpuProfiler::Scope scope(profiler, CpuProfiler::Stage::DRIVER);
+    }).join();
+    profiler.setEnabled(false);
+
+    Renderer::CpuCounters sort = profiler.getCounters(CpuProfiler::Stage::SORT);
+    EXPECT_EQ(3u, sort.samples);
+    EXPECT_EQ(1u, profiler.getCounters(CpuProfiler::Stage::DRIVER).samples);
+    EXPECT_EQ(0u, profiler.getCounters(CpuProfiler::Stage::CULLING).samples);
+
+    // a sampled scope adds the same duration to its counters and to its stage time
+    EXPECT_EQ(sortTime + sort.time, profiler.getStageTime(CpuProfiler::Stage::SORT));
+    EXPECT_EQ(profiler.getCounters(CpuProfiler::Stage::DRIVER).time,
+            profiler.getStageTime(CpuProfiler::Stage::DRIVER));
+    EXPECT_EQ(0u, profiler.getStageTime(CpuProfiler::Stage::CULLING));
+
+    profiler.reset();
+    EXPECT_EQ(0u, profiler.getCounters(CpuProfiler::Stage::SORT).samples);
+    EXPECT_EQ(0u, profiler.getCounters(CpuProfiler::Stage::SORT).time);
+    EXPECT_EQ(sortTime + sort.time, profiler.getStageTime(CpuProfiler::Stage::SORT));
+}
+
+TEST(FilamentTest, RangeAllocator) {
+    RangeAllocator allocator(100);
+
+    EXPECT_EQ(0u, allocator.allocate(10));
+    EXPECT_EQ(10u, allocator.allocate(20));
+    EXPECT_EQ(30u, allocator.allocate(30));
+    EXPECT_EQ(40u, allocator.getFreeSize());
+    EXPECT_EQ(RangeAllocator::INVALID, allocator.allocate(41));
+    EXPECT_EQ(RangeAllocator::INVALID, allocator.allocate(0));
+
+    // the smallest range that fits is used
+    allocator.free(0, 10);
+    EXPECT_EQ(2u, allocator.getFreeRangeCount());
+    EXPECT_EQ(0u, allocator.allocate(8));
+    EXPECT_EQ(8u, allocator.allocate(2));
+    EXPECT_EQ(1u, allocator.getFreeRangeCount());
+
+    // freed ranges are merged with their free neighbours
+    allocator.free(10, 20);
+    allocator.free(0, 8);
+    EXPECT_EQ(3u, allocator.getFreeRangeCount());
+    allocator.free(8, 2);
+    EXPECT_EQ(2u, allocator.getFreeRangeCount());
+    allocator.free(30, 30);
+    EXPECT_EQ(1u, allocator.getFreeRangeCount());
+    EXPECT_EQ(100u, allocator.getFreeSize());
+    EXPECT_EQ(0u, allocator.allocate(100));
+}
+
+TEST(FilamentTest, GeometryArena) {
+    using namespace ::filament::details;
+
+    FEngine* engine = FEngine::create();
+    {
+        GeometryArena* arena = GeometryArena::Builder()
+                .vertexCount(64)
+                .indexCount(128)
+                .attribute(VertexAttribute::POSITION, GeometryArena::AttributeType::FLOAT3)
+                .attribute(VertexAttribute::COLOR, GeometryArena::AttributeType::UBYTE4, 12)
+                .normalized(VertexAttribute::COLOR)
+                .build(*engine);
+        ASSERT_NE(nullptr, arena);
+        // the attributes are interleaved, they share the size of a vertex as their stride
+        EXPECT_EQ(16u, upcast(arena)->getVertexStride());
+        EXPECT_EQ(64u, arena->getVertexBuffer()->getVertexCount());
+        EXPECT_EQ(128u, arena->getIndexBuffer()->getIndexCount());
+
+        GeometryArena::Allocation a = arena->allocate(4, 6);
+        GeometryArena::Allocation b = arena->allocate(3, 3);
+        ASSERT_TRUE(a);
+        ASSERT_TRUE(b);
+        EXPECT_EQ(4u, b.firstVertex);
+        EXPECT_EQ(6u, b.firstIndex);
+        EXPECT_FALSE(arena->allocate(64, 3));
+        EXPECT_EQ(57u, arena->getFreeVertexCount());
+
+        static const float vertices[3 * 4] = {};
+        arena->setVertices(*engine, b, { vertices, sizeof(vertices) });
+
+        // indices are consumed before setIndices() returns
+        static const uint16_t indices[3] = { 0, 1, 2 };
+        bool released = false;
+        arena->setIndices(*engine, b, { indices, sizeof(indices),
+                [](void*, size_t, void* user) { *static_cast<bool*>(user) = true; }, &released },
+                GeometryArena::IndexType::USHORT);
+        EXPECT_TRUE(released);
+
+        // indices are rebased to the first vertex of the allocation
+        uint32_t rebased[3] = {};
+        FGeometryArena::rebaseIndices(rebased, indices, 3, GeometryArena::IndexType::USHORT,
+                b.firstVertex);
+        EXPECT_EQ(4u, rebased[0]);
+        EXPECT_EQ(5u, rebased[1]);
+        EXPECT_EQ(6u, rebased[2]);
+        static const uint32_t indices32[2] = { 0, 70000 };
+        FGeometryArena::rebaseIndices(rebased, indices32, 2, GeometryArena::IndexType::UINT, 4);
+        EXPECT_EQ(4u, rebased[0]);
+        EXPECT_EQ(70004u, rebased[1]);
+
+        // renderables share the buffers of the arena
+        Entity entities[2];
+        EntityManager::get().create(2, entities);
+        FMaterialInstance const* mi = engine->getDefaultMaterial()->getDefaultInstance();
+        for (size_t i = 0; i < 2; i++) {
+            RenderableManager::Builder(1)
+                    .geometry(0, RenderableManager::PrimitiveType::TRIANGLES, arena, i ? b : a)
+                    .material(0, mi)
+                    .culling(false)
+                    .build(*engine, entities[i]);
+        }
+        FRenderableManager& rcm = engine->getRenderableManager();
+        Slice<FRenderPrimitive> const& pa = rcm.getRenderPrimitives(rcm.getInstance(entities[0]), 0);
+        Slice<FRenderPrimitive> const& pb = rcm.getRenderPrimitives(rcm.getInstance(entities[1]), 0);
+        EXPECT_EQ(pa[0].getVertexBufferHandle().getId(), pb[0].getVertexBufferHandle().getId());
+        EXPECT_NE(pa[0].getHwHandle().getId(), pb[0].getHwHandle().getId());
+
+        // a missing arena or an empty allocation gives an empty primitive
+        Entity empty = EntityManager::get().create();
+        EXPECT_EQ(RenderableManager::Builder::Success, RenderableManager::Builder(2)
+                .geometry(0, RenderableManager::PrimitiveType::TRIANGLES, nullptr, a)
+                .geometry(1, RenderableManager::PrimitiveType::TRIANGLES, arena, {})
+                .culling(false)
+                .build(*engine, empty));
+        Slice<FRenderPrimitive> const& pe = rcm.getRenderPrimitives(rcm.getInstance(empty), 0);
+        EXPECT_FALSE(pe[0].getVertexBufferHandle());
+        EXPECT_FALSE(pe[1].getVertexBufferHandle());
+        engine->destroy(empty);
+        EntityManager::get().destroy(empty);
+
+        engine->destroy(entities[0]);
+        engine->destroy(entities[1]);
+        EntityManager::get().destroy(2, entities);
+
+        arena->free(a);
+        arena->free(b);
+        EXPECT_EQ(64u, arena->getFreeVertexCount());
+        EXPECT_EQ(128u, arena->getFreeIndexCount());
+        engine->destroy(upcast(arena));
+    }
+    engine->shutdown();
+    delete engine;
+}
+
+TEST(FilamentTest, MemoryStats) {
+    using namespace ::filament::details;
+    using Format = driver::TextureFormat;
+
+    EXPECT_EQ(64u, FTexture::getLevelSize(Format::RGBA8, 4, 4));
+    EXPECT_EQ(8u, FTexture::getLevelSize(Format::RGBA8, 1, 2));
+    EXPECT_EQ(32u, FTexture::getLevelSize(Format::ETC2_RGB8, 8, 8));
+    EXPECT_EQ(64u, FTexture::getLevelSize(Format::ETC2_EAC_RGBA8, 5, 8));
+    EXPECT_EQ(64u, FTexture::getLevelSize(Format::RGBA_ASTC_6x6, 8, 8));
+
+    FEngine* engine = FEngine::create();
+    {
+        const Engine::MemoryStats before = engine->getMemoryStats();
+        EXPECT_LE(before.perRenderPassArena.peak, before.perRenderPassArena.reserved);
+        EXPECT_LE(before.commandBuffer.current, before.commandBuffer.reserved);
+        EXPECT_LE(before.components.current, before.components.reserved);
+
+        GeometryArena* arena = GeometryArena::Builder()
+                .vertexCount(64)
+                .indexCount(128)
+                .attribute(VertexAttribute::POSITION, GeometryArena::AttributeType::FLOAT3, 0, 16)
+                .build(*engine);
+        ASSERT_NE(nullptr, arena);
+
+        // 64 vertices of 16 bytes and 128 32-bit indices
+        const Engine::MemoryStats created = engine->getMemoryStats();
+        EXPECT_EQ(before.buffers.current + 64 * 16 + 128 * 4, created.buffers.current);
+
+        engine->destroy(upcast(arena));
+        const Engine::MemoryStats destroyed = engine->getMemoryStats();
+        EXPECT_EQ(before.buffers.current, destroyed.buffers.current);
+        EXPECT_EQ(created.buffers.current, destroyed.buffers.peak);
+
+        // the depth of a texture is halved at each level: 4x4x4, 2x2x2 then 1x1x1 texels
+        Texture* texture = Texture::Builder()
+                .width(4)
+                .height(4)
+                .depth(4)
+                .levels(3)
+                .format(Texture::InternalFormat::RGBA8)
+                .build(*engine);
+        ASSERT_NE(nullptr, texture);
+        EXPECT_EQ(4u * (64 + 8 + 1), upcast(texture)->getMemorySize());
+        EXPECT_EQ(before.textures.current + 4u * (64 + 8 + 1),
+                engine->getMemoryStats().textures.current);
+        engine->destroy(upcast(texture));
+        EXPECT_EQ(before.textures.current, engine->getMemoryStats().textures.current);
+    }
+    engine->shutdown();
+    delete engine;
 }
 
 int main(int argc, char** argv) {
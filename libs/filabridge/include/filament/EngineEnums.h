@@ -62,6 +62,18 @@ constexpr size_t CONFIG_MAX_LIGHT_INDEX = CONFIG_MAX_LIGHT_COUNT - 1;
 // We store 64 bytes per bone.
 constexpr size_t CONFIG_MAX_BONE_COUNT = 256;
 
+// This value is also limited by UBO size, ES3.0 only guarantees 16 KiB.
+// We store 256 bytes (one PerRenderableUib) per instance.
+constexpr size_t CONFIG_MAX_INSTANCES = 64;
+
+// Maximum number of cascades of the directional light's shadow map.
+// The visibility of each cascade uses one bit of the 8-bits culling mask.
+constexpr size_t CONFIG_MAX_SHADOW_CASCADES = 4;
+
+// Maximum number of tiles of the spot and point lights' shadow atlas, a point light uses 6.
+// This value is also limited by the per-view UBO size (80 bytes per tile).
+constexpr size_t CONFIG_MAX_SHADOW_TILES = 16;
+
 // can't really use std::underlying_type<AttributeIndex>::type because the driver takes a uint32_t
 using AttributeBitset = utils::bitset32;
 
@@ -21,6 +21,10 @@
 #include <stdint.h>
 
 namespace filament {
+    // Update this when the material package or the engine's uniform/sampler interface blocks
+    // change in a way that makes previously compiled materials incompatible.
+    static constexpr size_t MATERIAL_VERSION = 4;
+
     enum class Shading : uint8_t {
         UNLIT,                  // no lighting applied, emissive possible
         LIT,                    // default, standard lighting
@@ -41,7 +41,8 @@ struct PerViewSib {
     static constexpr size_t FROXELS        = 2;
     static constexpr size_t IBL_DFG_LUT    = 3;
     static constexpr size_t IBL_SPECULAR   = 4;
-    static constexpr size_t IBL_IRRADIANCE = 5;
+    static constexpr size_t SHADOW_ATLAS   = 5;
+    static constexpr size_t IBL_IRRADIANCE = 6;
 };
 
 struct PostProcessSib {
@@ -17,6 +17,7 @@
 #ifndef TNT_FILABRIDGE_UIBGENERATOR_H
 #define TNT_FILABRIDGE_UIBGENERATOR_H
 
+#include <filament/EngineEnums.h>
 
 #include <math/mat4.h>
 #include <math/vec4.h>
@@ -50,7 +51,7 @@ struct PerViewUib { // NOLINT(cppcoreguidelines-pro-type-member-init)
     filament::math::mat4f viewFromClipMatrix;
     filament::math::mat4f clipFromWorldMatrix;
     filament::math::mat4f worldFromClipMatrix;
-    filament::math::mat4f lightFromWorldMatrix;
+    filament::math::mat4f lightFromWorldMatrix[CONFIG_MAX_SHADOW_CASCADES];
 
     filament::math::float4 resolution; // viewport width, height, 1/width, 1/height
 
@@ -80,10 +81,21 @@ struct PerViewUib { // NOLINT(cppcoreguidelines-pro-type-member-init)
     alignas(16) filament::math::float4 iblSH[9]; // actually float3 entries (std140 requires float4 alignment)
 
     filament::math::float4 userTime;  // time(s), (double)time - (float)time, 0, 0
+
+    filament::math::float4 cascadeSplits;       // distance at which each cascade ends
+    filament::math::float4 cascadeConstantBias; // constant bias of each cascade
+    filament::math::float4 cascadeNormalBias;   // normal bias of each cascade
+    uint32_t cascades;                          // number of cascades
+
+    // spot and point lights shadows, one entry per tile of the shadow atlas
+    alignas(16) filament::math::mat4f shadowAtlasFromWorldMatrix[CONFIG_MAX_SHADOW_TILES];
+    filament::math::float4 shadowAtlasBias[CONFIG_MAX_SHADOW_TILES]; // constant, normal, 0, 0
 };
 
 
 // PerRenderableUib must have an alignment of 256 to be compatible with all versions of GLES.
+// The ObjectUniforms block is an array of CONFIG_MAX_INSTANCES of these, indexed by the
+// instance ID in the vertex shader.
 struct alignas(256) PerRenderableUib {
     filament::math::mat4f worldFromModelMatrix;
     filament::math::mat3f worldFromModelNormalMatrix;
@@ -96,7 +108,7 @@ struct LightsUib {
     filament::math::float4 positionFalloff;   // { float3(pos), 1/falloff^2 }
     filament::math::float4 colorIntensity;    // { float3(col), intensity }
     filament::math::float4 directionIES;      // { float3(dir), IES index }
-    filament::math::float4 spotScaleOffset;   // { scale, offset, unused, unused }
+    filament::math::float4 spotScaleOffset;   // { scale, offset, shadow index, unused }
 };
 
 struct PostProcessingUib {
@@ -34,6 +34,7 @@ SamplerInterfaceBlock const& SibGenerator::getPerViewSib() noexcept {
             .add("froxels",       Type::SAMPLER_2D,      Format::UINT,  Precision::MEDIUM)
             .add("iblDFG",        Type::SAMPLER_2D,      Format::FLOAT, Precision::MEDIUM)
             .add("iblSpecular",   Type::SAMPLER_CUBEMAP, Format::FLOAT, Precision::MEDIUM)
+            .add("shadowAtlas",   Type::SAMPLER_2D,      Format::SHADOW,Precision::LOW)
             .build();
     return sib;
 }
@@ -31,6 +31,8 @@ static_assert(sizeof(PerRenderableUib) % 256 == 0,
 static_assert(CONFIG_MAX_BONE_COUNT * sizeof(PerRenderableUibBone) <= 16384,
         "Bones exceed max UBO size");
 
+static_assert(CONFIG_MAX_INSTANCES * sizeof(PerRenderableUib) <= 16384,
+        "Instances exceed max UBO size");
 
 UniformInterfaceBlock const& UibGenerator::getPerViewUib() noexcept  {
     // IMPORTANT NOTE: Respect std140 layout, don't update without updating Engine::PerViewUib
@@ -43,7 +45,7 @@ UniformInterfaceBlock const& UibGenerator::getPerViewUib() noexcept  {
             .add("viewFromClipMatrix",      1, UniformInterfaceBlock::Type::MAT4, Precision::HIGH)
             .add("clipFromWorldMatrix",     1, UniformInterfaceBlock::Type::MAT4, Precision::HIGH)
             .add("worldFromClipMatrix",     1, UniformInterfaceBlock::Type::MAT4, Precision::HIGH)
-            .add("lightFromWorldMatrix",    1, UniformInterfaceBlock::Type::MAT4, Precision::HIGH)
+            .add("lightFromWorldMatrix",    CONFIG_MAX_SHADOW_CASCADES, UniformInterfaceBlock::Type::MAT4, Precision::HIGH)
             // view
             .add("resolution",              1, UniformInterfaceBlock::Type::FLOAT4, Precision::HIGH)
             // camera
@@ -73,15 +75,26 @@ UniformInterfaceBlock const& UibGenerator::getPerViewUib() noexcept  {
             .add("iblSH",                   9, UniformInterfaceBlock::Type::FLOAT3)
             // user time
             .add("userTime",                1, UniformInterfaceBlock::Type::FLOAT4)
+            // shadow cascades
+            .add("cascadeSplits",           1, UniformInterfaceBlock::Type::FLOAT4, Precision::HIGH)
+            .add("cascadeConstantBias",     1, UniformInterfaceBlock::Type::FLOAT4)
+            .add("cascadeNormalBias",       1, UniformInterfaceBlock::Type::FLOAT4)
+            .add("cascades",                1, UniformInterfaceBlock::Type::UINT)
+            // spot and point lights shadows
+            .add("shadowAtlasFromWorldMatrix", CONFIG_MAX_SHADOW_TILES, UniformInterfaceBlock::Type::MAT4, Precision::HIGH)
+            .add("shadowAtlasBias",         CONFIG_MAX_SHADOW_TILES, UniformInterfaceBlock::Type::FLOAT4)
             .build();
     return uib;
 }
 
 UniformInterfaceBlock const& UibGenerator::getPerRenderableUib() noexcept {
+    // IMPORTANT NOTE: each instance is a PerRenderableUib packed into 4 mat4 (256 bytes):
+    //    [0] worldFromModelMatrix
+    //    [1] worldFromModelNormalMatrix (std140 mat3, i.e. upper-left of a mat4)
+    //    [2..3] padding
     static UniformInterfaceBlock uib =  UniformInterfaceBlock::Builder()
             .name("ObjectUniforms")
-            .add("worldFromModelMatrix",       1, UniformInterfaceBlock::Type::MAT4, Precision::HIGH)
-            .add("worldFromModelNormalMatrix", 1, UniformInterfaceBlock::Type::MAT3, Precision::HIGH)
+            .add("instances", CONFIG_MAX_INSTANCES * 4, UniformInterfaceBlock::Type::MAT4, Precision::HIGH)
             .build();
     return uib;
 }
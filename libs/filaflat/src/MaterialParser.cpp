@@ -136,6 +136,10 @@ bool MaterialParser::isPostProcessMaterial() const noexcept {
 }
 
 // Accessors
+bool MaterialParser::getMaterialVersion(uint32_t* value) const noexcept {
+    return mImpl->getFromSimpleChunk(ChunkType::MaterialVersion, value);
+}
+
 bool MaterialParser::getName(utils::CString* cstring) const noexcept {
    ChunkType type = ChunkType::MaterialName;
 
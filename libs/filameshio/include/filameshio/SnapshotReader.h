@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TNT_FILAMENT_FILAMESHIO_SNAPSHOTREADER_H
+#define TNT_FILAMENT_FILAMESHIO_SNAPSHOTREADER_H
+
+#include <filameshio/MeshReader.h>
+
+#include <utils/Entity.h>
+#include <utils/Path.h>
+
+#include <stddef.h>
+
+#include <vector>
+
+namespace filament {
+    class Engine;
+    class VertexBuffer;
+    class IndexBuffer;
+}
+
+namespace filamesh {
+
+/**
+ * Loads the binary scene snapshots written by SnapshotWriter.
+ *
+ * A snapshot is loaded in a single pass: all the entities are created at once, their transform
+ * components are created in bulk from the hierarchy stored in the snapshot, and the vertex and
+ * index buffers are uploaded directly from the snapshot's memory, without copies.
+ *
+ * The entities aren't added to any Scene.
+ */
+class SnapshotReader {
+public:
+    using Callback = MeshReader::Callback;
+    using MaterialRegistry = MeshReader::MaterialRegistry;
+
+    struct Scene {
+        // one entity per node of the snapshot, in the same order
+        std::vector<utils::Entity> entities;
+        std::vector<filament::VertexBuffer*> vertexBuffers;
+        std::vector<filament::IndexBuffer*> indexBuffers;
+    };
+
+    /**
+     * Loads a snapshot from the specified file, which is mapped in memory until the engine
+     * doesn't need its data anymore. Materials are looked up by name in the registry; a
+     * material that can't be found is replaced by the material named "DefaultMaterial", if
+     * any, or the engine's default material.
+     */
+    static Scene loadFromFile(filament::Engine* engine, const utils::Path& path,
+            MaterialRegistry& materials);
+
+    /**
+     * Loads a snapshot from an in-memory buffer. The buffer must stay valid until destructor is
+     * called, which happens once the engine doesn't need its data anymore. The destructor is
+     * also called if the snapshot can't be loaded.
+     */
+    static Scene loadFromBuffer(filament::Engine* engine,
+            void const* data, size_t size, Callback destructor, void* user,
+            MaterialRegistry& materials);
+
+    // Destroys the entities, components and buffers of a loaded snapshot.
+    static void destroy(filament::Engine* engine, Scene& scene);
+};
+
+} // namespace filamesh
+
+#endif // TNT_FILAMENT_FILAMESHIO_SNAPSHOTREADER_H
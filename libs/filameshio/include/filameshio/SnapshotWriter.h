@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TNT_FILAMENT_FILAMESHIO_SNAPSHOTWRITER_H
+#define TNT_FILAMENT_FILAMESHIO_SNAPSHOTWRITER_H
+
+#include <filameshio/snapshot.h>
+
+#include <utils/Path.h>
+
+#include <math/mat4.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace filamesh {
+
+/**
+ * Builds a binary scene snapshot, which can be loaded with SnapshotReader. The format is
+ * described in filameshio/snapshot.h.
+ *
+ * Nodes are created in order and a node's parent must be created before it. Each node becomes
+ * an entity with a transform component when the snapshot is loaded.
+ */
+class SnapshotWriter {
+public:
+    /**
+     * Adds a named material, which is matched against the material registry when loading.
+     * Returns the index of the material in the snapshot.
+     */
+    uint32_t addMaterial(std::string name);
+
+    /**
+     * Adds a geometry, i.e. a vertex buffer and an index buffer. The vertex count, index count,
+     * index type and attributes of the geometry are used as is, its offsets and sizes are set by
+     * the writer. The data is copied. Returns the index of the geometry in the snapshot.
+     */
+    uint32_t addGeometry(snapshot::Geometry geometry,
+            void const* vertices, size_t verticesSize,
+            void const* indices, size_t indicesSize);
+
+    /**
+     * Adds a node with the given parent node, or -1 if it is a root, and a local transform
+     * relative to its parent. Returns the index of the node in the snapshot.
+     */
+    uint32_t addNode(int32_t parent, const filament::math::mat4f& localTransform);
+
+    /**
+     * Adds a renderable to the node renderable.node, made of the given primitives. The
+     * firstPrimitive and primitiveCount fields of the renderable are set by the writer.
+     */
+    void addRenderable(snapshot::Renderable renderable,
+            snapshot::Primitive const* primitives, size_t primitiveCount);
+
+    // Returns the snapshot in its binary form.
+    std::vector<uint8_t> serialize() const;
+
+    // Writes the snapshot to a file, returns false if the file couldn't be written.
+    bool writeToFile(const utils::Path& path) const;
+
+private:
+    std::vector<int32_t> mParents;
+    std::vector<filament::math::mat4f> mTransforms;
+    std::vector<snapshot::Renderable> mRenderables;
+    std::vector<snapshot::Primitive> mPrimitives;
+    std::vector<snapshot::Geometry> mGeometries;
+    std::vector<std::string> mMaterials;
+    std::vector<uint8_t> mBlobs;
+};
+
+} // namespace filamesh
+
+#endif // TNT_FILAMENT_FILAMESHIO_SNAPSHOTWRITER_H
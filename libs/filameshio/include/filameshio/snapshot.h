@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_FILAMESHIO_SNAPSHOT_H
+#define TNT_FILAMENT_FILAMESHIO_SNAPSHOT_H
+
+#include <filament/Box.h>
+
+#include <math/mat4.h>
+
+#include <stdint.h>
+
+/*
+ * Binary scene snapshot, written by SnapshotWriter and loaded by SnapshotReader.
+ *
+ * The file is laid out so that it can be mapped in memory and used as is: every section starts
+ * at an offset aligned to ALIGNMENT and holds a flat array of one of the structures below.
+ * All offsets are in bytes from the start of the file.
+ *
+ *  MAGICID
+ *  Header
+ *  int32_t     parents[nodeCount]      index of the parent node or -1, parents[i] < i
+ *  mat4f       transforms[nodeCount]   local transforms, relative to the parent
+ *  Renderable  renderables[renderableCount]
+ *  Primitive   primitives[primitiveCount]
+ *  Geometry    geometries[geometryCount]
+ *  materials   materialCount x { uint32_t length, char name[length + 1] }
+ *  blobs       vertex and index data referenced by the geometries
+ */
+
+namespace filamesh {
+namespace snapshot {
+
+static const char MAGICID[] { 'F', 'I', 'L', 'A', 'S', 'N', 'A', 'P' };
+
+static const uint32_t VERSION = 1;
+
+static const uint32_t ALIGNMENT = 16;
+
+static const uint32_t MAX_ATTRIBUTES = 8;
+
+enum IndexType : uint32_t {
+    UI32 = 0,
+    UI16 = 1,
+};
+
+enum RenderableFlags : uint8_t {
+    CAST_SHADOWS    = 1 << 0,
+    RECEIVE_SHADOWS = 1 << 1,
+    CULLING         = 1 << 2,
+};
+
+enum AttributeFlags : uint8_t {
+    NORMALIZED      = 1 << 0,
+};
+
+struct Header {
+    uint32_t version;
+    uint32_t nodeCount;
+    uint32_t renderableCount;
+    uint32_t primitiveCount;
+    uint32_t geometryCount;
+    uint32_t materialCount;
+    uint64_t offsetParents;
+    uint64_t offsetTransforms;
+    uint64_t offsetRenderables;
+    uint64_t offsetPrimitives;
+    uint64_t offsetGeometries;
+    uint64_t offsetMaterials;
+    uint64_t offsetBlobs;
+    uint64_t size;              // size of the whole file
+};
+
+// A renderable component, attached to the entity of a node.
+struct Renderable {
+    uint32_t node;
+    uint32_t firstPrimitive;    // index in the primitives array
+    uint32_t primitiveCount;
+    uint8_t layerMask;
+    uint8_t priority;
+    uint8_t flags;              // RenderableFlags
+    uint8_t reserved;
+    filament::Box aabb;
+};
+
+struct Primitive {
+    uint32_t geometry;          // index in the geometries array
+    uint32_t material;          // index in the materials table
+    uint32_t type;              // RenderableManager::PrimitiveType
+    uint32_t offset;
+    uint32_t count;
+    uint32_t minIndex;
+    uint32_t maxIndex;
+};
+
+// A vertex attribute, all attributes of a geometry are in a single vertex buffer.
+struct Attribute {
+    uint8_t attribute;          // VertexAttribute
+    uint8_t type;               // VertexBuffer::AttributeType
+    uint8_t stride;
+    uint8_t flags;              // AttributeFlags
+    uint32_t offset;
+};
+
+struct Geometry {
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t indexType;         // IndexType
+    uint32_t attributeCount;
+    Attribute attributes[MAX_ATTRIBUTES];
+    uint64_t offsetVertices;
+    uint64_t sizeVertices;
+    uint64_t offsetIndices;
+    uint64_t sizeIndices;
+};
+
+} // namespace snapshot
+} // namespace filamesh
+
+#endif // TNT_FILAMENT_FILAMESHIO_SNAPSHOT_H
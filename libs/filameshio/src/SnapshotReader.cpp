@@ -0,0 +1,387 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <filameshio/SnapshotReader.h>
+#include <filameshio/snapshot.h>
+
+#include <filament/Engine.h>
+#include <filament/IndexBuffer.h>
+#include <filament/MaterialInstance.h>
+#include <filament/RenderableManager.h>
+#include <filament/TransformManager.h>
+#include <filament/VertexBuffer.h>
+
+#include <utils/EntityManager.h>
+#include <utils/Log.h>
+#include <utils/Systrace.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#if !defined(WIN32)
+#    include <sys/mman.h>
+#    include <unistd.h>
+#else
+#    include <io.h>
+#endif
+
+using namespace filament;
+using namespace filament::math;
+using namespace filamesh::snapshot;
+
+#define DEFAULT_MATERIAL "DefaultMaterial"
+
+namespace filamesh {
+
+namespace {
+
+// The snapshot's data is shared by all the buffer descriptors pointing into it, it is released
+// with the user's destructor when the last one is released.
+struct SharedData {
+    std::atomic<uint32_t> refs{ 1 };
+    void const* data;
+    size_t size;
+    SnapshotReader::Callback destructor;
+    void* user;
+
+    SharedData(void const* data, size_t size, SnapshotReader::Callback destructor, void* user)
+            : data(data), size(size), destructor(destructor), user(user) {
+    }
+
+    SharedData* retain() noexcept {
+        refs.fetch_add(1, std::memory_order_relaxed);
+        return this;
+    }
+
+    void release() noexcept {
+        if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            if (destructor) {
+                destructor(const_cast<void*>(data), size, user);
+            }
+            delete this;
+        }
+    }
+
+    static void release(void*, size_t, void* user) noexcept {
+        static_cast<SharedData*>(user)->release();
+    }
+};
+
+bool inBounds(uint64_t offset, uint64_t count, size_t elementSize, size_t size) {
+    return offset <= size && count <= (size - offset) / elementSize;
+}
+
+// sizes of the VertexBuffer::AttributeType values, in declaration order
+const uint8_t ATTRIBUTE_TYPE_SIZES[] = {
+    1, 2, 3, 4,     // BYTE
+    1, 2, 3, 4,     // UBYTE
+    2, 4, 6, 8,     // SHORT
+    2, 4, 6, 8,     // USHORT
+    4, 4,           // INT, UINT
+    4, 8, 12, 16,   // FLOAT
+    2, 4, 6, 8,     // HALF
+};
+
+static_assert(sizeof(ATTRIBUTE_TYPE_SIZES) == size_t(VertexBuffer::AttributeType::HALF4) + 1,
+        "ATTRIBUTE_TYPE_SIZES must have an entry per attribute type");
+
+// All the vertices of each attribute must be in the vertex data.
+bool isValidAttribute(Attribute const& a, uint32_t vertexCount, uint64_t sizeVertices) {
+    if (a.attribute > VertexAttribute::BONE_WEIGHTS || a.type >= sizeof(ATTRIBUTE_TYPE_SIZES)) {
+        return false;
+    }
+    const uint64_t size = ATTRIBUTE_TYPE_SIZES[a.type];
+    const uint64_t stride = a.stride ? a.stride : size;
+    return a.offset + (vertexCount - 1) * stride + size <= sizeVertices;
+}
+
+bool isValidPrimitiveType(uint32_t type) {
+    using PrimitiveType = RenderableManager::PrimitiveType;
+    return type == uint32_t(PrimitiveType::POINTS) || type == uint32_t(PrimitiveType::LINES) ||
+           type == uint32_t(PrimitiveType::TRIANGLES);
+}
+
+// Checks that all the sections and indices of the snapshot are valid, so that loading it
+// doesn't need any further checks.
+Header const* validate(uint8_t const* data, size_t size, std::vector<std::string>& materials) {
+    if (size < sizeof(MAGICID) + sizeof(Header) || memcmp(data, MAGICID, sizeof(MAGICID))) {
+        utils::slog.e << "Magic string not found." << utils::io::endl;
+        return nullptr;
+    }
+    Header const* header = (Header const*)(data + sizeof(MAGICID));
+    if (header->version != VERSION) {
+        utils::slog.e << "Unsupported snapshot version " << header->version << utils::io::endl;
+        return nullptr;
+    }
+
+    if (header->size > size ||
+        !inBounds(header->offsetParents, header->nodeCount, sizeof(int32_t), size) ||
+        !inBounds(header->offsetTransforms, header->nodeCount, sizeof(mat4f), size) ||
+        !inBounds(header->offsetRenderables, header->renderableCount, sizeof(Renderable), size) ||
+        !inBounds(header->offsetPrimitives, header->primitiveCount, sizeof(Primitive), size) ||
+        !inBounds(header->offsetGeometries, header->geometryCount, sizeof(Geometry), size) ||
+        !inBounds(header->offsetMaterials, 0, 1, size) ||
+        (header->offsetParents | header->offsetTransforms | header->offsetRenderables |
+         header->offsetPrimitives | header->offsetGeometries) % ALIGNMENT) {
+        utils::slog.e << "Truncated or corrupted snapshot." << utils::io::endl;
+        return nullptr;
+    }
+
+    int32_t const* parents = (int32_t const*)(data + header->offsetParents);
+    for (size_t i = 0; i < header->nodeCount; i++) {
+        if (parents[i] >= int32_t(i) || parents[i] < -1) {
+            utils::slog.e << "Invalid parent for node " << i << utils::io::endl;
+            return nullptr;
+        }
+    }
+
+    Geometry const* geometries = (Geometry const*)(data + header->offsetGeometries);
+    for (size_t i = 0; i < header->geometryCount; i++) {
+        Geometry const& g = geometries[i];
+        const uint64_t indexSize = g.indexType == UI16 ? sizeof(uint16_t) : sizeof(uint32_t);
+        bool valid = g.attributeCount <= MAX_ATTRIBUTES && g.vertexCount && g.indexCount &&
+                (g.indexType == UI16 || g.indexType == UI32) &&
+                g.sizeIndices == g.indexCount * indexSize &&
+                inBounds(g.offsetVertices, g.sizeVertices, 1, size) &&
+                inBounds(g.offsetIndices, g.sizeIndices, 1, size);
+        for (size_t j = 0; valid && j < g.attributeCount; j++) {
+            valid = isValidAttribute(g.attributes[j], g.vertexCount, g.sizeVertices);
+        }
+        if (!valid) {
+            utils::slog.e << "Invalid geometry " << i << utils::io::endl;
+            return nullptr;
+        }
+    }
+
+    // the material table is the only section that isn't an array
+    uint8_t const* p = data + header->offsetMaterials;
+    uint8_t const* const end = data + size;
+    materials.resize(header->materialCount);
+    for (size_t i = 0; i < header->materialCount; i++) {
+        uint32_t length;
+        if (size_t(end - p) < sizeof(uint32_t)) {
+            return nullptr;
+        }
+        memcpy(&length, p, sizeof(uint32_t));
+        p += sizeof(uint32_t);
+        if (size_t(end - p) <= length || p[length]) {
+            utils::slog.e << "Invalid material " << i << utils::io::endl;
+            return nullptr;
+        }
+        materials[i].assign((char const*)p, length);
+        p += length + 1; // null terminated
+    }
+
+    Primitive const* primitives = (Primitive const*)(data + header->offsetPrimitives);
+    for (size_t i = 0; i < header->primitiveCount; i++) {
+        Primitive const& p = primitives[i];
+        if (p.geometry >= header->geometryCount || p.material >= header->materialCount ||
+            !isValidPrimitiveType(p.type)) {
+            utils::slog.e << "Invalid primitive " << i << utils::io::endl;
+            return nullptr;
+        }
+        Geometry const& g = geometries[p.geometry];
+        if (uint64_t(p.offset) + p.count > g.indexCount ||
+            p.minIndex >= g.vertexCount || p.maxIndex >= g.vertexCount) {
+            utils::slog.e << "Invalid primitive " << i << utils::io::endl;
+            return nullptr;
+        }
+    }
+
+    Renderable const* renderables = (Renderable const*)(data + header->offsetRenderables);
+    for (size_t i = 0; i < header->renderableCount; i++) {
+        Renderable const& r = renderables[i];
+        if (r.node >= header->nodeCount || !r.primitiveCount ||
+            r.firstPrimitive > header->primitiveCount ||
+            r.primitiveCount > header->primitiveCount - r.firstPrimitive) {
+            utils::slog.e << "Invalid renderable " << i << utils::io::endl;
+            return nullptr;
+        }
+    }
+
+    return header;
+}
+
+} // anonymous namespace
+
+SnapshotReader::Scene SnapshotReader::loadFromFile(Engine* engine, const utils::Path& path,
+        MaterialRegistry& materials) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        utils::slog.e << "Couldn't open the snapshot " << path.c_str() << utils::io::endl;
+        return {};
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        utils::slog.e << "Couldn't stat the snapshot " << path.c_str() << utils::io::endl;
+        close(fd);
+        return {};
+    }
+    const size_t size = size_t(st.st_size);
+
+#if !defined(WIN32)
+    // the pages are only read when they're accessed, and they're shared with the page cache
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        utils::slog.e << "Couldn't map the snapshot " << path.c_str() << utils::io::endl;
+        return {};
+    }
+    auto destructor = [](void* buffer, size_t size, void*) { munmap(buffer, size); };
+#else
+    // read() takes and returns an int, large files are read in several chunks
+    void* data = malloc(size);
+    size_t done = 0;
+    while (data && done < size) {
+        const size_t chunk = std::min(size - done, size_t(INT_MAX));
+        const int n = read(fd, (uint8_t*)data + done, unsigned(chunk));
+        if (n <= 0) {
+            break;
+        }
+        done += size_t(n);
+    }
+    const bool success = data && done == size;
+    close(fd);
+    if (!success) {
+        utils::slog.e << "Couldn't read the snapshot " << path.c_str() << utils::io::endl;
+        free(data);
+        return {};
+    }
+    auto destructor = [](void* buffer, size_t, void*) { free(buffer); };
+#endif
+
+    return loadFromBuffer(engine, data, size, destructor, nullptr, materials);
+}
+
+SnapshotReader::Scene SnapshotReader::loadFromBuffer(Engine* engine,
+        void const* data, size_t size, Callback destructor, void* user,
+        MaterialRegistry& materials) {
+    SYSTRACE_CALL();
+
+    // we hold a reference until all the buffers are created
+    SharedData* shared = new SharedData(data, size, destructor, user);
+
+    uint8_t const* const base = (uint8_t const*)data;
+    std::vector<std::string> materialNames;
+    Header const* header = validate(base, size, materialNames);
+    if (!header) {
+        shared->release();
+        return {};
+    }
+
+    const size_t nodeCount = header->nodeCount;
+    int32_t const* parents = (int32_t const*)(base + header->offsetParents);
+    mat4f const* transforms = (mat4f const*)(base + header->offsetTransforms);
+    Renderable const* renderables = (Renderable const*)(base + header->offsetRenderables);
+    Primitive const* primitives = (Primitive const*)(base + header->offsetPrimitives);
+    Geometry const* geometries = (Geometry const*)(base + header->offsetGeometries);
+
+    Scene scene;
+
+    // all the entities and their transforms are created at once
+    scene.entities.resize(nodeCount);
+    utils::EntityManager::get().create(nodeCount, scene.entities.data());
+    engine->getTransformManager().create(scene.entities.data(), parents, transforms, nodeCount);
+
+    // the buffers use the snapshot's data directly, which is released once they're uploaded
+    scene.vertexBuffers.resize(header->geometryCount);
+    scene.indexBuffers.resize(header->geometryCount);
+    for (size_t i = 0; i < header->geometryCount; i++) {
+        Geometry const& g = geometries[i];
+
+        VertexBuffer::Builder vbb;
+        vbb.vertexCount(g.vertexCount).bufferCount(1);
+        for (size_t j = 0; j < g.attributeCount; j++) {
+            Attribute const& a = g.attributes[j];
+            vbb.attribute(VertexAttribute(a.attribute), 0, VertexBuffer::AttributeType(a.type),
+                    a.offset, a.stride);
+            if (a.flags & NORMALIZED) {
+                vbb.normalized(VertexAttribute(a.attribute));
+            }
+        }
+        VertexBuffer* vb = vbb.build(*engine);
+        vb->setBufferAt(*engine, 0, VertexBuffer::BufferDescriptor(
+                base + g.offsetVertices, g.sizeVertices, &SharedData::release, shared->retain()));
+
+        IndexBuffer* ib = IndexBuffer::Builder()
+                .indexCount(g.indexCount)
+                .bufferType(g.indexType == UI16 ? IndexBuffer::IndexType::USHORT
+                        : IndexBuffer::IndexType::UINT)
+                .build(*engine);
+        ib->setBuffer(*engine, IndexBuffer::BufferDescriptor(
+                base + g.offsetIndices, g.sizeIndices, &SharedData::release, shared->retain()));
+
+        scene.vertexBuffers[i] = vb;
+        scene.indexBuffers[i] = ib;
+    }
+
+    // resolve each material once, rather than once per primitive
+    const auto defaultIt = materials.find(DEFAULT_MATERIAL);
+    MaterialInstance* const defaultMaterial =
+            defaultIt != materials.end() ? defaultIt->second : nullptr;
+    std::vector<MaterialInstance*> materialInstances(materialNames.size());
+    for (size_t i = 0; i < materialNames.size(); i++) {
+        const auto it = materials.find(materialNames[i]);
+        materialInstances[i] = it != materials.end() ? it->second : defaultMaterial;
+    }
+
+    for (size_t i = 0; i < header->renderableCount; i++) {
+        Renderable const& r = renderables[i];
+        RenderableManager::Builder builder(r.primitiveCount);
+        builder.boundingBox(r.aabb)
+                .layerMask(0xff, r.layerMask)
+                .priority(r.priority)
+                .castShadows(bool(r.flags & CAST_SHADOWS))
+                .receiveShadows(bool(r.flags & RECEIVE_SHADOWS))
+                .culling(bool(r.flags & CULLING));
+        for (size_t j = 0; j < r.primitiveCount; j++) {
+            Primitive const& p = primitives[r.firstPrimitive + j];
+            builder.geometry(j, RenderableManager::PrimitiveType(p.type),
+                    scene.vertexBuffers[p.geometry], scene.indexBuffers[p.geometry],
+                    p.offset, p.minIndex, p.maxIndex, p.count);
+            if (MaterialInstance* mi = materialInstances[p.material]) {
+                builder.material(j, mi);
+            }
+        }
+        builder.build(*engine, scene.entities[r.node]);
+    }
+
+    shared->release();
+    return scene;
+}
+
+void SnapshotReader::destroy(Engine* engine, Scene& scene) {
+    for (utils::Entity entity : scene.entities) {
+        engine->destroy(entity);
+    }
+    utils::EntityManager::get().destroy(scene.entities.size(), scene.entities.data());
+    for (VertexBuffer* vb : scene.vertexBuffers) {
+        engine->destroy(vb);
+    }
+    for (IndexBuffer* ib : scene.indexBuffers) {
+        engine->destroy(ib);
+    }
+    scene = {};
+}
+
+} // namespace filamesh
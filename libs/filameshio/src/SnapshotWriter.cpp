@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <filameshio/SnapshotWriter.h>
+
+#include <utils/Log.h>
+
+#include <fstream>
+
+#include <assert.h>
+#include <string.h>
+
+using namespace filament::math;
+using namespace filamesh::snapshot;
+
+namespace filamesh {
+
+static size_t align(size_t offset) {
+    return (offset + ALIGNMENT - 1) & ~size_t(ALIGNMENT - 1);
+}
+
+uint32_t SnapshotWriter::addMaterial(std::string name) {
+    mMaterials.push_back(std::move(name));
+    return uint32_t(mMaterials.size() - 1);
+}
+
+uint32_t SnapshotWriter::addGeometry(Geometry geometry,
+        void const* vertices, size_t verticesSize,
+        void const* indices, size_t indicesSize) {
+    // offsets are relative to the blobs section until serialize()
+    geometry.offsetVertices = mBlobs.size();
+    geometry.sizeVertices = verticesSize;
+    mBlobs.insert(mBlobs.end(), (uint8_t const*)vertices, (uint8_t const*)vertices + verticesSize);
+    mBlobs.resize(align(mBlobs.size()));
+
+    geometry.offsetIndices = mBlobs.size();
+    geometry.sizeIndices = indicesSize;
+    mBlobs.insert(mBlobs.end(), (uint8_t const*)indices, (uint8_t const*)indices + indicesSize);
+    mBlobs.resize(align(mBlobs.size()));
+
+    mGeometries.push_back(geometry);
+    return uint32_t(mGeometries.size() - 1);
+}
+
+uint32_t SnapshotWriter::addNode(int32_t parent, const mat4f& localTransform) {
+    assert(parent < int32_t(mParents.size()));
+    mParents.push_back(parent);
+    mTransforms.push_back(localTransform);
+    return uint32_t(mParents.size() - 1);
+}
+
+void SnapshotWriter::addRenderable(Renderable renderable,
+        Primitive const* primitives, size_t primitiveCount) {
+    renderable.firstPrimitive = uint32_t(mPrimitives.size());
+    renderable.primitiveCount = uint32_t(primitiveCount);
+    mPrimitives.insert(mPrimitives.end(), primitives, primitives + primitiveCount);
+    mRenderables.push_back(renderable);
+}
+
+std::vector<uint8_t> SnapshotWriter::serialize() const {
+    Header header{};
+    header.version = VERSION;
+    header.nodeCount = uint32_t(mParents.size());
+    header.renderableCount = uint32_t(mRenderables.size());
+    header.primitiveCount = uint32_t(mPrimitives.size());
+    header.geometryCount = uint32_t(mGeometries.size());
+    header.materialCount = uint32_t(mMaterials.size());
+
+    size_t materialsSize = 0;
+    for (std::string const& name : mMaterials) {
+        materialsSize += sizeof(uint32_t) + name.size() + 1;
+    }
+
+    // compute the layout, every section is aligned
+    size_t offset = sizeof(MAGICID) + sizeof(Header);
+    auto section = [&offset](size_t size) {
+        offset = align(offset);
+        size_t const start = offset;
+        offset += size;
+        return uint64_t(start);
+    };
+    header.offsetParents = section(mParents.size() * sizeof(int32_t));
+    header.offsetTransforms = section(mTransforms.size() * sizeof(mat4f));
+    header.offsetRenderables = section(mRenderables.size() * sizeof(Renderable));
+    header.offsetPrimitives = section(mPrimitives.size() * sizeof(Primitive));
+    header.offsetGeometries = section(mGeometries.size() * sizeof(Geometry));
+    header.offsetMaterials = section(materialsSize);
+    header.offsetBlobs = section(mBlobs.size());
+    header.size = offset;
+
+    std::vector<uint8_t> out(header.size);
+    auto write = [&out](uint64_t offset, void const* data, size_t size) {
+        if (size) {
+            memcpy(out.data() + offset, data, size);
+        }
+    };
+
+    write(0, MAGICID, sizeof(MAGICID));
+    write(sizeof(MAGICID), &header, sizeof(Header));
+    write(header.offsetParents, mParents.data(), mParents.size() * sizeof(int32_t));
+    write(header.offsetTransforms, mTransforms.data(), mTransforms.size() * sizeof(mat4f));
+    write(header.offsetRenderables, mRenderables.data(),
+            mRenderables.size() * sizeof(Renderable));
+    write(header.offsetPrimitives, mPrimitives.data(), mPrimitives.size() * sizeof(Primitive));
+
+    uint8_t* geometries = out.data() + header.offsetGeometries;
+    for (Geometry geometry : mGeometries) {
+        geometry.offsetVertices += header.offsetBlobs;
+        geometry.offsetIndices += header.offsetBlobs;
+        memcpy(geometries, &geometry, sizeof(Geometry));
+        geometries += sizeof(Geometry);
+    }
+
+    uint8_t* materials = out.data() + header.offsetMaterials;
+    for (std::string const& name : mMaterials) {
+        uint32_t const length = uint32_t(name.size());
+        memcpy(materials, &length, sizeof(uint32_t));
+        materials += sizeof(uint32_t);
+        memcpy(materials, name.c_str(), length + 1); // null terminated
+        materials += length + 1;
+    }
+
+    write(header.offsetBlobs, mBlobs.data(), mBlobs.size());
+    return out;
+}
+
+bool SnapshotWriter::writeToFile(const utils::Path& path) const {
+    std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+    if (!file) {
+        utils::slog.e << "Couldn't create the snapshot " << path.c_str() << utils::io::endl;
+        return false;
+    }
+    std::vector<uint8_t> const data = serialize();
+    file.write((char const*)data.data(), data.size());
+    return bool(file);
+}
+
+} // namespace filamesh
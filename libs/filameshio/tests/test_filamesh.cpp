@@ -15,11 +15,15 @@
  */
 
 #include <filament/Engine.h>
+#include <filament/Fence.h>
 #include <filament/Material.h>
 #include <filament/RenderableManager.h>
+#include <filament/TransformManager.h>
 
 #include <filameshio/filamesh.h>
 #include <filameshio/MeshReader.h>
+#include <filameshio/SnapshotReader.h>
+#include <filameshio/SnapshotWriter.h>
 
 #include <math/half.h>
 #include <math/mat3.h>
@@ -216,6 +220,110 @@ TEST_F(FilameshTest, Interleaved) {
     engine->destroy(mi);
 }
 
+TEST_F(FilameshTest, Snapshot) {
+    // A root with a child renderable, which has a child of its own
+    SnapshotWriter writer;
+    const uint32_t material = writer.addMaterial("DefaultMaterial");
+
+    snapshot::Geometry geometry{};
+    geometry.vertexCount = vertexCount;
+    geometry.indexCount = 3;
+    geometry.indexType = snapshot::UI16;
+    geometry.attributeCount = 1;
+    geometry.attributes[0] = {
+        .attribute = VertexAttribute::POSITION,
+        .type = uint8_t(VertexBuffer::AttributeType::HALF4),
+        .stride = sizeof(half4),
+    };
+    const uint32_t triangle = writer.addGeometry(geometry,
+            positions, sizeof(positions), indices, sizeof(indices));
+
+    const uint32_t root = writer.addNode(-1, mat4f::translate(float3(1, 0, 0)));
+    const uint32_t child = writer.addNode(root, mat4f::translate(float3(0, 2, 0)));
+    writer.addNode(child, mat4f::translate(float3(0, 0, 3)));
+
+    const snapshot::Primitive primitive {
+        .geometry = triangle,
+        .material = material,
+        .type = uint32_t(RenderableManager::PrimitiveType::TRIANGLES),
+        .count = 3,
+        .maxIndex = 2
+    };
+    writer.addRenderable({
+        .node = child,
+        .layerMask = 0x1,
+        .priority = 4,
+        .flags = snapshot::RECEIVE_SHADOWS | snapshot::CULLING,
+        .aabb = unitBox
+    }, &primitive, 1);
+
+    // The buffers are uploaded from the serialized data, which must outlive them
+    std::vector<uint8_t> data = writer.serialize();
+    int released = 0;
+    MeshReader::MaterialRegistry materials;
+    MaterialInstance* mi = engine->getDefaultMaterial()->createInstance();
+    materials["DefaultMaterial"] = mi;
+    auto scene = SnapshotReader::loadFromBuffer(engine, data.data(), data.size(),
+            [](void*, size_t, void* user) { (*(int*) user)++; }, &released, materials);
+    ASSERT_EQ(scene.entities.size(), 3);
+    EXPECT_EQ(scene.vertexBuffers.size(), 1);
+    EXPECT_EQ(scene.indexBuffers.size(), 1);
+
+    auto& tcm = engine->getTransformManager();
+    auto leaf = tcm.getInstance(scene.entities[2]);
+    const float3 position = tcm.getWorldTransform(leaf)[3].xyz;
+    EXPECT_FLOAT_EQ(position.x, 1.0f);
+    EXPECT_FLOAT_EQ(position.y, 2.0f);
+    EXPECT_FLOAT_EQ(position.z, 3.0f);
+
+    auto& rm = engine->getRenderableManager();
+    EXPECT_FALSE(rm.getInstance(scene.entities[0]));
+    auto inst = rm.getInstance(scene.entities[1]);
+    ASSERT_TRUE(inst);
+    EXPECT_EQ(rm.getPrimitiveCount(inst), 1);
+
+    // The data is released only once, after all the buffers are uploaded
+    Fence::waitAndDestroy(engine->createFence());
+    EXPECT_EQ(released, 1);
+
+    // A snapshot of another version is rejected
+    data[sizeof(snapshot::MAGICID)] = 0;
+    auto invalid = SnapshotReader::loadFromBuffer(engine, data.data(), data.size(),
+            nullptr, nullptr, materials);
+    EXPECT_TRUE(invalid.entities.empty());
+    data[sizeof(snapshot::MAGICID)] = uint8_t(snapshot::VERSION);
+
+    // Geometries and primitives that reference data out of their buffers are rejected
+    auto const& header = *(snapshot::Header const*)(data.data() + sizeof(snapshot::MAGICID));
+    auto isRejected = [&](auto corrupt) {
+        std::vector<uint8_t> corrupted = data;
+        corrupt(*(snapshot::Geometry*)(corrupted.data() + header.offsetGeometries),
+                *(snapshot::Primitive*)(corrupted.data() + header.offsetPrimitives));
+        auto loaded = SnapshotReader::loadFromBuffer(engine, corrupted.data(), corrupted.size(),
+                nullptr, nullptr, materials);
+        return loaded.entities.empty();
+    };
+    using G = snapshot::Geometry;
+    using P = snapshot::Primitive;
+    EXPECT_TRUE(isRejected([](G& g, P&) { g.sizeVertices = 2 * sizeof(half4); }));
+    EXPECT_TRUE(isRejected([](G& g, P&) { g.attributes[0].offset = sizeof(half4); }));
+    EXPECT_TRUE(isRejected([](G& g, P&) { g.attributes[0].stride = 2 * sizeof(half4); }));
+    EXPECT_TRUE(isRejected([](G& g, P&) { g.attributes[0].type = 0xff; }));
+    EXPECT_TRUE(isRejected([](G& g, P&) { g.attributes[0].attribute = 0xff; }));
+    EXPECT_TRUE(isRejected([](G& g, P&) { g.sizeIndices = sizeof(uint16_t); }));
+    EXPECT_TRUE(isRejected([](G& g, P&) { g.indexType = 2; }));
+    EXPECT_TRUE(isRejected([](G& g, P&) { g.indexType = snapshot::UI32; }));
+    EXPECT_TRUE(isRejected([](G&, P& p) { p.offset = 1; }));
+    EXPECT_TRUE(isRejected([](G&, P& p) { p.count = 4; }));
+    EXPECT_TRUE(isRejected([](G&, P& p) { p.minIndex = 3; }));
+    EXPECT_TRUE(isRejected([](G&, P& p) { p.maxIndex = 3; }));
+    EXPECT_TRUE(isRejected([](G&, P& p) { p.type = 2; }));
+
+    // Cleanup.
+    SnapshotReader::destroy(engine, scene);
+    engine->destroy(mi);
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -22,6 +22,9 @@
 
 #include <image/KtxBundle.h>
 
+#include <stdlib.h>
+#include <string.h>
+
 namespace image {
 
 /**
@@ -159,6 +162,92 @@ namespace KtxUtility {
         return createTexture(engine, *ktx, srgb, rgbm, freeKtx, ktx);
     }
 
+    /**
+     * Provides the miplevels of a 2D KTX bundle to a streamed texture. Each level is copied
+     * out of the bundle when it's requested, so the uploads never refer to the bundle.
+     */
+    class KtxStreamingSource : public Texture::StreamingSource {
+    public:
+        KtxStreamingSource(KtxBundle* ktx, bool rgbm) : mKtx(ktx), mRgbm(rgbm) {}
+
+        ~KtxStreamingSource() override {
+            delete mKtx;
+        }
+
+        size_t getLevelSize(size_t level) const noexcept override {
+            uint8_t* data;
+            uint32_t size;
+            return mKtx->getBlob({ uint32_t(level), 0, 0 }, &data, &size) ? size : 0;
+        }
+
+        PixelBufferDescriptor getLevel(size_t level) noexcept override {
+            uint8_t* data = nullptr;
+            uint32_t size = 0;
+            void* copy = nullptr;
+            if (mKtx->getBlob({ uint32_t(level), 0, 0 }, &data, &size)) {
+                copy = malloc(size);
+                memcpy(copy, data, size);
+            }
+
+            auto freeCopy = [](void* buffer, size_t, void*) { free(buffer); };
+            const auto& ktxinfo = mKtx->getInfo();
+            if (isCompressed(ktxinfo)) {
+                return PixelBufferDescriptor(copy, size,
+                        toCompressedPixelDataType(ktxinfo), size, freeCopy);
+            }
+            return PixelBufferDescriptor(copy, size,
+                    toPixelDataFormat(ktxinfo, mRgbm), toPixelDataType(ktxinfo), freeCopy);
+        }
+
+    private:
+        KtxBundle* const mKtx;
+        const bool mRgbm;
+    };
+
+    /**
+     * Creates a Texture object from a KTX bundle, and streams its miplevels as they're needed
+     * on screen. Only the coarsest miplevels are uploaded right away. The bundle is destroyed
+     * with the texture.
+     *
+     * Cubemaps can't be streamed, all their miplevels are uploaded like createTexture() does.
+     *
+     * @param engine Used to create the Filament Texture
+     * @param ktx In-memory representation of a KTX file
+     * @param srgb Forces the KTX-specified format into an SRGB format if possible
+     * @param rgbm Interpret alpha as an HDR multiplier
+     * @param uvDensity How many times the texture repeats across the renderables using it
+     *
+     * @see Texture::setStreamingSource()
+     */
+    inline Texture* createStreamingTexture(Engine* engine, KtxBundle* ktx, bool srgb, bool rgbm,
+            float uvDensity = 1.0f) {
+        if (ktx->isCubemap()) {
+            return createTexture(engine, ktx, srgb, rgbm);
+        }
+
+        auto texformat = toTextureFormat(ktx->getInfo());
+        if (srgb) {
+            if (texformat == Texture::InternalFormat::RGB8) {
+                texformat = Texture::InternalFormat::SRGB8;
+            }
+            if (texformat == Texture::InternalFormat::RGBA8) {
+                texformat = Texture::InternalFormat::SRGB8_A8;
+            }
+        }
+
+        Texture* texture = Texture::Builder()
+            .width(ktx->getInfo().pixelWidth)
+            .height(ktx->getInfo().pixelHeight)
+            .levels(ktx->getNumMipLevels())
+            .sampler(Texture::Sampler::SAMPLER_2D)
+            .rgbm(rgbm)
+            .format(texformat)
+            .build(*engine);
+
+        texture->setStreamingSource(*engine, new KtxStreamingSource(ktx, rgbm), uvDensity);
+        return texture;
+    }
+
     template<typename T>
     T toCompressedFilamentEnum(uint32_t format) {
         switch (format) {
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PerformanceCounters.h"
+
+#include <utils/compiler.h>
+#include <utils/Entity.h>
+#include <utils/EntityIndexMap.h>
+#include <utils/EntityManager.h>
+
+#include <tsl/robin_map.h>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace utils;
+
+// Compares the Entity -> Instance lookup of a robin_map (what component managers used to do)
+// with the direct-indexed EntityIndexMap. Half of the entities have a component, and lookups
+// are done in a random order, which is typical of FScene::prepare().
+class EntityLookup : public benchmark::Fixture {
+public:
+    void SetUp(benchmark::State& state) override;
+    void TearDown(benchmark::State& state) override;
+
+protected:
+    std::vector<Entity> entities;
+    tsl::robin_map<Entity, uint32_t> robinMap;
+    EntityIndexMap<uint32_t>* indexMap = nullptr;
+};
+
+void EntityLookup::SetUp(benchmark::State& state) {
+    EntityManager& em = EntityManager::get();
+    entities.resize(size_t(state.range(0)));
+    em.create(entities.size(), entities.data());
+    indexMap = new EntityIndexMap<uint32_t>();
+    for (size_t i = 0; i < entities.size(); i += 2) {
+        robinMap[entities[i]] = uint32_t(i + 1);
+        indexMap->set(entities[i], uint32_t(i + 1));
+    }
+    std::default_random_engine gen{123};
+    std::shuffle(entities.begin(), entities.end(), gen);
+}
+
+void EntityLookup::TearDown(benchmark::State& state) {
+    EntityManager::get().destroy(entities.size(), entities.data());
+    entities.clear();
+    robinMap.clear();
+    delete indexMap;
+    indexMap = nullptr;
+}
+
+BENCHMARK_DEFINE_F(EntityLookup, robinMap)(benchmark::State& state) {
+    Entity const* const UTILS_RESTRICT e = entities.data();
+    const size_t count = entities.size();
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            for (size_t i = 0; i < count; i++) {
+                auto pos = robinMap.find(e[i]);
+                uint32_t instance = pos != robinMap.end() ? pos->second : 0;
+                benchmark::DoNotOptimize(instance);
+            }
+        }
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(count));
+}
+
+BENCHMARK_DEFINE_F(EntityLookup, indexMap)(benchmark::State& state) {
+    Entity const* const UTILS_RESTRICT e = entities.data();
+    const size_t count = entities.size();
+    EntityIndexMap<uint32_t> const& map = *indexMap;
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            for (size_t i = 0; i < count; i++) {
+                uint32_t instance = map.get(e[i]);
+                benchmark::DoNotOptimize(instance);
+            }
+        }
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(count));
+}
+
+BENCHMARK_REGISTER_F(EntityLookup, robinMap)->Range(64, 64 << 10);
+BENCHMARK_REGISTER_F(EntityLookup, indexMap)->Range(64, 64 << 10);
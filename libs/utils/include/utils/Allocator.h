@@ -492,6 +492,7 @@ struct Untracked {
 
 // This high watermark tracker works only with allocator that either implement
 // free(void*, size_t), or reset() / rewind()
+// It only costs an add and a compare per allocation, so it can be used in release builds.
 
 struct HighWatermark {
     HighWatermark() noexcept = default;
@@ -507,6 +508,10 @@ struct HighWatermark {
     void onReset() noexcept {  mCurrent = 0; }
     void onRewind(void const* addr) noexcept { mCurrent = uint32_t(uintptr_t(addr) - uintptr_t(mBase)); }
 
+    size_t getSize() const noexcept { return mSize; }
+    size_t getCurrent() const noexcept { return mCurrent; }
+    size_t getHighWatermark() const noexcept { return mHighWaterMark; }
+
 private:
     const char* mName = nullptr;
     void* mBase = nullptr;
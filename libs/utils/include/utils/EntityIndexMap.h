@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_UTILS_ENTITYINDEXMAP_H
+#define TNT_UTILS_ENTITYINDEXMAP_H
+
+#include <utils/compiler.h>
+#include <utils/Entity.h>
+#include <utils/EntityManager.h>
+
+#include <tsl/robin_map.h>
+
+#include <type_traits>
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace utils {
+
+/*
+ * A map from Entity to a small trivial value (typically a component instance), directly
+ * indexed by the Entity's index.
+ *
+ * Entries are stored in pages of PAGE_SIZE entries, allocated the first time an Entity of
+ * that range is inserted. A lookup is two dependent loads and a compare, with no hashing
+ * and no probing.
+ *
+ * Each entry remembers the full identity of its Entity, so that a destroyed Entity never
+ * aliases a newer one with the same index. Because components of destroyed entities are often
+ * garbage-collected lazily, two entities can be mapped with the same index at the same time;
+ * in that case the newest one stays in the table and the older (dead) ones are moved to a
+ * small overflow map, which is only looked at when it's not empty.
+ */
+template<typename T>
+class EntityIndexMap {
+    static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+
+    static constexpr size_t PAGE_SHIFT = 9;
+    static constexpr size_t PAGE_SIZE = 1u << PAGE_SHIFT;
+    static constexpr size_t PAGE_MASK = PAGE_SIZE - 1u;
+    static constexpr size_t PAGE_COUNT =
+            (EntityManager::RAW_INDEX_COUNT + PAGE_SIZE - 1) >> PAGE_SHIFT;
+
+    struct Entry {
+        Entity entity; // null when the entry is empty, the null entity is never stored
+        T value;
+    };
+
+public:
+    EntityIndexMap() noexcept = default;
+
+    ~EntityIndexMap() noexcept {
+        for (Entry* page : mPages) {
+            delete [] page;
+        }
+    }
+
+    // not copyable
+    EntityIndexMap(EntityIndexMap const& rhs) = delete;
+    EntityIndexMap& operator=(EntityIndexMap const& rhs) = delete;
+
+    // returns the value associated to e or a default-initialized T
+    T get(Entity e) const noexcept {
+        const size_t index = EntityManager::getIndex(e);
+        Entry const* const page = mPages[index >> PAGE_SHIFT];
+        if (UTILS_LIKELY(page)) {
+            Entry const& entry = page[index & PAGE_MASK];
+            if (UTILS_LIKELY(entry.entity == e)) {
+                return entry.value;
+            }
+        }
+        return UTILS_LIKELY(mOverflow.empty()) ? T{} : getOverflow(e);
+    }
+
+    // associates a value to e, replaces the existing value if any
+    void set(Entity e, T value) {
+        assert(!e.isNull());
+        const size_t index = EntityManager::getIndex(e);
+        Entry*& page = mPages[index >> PAGE_SHIFT];
+        if (UTILS_UNLIKELY(!page)) {
+            page = new Entry[PAGE_SIZE]();
+            mPageCount++;
+        }
+        Entry& entry = page[index & PAGE_MASK];
+        if (UTILS_LIKELY(entry.entity == e || entry.entity.isNull())) {
+            entry = { e, value };
+            return;
+        }
+        auto pos = mOverflow.find(e);
+        if (pos != mOverflow.end()) {
+            // updating an older entity that lives in the overflow map
+            pos.value() = value;
+            return;
+        }
+        // a new entity reuses the index of an older one, which must have been destroyed
+        // already; the older one is moved out of the way.
+        mOverflow[entry.entity] = entry.value;
+        entry = { e, value };
+    }
+
+    // removes e from the map, returns whether it was found
+    bool erase(Entity e) noexcept {
+        const size_t index = EntityManager::getIndex(e);
+        Entry* const page = mPages[index >> PAGE_SHIFT];
+        if (page) {
+            Entry& entry = page[index & PAGE_MASK];
+            if (!e.isNull() && entry.entity == e) {
+                entry = {};
+                return true;
+            }
+        }
+        return mOverflow.erase(e) != 0;
+    }
+
+    // bytes allocated by the map, pages are never freed
+    size_t getMemorySize() const noexcept {
+        return sizeof(mPages) + mPageCount * PAGE_SIZE * sizeof(Entry) +
+                mOverflow.bucket_count() * sizeof(std::pair<Entity, T>);
+    }
+
+private:
+    UTILS_NOINLINE
+    T getOverflow(Entity e) const noexcept {
+        auto pos = mOverflow.find(e);
+        return pos != mOverflow.end() ? pos->second : T{};
+    }
+
+    Entry* mPages[PAGE_COUNT] = {};
+    size_t mPageCount = 0;
+    tsl::robin_map<Entity, T> mOverflow;
+};
+
+} // namespace utils
+
+#endif // TNT_UTILS_ENTITYINDEXMAP_H
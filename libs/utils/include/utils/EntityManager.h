@@ -24,6 +24,9 @@
 
 namespace utils {
 
+template<typename T>
+class EntityIndexMap;
+
 class EntityManager {
 public:
     // Get the global EntityManager. Is is recommended to cache this value.
@@ -91,6 +94,7 @@ public:
 
 private:
     friend class EntityManagerImpl;
+    template<typename T> friend class EntityIndexMap;
     EntityManager();
     ~EntityManager();
 
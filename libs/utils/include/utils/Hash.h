@@ -44,6 +44,18 @@ inline uint32_t murmur3(const uint32_t* key, size_t wordCount, uint32_t seed) {
     return h;
 }
 
+// 64-bits FNV-1a, hashes byte streams of any size. The seed allows chaining several calls.
+inline uint64_t fnv1a64(const void* data, size_t size,
+        uint64_t seed = 0xcbf29ce484222325ull) noexcept {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    uint64_t h = seed;
+    for (size_t i = 0; i < size; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
 template<typename T>
 struct MurmurHashFn {
     uint32_t operator()(const T& key) const {
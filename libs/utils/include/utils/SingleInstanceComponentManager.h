@@ -19,11 +19,10 @@
 
 #include <utils/compiler.h>
 #include <utils/Entity.h>
+#include <utils/EntityIndexMap.h>
 #include <utils/EntityManager.h>
 #include <utils/StructureOfArrays.h>
 
-#include <tsl/robin_map.h>
-
 #include <assert.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -86,12 +85,19 @@ public:
     }
 
     // Get instance of this Entity to be used to retrieve components
-    UTILS_NOINLINE
     Instance getInstance(Entity e) const noexcept {
+        return mInstanceMap.get(e);
+    }
+
+    // Get the instances of 'count' entities at once. Entities without a component of this
+    // manager get a null instance. I is any type constructible from an Instance.
+    template<typename I>
+    void getInstances(Entity const* UTILS_RESTRICT entities, I* UTILS_RESTRICT instances,
+            size_t count) const noexcept {
         auto const& map = mInstanceMap;
-        // find() generates quite a bit of code
-        auto pos = map.find(e);
-        return pos != map.end() ? pos->second : 0;
+        for (size_t i = 0; i < count; i++) {
+            instances[i] = I(map.get(entities[i]));
+        }
     }
 
     // returns the number of components (i.e. size of each arrays)
@@ -104,6 +110,16 @@ public:
         return getComponentCount() == 0;
     }
 
+    // bytes used by the components, including the map from entities to instances
+    size_t getMemoryUsed() const noexcept {
+        return SoA::getNeededSize(mData.size()) + mInstanceMap.getMemorySize();
+    }
+
+    // bytes allocated for the components, used or not
+    size_t getMemoryReserved() const noexcept {
+        return SoA::getNeededSize(mData.capacity()) + mInstanceMap.getMemorySize();
+    }
+
     // returns a pointer to the Entity array. This is basically the list
     // of entities this component manager handles.
     // The pointer becomes invalid when adding or removing a component.
@@ -115,6 +131,15 @@ public:
         return elementAt<ENTITY_INDEX>(i);
     }
 
+    // Pre-allocates storage for count components in total, so that adding them doesn't
+    // reallocate the arrays. This invalidates all pointers components.
+    void reserve(size_t count) {
+        // +1 for the dummy component at index 0
+        if (count + 1 > mData.capacity()) {
+            mData.setCapacity(count + 1);
+        }
+    }
+
     // Add a component to the given Entity. If the entity already has a component from this
     // manager, this function is a no-op.
     // This invalidates all pointers components.
@@ -222,10 +247,10 @@ protected:
             Entity& ej = elementAt<ENTITY_INDEX>(j);
             std::swap(ei, ej);
             if (ei) {
-                map[ei] = i;
+                map.set(ei, i);
             }
             if (ej) {
-                map[ej] = j;
+                map.set(ej, j);
             }
         }
     }
@@ -256,7 +281,7 @@ protected:
 
 private:
     // maps an entity to an instance index
-    tsl::robin_map<Entity, Instance> mInstanceMap;
+    EntityIndexMap<Instance> mInstanceMap;
     default_random_engine mRng;
 };
 
@@ -271,10 +296,10 @@ SingleInstanceComponentManager<Elements ...>::addComponent(Entity e) {
             mData.push_back().template back<ENTITY_INDEX>() = e;
             // index 0 is used when the component doesn't exist
             ci = Instance(mData.size() - 1);
-            mInstanceMap[e] = ci;
+            mInstanceMap.set(e, ci);
         } else {
             // if the entity already has this component, just return its instance
-            ci = mInstanceMap[e];
+            ci = mInstanceMap.get(e);
         }
     }
     assert(ci != 0);
@@ -286,10 +311,8 @@ template <typename ... Elements>
 typename SingleInstanceComponentManager<Elements ...>::Instance
 SingleInstanceComponentManager<Elements ... >::removeComponent(Entity e) {
     auto& map = mInstanceMap;
-    auto pos = map.find(e);
-    if (UTILS_LIKELY(pos != map.end())) {
-        size_t index = pos->second;
-        assert(index != 0);
+    const Instance index = map.get(e);
+    if (UTILS_LIKELY(index != 0)) {
         size_t last = mData.size() - 1;
         if (last != index) {
             // move the last item to where we removed this component, as to keep
@@ -299,10 +322,10 @@ SingleInstanceComponentManager<Elements ... >::removeComponent(Entity e) {
             });
 
             Entity lastEntity = mData.template elementAt<ENTITY_INDEX>(index);
-            map[lastEntity] = index;
+            map.set(lastEntity, index);
         }
         mData.pop_back();
-        map.erase(pos);
+        map.erase(e);
         return last;
     }
     return 0;
@@ -24,10 +24,11 @@
 #define SYSTRACE_TAG_JOBSYSTEM      (1<<2)
 
 
-#if defined(ANDROID)
+#if defined(ANDROID) || defined(__linux__) || defined(__APPLE__)
 
 #include <atomic>
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <unistd.h>
@@ -94,6 +95,34 @@
 #define SYSTRACE_VALUE64(name, val) \
         ___tracer.value(SYSTRACE_TAG, name, int64_t(val))
 
+#if defined(ANDROID)
+
+// on Android the events are recorded by systrace
+#define SYSTRACE_START_RECORDING(eventsPerThread)
+#define SYSTRACE_STOP_RECORDING()
+#define SYSTRACE_DUMP(path)
+
+#else
+
+/**
+ * Starts recording the events of the enabled tags in memory, in a ring buffer of
+ * eventsPerThread events for each thread (rounded up to a power of two).
+ * Recording also starts when tracing is first enabled if the FILAMENT_SYSTRACE environment
+ * variable is set, in which case the events are dumped to the file it names at exit.
+ */
+#define SYSTRACE_START_RECORDING(eventsPerThread) \
+        ::utils::details::Systrace::startRecording(eventsPerThread)
+
+#define SYSTRACE_STOP_RECORDING() ::utils::details::Systrace::stopRecording()
+
+/**
+ * Writes the events recorded so far to the file at path, in the Chrome trace-event JSON format
+ * which can be opened with chrome://tracing or ui.perfetto.dev.
+ */
+#define SYSTRACE_DUMP(path) ::utils::details::Systrace::dump(path)
+
+#endif
+
 // ------------------------------------------------------------------------------------------------
 // No user serviceable code below...
 // ------------------------------------------------------------------------------------------------
@@ -101,6 +130,8 @@
 namespace utils {
 namespace details {
 
+#if defined(ANDROID)
+
 class Systrace {
 public:
 
@@ -189,6 +220,85 @@ private:
     static bool isTracingEnabled(uint32_t tag) noexcept;
 };
 
+#else // !ANDROID
+
+/*
+ * Events are recorded in memory, in a lock-free ring buffer per thread, and written as Chrome
+ * trace-event JSON on demand. When nothing is recording, a trace point costs a relaxed load
+ * and a branch.
+ */
+class Systrace {
+public:
+
+    enum tags {
+        NEVER       = SYSTRACE_TAG_NEVER,
+        ALWAYS      = SYSTRACE_TAG_ALWAYS,
+        FILAMENT    = SYSTRACE_TAG_FILAMENT,
+        JOBSYSTEM   = SYSTRACE_TAG_JOBSYSTEM
+        // we could define more TAGS here, as we need them.
+    };
+
+    Systrace(uint32_t tag) noexcept
+            : mIsTracingEnabled(tag && (sRecordedTags.load(std::memory_order_relaxed) & tag)) {
+    }
+
+    static void enable(uint32_t tags) noexcept;
+    static void disable(uint32_t tags) noexcept;
+
+    static void startRecording(size_t eventsPerThread) noexcept;
+    static void stopRecording() noexcept;
+    static bool dump(const char* path) noexcept;
+
+    inline void asyncBegin(uint32_t tag, const char* name, int32_t cookie) noexcept {
+        if (tag && UTILS_UNLIKELY(mIsTracingEnabled)) {
+            record('b', name, cookie);
+        }
+    }
+
+    inline void asyncEnd(uint32_t tag, const char* name, int32_t cookie) noexcept {
+        if (tag && UTILS_UNLIKELY(mIsTracingEnabled)) {
+            record('e', name, cookie);
+        }
+    }
+
+    inline void value(uint32_t tag, const char* name, int32_t value) noexcept {
+        if (tag && UTILS_UNLIKELY(mIsTracingEnabled)) {
+            record('C', name, value);
+        }
+    }
+
+    inline void value(uint32_t tag, const char* name, int64_t value) noexcept {
+        if (tag && UTILS_UNLIKELY(mIsTracingEnabled)) {
+            record('C', name, value);
+        }
+    }
+
+private:
+    friend class ScopedTrace;
+
+    inline void traceBegin(uint32_t tag, const char* name) noexcept {
+        if (tag && UTILS_UNLIKELY(mIsTracingEnabled)) {
+            record('B', name, 0);
+        }
+    }
+
+    inline void traceEnd(uint32_t tag) noexcept {
+        if (tag && UTILS_UNLIKELY(mIsTracingEnabled)) {
+            record('E', nullptr, 0);
+        }
+    }
+
+    // type is the phase of the event in the trace-event format
+    static void record(char type, const char* name, int64_t value) noexcept;
+
+    // the enabled tags while recording, 0 otherwise
+    static std::atomic<uint32_t> sRecordedTags;
+
+    const bool mIsTracingEnabled;
+};
+
+#endif // ANDROID
+
 // ------------------------------------------------------------------------------------------------
 
 class ScopedTrace {
@@ -219,7 +329,7 @@ private:
 } // namespace utils
 
 // ------------------------------------------------------------------------------------------------
-#else // !ANDROID
+#else // !(ANDROID || __linux__ || __APPLE__)
 // ------------------------------------------------------------------------------------------------
 
 #define SYSTRACE_ENABLE()
@@ -231,7 +341,10 @@ private:
 #define SYSTRACE_ASYNC_END(name, cookie)
 #define SYSTRACE_VALUE32(name, val)
 #define SYSTRACE_VALUE64(name, val)
+#define SYSTRACE_START_RECORDING(eventsPerThread)
+#define SYSTRACE_STOP_RECORDING()
+#define SYSTRACE_DUMP(path)
 
-#endif // ANDROID
+#endif // ANDROID || __linux__ || __APPLE__
 
 #endif // TNT_UTILS_SYSTRACE_H
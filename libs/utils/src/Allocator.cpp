@@ -126,10 +126,12 @@ AtomicFreeList::AtomicFreeList(void* begin, void* end,
 }
 
 TrackingPolicy::HighWatermark::~HighWatermark() noexcept {
+#ifndef NDEBUG
     size_t wm = mHighWaterMark;
     size_t wmpct = wm / (mSize / 100);
     slog.d << mName << " arena: High watermark "
            << wm / 1024 << " KiB (" << wmpct << "%)" << io::endl;
+#endif
 }
 
 } // namespace utils
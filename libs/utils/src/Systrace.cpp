@@ -138,4 +138,247 @@ void Systrace::init(uint32_t tag) noexcept {
 } // namespace details
 } // namespace utils
 
+#elif defined(__linux__) || defined(__APPLE__)
+
+#include <utils/Mutex.h>
+#include <utils/ThreadLocal.h>
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <pthread.h>
+#include <stdlib.h>
+
+namespace utils {
+namespace details {
+
+namespace {
+
+struct EventData {
+    int64_t time;       // in ns
+    const char* name;
+    int64_t value;      // value of a counter, or cookie of an async event
+    char type;
+};
+
+// A slot of the ring buffer. seq is the index of the event it holds plus one, or 0 while the
+// event is being written. It is written last, so that dump() can tell whether the event it
+// copied was overwritten in the meantime.
+struct Event {
+    EventData data;
+    std::atomic<uint64_t> seq = { 0 };
+};
+
+// The events of a thread. Only its thread writes to it, without locking, and the events can be
+// read at any time by dump(). The events outlive the thread, so they can be dumped later.
+struct ThreadEvents {
+    ThreadEvents(size_t capacity, uint32_t tid) noexcept
+            : events(new Event[capacity]), capacity(capacity), tid(tid) {
+    }
+    const std::unique_ptr<Event[]> events;
+    const size_t capacity;                  // a power of two
+    std::atomic<uint64_t> head = { 0 };     // number of events ever written
+    const uint32_t tid;
+    char name[32] = {};
+};
+
+struct Recorder {
+    Recorder() noexcept {
+        const char* path = getenv("FILAMENT_SYSTRACE");
+        if (path && *path) {
+            exitPath = path;
+            recording = true;
+            start = now();
+            atexit([]() { Systrace::dump(get().exitPath); });
+        }
+    }
+
+    // never destroyed, threads may still record while the process exits
+    static Recorder& get() noexcept {
+        static Recorder* const recorder = new Recorder;
+        return *recorder;
+    }
+
+    static int64_t now() noexcept {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    Mutex lock;
+    std::vector<std::unique_ptr<ThreadEvents>> threads;
+    size_t eventsPerThread = 64 * 1024;
+    uint32_t enabledTags = 0;
+    bool recording = false;
+    int64_t start = 0;                      // events recorded before this aren't dumped
+    const char* exitPath = nullptr;
+};
+
+UTILS_DEFINE_TLS(ThreadEvents*) sThreadEvents(nullptr);
+
+ThreadEvents* createThreadEvents() noexcept {
+    Recorder& recorder = Recorder::get();
+    std::lock_guard<Mutex> guard(recorder.lock);
+    ThreadEvents* events = new ThreadEvents(recorder.eventsPerThread,
+            uint32_t(recorder.threads.size() + 1));
+    pthread_getname_np(pthread_self(), events->name, sizeof(events->name));
+    recorder.threads.emplace_back(events);
+    return events;
+}
+
+// must be called with the lock held
+uint32_t getRecordedTags(Recorder const& recorder) noexcept {
+    return recorder.recording ? (recorder.enabledTags | SYSTRACE_TAG_ALWAYS) : 0;
+}
+
+void writeString(FILE* file, const char* s) noexcept {
+    fputc('"', file);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') {
+            fputc('\\', file);
+        }
+        if (uint8_t(*s) >= 0x20) {
+            fputc(*s, file);
+        }
+    }
+    fputc('"', file);
+}
+
+} // anonymous namespace
+
+std::atomic<uint32_t> Systrace::sRecordedTags = { 0 };
+
+void Systrace::enable(uint32_t tags) noexcept {
+    Recorder& recorder = Recorder::get();
+    std::lock_guard<Mutex> guard(recorder.lock);
+    recorder.enabledTags |= tags;
+    sRecordedTags.store(getRecordedTags(recorder), std::memory_order_relaxed);
+}
+
+void Systrace::disable(uint32_t tags) noexcept {
+    Recorder& recorder = Recorder::get();
+    std::lock_guard<Mutex> guard(recorder.lock);
+    recorder.enabledTags &= ~tags;
+    sRecordedTags.store(getRecordedTags(recorder), std::memory_order_relaxed);
+}
+
+void Systrace::startRecording(size_t eventsPerThread) noexcept {
+    Recorder& recorder = Recorder::get();
+    std::lock_guard<Mutex> guard(recorder.lock);
+    // only applies to the threads that haven't recorded anything yet
+    size_t capacity = 1;
+    while (capacity < eventsPerThread) {
+        capacity *= 2;
+    }
+    recorder.eventsPerThread = capacity;
+    recorder.recording = true;
+    recorder.start = Recorder::now();
+    sRecordedTags.store(getRecordedTags(recorder), std::memory_order_relaxed);
+}
+
+void Systrace::stopRecording() noexcept {
+    Recorder& recorder = Recorder::get();
+    std::lock_guard<Mutex> guard(recorder.lock);
+    recorder.recording = false;
+    sRecordedTags.store(getRecordedTags(recorder), std::memory_order_relaxed);
+}
+
+void Systrace::record(char type, const char* name, int64_t value) noexcept {
+    ThreadEvents* events = sThreadEvents;
+    if (UTILS_UNLIKELY(!events)) {
+        events = createThreadEvents();
+        sThreadEvents = events;
+    }
+    const uint64_t head = events->head.load(std::memory_order_relaxed);
+    Event& event = events->events[head & (events->capacity - 1)];
+    event.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    event.data = { Recorder::now(), name, value, type };
+    // publishes the event to dump()
+    event.seq.store(head + 1, std::memory_order_release);
+    events->head.store(head + 1, std::memory_order_release);
+}
+
+bool Systrace::dump(const char* path) noexcept {
+    Recorder& recorder = Recorder::get();
+    std::lock_guard<Mutex> guard(recorder.lock);
+
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        slog.e << "Couldn't create the trace " << path << io::endl;
+        return false;
+    }
+
+    const int pid = getpid();
+    const int64_t start = recorder.start;
+    bool first = true;
+    auto separator = [file, &first]() {
+        fputs(first ? "\n" : ",\n", file);
+        first = false;
+    };
+
+    fputs("{\"traceEvents\":[", file);
+    std::vector<EventData> events;
+    for (auto const& thread : recorder.threads) {
+        const size_t capacity = thread->capacity;
+        const uint64_t end = thread->head.load(std::memory_order_acquire);
+        const uint64_t begin = end > capacity ? end - capacity : 0;
+        events.clear();
+        for (uint64_t i = begin; i < end; i++) {
+            Event const& event = thread->events[i & (capacity - 1)];
+            const uint64_t seq = event.seq.load(std::memory_order_acquire);
+            const EventData data = event.data;
+            // the thread may be overwriting the oldest events while we copy them
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq == i + 1 && event.seq.load(std::memory_order_relaxed) == seq) {
+                events.push_back(data);
+            }
+        }
+
+        separator();
+        fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,"
+                "\"args\":{\"name\":", pid, thread->tid);
+        writeString(file, thread->name);
+        fputs("}}", file);
+
+        // ends of scopes whose beginning isn't in the buffer are skipped
+        size_t depth = 0;
+        for (EventData const& e : events) {
+            if (e.time < start) {
+                continue;
+            }
+            if (e.type == 'B') {
+                depth++;
+            } else if (e.type == 'E') {
+                if (!depth) {
+                    continue;
+                }
+                depth--;
+            }
+            separator();
+            fprintf(file, "{\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%u",
+                    e.type, double(e.time - start) * 1e-3, pid, thread->tid);
+            if (e.name) {
+                fputs(",\"name\":", file);
+                writeString(file, e.name);
+            }
+            if (e.type == 'C') {
+                fprintf(file, ",\"args\":{\"value\":%lld}", (long long)e.value);
+            } else if (e.type == 'b' || e.type == 'e') {
+                fprintf(file, ",\"cat\":\"async\",\"id\":%lld", (long long)e.value);
+            }
+            fputc('}', file);
+        }
+    }
+    fputs("\n],\"displayTimeUnit\":\"ns\"}\n", file);
+
+    const bool success = !ferror(file);
+    fclose(file);
+    return success;
+}
+
+} // namespace details
+} // namespace utils
+
 #endif // ANDROID
@@ -284,6 +284,30 @@ TEST(AllocatorTest, ScopedStackArena) {
     allocator.getAllocator().reset();
 }
 
+TEST(AllocatorTest, HighWatermark) {
+    using Allocator = Arena<LinearAllocator, LockingPolicy::NoLock,
+            TrackingPolicy::HighWatermark>;
+    Allocator allocator("HighWatermark", 1024);
+    EXPECT_EQ(1024u, allocator.getListener().getSize());
+    EXPECT_EQ(0u, allocator.getListener().getHighWatermark());
+
+    {
+        ArenaScope<Allocator> ssa(allocator);
+        ssa.allocate(256);
+        ssa.allocate(128);
+        EXPECT_EQ(384u, allocator.getListener().getCurrent());
+    }
+    // the scope rewinds the arena
+    EXPECT_EQ(0u, allocator.getListener().getCurrent());
+
+    {
+        ArenaScope<Allocator> ssa(allocator);
+        ssa.allocate(64);
+        EXPECT_EQ(64u, allocator.getListener().getCurrent());
+    }
+    EXPECT_EQ(384u, allocator.getListener().getHighWatermark());
+}
+
 TEST(AllocatorTest, STLAllocator) {
     struct Tracking {
         Tracking() noexcept { }
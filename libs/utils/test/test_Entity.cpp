@@ -19,6 +19,7 @@
 #include <memory>
 
 #include "../src/EntityManagerImpl.h"
+#include <utils/EntityIndexMap.h>
 #include <utils/NameComponentManager.h>
 
 using namespace utils;
@@ -176,3 +177,76 @@ TEST(EntityTest, NameComponent) {
 
     cm.gc(em);
 }
+
+TEST(EntityTest, IndexMap) {
+    EntityManagerImpl em;
+    EntityIndexMap<uint32_t> map;
+
+    EXPECT_EQ(0, map.get(Entity{}));
+
+    Entity entities[1024];
+    em.create(1024, entities);
+    for (uint32_t i = 0; i < 1024; i++) {
+        map.set(entities[i], i + 1);
+    }
+    for (uint32_t i = 0; i < 1024; i++) {
+        EXPECT_EQ(i + 1, map.get(entities[i]));
+    }
+    EXPECT_EQ(0, map.get(Entity{}));
+
+    // this entity reuses the index of entities[0], with a new generation
+    em.destroy(1024, entities);
+    Entity e = em.create();
+    EXPECT_EQ(EntityManagerImpl::makeIdentity(1, 1), e.getId());
+    EXPECT_EQ(0, map.get(e));
+
+    // both the old and the new entity must be found
+    map.set(e, 42);
+    EXPECT_EQ(42, map.get(e));
+    EXPECT_EQ(1, map.get(entities[0]));
+    map.set(entities[0], 2);
+    EXPECT_EQ(42, map.get(e));
+    EXPECT_EQ(2, map.get(entities[0]));
+
+    EXPECT_TRUE(map.erase(entities[0]));
+    EXPECT_FALSE(map.erase(entities[0]));
+    EXPECT_EQ(0, map.get(entities[0]));
+    EXPECT_EQ(42, map.get(e));
+
+    EXPECT_TRUE(map.erase(e));
+    EXPECT_EQ(0, map.get(e));
+    EXPECT_EQ(2, map.get(entities[1]));
+}
+
+TEST(EntityTest, NameComponentReusedIndex) {
+    EntityManagerImpl em;
+    NameComponentManager cm(em);
+
+    Entity entities[1024];
+    em.create(1024, entities);
+    cm.addComponent(entities[0]);
+    cm.addComponent(entities[1]);
+    em.destroy(1024, entities);
+
+    // the components of dead entities are still around, a new entity reuses index 1
+    Entity e = em.create();
+    cm.addComponent(e);
+    cm.setName(cm.getInstance(e), "e");
+    EXPECT_EQ(3, cm.getComponentCount());
+
+    Entity query[] = { entities[0], e, entities[2] };
+    NameComponentManager::Instance instances[3];
+    cm.getInstances(query, instances, 3);
+    EXPECT_EQ(1, instances[0].asValue());
+    EXPECT_EQ(3, instances[1].asValue());
+    EXPECT_EQ(0, instances[2].asValue());
+
+    cm.removeComponent(entities[0]);
+    cm.removeComponent(entities[1]);
+    EXPECT_EQ(1, cm.getComponentCount());
+    EXPECT_FALSE(cm.hasComponent(entities[0]));
+    EXPECT_TRUE(cm.hasComponent(e));
+    EXPECT_STREQ("e", cm.getName(cm.getInstance(e)));
+
+    em.destroy(e);
+}
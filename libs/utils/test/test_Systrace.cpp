@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <utils/JobSystem.h>
+#include <utils/Systrace.h>
+
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace utils;
+
+static std::string dump() {
+    const char* path = "test_systrace.json";
+    EXPECT_TRUE(SYSTRACE_DUMP(path));
+    std::ifstream file(path);
+    std::stringstream json;
+    json << file.rdbuf();
+    file.close();
+    remove(path);
+    return json.str();
+}
+
+static size_t count(std::string const& s, std::string const& pattern) {
+    size_t n = 0;
+    for (size_t pos = s.find(pattern); pos != std::string::npos; pos = s.find(pattern, pos + 1)) {
+        n++;
+    }
+    return n;
+}
+
+TEST(SystraceTest, Dump) {
+    SYSTRACE_START_RECORDING(1024);
+
+    std::thread thread([]() {
+        JobSystem::setThreadName("SystraceTest");
+        SYSTRACE_NAME("worker");
+        SYSTRACE_VALUE32("counter", 42);
+    });
+    thread.join();
+
+    {
+        SYSTRACE_CONTEXT();
+        SYSTRACE_ASYNC_BEGIN("async", 7);
+        SYSTRACE_ASYNC_END("async", 7);
+    }
+
+    SYSTRACE_STOP_RECORDING();
+    {
+        SYSTRACE_NAME("ignored");
+    }
+
+    std::string json(dump());
+    EXPECT_EQ(0u, json.find("{\"traceEvents\":["));
+    EXPECT_EQ(1u, count(json, "{\"name\":\"SystraceTest\"}"));
+    EXPECT_EQ(1u, count(json, "\"ph\":\"B\","));
+    EXPECT_EQ(1u, count(json, "\"ph\":\"E\","));
+    EXPECT_EQ(1u, count(json, "\"name\":\"worker\""));
+    EXPECT_EQ(1u, count(json, "\"name\":\"counter\",\"args\":{\"value\":42}"));
+    EXPECT_EQ(2u, count(json, "\"name\":\"async\",\"cat\":\"async\",\"id\":7"));
+    EXPECT_EQ(0u, count(json, "ignored"));
+}
+
+TEST(SystraceTest, RingBuffer) {
+    // only the most recent events of each thread are kept
+    SYSTRACE_START_RECORDING(16);
+
+    std::thread thread([]() {
+        for (size_t i = 0; i < 100; i++) {
+            SYSTRACE_NAME("scope");
+        }
+    });
+    thread.join();
+
+    SYSTRACE_STOP_RECORDING();
+
+    std::string json(dump());
+    EXPECT_EQ(8u, count(json, "\"ph\":\"B\","));
+    EXPECT_EQ(8u, count(json, "\"ph\":\"E\","));
+    EXPECT_EQ(8u, count(json, "\"name\":\"scope\""));
+}
+
+TEST(SystraceTest, DumpWhileRecording) {
+    SYSTRACE_START_RECORDING(16);
+
+    std::atomic_bool done = { false };
+    std::thread thread([&done]() {
+        while (!done.load(std::memory_order_relaxed)) {
+            SYSTRACE_NAME("scope");
+        }
+    });
+
+    for (size_t i = 0; i < 100; i++) {
+        std::string json(dump());
+        // the events being overwritten by the thread are skipped, the others are in order
+        double last = 0;
+        for (size_t pos = json.find("\"ts\":"); pos != std::string::npos;
+                pos = json.find("\"ts\":", pos + 1)) {
+            const double ts = strtod(json.c_str() + pos + 5, nullptr);
+            EXPECT_LE(last, ts);
+            last = ts;
+        }
+        EXPECT_GE(16u, count(json, "\"name\":\"scope\""));
+    }
+
+    done = true;
+    thread.join();
+    SYSTRACE_STOP_RECORDING();
+}
@@ -57,6 +57,18 @@ HIGHP float getUserTimeMod(float m) {
     return mod(mod(frameUniforms.userTime.x, m) + mod(frameUniforms.userTime.y, m), m);
 }
 
+#if defined(HAS_SHADOWING) && defined(HAS_DIRECTIONAL_LIGHTING)
+/**
+ * Returns the index of the shadow cascade covering the specified world space point.
+ */
+uint getShadowCascade(const vec3 p) {
+    HIGHP float z = -(frameUniforms.viewFromWorldMatrix * vec4(p, 1.0)).z;
+    uvec4 greater = uvec4(greaterThan(vec4(z), frameUniforms.cascadeSplits));
+    uint cascade = greater.x + greater.y + greater.z + greater.w;
+    return min(cascade, frameUniforms.cascades - 1u);
+}
+#endif
+
 /** @public-api */
 float getExposure() {
     return frameUniforms.exposure;
@@ -25,6 +25,14 @@ vec2 getUV1() {
 
 #if defined(HAS_SHADOWING) && defined(HAS_DIRECTIONAL_LIGHTING)
 HIGHP vec3 getLightSpacePosition() {
+    if (frameUniforms.cascades > 1u) {
+        // vertex_lightSpacePosition is the biased world space position, see shadowing.vs
+        uint cascade = getShadowCascade(vertex_worldPosition);
+        HIGHP vec4 p = frameUniforms.lightFromWorldMatrix[cascade] *
+                vec4(vertex_lightSpacePosition.xyz, 1.0);
+        p.z -= frameUniforms.cascadeConstantBias[cascade];
+        return p.xyz * (1.0 / p.w);
+    }
     return vertex_lightSpacePosition.xyz * (1.0 / vertex_lightSpacePosition.w);
 }
 #endif
@@ -3,17 +3,29 @@
 //------------------------------------------------------------------------------
 
 mat4 getLightFromWorldMatrix() {
-    return frameUniforms.lightFromWorldMatrix;
+    return frameUniforms.lightFromWorldMatrix[0];
+}
+
+/**
+ * Returns the index of the current instance in the ObjectUniforms block. Each instance
+ * uses 4 consecutive matrices, see UibGenerator::getPerRenderableUib().
+ */
+int getInstanceIndex() {
+#if defined(CODEGEN_TARGET_VULKAN_ENVIRONMENT)
+    return gl_InstanceIndex * 4;
+#else
+    return gl_InstanceID * 4;
+#endif
 }
 
 /** @public-api */
 mat4 getWorldFromModelMatrix() {
-    return objectUniforms.worldFromModelMatrix;
+    return objectUniforms.instances[getInstanceIndex()];
 }
 
 /** @public-api */
 mat3 getWorldFromModelNormalMatrix() {
-    return objectUniforms.worldFromModelNormalMatrix;
+    return mat3(objectUniforms.instances[getInstanceIndex() + 1]);
 }
 
 //------------------------------------------------------------------------------
@@ -99,6 +99,39 @@ float getAngleAttenuation(const vec3 lightDir, const vec3 l, const vec2 scaleOff
     return attenuation * attenuation;
 }
 
+#if defined(HAS_SHADOWING)
+/**
+ * Returns the visibility of a spot or point light at the current fragment, sampled from the
+ * shadow atlas. shadowIndex is the index of the light's first tile in the atlas plus one.
+ * The 6 tiles of a point light are the faces of a cube, in the order +x, -x, +y, -y, +z, -z.
+ */
+float getPunctualLightShadow(const uint shadowIndex, const HIGHP vec3 posToLight,
+        const bool isPointLight) {
+    uint tile = shadowIndex - 1u;
+    if (isPointLight) {
+        HIGHP vec3 d = -posToLight;
+        vec3 a = abs(d);
+        if (a.x >= a.y && a.x >= a.z) {
+            tile += d.x >= 0.0 ? 0u : 1u;
+        } else if (a.y >= a.z) {
+            tile += d.y >= 0.0 ? 2u : 3u;
+        } else {
+            tile += d.z >= 0.0 ? 4u : 5u;
+        }
+    }
+
+    // the constant bias moves the position towards the light, the normal bias grows with
+    // the distance to the light, like the size of a texel of the tile
+    vec2 bias = frameUniforms.shadowAtlasBias[tile].xy;
+    HIGHP float distance = length(posToLight);
+    HIGHP vec3 p = vertex_worldPosition +
+            posToLight * (bias.x / max(distance, 1e-4)) + shading_normal * (bias.y * distance);
+
+    HIGHP vec4 lightSpace = frameUniforms.shadowAtlasFromWorldMatrix[tile] * vec4(p, 1.0);
+    return shadow(light_shadowAtlas, lightSpace.xyz * (1.0 / lightSpace.w));
+}
+#endif
+
 /**
  * Light setup common to point and spot light. This function sets the light vector
  * "l" and the attenuation factor in the Light structure. The attenuation factor
@@ -138,6 +171,14 @@ Light getSpotLight(uint index) {
 
     light.attenuation *= getAngleAttenuation(-directionIES.xyz, light.l, scaleOffset);
 
+#if defined(HAS_SHADOWING)
+    uint shadowIndex = uint(lightsUniforms.lights[lightIndex][3].z);
+    if (shadowIndex != 0u && light.attenuation > 0.0) {
+        light.attenuation *= getPunctualLightShadow(shadowIndex,
+                positionFalloff.xyz - vertex_worldPosition, false);
+    }
+#endif
+
     return light;
 }
 
@@ -162,6 +203,14 @@ Light getPointLight(uint index) {
 
     setupPunctualLight(light, positionFalloff);
 
+#if defined(HAS_SHADOWING)
+    uint shadowIndex = uint(lightsUniforms.lights[lightIndex][3].z);
+    if (shadowIndex != 0u && light.attenuation > 0.0) {
+        light.attenuation *= getPunctualLightShadow(shadowIndex,
+                positionFalloff.xyz - vertex_worldPosition, true);
+    }
+#endif
+
     return light;
 }
 
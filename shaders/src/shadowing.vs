@@ -18,6 +18,13 @@ vec4 getLightSpacePosition(const vec3 p, const vec3 n) {
     float normalBias = sqrt(1.0 - NoL * NoL);
 #endif
 
+    if (frameUniforms.cascades > 1u) {
+        // With cascades, the shadow map is chosen per fragment: only apply the normal bias of
+        // the cascade this vertex is in, the fragment shader does the projection.
+        uint cascade = getShadowCascade(p);
+        return vec4(p + n * (normalBias * frameUniforms.cascadeNormalBias[cascade]), 1.0);
+    }
+
     vec3 offsetPosition = p + n * (normalBias * frameUniforms.shadowBias.y);
     vec4 lightSpacePosition = (getLightFromWorldMatrix() * vec4(offsetPosition, 1.0));
     lightSpacePosition.z -= frameUniforms.shadowBias.x;
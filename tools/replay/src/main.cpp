@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <getopt/getopt.h>
+
+#include "driver/CaptureReplay.h"
+
+#include <filament/driver/DriverEnums.h>
+
+#include <utils/Path.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using namespace filament;
+using namespace utils;
+
+struct Config {
+    driver::Backend backend = driver::Backend::DEFAULT;
+    int iterations = 1;
+};
+
+static void printUsage(const char* name) {
+    std::string execName(utils::Path(name).getName());
+    std::string usage(
+            "REPLAY executes the driver commands captured with Engine::Config::driverCapturePath\n"
+                    "Usage:\n"
+                    "    REPLAY [options] <capture file>\n"
+                    "\n"
+                    "Options:\n"
+                    "   --help, -h\n"
+                    "       Print this message\n\n"
+                    "   --backend=<backend>, -b <backend>\n"
+                    "       Backend to replay the capture on: opengl, vulkan, metal or noop\n"
+                    "       (noop is only available in debug builds)\n\n"
+                    "   --iterations=<count>, -i <count>\n"
+                    "       Number of times the capture is replayed, default is 1\n\n"
+                    "   --license\n"
+                    "       Print copyright and license information\n\n"
+    );
+
+    const std::string from("REPLAY");
+    for (size_t pos = usage.find(from); pos != std::string::npos; pos = usage.find(from, pos)) {
+        usage.replace(pos, from.length(), execName);
+    }
+    printf("%s", usage.c_str());
+}
+
+static void license() {
+    std::cout <<
+    #include "licenses/licenses.inc"
+    ;
+}
+
+static int handleArguments(int argc, char* argv[], Config* config) {
+    static constexpr const char* OPTSTR = "hlb:i:";
+    static const struct option OPTIONS[] = {
+            { "help",       no_argument,       0, 'h' },
+            { "license",    no_argument,       0, 'l' },
+            { "backend",    required_argument, 0, 'b' },
+            { "iterations", required_argument, 0, 'i' },
+            { 0, 0, 0, 0 }  // termination of the option list
+    };
+
+    int opt;
+    int optionIndex = 0;
+
+    while ((opt = getopt_long(argc, argv, OPTSTR, OPTIONS, &optionIndex)) >= 0) {
+        std::string arg(optarg ? optarg : "");
+        switch (opt) {
+            default:
+            case 'h':
+                printUsage(argv[0]);
+                exit(0);
+            case 'l':
+                license();
+                exit(0);
+            case 'b':
+                if (arg == "opengl") {
+                    config->backend = driver::Backend::OPENGL;
+                } else if (arg == "vulkan") {
+                    config->backend = driver::Backend::VULKAN;
+                } else if (arg == "metal") {
+                    config->backend = driver::Backend::METAL;
+                } else if (arg == "noop") {
+                    config->backend = driver::Backend::NOOP;
+                } else {
+                    std::cerr << "Unrecognized backend. Must be 'opengl'|'vulkan'|'metal'|'noop'."
+                            << std::endl;
+                    exit(1);
+                }
+                break;
+            case 'i':
+                config->iterations = std::max(1, std::stoi(arg));
+                break;
+        }
+    }
+
+    return optind;
+}
+
+int main(int argc, char* argv[]) {
+    Config config;
+    int optionIndex = handleArguments(argc, argv, &config);
+
+    int numArgs = argc - optionIndex;
+    if (numArgs < 1) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    Path src(argv[optionIndex]);
+    if (!src.exists()) {
+        std::cerr << "The capture " << src << " does not exist." << std::endl;
+        return 1;
+    }
+
+    for (int i = 0; i < config.iterations; i++) {
+        CaptureReplay::Stats stats;
+        if (!CaptureReplay::replay(src.c_str(), config.backend, stats)) {
+            std::cerr << "Could not replay the capture " << src << std::endl;
+            return 1;
+        }
+
+        const double ms = 1e-6;
+        std::cout << std::fixed << std::setprecision(3)
+                << "commands: " << stats.commands
+                << ", frames: " << stats.frames
+                << ", capture: " << stats.bytes / 1024 << " KiB"
+                << ", duration: " << stats.duration * ms << " ms";
+        if (stats.frames) {
+            std::cout << ", average frame: " << stats.duration * ms / stats.frames << " ms"
+                    << ", longest frame: " << stats.longestFrame * ms << " ms";
+        }
+        std::cout << std::endl;
+    }
+
+    return 0;
+}